@@ -0,0 +1,89 @@
+// Copyright (c) 2017-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <helpers/benchmark.hpp>
+#include <helpers/workbook_generator.hpp>
+#include <xlnt/utils/exceptions.hpp>
+
+namespace {
+
+using xlnt::benchmarks::argument;
+
+void usage()
+{
+    std::cerr << "usage: benchmark-generate --output=FILE [--sheets=N] [--rows=N] [--columns=N]\n"
+              << "                          [--density=R] [--string-ratio=R] [--distinct-strings=N]\n"
+              << "                          [--styles=N] [--formula-ratio=R] [--merged-regions=N]\n"
+              << "                          [--comments=N] [--seed=N]\n\n"
+              << "Writes a synthetic workbook of the given shape to FILE. The file is streamed\n"
+              << "so it can be much larger than memory. The same options always produce the same file.\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const auto output = argument(argc, argv, "output", "");
+
+    if (xlnt::benchmarks::flag(argc, argv, "help") || output.empty())
+    {
+        usage();
+        return output.empty() ? 1 : 0;
+    }
+
+    workbook_shape shape;
+    shape.sheets = std::stoul(argument(argc, argv, "sheets", std::to_string(shape.sheets)));
+    shape.rows = std::stoul(argument(argc, argv, "rows", std::to_string(shape.rows)));
+    shape.columns = std::stoul(argument(argc, argv, "columns", std::to_string(shape.columns)));
+    shape.density = std::stod(argument(argc, argv, "density", std::to_string(shape.density)));
+    shape.string_ratio = std::stod(argument(argc, argv, "string-ratio", std::to_string(shape.string_ratio)));
+    shape.distinct_strings = std::stoul(argument(argc, argv, "distinct-strings", std::to_string(shape.distinct_strings)));
+    shape.styles = std::stoul(argument(argc, argv, "styles", std::to_string(shape.styles)));
+    shape.formula_ratio = std::stod(argument(argc, argv, "formula-ratio", std::to_string(shape.formula_ratio)));
+    shape.merged_regions = std::stoul(argument(argc, argv, "merged-regions", std::to_string(shape.merged_regions)));
+    shape.comments = std::stoul(argument(argc, argv, "comments", std::to_string(shape.comments)));
+    shape.seed = std::stoull(argument(argc, argv, "seed", std::to_string(shape.seed)));
+
+    try
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const auto totals = generate_workbook(shape, xlnt::path(output));
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cerr << "wrote " << totals.cells << " cells (" << totals.number_cells << " numbers, "
+                  << totals.string_cells << " strings, " << totals.formula_cells << " formulas), "
+                  << totals.merged_regions << " merged regions and " << totals.comments << " comments to "
+                  << output << " in " << elapsed << "s" << std::endl;
+    }
+    catch (const xlnt::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,288 @@
+// Copyright (c) 2017-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <helpers/memory.hpp>
+
+namespace xlnt {
+namespace benchmarks {
+
+/// <summary>
+/// Summary statistics of a set of samples.
+/// </summary>
+struct statistics
+{
+    std::size_t samples = 0;
+    double min = 0.0;
+    double max = 0.0;
+    double mean = 0.0;
+    double median = 0.0;
+    double stddev = 0.0;
+};
+
+inline statistics summarize(std::vector<double> samples)
+{
+    statistics result;
+    result.samples = samples.size();
+
+    if (samples.empty())
+    {
+        return result;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    result.min = samples.front();
+    result.max = samples.back();
+
+    const auto middle = samples.size() / 2;
+    result.median = samples.size() % 2 == 1 ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2;
+
+    for (auto sample : samples)
+    {
+        result.mean += sample;
+    }
+
+    result.mean /= static_cast<double>(samples.size());
+
+    if (samples.size() > 1)
+    {
+        auto sum_of_squares = 0.0;
+
+        for (auto sample : samples)
+        {
+            sum_of_squares += (sample - result.mean) * (sample - result.mean);
+        }
+
+        result.stddev = std::sqrt(sum_of_squares / static_cast<double>(samples.size() - 1));
+    }
+
+    return result;
+}
+
+/// <summary>
+/// The measurements of one workload.
+/// </summary>
+struct result
+{
+    std::string name;
+    statistics milliseconds;
+    // per timed iteration, averaged
+    std::size_t allocations = 0;
+    std::size_t allocated_bytes = 0;
+    // highest resident set size seen while running the workload
+    std::size_t peak_rss_bytes = 0;
+};
+
+/// <summary>
+/// Runs workloads a number of times, measuring each run with a steady clock, and
+/// reports the results as JSON.
+/// </summary>
+class runner
+{
+public:
+    runner(std::size_t warmup, std::size_t iterations, const std::string &filter)
+        : warmup_(warmup),
+          iterations_(std::max(iterations, std::size_t(1))),
+          filter_(filter)
+    {
+    }
+
+    /// <summary>
+    /// Adds a parameter describing the conditions of the run, such as the shape of the data.
+    /// </summary>
+    void parameter(const std::string &name, const std::string &value)
+    {
+        parameters_.emplace_back(name, value);
+    }
+
+    /// <summary>
+    /// Runs body warmup times and then iterations times, timing only body. setup is
+    /// called untimed before each call of body, for example to prepare its input.
+    /// Workloads whose name doesn't contain the filter are skipped.
+    /// </summary>
+    void run(const std::string &name, const std::function<void()> &setup, const std::function<void()> &body)
+    {
+        if (name.find(filter_) == std::string::npos) return;
+
+        std::cerr << name << std::flush;
+
+        for (std::size_t i = 0; i < warmup_; ++i)
+        {
+            setup();
+            body();
+        }
+
+        reset_peak_rss();
+
+        result measured;
+        measured.name = name;
+
+        std::vector<double> samples;
+        std::size_t allocations = 0;
+        std::size_t bytes = 0;
+
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            setup();
+
+            const auto allocations_before = allocation_count();
+            const auto bytes_before = allocated_bytes();
+            const auto start = std::chrono::steady_clock::now();
+
+            body();
+
+            const auto end = std::chrono::steady_clock::now();
+            allocations += allocation_count() - allocations_before;
+            bytes += allocated_bytes() - bytes_before;
+
+            samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            std::cerr << '.' << std::flush;
+        }
+
+        measured.milliseconds = summarize(samples);
+        measured.allocations = allocations / iterations_;
+        measured.allocated_bytes = bytes / iterations_;
+        measured.peak_rss_bytes = peak_rss_bytes();
+
+        std::cerr << ' ' << measured.milliseconds.median << " ms" << std::endl;
+
+        results_.push_back(measured);
+    }
+
+    /// <summary>
+    /// Writes the parameters and results as a JSON object to out.
+    /// </summary>
+    void write_json(std::ostream &out) const
+    {
+        out << "{\n  \"parameters\": {";
+
+        for (std::size_t i = 0; i < parameters_.size(); ++i)
+        {
+            out << (i == 0 ? "\n" : ",\n") << "    " << quote(parameters_[i].first) << ": "
+                << quote(parameters_[i].second);
+        }
+
+        out << "\n  },\n  \"benchmarks\": [";
+
+        for (std::size_t i = 0; i < results_.size(); ++i)
+        {
+            const auto &r = results_[i];
+            const auto &t = r.milliseconds;
+
+            out << (i == 0 ? "\n" : ",\n") << "    {\n"
+                << "      \"name\": " << quote(r.name) << ",\n"
+                << "      \"iterations\": " << t.samples << ",\n"
+                << std::fixed << std::setprecision(3)
+                << "      \"time_ms\": {\"min\": " << t.min << ", \"median\": " << t.median
+                << ", \"mean\": " << t.mean << ", \"max\": " << t.max << ", \"stddev\": " << t.stddev << "},\n"
+                << "      \"allocations\": " << r.allocations << ",\n"
+                << "      \"allocated_bytes\": " << r.allocated_bytes << ",\n"
+                << "      \"peak_rss_bytes\": " << r.peak_rss_bytes << "\n"
+                << "    }";
+        }
+
+        out << "\n  ]\n}\n";
+    }
+
+private:
+    static std::string quote(const std::string &text)
+    {
+        std::ostringstream quoted;
+        quoted << '"';
+
+        for (auto c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                quoted << '\\' << c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                quoted << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+            }
+            else
+            {
+                quoted << c;
+            }
+        }
+
+        quoted << '"';
+
+        return quoted.str();
+    }
+
+    std::size_t warmup_;
+    std::size_t iterations_;
+    std::string filter_;
+    std::vector<std::pair<std::string, std::string>> parameters_;
+    std::vector<result> results_;
+};
+
+// Reads arguments of the form --name=value.
+inline std::string argument(int argc, char *argv[], const std::string &name, const std::string &default_value)
+{
+    const auto prefix = "--" + name + "=";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const auto arg = std::string(argv[i]);
+
+        if (arg.compare(0, prefix.size(), prefix) == 0)
+        {
+            return arg.substr(prefix.size());
+        }
+    }
+
+    return default_value;
+}
+
+// Returns true if --name was given on its own.
+inline bool flag(int argc, char *argv[], const std::string &name)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--" + name)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace benchmarks
+} // namespace xlnt
@@ -0,0 +1,106 @@
+// Copyright (c) 2017-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace xlnt {
+namespace benchmarks {
+
+/// <summary>
+/// Returns the number of calls to operator new since the program started.
+/// Defined in allocation_counter.cpp, which replaces the global allocation functions.
+/// </summary>
+std::size_t allocation_count();
+
+/// <summary>
+/// Returns the total number of bytes requested from operator new since the program started.
+/// </summary>
+std::size_t allocated_bytes();
+
+/// <summary>
+/// Returns the highest resident set size of this process in bytes, since the
+/// last call to reset_peak_rss() where that is supported, or since it started.
+/// </summary>
+inline std::size_t peak_rss_bytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return static_cast<std::size_t>(counters.PeakWorkingSetSize);
+    }
+
+    return 0;
+#else
+#if defined(__linux__)
+    // VmHWM can be reset, unlike ru_maxrss
+    std::ifstream status("/proc/self/status");
+    std::string line;
+
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 6, "VmHWM:") == 0)
+        {
+            return static_cast<std::size_t>(std::stoull(line.substr(6))) * 1024;
+        }
+    }
+#endif
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+#if defined(__APPLE__)
+    return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+/// <summary>
+/// Lowers the peak resident set size to the current one so that the peak of the next
+/// workload can be measured on its own. Only supported on Linux, a no-op elsewhere.
+/// </summary>
+inline void reset_peak_rss()
+{
+#if defined(__linux__)
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+#endif
+}
+
+} // namespace benchmarks
+} // namespace xlnt
@@ -0,0 +1,340 @@
+// Copyright (c) 2017-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <helpers/benchmark.hpp>
+#include <helpers/path_helper.hpp>
+#include <helpers/workbook_generator.hpp>
+#include <xlnt/xlnt.hpp>
+
+namespace {
+
+using xlnt::benchmarks::argument;
+
+// The shape of the generated worksheet every workload runs on.
+struct dataset_shape
+{
+    std::size_t rows = 10000;
+    std::size_t columns = 20;
+    double string_ratio = 0.3;
+    std::size_t distinct_strings = 1000;
+    std::size_t styles = 100;
+};
+
+// Calls visit(column, row, is_string, number, string_index) for every cell of a
+// worksheet of the given shape. The same shape always produces the same cells.
+template <typename Visitor>
+void for_each_cell(const dataset_shape &shape, Visitor visit)
+{
+    std::mt19937 random(12345);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::uniform_int_distribution<std::size_t> string_index(0, std::max(shape.distinct_strings, std::size_t(1)) - 1);
+
+    for (std::size_t row = 1; row <= shape.rows; ++row)
+    {
+        for (std::size_t column = 1; column <= shape.columns; ++column)
+        {
+            const auto is_string = unit(random) < shape.string_ratio;
+            const auto number = unit(random) * 1000.0;
+            const auto index = string_index(random);
+
+            visit(static_cast<xlnt::column_t::index_t>(column), static_cast<xlnt::row_t>(row), is_string, number, index);
+        }
+    }
+}
+
+std::vector<std::string> make_strings(const dataset_shape &shape)
+{
+    std::vector<std::string> strings;
+
+    for (std::size_t i = 0; i < std::max(shape.distinct_strings, std::size_t(1)); ++i)
+    {
+        strings.push_back("string value " + std::to_string(i));
+    }
+
+    return strings;
+}
+
+void populate(xlnt::worksheet ws, const dataset_shape &shape, const std::vector<std::string> &strings)
+{
+    for_each_cell(shape, [&](xlnt::column_t::index_t column, xlnt::row_t row, bool is_string, double number, std::size_t index) {
+        auto cell = ws.cell(xlnt::cell_reference(column, row));
+
+        if (is_string)
+        {
+            cell.value(strings[index]);
+        }
+        else
+        {
+            cell.value(number);
+        }
+    });
+}
+
+std::vector<xlnt::format> make_formats(xlnt::workbook &wb, std::size_t count)
+{
+    std::vector<xlnt::format> formats;
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        xlnt::font font;
+        font.size(8.0 + static_cast<double>(i % 20));
+        font.bold(i % 2 == 0);
+        font.italic(i % 3 == 0);
+        font.color(xlnt::rgb_color(static_cast<std::uint8_t>(i * 7), static_cast<std::uint8_t>(i * 13), static_cast<std::uint8_t>(i)));
+
+        formats.push_back(wb.create_format().font(font, true));
+    }
+
+    return formats;
+}
+
+void usage()
+{
+    std::cerr << "usage: benchmark-suite [--rows=N] [--columns=N] [--string-ratio=R] [--distinct-strings=N]\n"
+              << "                       [--styles=N] [--iterations=N] [--warmup=N] [--filter=TEXT]\n"
+              << "                       [--sheets=N] [--density=R] [--formula-ratio=R] [--merged-regions=N]\n"
+              << "                       [--comments=N] [--input=FILE] [--label=TEXT] [--output=FILE]\n\n"
+              << "Runs every workload on a generated worksheet of the given shape and writes\n"
+              << "the results as JSON to FILE or standard output. Progress goes to standard error.\n"
+              << "load_generated reads a package written by the workbook generator with the\n"
+              << "extra sheet, density, formula, merge and comment options, or FILE if --input\n"
+              << "names one, for example a large workbook from benchmark-generate.\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (xlnt::benchmarks::flag(argc, argv, "help"))
+    {
+        usage();
+        return 0;
+    }
+
+    dataset_shape shape;
+    shape.rows = std::stoul(argument(argc, argv, "rows", std::to_string(shape.rows)));
+    shape.columns = std::stoul(argument(argc, argv, "columns", std::to_string(shape.columns)));
+    shape.string_ratio = std::stod(argument(argc, argv, "string-ratio", std::to_string(shape.string_ratio)));
+    shape.distinct_strings = std::stoul(argument(argc, argv, "distinct-strings", std::to_string(shape.distinct_strings)));
+    shape.styles = std::stoul(argument(argc, argv, "styles", std::to_string(shape.styles)));
+
+    workbook_shape generated;
+    generated.rows = shape.rows;
+    generated.columns = shape.columns;
+    generated.string_ratio = shape.string_ratio;
+    generated.distinct_strings = shape.distinct_strings;
+    generated.styles = shape.styles;
+    generated.sheets = std::stoul(argument(argc, argv, "sheets", std::to_string(generated.sheets)));
+    generated.density = std::stod(argument(argc, argv, "density", std::to_string(generated.density)));
+    generated.formula_ratio = std::stod(argument(argc, argv, "formula-ratio", std::to_string(generated.formula_ratio)));
+    generated.merged_regions = std::stoul(argument(argc, argv, "merged-regions", std::to_string(generated.merged_regions)));
+    generated.comments = std::stoul(argument(argc, argv, "comments", std::to_string(generated.comments)));
+
+    const auto input = argument(argc, argv, "input", "");
+    const auto iterations = std::stoul(argument(argc, argv, "iterations", "5"));
+    const auto warmup = std::stoul(argument(argc, argv, "warmup", "1"));
+    const auto output = argument(argc, argv, "output", "");
+
+    xlnt::benchmarks::runner runner(warmup, iterations, argument(argc, argv, "filter", ""));
+    runner.parameter("label", argument(argc, argv, "label", ""));
+    runner.parameter("rows", std::to_string(shape.rows));
+    runner.parameter("columns", std::to_string(shape.columns));
+    runner.parameter("string_ratio", std::to_string(shape.string_ratio));
+    runner.parameter("distinct_strings", std::to_string(shape.distinct_strings));
+    runner.parameter("styles", std::to_string(shape.styles));
+    runner.parameter("sheets", std::to_string(generated.sheets));
+    runner.parameter("density", std::to_string(generated.density));
+    runner.parameter("formula_ratio", std::to_string(generated.formula_ratio));
+    runner.parameter("merged_regions", std::to_string(generated.merged_regions));
+    runner.parameter("comments", std::to_string(generated.comments));
+    runner.parameter("input", input);
+
+    const auto strings = make_strings(shape);
+    const auto password = std::string("benchmark");
+    const auto nothing = [] {};
+
+    xlnt::workbook source;
+    populate(source.active_sheet(), shape, strings);
+    const auto title = source.active_sheet().title();
+
+    std::vector<std::uint8_t> saved;
+    source.save(saved);
+
+    std::vector<std::uint8_t> encrypted;
+    std::vector<std::uint8_t> output_data;
+
+    runner.run("populate", nothing, [&] {
+        xlnt::workbook wb;
+        populate(wb.active_sheet(), shape, strings);
+    });
+
+    runner.run("shared_strings", nothing, [&] {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+
+        for_each_cell(shape, [&](xlnt::column_t::index_t column, xlnt::row_t row, bool, double, std::size_t index) {
+            ws.cell(xlnt::cell_reference(column, row)).value(strings[index]);
+        });
+    });
+
+    runner.run("save", [&] { output_data.clear(); }, [&] {
+        source.save(output_data);
+    });
+
+    if (!output_data.empty())
+    {
+        runner.parameter("save_bytes", std::to_string(output_data.size()));
+    }
+
+    // the same save at the extremes of the size and speed trade-off
+    const std::vector<std::pair<std::string, xlnt::compression_options>> compressions = {
+        {"stored", xlnt::compression_options::stored()},
+        {"fastest", xlnt::compression_options::fastest()},
+        {"smallest", xlnt::compression_options::smallest()}};
+
+    for (const auto &compression : compressions)
+    {
+        xlnt::save_options options;
+        options.compression = compression.second;
+
+        runner.run("save_" + compression.first, [&] { output_data.clear(); }, [&] {
+            source.save(output_data, options);
+        });
+
+        if (!output_data.empty())
+        {
+            runner.parameter("save_" + compression.first + "_bytes", std::to_string(output_data.size()));
+        }
+    }
+
+    runner.run("load", nothing, [&] {
+        xlnt::workbook wb;
+        wb.load(saved);
+    });
+
+    std::string generated_data;
+
+    if (input.empty())
+    {
+        std::ostringstream generated_stream;
+        generate_workbook(generated, generated_stream);
+        generated_data = generated_stream.str();
+    }
+
+    runner.run("load_generated", nothing, [&] {
+        xlnt::workbook wb;
+
+        if (input.empty())
+        {
+            std::istringstream stream(generated_data);
+            wb.load(stream);
+        }
+        else
+        {
+            wb.load(xlnt::path(input));
+        }
+    });
+
+    runner.run("streaming_read", nothing, [&] {
+        xlnt::streaming_workbook_reader reader;
+        reader.open(saved);
+        reader.begin_worksheet(title);
+
+        while (reader.has_cell())
+        {
+            reader.read_cell();
+        }
+
+        reader.end_worksheet();
+    });
+
+    runner.run("streaming_write", [&] { output_data.clear(); }, [&] {
+        xlnt::streaming_workbook_writer writer;
+        writer.open(output_data);
+        writer.add_worksheet(title);
+
+        for_each_cell(shape, [&](xlnt::column_t::index_t column, xlnt::row_t row, bool is_string, double number, std::size_t index) {
+            auto cell = writer.add_cell(xlnt::cell_reference(column, row));
+
+            if (is_string)
+            {
+                cell.value(strings[index]);
+            }
+            else
+            {
+                cell.value(number);
+            }
+        });
+
+        writer.close();
+    });
+
+    runner.run("styles", [&] { output_data.clear(); }, [&] {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+        populate(ws, shape, strings);
+
+        const auto formats = make_formats(wb, std::max(shape.styles, std::size_t(1)));
+        std::size_t next = 0;
+
+        for_each_cell(shape, [&](xlnt::column_t::index_t column, xlnt::row_t row, bool, double, std::size_t) {
+            ws.cell(xlnt::cell_reference(column, row)).format(formats[next++ % formats.size()]);
+        });
+
+        wb.save(output_data);
+    });
+
+    runner.run("encrypt", [&] { encrypted.clear(); }, [&] {
+        source.save(encrypted, password);
+    });
+
+    // xlnt can't read back the files it encrypts yet, so decrypt a sample from the tests
+    const auto encrypted_sample = path_helper::test_file("5_encrypted_agile.xlsx");
+
+    runner.run("decrypt", nothing, [&] {
+        xlnt::workbook wb;
+        wb.load(encrypted_sample, "secret");
+    });
+
+    if (output.empty())
+    {
+        runner.write_json(std::cout);
+    }
+    else
+    {
+        std::ofstream file(output);
+        runner.write_json(file);
+    }
+
+    return 0;
+}
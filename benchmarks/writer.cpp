@@ -22,7 +22,9 @@
 // @author: see AUTHORS file
 
 #include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <vector>
 
 #include <helpers/timing.hpp>
 #include <xlnt/xlnt.hpp>
@@ -32,7 +34,7 @@ namespace {
 // Create a worksheet with variable width rows. Because data must be
 // serialised row by row it is often the width of the rows which is most
 // important.
-void writer(int cols, int rows)
+void writer(int cols, int rows, const xlnt::compression_options &compression)
 {
     xlnt::workbook wb;
     auto ws = wb.create_sheet();
@@ -54,14 +56,19 @@ void writer(int cols, int rows)
 
     std::cout << std::endl;
 
-    auto filename = "benchmark.xlsx";
-    wb.save(filename);
+    xlnt::save_options options;
+    options.compression = compression;
+
+    std::vector<std::uint8_t> data;
+    wb.save(data, options);
+    std::cout << data.size() << " bytes" << std::endl;
 }
 
 // Create a timeit call to a function and pass in keyword arguments.
 // The function is called twice, once using the standard workbook, then with the optimised one.
 // Time from the best of three is taken.
-void timer(std::function<void(int, int)> fn, int cols, int rows)
+void timer(std::function<void(int, int, const xlnt::compression_options &)> fn, int cols, int rows,
+    const xlnt::compression_options &compression = xlnt::compression_options())
 {
     using xlnt::benchmarks::current_time;
 
@@ -73,7 +80,7 @@ void timer(std::function<void(int, int)> fn, int cols, int rows)
     for(int i = 0; i < repeat; i++)
     {
         auto start = current_time();
-        fn(cols, rows);
+        fn(cols, rows, compression);
         time = std::min(current_time() - start, time);
     }
 
@@ -91,5 +98,12 @@ int main()
     timer(&writer, 10, 10000);
     timer(&writer, 4000, 1000);
 
+    std::cout << "stored" << std::endl;
+    timer(&writer, 4000, 100, xlnt::compression_options::stored());
+    std::cout << "fastest" << std::endl;
+    timer(&writer, 4000, 100, xlnt::compression_options::fastest());
+    std::cout << "smallest" << std::endl;
+    timer(&writer, 4000, 100, xlnt::compression_options::smallest());
+
     return 0;
 }
@@ -183,6 +183,12 @@ public:
     /// </summary>
     void value(const std::string &string_value);
 
+    /// <summary>
+    /// Sets the value of this cell to the given value. The string is moved
+    /// into the shared string table if it isn't already there.
+    /// </summary>
+    void value(std::string &&string_value);
+
     /// <summary>
     /// Sets the value of this cell to the given value.
     /// </summary>
@@ -495,9 +501,10 @@ public:
     bool is_merged() const;
 
     /// <summary>
-    /// Makes this a merged cell iff merged is true.
-    /// Generally, this shouldn't be called directly. Instead,
-    /// use worksheet::merge_cells on its parent worksheet.
+    /// Unmerges the whole range containing this cell if merged is false. Passing true
+    /// does nothing since a single cell isn't a merged range. Generally, this shouldn't
+    /// be called directly. Instead, use worksheet::merge_cells and
+    /// worksheet::unmerge_cells on its parent worksheet.
     /// </summary>
     void merged(bool merged);
 
@@ -625,6 +632,12 @@ private:
     /// </summary>
     class format modifiable_format();
 
+    /// <summary>
+    /// Tells the workbook's formula engine, if it has one, that the value or,
+    /// if formula is true, the formula of this cell changed.
+    /// </summary>
+    void notify_changed(bool formula);
+
     /// <summary>
     /// Delete the default zero-argument constructor.
     /// </summary>
@@ -636,9 +649,10 @@ private:
     cell(detail::cell_impl *d);
 
     /// <summary>
-    /// A pointer to this cell's implementation.
+    /// A pointer to this cell's implementation. It's looked up again on use
+    /// if the worksheet was copied since, which const methods may do too.
     /// </summary>
-    detail::cell_impl *d_;
+    mutable detail::cell_impl *d_;
 };
 
 /// <summary>
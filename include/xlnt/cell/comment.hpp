@@ -30,6 +30,10 @@
 
 namespace xlnt {
 
+namespace detail {
+class heap_usage;
+} // namespace detail
+
 /// <summary>
 /// A comment can be applied to a cell to provide extra information about its contents.
 /// </summary>
@@ -122,6 +126,8 @@ public:
     bool operator!=(const comment &other) const;
 
 private:
+    friend class detail::heap_usage;
+
     /// <summary>
     /// The formatted textual content in this cell displayed directly after the author.
     /// </summary>
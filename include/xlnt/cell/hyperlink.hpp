@@ -30,6 +30,7 @@ namespace xlnt {
 
 namespace detail {
 struct hyperlink_impl;
+class xlsx_producer;
 }
 
 class cell;
@@ -63,6 +64,7 @@ public:
 
 private:
     friend class cell;
+    friend class detail::xlsx_producer;
     hyperlink(detail::hyperlink_impl *d);
     detail::hyperlink_impl *d_;
 };
@@ -31,6 +31,11 @@
 
 namespace xlnt {
 
+namespace detail {
+class heap_usage;
+class shared_string_table;
+} // namespace detail
+
 /// <summary>
 /// Encapsulates zero or more formatted text runs where a text run
 /// is a string of text with the same defined formatting.
@@ -48,11 +53,22 @@ public:
     /// </summary>
     rich_text(const std::string &plain_text);
 
+    /// <summary>
+    /// Constructs a rich text object with the given text and no font.
+    /// The text is moved into the single run rather than copied.
+    /// </summary>
+    rich_text(std::string &&plain_text);
+
     /// <summary>
     /// Constructs a rich text object from other
     /// </summary>
     rich_text(const rich_text &other);
 
+    /// <summary>
+    /// Constructs a rich text object by moving the runs of other.
+    /// </summary>
+    rich_text(rich_text &&other) noexcept;
+
     /// <summary>
     /// Constructs a rich text object with the given text and font.
     /// </summary>
@@ -94,11 +110,21 @@ public:
     /// </summary>
     void add_run(const rich_text_run &t);
 
+    /// <summary>
+    /// Adds a new run to the end of the set of runs by moving it.
+    /// </summary>
+    void add_run(rich_text_run &&t);
+
     /// <summary>
     /// Copies rich text object from other
     /// </summary>
     rich_text& operator=(const rich_text &rhs);
 
+    /// <summary>
+    /// Moves the runs of rhs into this rich text object.
+    /// </summary>
+    rich_text &operator=(rich_text &&rhs) noexcept;
+
     /// <summary>
     /// Returns true if the runs that make up this text are identical to those in rhs.
     /// </summary>
@@ -120,6 +146,9 @@ public:
     bool operator!=(const std::string &rhs) const;
 
 private:
+    friend class detail::heap_usage;
+    friend class detail::shared_string_table;
+
     /// <summary>
     /// The runs that make up this rich text.
     /// </summary>
@@ -24,6 +24,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <xlnt/xlnt_config.hpp>
 #include <xlnt/utils/calendar.hpp>
@@ -48,6 +49,18 @@ struct XLNT_API date
     /// </summary>
     static date from_number(int days_since_base_year, calendar base_date);
 
+    /// <summary>
+    /// Returns the result of date::from_number for each element of serials.
+    /// The whole vector is converted in one loop the compiler can vectorize.
+    /// </summary>
+    static std::vector<date> from_numbers(const std::vector<int> &serials, calendar base_date);
+
+    /// <summary>
+    /// Returns the result of date::to_number for each element of dates.
+    /// The whole vector is converted in one loop without function calls.
+    /// </summary>
+    static std::vector<int> to_numbers(const std::vector<date> &dates, calendar base_date);
+
     /// <summary>
     /// Constructs a data from a given year, month, and day.
     /// </summary>
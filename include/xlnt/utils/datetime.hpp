@@ -24,6 +24,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <xlnt/xlnt_config.hpp>
 #include <xlnt/utils/calendar.hpp>
@@ -56,6 +57,18 @@ struct XLNT_API datetime
     /// </summary>
     static datetime from_number(double number, calendar base_date);
 
+    /// <summary>
+    /// Returns the result of datetime::from_number for each element of numbers.
+    /// The date parts are converted together by date::from_numbers.
+    /// </summary>
+    static std::vector<datetime> from_numbers(const std::vector<double> &numbers, calendar base_date);
+
+    /// <summary>
+    /// Returns the result of datetime::to_number for each element of datetimes.
+    /// The date parts are converted together by date::to_numbers.
+    /// </summary>
+    static std::vector<double> to_numbers(const std::vector<datetime> &datetimes, calendar base_date);
+
     /// <summary>
     /// Returns a datetime equivalent to the ISO-formatted string iso_string.
     /// </summary>
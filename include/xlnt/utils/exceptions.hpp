@@ -361,4 +361,26 @@ public:
     virtual ~unsupported();
 };
 
+/// <summary>
+/// Exception for a load or save stopped through a cancellation_token
+/// </summary>
+class XLNT_API operation_cancelled : public exception
+{
+public:
+    /// <summary>
+    /// Default constructor.
+    /// </summary>
+    operation_cancelled();
+
+    /// <summary>
+    /// Default copy constructor.
+    /// </summary>
+    operation_cancelled(const operation_cancelled &) = default;
+
+    /// <summary>
+    /// Destructor
+    /// </summary>
+    virtual ~operation_cancelled();
+};
+
 } // namespace xlnt
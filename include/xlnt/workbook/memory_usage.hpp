@@ -0,0 +1,136 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <xlnt/xlnt_config.hpp>
+
+namespace xlnt {
+
+/// <summary>
+/// The bytes a worksheet uses, by what they are used for. Byte counts are estimates made
+/// from the sizes and capacities of the containers holding the data. Rows shared with
+/// copies of the worksheet count in proportion to the number of worksheets sharing them,
+/// so the totals of a workbook and its copies add up to what they use together.
+/// </summary>
+class XLNT_API worksheet_memory_usage
+{
+public:
+    /// <summary>
+    /// The title of the worksheet.
+    /// </summary>
+    std::string title;
+
+    /// <summary>
+    /// The number of cells stored, including cells without a value.
+    /// </summary>
+    std::size_t cells = 0;
+
+    /// <summary>
+    /// Bytes used by rows and cells including inline strings and hyperlinks.
+    /// </summary>
+    std::size_t cell_storage = 0;
+
+    /// <summary>
+    /// Bytes used by the text of formulas and shared formula groups.
+    /// </summary>
+    std::size_t formulas = 0;
+
+    /// <summary>
+    /// Bytes used by cell comments.
+    /// </summary>
+    std::size_t comments = 0;
+
+    /// <summary>
+    /// Bytes used by everything else, such as merged ranges, row and column
+    /// properties, views and named ranges.
+    /// </summary>
+    std::size_t other = 0;
+
+    /// <summary>
+    /// Bytes of cells paged out to the scratch file set by workbook::memory_budget.
+    /// Not included in the total.
+    /// </summary>
+    std::size_t spilled = 0;
+
+    /// <summary>
+    /// Returns the sum of the byte counts in memory.
+    /// </summary>
+    std::size_t total() const;
+};
+
+/// <summary>
+/// The bytes a workbook uses, by what they are used for and by worksheet. Byte counts
+/// are estimates in the same way as for worksheet_memory_usage.
+/// </summary>
+class XLNT_API workbook_memory_usage
+{
+public:
+    /// <summary>
+    /// The memory usage of each worksheet in order.
+    /// </summary>
+    std::vector<worksheet_memory_usage> worksheets;
+
+    /// <summary>
+    /// Bytes used by the shared string table and its lookup structures.
+    /// </summary>
+    std::size_t shared_strings = 0;
+
+    /// <summary>
+    /// Bytes used by formats, styles, fonts, fills, borders and number formats.
+    /// </summary>
+    std::size_t stylesheet = 0;
+
+    /// <summary>
+    /// Bytes used by embedded images.
+    /// </summary>
+    std::size_t images = 0;
+
+    /// <summary>
+    /// Bytes used by the dependency graph and results kept by workbook::calculate.
+    /// </summary>
+    std::size_t calculation = 0;
+
+    /// <summary>
+    /// Bytes used by everything else, such as the package manifest, properties and the theme.
+    /// </summary>
+    std::size_t other = 0;
+
+    /// <summary>
+    /// Bytes of images paged out to the scratch file set by workbook::memory_budget.
+    /// Not included in the total.
+    /// </summary>
+    std::size_t spilled = 0;
+
+    /// <summary>
+    /// Returns the sum of the byte counts of the workbook and all of its worksheets
+    /// in memory.
+    /// </summary>
+    std::size_t total() const;
+};
+
+} // namespace xlnt
@@ -0,0 +1,285 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+
+#include <xlnt/xlnt_config.hpp>
+#include <xlnt/packaging/relationship.hpp>
+
+namespace xlnt {
+
+class serialization_statistics;
+
+/// <summary>
+/// How far a load or save has got, passed to the progress callback in load_options
+/// and save_options.
+/// </summary>
+class XLNT_API serialization_progress
+{
+public:
+    /// <summary>
+    /// The number of parts of the package read or written so far.
+    /// </summary>
+    std::uint64_t parts = 0;
+
+    /// <summary>
+    /// The number of bytes inflated or deflated so far. A part read more than once,
+    /// such as an image, counts each time.
+    /// </summary>
+    std::uint64_t bytes = 0;
+
+    /// <summary>
+    /// When loading, the uncompressed size of all parts in the package, against which
+    /// bytes can be compared to estimate the remaining work. Only an estimate since some
+    /// parts are skipped and others read twice. Zero when saving.
+    /// </summary>
+    std::uint64_t total_bytes = 0;
+
+    /// <summary>
+    /// The number of worksheet rows read or written so far.
+    /// </summary>
+    std::uint64_t rows = 0;
+};
+
+/// <summary>
+/// Lets one thread cancel a load or save running on another. The load or save checks
+/// the token before each part and each worksheet row and throws operation_cancelled
+/// once it is cancelled.
+/// </summary>
+class XLNT_API cancellation_token
+{
+public:
+    /// <summary>
+    /// Requests cancellation of every load or save using this token.
+    /// </summary>
+    void cancel()
+    {
+        cancelled_.store(true);
+    }
+
+    /// <summary>
+    /// Returns true if cancel has been called.
+    /// </summary>
+    bool cancelled() const
+    {
+        return cancelled_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<bool> cancelled_{false};
+};
+
+/// <summary>
+/// Options for workbook::load.
+/// </summary>
+class XLNT_API load_options
+{
+public:
+    /// <summary>
+    /// If not null, timings and counters of the load are stored here.
+    /// See serialization_statistics.
+    /// </summary>
+    serialization_statistics *statistics = nullptr;
+
+    /// <summary>
+    /// If set, called on the loading thread after each part and every progress_interval
+    /// rows, and once more when the load is complete.
+    /// </summary>
+    std::function<void(const serialization_progress &)> progress;
+
+    /// <summary>
+    /// The number of worksheet rows between calls to progress.
+    /// </summary>
+    std::uint64_t progress_interval = 1000;
+
+    /// <summary>
+    /// If not null, the load stops by throwing operation_cancelled once this is cancelled.
+    /// The workbook being loaded is then left unchanged.
+    /// </summary>
+    const cancellation_token *cancellation = nullptr;
+
+    /// <summary>
+    /// If true, the package is kept with the workbook, mapped into memory when loaded
+    /// from a file and copied into memory otherwise. Saving the workbook then copies
+    /// the parts which haven't changed since as they are, still compressed, instead of
+    /// writing them again. A worksheet counts as changed once anything in it is
+    /// written, including values stored by workbook::calculate. Every worksheet is
+    /// written again if a format or the workbook view changed. Saving to a file writes
+    /// a new file and renames it into place, so the workbook can be saved over the file
+    /// it was loaded from. Where a mapped file can't be replaced, the package is read
+    /// into memory first.
+    /// </summary>
+    bool keep_source = false;
+
+    /// <summary>
+    /// If true, large parts such as big worksheets are inflated on a second thread
+    /// while they are parsed, so that the two overlap. Only applies when loading from
+    /// a file or from memory, not from a stream.
+    /// </summary>
+    bool pipeline = false;
+
+    /// <summary>
+    /// The number of threads which parse the rows of each large worksheet, or 0 for one
+    /// per core. The worksheet is inflated into memory first and its rows are divided
+    /// between the threads, then added to the worksheet in their original order, so the
+    /// result is the same for any number of threads.
+    /// </summary>
+    std::size_t parse_threads = 1;
+};
+
+/// <summary>
+/// How repeated data is looked for when deflating a part. These are the strategies
+/// of deflateInit2 in the zlib manual.
+/// </summary>
+enum class XLNT_API compression_strategy
+{
+    /// <summary>
+    /// The usual strategy, suited to XML.
+    /// </summary>
+    default_strategy,
+    /// <summary>
+    /// Favours Huffman coding over string matching, for data made of small, mostly random values.
+    /// </summary>
+    filtered,
+    /// <summary>
+    /// Huffman coding only, without string matching. Fast but compresses XML poorly.
+    /// </summary>
+    huffman_only,
+    /// <summary>
+    /// Only matches runs of the same byte. Nearly as fast as huffman_only.
+    /// </summary>
+    rle,
+    /// <summary>
+    /// Uses the fixed Huffman codes of the deflate specification instead of computing them.
+    /// </summary>
+    fixed
+};
+
+/// <summary>
+/// How the parts of a package are compressed when it is saved.
+/// </summary>
+class XLNT_API compression_options
+{
+public:
+    /// <summary>
+    /// Returns options which store parts without compressing them. This is the fastest
+    /// way to save and load but the package is several times larger.
+    /// </summary>
+    static compression_options stored();
+
+    /// <summary>
+    /// Returns options which deflate parts as fast as possible at some cost in size.
+    /// </summary>
+    static compression_options fastest();
+
+    /// <summary>
+    /// Returns options which deflate parts as small as possible at some cost in time.
+    /// </summary>
+    static compression_options smallest();
+
+    /// <summary>
+    /// The deflate compression level as in zlib, from 1 (fastest) to 9 (smallest), or -1
+    /// for the default, which is currently 6. A level of 0 stores parts without compressing
+    /// them at all, which is the only time strategy is ignored.
+    /// </summary>
+    int level = -1;
+
+    /// <summary>
+    /// How repeated data is looked for.
+    /// </summary>
+    compression_strategy strategy = compression_strategy::default_strategy;
+
+    /// <summary>
+    /// The size in bytes of the buffers between the XML writer and the compressor and
+    /// between the compressor and the destination stream. Larger buffers mean fewer, larger writes to the
+    /// destination. Doesn't change the bytes written. Must be at least 64.
+    /// </summary>
+    std::size_t buffer_size = 16384;
+};
+
+/// <summary>
+/// Options for workbook::save.
+/// </summary>
+class XLNT_API save_options
+{
+public:
+    /// <summary>
+    /// If not null, timings and counters of the save are stored here.
+    /// See serialization_statistics.
+    /// </summary>
+    serialization_statistics *statistics = nullptr;
+
+    /// <summary>
+    /// If set, called on the saving thread after each part and every progress_interval
+    /// rows, and once more when the save is complete.
+    /// </summary>
+    std::function<void(const serialization_progress &)> progress;
+
+    /// <summary>
+    /// The number of worksheet rows between calls to progress.
+    /// </summary>
+    std::uint64_t progress_interval = 1000;
+
+    /// <summary>
+    /// If not null, the save stops by throwing operation_cancelled once this is cancelled.
+    /// The destination is then left with an incomplete package.
+    /// </summary>
+    const cancellation_token *cancellation = nullptr;
+
+    /// <summary>
+    /// How parts are compressed unless part_compression says otherwise.
+    /// </summary>
+    compression_options compression;
+
+    /// <summary>
+    /// How to compress the parts which are the target of a relationship of each type,
+    /// for example relationship_type::image to store images that are compressed already.
+    /// Parts copied from a kept source package (see load_options::keep_source) are
+    /// copied as they were compressed there.
+    /// </summary>
+    std::map<relationship_type, compression_options> part_compression;
+
+    /// <summary>
+    /// If true, worksheets and the shared string table are deflated and written to
+    /// the destination on a second thread while they are serialized, so that the two
+    /// overlap.
+    /// </summary>
+    bool pipeline = false;
+
+    /// <summary>
+    /// The number of threads which write worksheets, or 0 for one per core. With more
+    /// than one, each worksheet that has to be written is serialized and deflated into
+    /// memory along with its comments and drawings by one of the threads, and then
+    /// copied into the package in the usual order, so the package is the same for any
+    /// number of threads. The workbook must not be changed until the save returns.
+    /// </summary>
+    std::size_t write_threads = 1;
+};
+
+} // namespace xlnt
@@ -0,0 +1,140 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <xlnt/xlnt_config.hpp>
+#include <xlnt/utils/path.hpp>
+
+namespace xlnt {
+
+/// <summary>
+/// Timings and sizes of one part of a package read by workbook::load or written by workbook::save.
+/// </summary>
+class XLNT_API part_statistics
+{
+public:
+    /// <summary>
+    /// The path of the part in the package.
+    /// </summary>
+    path part;
+
+    /// <summary>
+    /// Seconds spent on this part, not including parts read while it was being read.
+    /// </summary>
+    double seconds = 0.0;
+
+    /// <summary>
+    /// The part of seconds spent inflating or deflating the part.
+    /// </summary>
+    double compression_seconds = 0.0;
+
+    /// <summary>
+    /// The size of the part in the package.
+    /// </summary>
+    std::uint64_t compressed_bytes = 0;
+
+    /// <summary>
+    /// The size of the part after inflating or before deflating it.
+    /// </summary>
+    std::uint64_t uncompressed_bytes = 0;
+
+    /// <summary>
+    /// The allocations made while the part was read or written, as counted by
+    /// serialization_statistics::allocation_counter.
+    /// </summary>
+    std::uint64_t allocations = 0;
+};
+
+/// <summary>
+/// Timings and counters filled in by workbook::load and workbook::save when given a
+/// load_options or save_options pointing to an instance of this class. They are only
+/// collected if xlnt was built with the INSTRUMENTATION CMake option. Otherwise the code
+/// collecting them is compiled out and everything stays zero.
+/// </summary>
+class XLNT_API serialization_statistics
+{
+public:
+    /// <summary>
+    /// Returns true if this build of xlnt collects statistics.
+    /// </summary>
+    static bool enabled();
+
+    /// <summary>
+    /// If set, called when each part is opened and closed to count the allocations made
+    /// in between, for example by returning a counter kept by a replacement operator new.
+    /// </summary>
+    std::function<std::uint64_t()> allocation_counter;
+
+    /// <summary>
+    /// Seconds spent in the whole load or save.
+    /// </summary>
+    double seconds = 0.0;
+
+    /// <summary>
+    /// Statistics for each part in the order the parts were opened. A part opened
+    /// more than once, such as an image, has a record for each time.
+    /// </summary>
+    std::vector<part_statistics> parts;
+
+    /// <summary>
+    /// The number of worksheet rows read or written.
+    /// </summary>
+    std::uint64_t rows = 0;
+
+    /// <summary>
+    /// The number of cells read or written.
+    /// </summary>
+    std::uint64_t cells = 0;
+
+    /// <summary>
+    /// The number of strings in the shared string table read or written.
+    /// </summary>
+    std::uint64_t shared_strings = 0;
+
+    /// <summary>
+    /// The number of cell formats read or written.
+    /// </summary>
+    std::uint64_t formats = 0;
+
+    /// <summary>
+    /// Returns the sum of the compressed sizes of all parts.
+    /// </summary>
+    std::uint64_t compressed_bytes() const;
+
+    /// <summary>
+    /// Returns the sum of the uncompressed sizes of all parts.
+    /// </summary>
+    std::uint64_t uncompressed_bytes() const;
+
+    /// <summary>
+    /// Returns the sum of the time spent inflating or deflating all parts.
+    /// </summary>
+    double compression_seconds() const;
+};
+
+} // namespace xlnt
@@ -0,0 +1,111 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <xlnt/xlnt_config.hpp>
+#include <xlnt/cell/rich_text.hpp>
+
+namespace xlnt {
+
+namespace detail {
+
+class shared_string_table;
+
+} // namespace detail
+
+/// <summary>
+/// A read-only view of the shared strings of a workbook in order of index. It refers to
+/// the strings the workbook stores rather than copying them, so it reflects strings added
+/// after it was made and is only valid as long as the workbook it came from.
+/// </summary>
+class XLNT_API shared_string_view
+{
+public:
+    using const_iterator = std::vector<rich_text>::const_iterator;
+
+    /// <summary>
+    /// Returned by find when the string isn't shared.
+    /// </summary>
+    static const std::size_t npos;
+
+    /// <summary>
+    /// Returns the number of shared strings, including duplicates.
+    /// </summary>
+    std::size_t size() const;
+
+    /// <summary>
+    /// Returns true if there are no shared strings.
+    /// </summary>
+    bool empty() const;
+
+    /// <summary>
+    /// Returns the string with the given index. Throws invalid_parameter if it doesn't exist.
+    /// </summary>
+    const rich_text &at(std::size_t index) const;
+
+    /// <summary>
+    /// Returns the string with the given index, which must exist.
+    /// </summary>
+    const rich_text &operator[](std::size_t index) const;
+
+    /// <summary>
+    /// Returns the index of the first string equal to text or npos.
+    /// </summary>
+    std::size_t find(const rich_text &text) const;
+
+    /// <summary>
+    /// Returns the index of the first string equal to rich_text(plain_text) or npos.
+    /// This doesn't construct a rich_text.
+    /// </summary>
+    std::size_t find(const std::string &plain_text) const;
+
+    /// <summary>
+    /// Returns an iterator to the string with index 0.
+    /// </summary>
+    const_iterator begin() const;
+
+    /// <summary>
+    /// Returns an iterator past the last string.
+    /// </summary>
+    const_iterator end() const;
+
+private:
+    friend class workbook;
+
+    /// <summary>
+    /// Constructs a view of the given table.
+    /// </summary>
+    explicit shared_string_view(const detail::shared_string_table &table);
+
+    /// <summary>
+    /// The table of the workbook this view came from.
+    /// </summary>
+    const detail::shared_string_table *table_;
+};
+
+} // namespace xlnt
@@ -35,6 +35,7 @@
 
 #include <xlnt/xlnt_config.hpp>
 #include <xlnt/cell/rich_text.hpp>
+#include <xlnt/workbook/shared_string_view.hpp>
 
 namespace xlnt {
 
@@ -53,6 +54,7 @@ class const_worksheet_iterator;
 class drawing;
 class fill;
 class font;
+class load_options;
 class format;
 class rich_text;
 class manifest;
@@ -65,11 +67,13 @@ class protection;
 class range;
 class range_reference;
 class relationship;
+class save_options;
 class streaming_workbook_reader;
 class style;
 class style_serializer;
 class theme;
 class variant;
+class workbook_memory_usage;
 class workbook_view;
 class worksheet;
 class worksheet_iterator;
@@ -81,6 +85,8 @@ namespace detail {
 
 struct stylesheet;
 struct workbook_impl;
+class snapshot_consumer;
+class snapshot_producer;
 class xlsx_consumer;
 class xlsx_producer;
 
@@ -159,6 +165,10 @@ public:
 
     /// <summary>
     /// Copy constructor. Constructs this workbook from existing workbook, other.
+    /// Cell storage is shared with other and only copied one row at a time as
+    /// cells are accessed through either workbook. Cell objects already obtained
+    /// from other keep referring to other only, copying their row when they are
+    /// next used, until other is copied again.
     /// </summary>
     workbook(const workbook &other);
 
@@ -188,13 +198,16 @@ public:
 
     /// <summary>
     /// Creates and returns a new sheet after the last sheet initializing it
-    /// with all of the data from the provided worksheet.
+    /// with all of the data from the provided worksheet. As with copying a
+    /// workbook, cells are shared between the two sheets until they are accessed
+    /// and existing cell objects keep referring to worksheet.
     /// </summary>
     worksheet copy_sheet(worksheet worksheet);
 
     /// <summary>
     /// Creates and returns a new sheet at the specified index initializing it
-    /// with all of the data from the provided worksheet.
+    /// with all of the data from the provided worksheet. Cells are shared as
+    /// described for copy_sheet(worksheet).
     /// </summary>
     worksheet copy_sheet(worksheet worksheet, std::size_t index);
 
@@ -517,6 +530,24 @@ public:
     /// </summary>
     void save(std::ostream &stream, const std::string &password) const;
 
+    /// <summary>
+    /// Serializes the workbook into an XLSX file and saves the bytes into
+    /// byte vector data using the given options.
+    /// </summary>
+    void save(std::vector<std::uint8_t> &data, const save_options &options) const;
+
+    /// <summary>
+    /// Serializes the workbook into an XLSX file and saves the data into a file
+    /// named filename using the given options.
+    /// </summary>
+    void save(const xlnt::path &filename, const save_options &options) const;
+
+    /// <summary>
+    /// Serializes the workbook into an XLSX file and saves the data into stream
+    /// using the given options.
+    /// </summary>
+    void save(std::ostream &stream, const save_options &options) const;
+
     /// <summary>
     /// Interprets byte vector data as an XLSX file and sets the content of this
     /// workbook to match that file.
@@ -579,6 +610,52 @@ public:
     /// </summary>
     void load(std::istream &stream, const std::string &password);
 
+    /// <summary>
+    /// Interprets byte vector data as an XLSX file and sets the content of this
+    /// workbook to match that file using the given options.
+    /// </summary>
+    void load(const std::vector<std::uint8_t> &data, const load_options &options);
+
+    /// <summary>
+    /// Interprets file with the given filename as an XLSX file and sets the
+    /// content of this workbook to match that file using the given options.
+    /// </summary>
+    void load(const xlnt::path &filename, const load_options &options);
+
+    /// <summary>
+    /// Interprets data in stream as an XLSX file and sets the content of this
+    /// workbook to match that file using the given options.
+    /// </summary>
+    void load(std::istream &stream, const load_options &options);
+
+    /// <summary>
+    /// Replaces the content of data with a snapshot of this workbook. A snapshot is
+    /// meant to be kept as a local cache beside a workbook that is loaded repeatedly.
+    /// Loading one only parses the small parts describing styles, properties and the
+    /// like while cells and shared strings are copied out of a compact binary form.
+    /// Snapshots can only be loaded by a build of xlnt using the same snapshot format
+    /// on a machine with the same byte order.
+    /// </summary>
+    void save_snapshot(std::vector<std::uint8_t> &data) const;
+
+    /// <summary>
+    /// Writes a snapshot of this workbook to the file with the given filename.
+    /// </summary>
+    void save_snapshot(const xlnt::path &filename) const;
+
+    /// <summary>
+    /// Sets the content of this workbook to match the snapshot in data. Throws
+    /// invalid_file if data isn't a complete snapshot and unsupported if it can't
+    /// be loaded by this build or on this machine.
+    /// </summary>
+    void load_snapshot(const std::vector<std::uint8_t> &data);
+
+    /// <summary>
+    /// Sets the content of this workbook to match the snapshot in the file with the
+    /// given filename, which is read straight from memory when it can be mapped.
+    /// </summary>
+    void load_snapshot(const xlnt::path &filename);
+
     // View
 
     /// <summary>
@@ -762,7 +839,34 @@ public:
     std::size_t add_shared_string(const rich_text &shared, bool allow_duplicates = false);
 
     /// <summary>
-    /// Returns a reference to the shared string ordered by id
+    /// Adds a shared string to the set of shared strings used by this workbook,
+    /// moving shared into the table if it is added.
+    /// This should not generally be called unless you know what you're doing.
+    /// If allow_duplicates is false and the string is already in the collection,
+    /// it will not be added. Returns the index of the added string.
+    /// </summary>
+    std::size_t add_shared_string(rich_text &&shared, bool allow_duplicates = false);
+
+    /// <summary>
+    /// Adds an unformatted shared string to the set of shared strings used by this
+    /// workbook. The lookup for an existing copy is done without constructing a
+    /// rich_text, which is only built if the string is added.
+    /// This should not generally be called unless you know what you're doing.
+    /// If allow_duplicates is false and the string is already in the collection,
+    /// it will not be added. Returns the index of the added string.
+    /// </summary>
+    std::size_t add_shared_string(std::string &&shared, bool allow_duplicates = false);
+
+    /// <summary>
+    /// Returns a view of the shared strings in order of index that refers to the
+    /// strings stored by this workbook without copying them.
+    /// </summary>
+    shared_string_view shared_strings_view() const;
+
+    /// <summary>
+    /// Returns a reference to the shared string ordered by id.
+    /// This map is built from the shared strings the first time it is requested and
+    /// holds a copy of every string. Use shared_strings_view to avoid the copies.
     /// </summary>
     const std::map<std::size_t, rich_text> &shared_strings_by_id() const;
 
@@ -772,14 +876,17 @@ public:
     const rich_text &shared_strings(std::size_t index) const;
 
     /// <summary>
-    /// Returns a reference to the shared strings being used by cells
-    /// in this workbook.
+    /// Returns a reference to the shared strings being used by cells in this
+    /// workbook. This map is built from the shared strings the first time it is
+    /// requested and holds a copy of every string. Changes made to it don't affect
+    /// the workbook, so use add_shared_string to add strings. Use shared_strings_view
+    /// to avoid the copies.
     /// </summary>
     std::unordered_map<rich_text, std::size_t, rich_text_hash> &shared_strings();
 
     /// <summary>
     /// Returns a reference to the shared strings being used by cells
-    /// in this workbook.
+    /// in this workbook. This map holds a copy of every string like the non-const overload.
     /// </summary>
     const std::unordered_map<rich_text, std::size_t, rich_text_hash> &shared_strings() const;
 
@@ -814,6 +921,43 @@ public:
     /// </summary>
     void calculation_properties(const class calculation_properties &props);
 
+    /// <summary>
+    /// Evaluates the formulas in this workbook and stores their results as the values
+    /// of their cells so that they are saved with the workbook. The first call evaluates
+    /// every formula. Later calls only evaluate formulas that depend on cells changed
+    /// since. Formulas that don't depend on each other are evaluated on up to threads
+    /// threads. Supports the arithmetic, concatenation, comparison and percent operators
+    /// and SUM, AVERAGE, COUNT, MIN, MAX, IF, VLOOKUP, INDEX and MATCH. Other functions
+    /// and defined names evaluate to #NAME? and circular references to #REF!.
+    /// </summary>
+    void calculate(std::size_t threads = 1);
+
+    /// <summary>
+    /// Returns an estimate of the bytes used by this workbook, broken down into
+    /// cell storage, shared strings, the stylesheet, comments, formulas and images,
+    /// and by worksheet.
+    /// </summary>
+    workbook_memory_usage memory_usage() const;
+
+    /// <summary>
+    /// Keeps the cells of this workbook within about budget bytes of memory by paging
+    /// blocks of rows that haven't been used recently out to a scratch file created in
+    /// scratch_directory, and paging them back in when they are accessed or saved.
+    /// Images are kept in the scratch file rather than in memory. Rows with a comment,
+    /// a hyperlink or formatted text in them always stay in memory, and inserting or
+    /// deleting rows or columns pages a worksheet back in until the budget is next
+    /// enforced. Paging out a row invalidates cell objects referring to it, so cells
+    /// should be looked up again after other rows have been accessed rather than kept.
+    /// While a budget is set, calculate, save and CSV export use one thread. A budget of zero pages
+    /// everything back in and removes the scratch file once nothing refers to it.
+    /// </summary>
+    void memory_budget(std::size_t budget, const path &scratch_directory);
+
+    /// <summary>
+    /// Returns the budget set by memory_budget or zero if none is set.
+    /// </summary>
+    std::size_t memory_budget() const;
+
     // Operators
 
     /// <summary>
@@ -845,8 +989,11 @@ public:
     bool operator!=(const workbook &rhs) const;
 
 private:
+    friend class cell;
     friend class streaming_workbook_reader;
     friend class worksheet;
+    friend class detail::snapshot_consumer;
+    friend class detail::snapshot_producer;
     friend class detail::xlsx_consumer;
     friend class detail::xlsx_producer;
 
@@ -0,0 +1,117 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <xlnt/xlnt_config.hpp>
+
+namespace xlnt {
+
+/// <summary>
+/// Determines which fields are enclosed in quote characters when a worksheet
+/// is exported as delimited text.
+/// </summary>
+enum class XLNT_API csv_quoting
+{
+    /// <summary>
+    /// Only fields containing the delimiter, the quote character or a line break are quoted.
+    /// </summary>
+    minimal,
+    /// <summary>
+    /// Every field is quoted.
+    /// </summary>
+    all,
+    /// <summary>
+    /// Every field except numbers and booleans is quoted.
+    /// </summary>
+    non_numeric,
+    /// <summary>
+    /// No field is quoted. A delimiter, line break or backslash in a field is escaped
+    /// with a backslash instead: a tab delimiter as \t, another delimiter as a backslash
+    /// followed by it, line feeds and carriage returns as \n and \r, and backslashes as \\.
+    /// </summary>
+    none
+};
+
+/// <summary>
+/// Options controlling how a worksheet or range is exported as delimited text
+/// (e.g. CSV or TSV).
+/// </summary>
+class XLNT_API csv_options
+{
+public:
+    /// <summary>
+    /// Returns options for comma-separated values as described by RFC 4180.
+    /// </summary>
+    static csv_options csv();
+
+    /// <summary>
+    /// Returns options for tab-separated values with quoting disabled, so tabs, line
+    /// breaks and backslashes in fields are escaped with a backslash.
+    /// </summary>
+    static csv_options tsv();
+
+    /// <summary>
+    /// The character written between fields
+    /// </summary>
+    char delimiter = ',';
+
+    /// <summary>
+    /// The character used to enclose quoted fields. Occurrences inside
+    /// a quoted field are doubled.
+    /// </summary>
+    char quote = '"';
+
+    /// <summary>
+    /// Which fields should be quoted
+    /// </summary>
+    csv_quoting quoting = csv_quoting::minimal;
+
+    /// <summary>
+    /// The sequence written after each row
+    /// </summary>
+    std::string line_terminator = "\r\n";
+
+    /// <summary>
+    /// If true, numeric cells are written using their number format as they
+    /// would be displayed. Otherwise, the raw value is written.
+    /// </summary>
+    bool formatted = true;
+
+    /// <summary>
+    /// The number of threads used to format blocks of rows. Values of 0 or 1
+    /// format all rows on the calling thread, as does a workbook with a memory budget.
+    /// </summary>
+    std::size_t threads = 1;
+
+    /// <summary>
+    /// The number of rows formatted together as a block before being written
+    /// to the output stream.
+    /// </summary>
+    std::size_t rows_per_block = 1024;
+};
+
+} // namespace xlnt
@@ -24,6 +24,7 @@
 #pragma once
 
 #include <functional>
+#include <iostream>
 #include <iterator>
 #include <memory>
 #include <string>
@@ -38,6 +39,7 @@
 #include <xlnt/styles/number_format.hpp>
 #include <xlnt/styles/protection.hpp>
 #include <xlnt/worksheet/cell_vector.hpp>
+#include <xlnt/worksheet/csv_options.hpp>
 #include <xlnt/worksheet/major_order.hpp>
 #include <xlnt/worksheet/range_iterator.hpp>
 #include <xlnt/worksheet/range_reference.hpp>
@@ -270,6 +272,12 @@ public:
     /// </summary>
     void apply(std::function<void(class cell)> f);
 
+    /// <summary>
+    /// Writes the displayed text of every cell in the range to stream as delimited
+    /// text (e.g. CSV or TSV). Rows are always written in row-major order.
+    /// </summary>
+    void save_csv(std::ostream &stream, const csv_options &options = csv_options()) const;
+
     /// <summary>
     /// Returns the n-th row or column in this range.
     /// </summary>
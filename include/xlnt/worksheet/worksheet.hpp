@@ -24,6 +24,7 @@
 
 #pragma once
 
+#include <iostream>
 #include <iterator>
 #include <memory>
 #include <string>
@@ -33,6 +34,7 @@
 #include <xlnt/xlnt_config.hpp>
 #include <xlnt/cell/index_types.hpp>
 #include <xlnt/packaging/relationship.hpp>
+#include <xlnt/worksheet/csv_options.hpp>
 #include <xlnt/worksheet/page_margins.hpp>
 #include <xlnt/worksheet/page_setup.hpp>
 #include <xlnt/worksheet/sheet_view.hpp>
@@ -56,6 +58,7 @@ class relationship;
 class row_properties;
 class sheet_format_properties;
 class workbook;
+class worksheet_memory_usage;
 class phonetic_pr;
 
 struct date;
@@ -270,6 +273,42 @@ public:
     /// </summary>
     void clear_row(row_t row);
 
+    /// <summary>
+    /// Inserts amount empty rows before row. Cells, merged ranges, comments, row properties,
+    /// page breaks, the auto filter and the print area at or below row are moved down.
+    /// Every row and comment is visited to find those to move, so this takes time in
+    /// proportion to the size of the worksheet. Moved rows still shared with a copy of
+    /// the worksheet are copied, since their cells store their row; a worksheet under a
+    /// memory budget is paged back in. Formulas and named ranges aren't updated and cell
+    /// objects obtained before the call shouldn't be used afterwards.
+    /// Throws invalid_parameter if this would move a cell past row 1048576.
+    /// </summary>
+    void insert_rows(row_t row, row_t amount = 1);
+
+    /// <summary>
+    /// Deletes amount rows starting at row and moves everything below them up.
+    /// Ranges overlapping the deleted rows shrink and are removed if nothing is left.
+    /// See insert_rows for what is moved.
+    /// </summary>
+    void delete_rows(row_t row, row_t amount = 1);
+
+    /// <summary>
+    /// Inserts amount empty columns before column. Cells, merged ranges, comments, column
+    /// properties, page breaks, the auto filter and the print area at or right of column
+    /// are moved right. Every row is visited and rows with a cell to move are copied if
+    /// they're shared with a copy of the worksheet. Formulas and named ranges aren't
+    /// updated and cell objects obtained before the call shouldn't be used afterwards.
+    /// Throws invalid_parameter if this would move a cell past column XFD.
+    /// </summary>
+    void insert_columns(column_t column, column_t::index_t amount = 1);
+
+    /// <summary>
+    /// Deletes amount columns starting at column and moves everything right of them left.
+    /// Ranges overlapping the deleted columns shrink and are removed if nothing is left.
+    /// See insert_columns for what is moved.
+    /// </summary>
+    void delete_columns(column_t column, column_t::index_t amount = 1);
+
     // properties
 
     /// <summary>
@@ -417,6 +456,12 @@ public:
     /// </summary>
     range_reference calculate_dimension() const;
 
+    /// <summary>
+    /// Returns an estimate of the bytes used by this worksheet, broken down into
+    /// cell storage, formulas, comments and everything else.
+    /// </summary>
+    worksheet_memory_usage memory_usage() const;
+
     // cell merge
 
     /// <summary>
@@ -745,6 +790,21 @@ public:
     /// </summary>
     void format_properties(const sheet_format_properties &properties);
 
+    // export
+
+    /// <summary>
+    /// Writes the displayed text of every cell within the calculated dimension
+    /// of this worksheet to stream as delimited text (e.g. CSV or TSV).
+    /// </summary>
+    void save_csv(std::ostream &stream, const csv_options &options = csv_options()) const;
+
+    /// <summary>
+    /// Writes the displayed text of every cell within reference to stream as
+    /// delimited text (e.g. CSV or TSV).
+    /// </summary>
+    void save_csv(const range_reference &reference, std::ostream &stream,
+        const csv_options &options = csv_options()) const;
+
 private:
     friend class cell;
     friend class const_range_iterator;
@@ -773,6 +833,12 @@ private:
     /// </summary>
     void garbage_collect_formulae();
 
+    /// <summary>
+    /// Makes the workbook's formula engine, if it has one, start over on its next
+    /// calculation. Called when cells are removed or moved.
+    /// </summary>
+    void reset_formula_engine();
+
     /// <summary>
     /// Sets the parent of this worksheet to wb.
     /// </summary>
@@ -24,12 +24,18 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <sstream>
+#include <unordered_map>
 
+#include <detail/formula/shared_formula.hpp>
 #include <detail/implementations/cell_impl.hpp>
 #include <detail/implementations/format_impl.hpp>
 #include <detail/implementations/hyperlink_impl.hpp>
 #include <detail/implementations/stylesheet.hpp>
+#include <detail/implementations/workbook_impl.hpp>
 #include <detail/implementations/worksheet_impl.hpp>
 #include <xlnt/cell/cell.hpp>
 #include <xlnt/cell/cell_reference.hpp>
@@ -59,6 +65,55 @@
 
 namespace {
 
+// The maximum number of characters Excel allows in a cell
+const std::size_t max_string_length = 32767;
+
+bool is_illegal_character(char c)
+{
+    const auto byte = static_cast<std::uint8_t>(c);
+    return byte < 32 && byte != 9 && byte != 10 && byte != 13;
+}
+
+// Returns a pointer to the first control character in [first, last) that isn't
+// allowed in a cell, or last if there isn't one. Eight bytes are tested at once
+// and only words that contain a byte less than 0x20 are inspected individually.
+const char *find_illegal_character(const char *first, const char *last)
+{
+    const auto ones = std::uint64_t(0x0101010101010101);
+    const auto high_bits = std::uint64_t(0x8080808080808080);
+
+    while (last - first >= 8)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, first, sizeof(word));
+
+        // Nonzero if any byte is less than 0x20. Bytes with the high bit set
+        // (i.e. part of a multi-byte UTF-8 sequence) never match.
+        if (((word - ones * 0x20) & ~word & high_bits) != 0)
+        {
+            for (auto i = 0; i < 8; ++i)
+            {
+                if (is_illegal_character(first[i])) return first + i;
+            }
+        }
+
+        first += 8;
+    }
+
+    return std::find_if(first, last, is_illegal_character);
+}
+
+void throw_if_illegal(const std::string &s)
+{
+    const auto end = s.data() + s.size();
+    const auto illegal = find_illegal_character(s.data(), end);
+
+    if (illegal != end)
+    {
+        throw xlnt::illegal_character(*illegal);
+    }
+}
+
 std::pair<bool, double> cast_numeric(const std::string &s)
 {
     auto str_end = static_cast<char *>(nullptr);
@@ -148,6 +203,45 @@ std::pair<bool, xlnt::time> cast_time(const std::string &s)
     return {true, result};
 }
 
+// Returns true if the built-in number format with the given id is a date format.
+// Parsing a format string costs far more than reading a cell, so each built-in
+// format is parsed once, on first use, instead of whenever is_date is called.
+bool is_builtin_date_format(std::size_t id)
+{
+    static const auto *date_formats = []() {
+        auto formats = new std::unordered_map<std::size_t, bool>();
+
+        for (auto candidate = std::size_t(0); candidate < 164; ++candidate)
+        {
+            if (xlnt::number_format::is_builtin_format(candidate))
+            {
+                (*formats)[candidate] = xlnt::number_format::from_builtin_id(candidate).is_date_format();
+            }
+        }
+
+        return formats;
+    }();
+
+    return date_formats->at(id);
+}
+
+// Returns the cell d points to. If the worksheet was copied since the cell was handed
+// out, d may point into a row shared with the copy, or one the worksheet has copied
+// away from since, so the cell is looked up again in a row of its own.
+xlnt::detail::cell_impl &impl(xlnt::detail::cell_impl *&d)
+{
+    const auto parent = d->parent_;
+    auto &cells = parent->cell_map_;
+
+    if (d->generation_ != cells.generation())
+    {
+        d = &cells.cell(d->row_, d->column_);
+        cells.handed_out(*d, parent);
+    }
+
+    return *d;
+}
+
 } // namespace
 
 namespace xlnt {
@@ -168,25 +262,8 @@ const std::unordered_map<std::string, int> &cell::error_codes()
 
 std::string cell::check_string(const std::string &to_check)
 {
-    // so we can modify it
-    std::string s = to_check;
-
-    if (s.size() == 0)
-    {
-        return s;
-    }
-    else if (s.size() > 32767)
-    {
-        s = s.substr(0, 32767); // max string length in Excel
-    }
-
-    for (char c : s)
-    {
-        if (c >= 0 && (c <= 8 || c == 11 || c == 12 || (c >= 14 && c <= 31)))
-        {
-            throw illegal_character(c);
-        }
-    }
+    auto s = to_check.substr(0, max_string_length);
+    throw_if_illegal(s);
 
     return s;
 }
@@ -198,7 +275,8 @@ cell::cell(detail::cell_impl *d)
 
 bool cell::garbage_collectible() const
 {
-    return !(has_value() || is_merged() || has_formula() || has_format() || has_hyperlink());
+    const auto &d = impl(d_);
+    return d.parent_->garbage_collectible(d);
 }
 
 void cell::value(std::nullptr_t)
@@ -208,57 +286,79 @@ void cell::value(std::nullptr_t)
 
 void cell::value(bool boolean_value)
 {
-    d_->type_ = type::boolean;
-    d_->value_numeric_ = boolean_value ? 1.0 : 0.0;
+    impl(d_).type_ = type::boolean;
+    impl(d_).value_numeric_ = boolean_value ? 1.0 : 0.0;
+    notify_changed(false);
 }
 
 void cell::value(int int_value)
 {
-    d_->value_numeric_ = static_cast<double>(int_value);
-    d_->type_ = type::number;
+    impl(d_).value_numeric_ = static_cast<double>(int_value);
+    impl(d_).type_ = type::number;
+    notify_changed(false);
 }
 
 void cell::value(unsigned int int_value)
 {
-    d_->value_numeric_ = static_cast<double>(int_value);
-    d_->type_ = type::number;
+    impl(d_).value_numeric_ = static_cast<double>(int_value);
+    impl(d_).type_ = type::number;
+    notify_changed(false);
 }
 
 void cell::value(long long int int_value)
 {
-    d_->value_numeric_ = static_cast<double>(int_value);
-    d_->type_ = type::number;
+    impl(d_).value_numeric_ = static_cast<double>(int_value);
+    impl(d_).type_ = type::number;
+    notify_changed(false);
 }
 
 void cell::value(unsigned long long int int_value)
 {
-    d_->value_numeric_ = static_cast<double>(int_value);
-    d_->type_ = type::number;
+    impl(d_).value_numeric_ = static_cast<double>(int_value);
+    impl(d_).type_ = type::number;
+    notify_changed(false);
 }
 
 void cell::value(float float_value)
 {
-    d_->value_numeric_ = static_cast<double>(float_value);
-    d_->type_ = type::number;
+    impl(d_).value_numeric_ = static_cast<double>(float_value);
+    impl(d_).type_ = type::number;
+    notify_changed(false);
 }
 
 void cell::value(double float_value)
 {
-    d_->value_numeric_ = static_cast<double>(float_value);
-    d_->type_ = type::number;
+    impl(d_).value_numeric_ = static_cast<double>(float_value);
+    impl(d_).type_ = type::number;
+    notify_changed(false);
 }
 
 void cell::value(const std::string &s)
 {
-    value(rich_text(check_string(s)));
+    value(s.substr(0, max_string_length));
+}
+
+void cell::value(std::string &&s)
+{
+    if (s.size() > max_string_length)
+    {
+        s.resize(max_string_length);
+    }
+
+    throw_if_illegal(s);
+
+    impl(d_).type_ = type::shared_string;
+    impl(d_).value_numeric_ = static_cast<double>(workbook().add_shared_string(std::move(s)));
+    notify_changed(false);
 }
 
 void cell::value(const rich_text &text)
 {
-    check_string(text.plain_text());
+    throw_if_illegal(text.plain_text());
 
-    d_->type_ = type::shared_string;
-    d_->value_numeric_ = static_cast<double>(workbook().add_shared_string(text));
+    impl(d_).type_ = type::shared_string;
+    impl(d_).value_numeric_ = static_cast<double>(workbook().add_shared_string(text));
+    notify_changed(false);
 }
 
 void cell::value(const char *c)
@@ -268,94 +368,113 @@ void cell::value(const char *c)
 
 void cell::value(const cell c)
 {
-    d_->type_ = c.d_->type_;
-    d_->value_numeric_ = c.d_->value_numeric_;
-    d_->value_text_ = c.d_->value_text_;
-    d_->hyperlink_ = c.d_->hyperlink_;
-    d_->formula_ = c.d_->formula_;
-    d_->format_ = c.d_->format_;
+    impl(d_).type_ = impl(c.d_).type_;
+    impl(d_).value_numeric_ = impl(c.d_).value_numeric_;
+    impl(d_).value_text_ = impl(c.d_).value_text_;
+    impl(d_).hyperlink_ = impl(c.d_).hyperlink_;
+    impl(d_).formula_ = c.has_formula() ? optional<std::string>(c.formula()) : optional<std::string>();
+    impl(d_).shared_formula_ = 0;
+    impl(d_).format_ = impl(c.d_).format_;
+    notify_changed(true);
 }
 
 void cell::value(const date &d)
 {
-    d_->type_ = type::number;
-    d_->value_numeric_ = d.to_number(base_date());
+    impl(d_).type_ = type::number;
+    impl(d_).value_numeric_ = d.to_number(base_date());
     number_format(number_format::date_yyyymmdd2());
+    notify_changed(false);
 }
 
 void cell::value(const datetime &d)
 {
-    d_->type_ = type::number;
-    d_->value_numeric_ = d.to_number(base_date());
+    impl(d_).type_ = type::number;
+    impl(d_).value_numeric_ = d.to_number(base_date());
     number_format(number_format::date_datetime());
+    notify_changed(false);
 }
 
 void cell::value(const time &t)
 {
-    d_->type_ = type::number;
-    d_->value_numeric_ = t.to_number();
+    impl(d_).type_ = type::number;
+    impl(d_).value_numeric_ = t.to_number();
     number_format(number_format::date_time6());
+    notify_changed(false);
 }
 
 void cell::value(const timedelta &t)
 {
-    d_->type_ = type::number;
-    d_->value_numeric_ = t.to_number();
+    impl(d_).type_ = type::number;
+    impl(d_).value_numeric_ = t.to_number();
     number_format(xlnt::number_format("[hh]:mm:ss"));
+    notify_changed(false);
 }
 
 row_t cell::row() const
 {
-    return d_->row_;
+    return impl(d_).row_;
 }
 
 column_t cell::column() const
 {
-    return d_->column_;
+    return impl(d_).column_;
 }
 
 column_t::index_t cell::column_index() const
 {
-    return d_->column_.index;
+    return impl(d_).column_.index;
 }
 
 void cell::merged(bool merged)
 {
-    d_->is_merged_ = merged;
+    // a single cell isn't a merged range, so only worksheet::merge_cells merges cells
+    if (merged || !is_merged()) return;
+
+    impl(d_).parent_->changed();
+
+    auto &merged_cells = impl(d_).parent_->merged_cells_;
+    merged_cells.erase(*merged_cells.find(impl(d_).row_, impl(d_).column_));
 }
 
 bool cell::is_merged() const
 {
-    return d_->is_merged_;
+    return impl(d_).parent_->merged_cells_.contains(impl(d_).row_, impl(d_).column_);
 }
 
 bool cell::is_date() const
 {
-    return data_type() == type::number
-        && has_format()
-        && number_format().is_date_format();
+    if (data_type() != type::number || !has_format()) return false;
+
+    const auto &format = *impl(d_).format_.get();
+
+    if (format.number_format_id.is_set() && number_format::is_builtin_format(format.number_format_id.get()))
+    {
+        return is_builtin_date_format(format.number_format_id.get());
+    }
+
+    return number_format().is_date_format();
 }
 
 cell_reference cell::reference() const
 {
-    return {d_->column_, d_->row_};
+    return {impl(d_).column_, impl(d_).row_};
 }
 
 bool cell::operator==(const cell &comparand) const
 {
-    return d_ == comparand.d_;
+    return &impl(d_) == &impl(comparand.d_);
 }
 
 bool cell::operator!=(const cell &comparand) const
 {
-    return d_ != comparand.d_;
+    return &impl(d_) != &impl(comparand.d_);
 }
 
 cell &cell::operator=(const cell &rhs) = default;
 
 hyperlink cell::hyperlink() const
 {
-    return xlnt::hyperlink(&d_->hyperlink_.get());
+    return xlnt::hyperlink(&impl(d_).hyperlink_.get());
 }
 
 void cell::hyperlink(const std::string &url, const std::string &display)
@@ -365,10 +484,12 @@ void cell::hyperlink(const std::string &url, const std::string &display)
         throw invalid_parameter();
     }
 
+    impl(d_).parent_->changed();
+
     auto ws = worksheet();
     auto &manifest = ws.workbook().manifest();
 
-    d_->hyperlink_ = detail::hyperlink_impl();
+    impl(d_).hyperlink_ = detail::hyperlink_impl();
 
     // check for existing relationships
     auto relationships = manifest.relationships(ws.path(), relationship_type::hyperlink);
@@ -376,7 +497,7 @@ void cell::hyperlink(const std::string &url, const std::string &display)
         [&url](xlnt::relationship rel) { return rel.target().path().string() == url; });
     if (relation != relationships.end())
     {
-        d_->hyperlink_.get().relationship = *relation;
+        impl(d_).hyperlink_.get().relationship = *relation;
     }
     else
     { // register a new relationship
@@ -386,57 +507,61 @@ void cell::hyperlink(const std::string &url, const std::string &display)
             uri(url),
             target_mode::external);
         // TODO: make manifest::register_relationship return the created relationship instead of rel id
-        d_->hyperlink_.get().relationship = manifest.relationship(ws.path(), rel_id);
+        impl(d_).hyperlink_.get().relationship = manifest.relationship(ws.path(), rel_id);
     }
     // if a value is already present, the display string is ignored
     if (has_value())
     {
-        d_->hyperlink_.get().display.set(to_string());
+        impl(d_).hyperlink_.get().display.set(to_string());
     }
     else
     {
-        d_->hyperlink_.get().display.set(display.empty() ? url : display);
+        impl(d_).hyperlink_.get().display.set(display.empty() ? url : display);
         value(hyperlink().display());
     }
 }
 
 void cell::hyperlink(xlnt::cell target, const std::string& display)
 {
+    impl(d_).parent_->changed();
+
     // TODO: should this computed value be a method on a cell?
     const auto cell_address = target.worksheet().title() + "!" + target.reference().to_string();
 
-    d_->hyperlink_ = detail::hyperlink_impl();
-    d_->hyperlink_.get().relationship = xlnt::relationship("", relationship_type::hyperlink,
+    impl(d_).hyperlink_ = detail::hyperlink_impl();
+    impl(d_).hyperlink_.get().relationship = xlnt::relationship("", relationship_type::hyperlink,
         uri(""), uri(cell_address), target_mode::internal);
     // if a value is already present, the display string is ignored
     if (has_value())
     {
-        d_->hyperlink_.get().display.set(to_string());
+        impl(d_).hyperlink_.get().display.set(to_string());
     }
     else
     {
-        d_->hyperlink_.get().display.set(display.empty() ? cell_address : display);
+        impl(d_).hyperlink_.get().display.set(display.empty() ? cell_address : display);
         value(hyperlink().display());
     }
 }
 
 void cell::hyperlink(xlnt::range target, const std::string &display)
 {
+    impl(d_).parent_->changed();
+
     // TODO: should this computed value be a method on a cell?
     const auto range_address = target.target_worksheet().title() + "!" + target.reference().to_string();
 
-    d_->hyperlink_ = detail::hyperlink_impl();
-    d_->hyperlink_.get().relationship = xlnt::relationship("", relationship_type::hyperlink,
+    impl(d_).hyperlink_ = detail::hyperlink_impl();
+    impl(d_).hyperlink_.get().relationship = xlnt::relationship("", relationship_type::hyperlink,
         uri(""), uri(range_address), target_mode::internal);
     
     // if a value is already present, the display string is ignored
     if (has_value())
     {
-        d_->hyperlink_.get().display.set(to_string());
+        impl(d_).hyperlink_.get().display.set(to_string());
     }
     else
     {
-        d_->hyperlink_.get().display.set(display.empty() ? range_address : display);
+        impl(d_).hyperlink_.get().display.set(display.empty() ? range_address : display);
         value(hyperlink().display());
     }
 }
@@ -450,38 +575,49 @@ void cell::formula(const std::string &formula)
 
     if (formula[0] == '=')
     {
-        d_->formula_ = formula.substr(1);
+        impl(d_).formula_ = formula.substr(1);
     }
     else
     {
-        d_->formula_ = formula;
+        impl(d_).formula_ = formula;
     }
 
+    impl(d_).shared_formula_ = 0;
+
     worksheet().register_calc_chain_in_manifest();
+    notify_changed(true);
 }
 
 bool cell::has_formula() const
 {
-    return d_->formula_.is_set();
+    return impl(d_).formula_.is_set() || impl(d_).shared_formula_ != 0;
 }
 
 std::string cell::formula() const
 {
-    return d_->formula_.get();
+    if (!has_formula())
+    {
+        throw invalid_attribute();
+    }
+
+    const auto &d = impl(d_);
+    return detail::cell_formula(d.parent_->shared_formulas_, d);
 }
 
 void cell::clear_formula()
 {
     if (has_formula())
     {
-        d_->formula_.clear();
+        impl(d_).formula_.clear();
+        impl(d_).shared_formula_ = 0;
         worksheet().garbage_collect_formulae();
+        notify_changed(true);
     }
 }
 
 std::string cell::error() const
 {
-    if (d_->type_ != type::error)
+    if (impl(d_).type_ != type::error)
     {
         throw xlnt::exception("called error() when cell type is not error");
     }
@@ -495,8 +631,9 @@ void cell::error(const std::string &error)
         throw invalid_data_type();
     }
 
-    d_->value_text_.plain_text(error, false);
-    d_->type_ = type::error;
+    impl(d_).value_text_.plain_text(error, false);
+    impl(d_).type_ = type::error;
+    notify_changed(false);
 }
 
 cell cell::offset(int column, int row)
@@ -506,12 +643,12 @@ cell cell::offset(int column, int row)
 
 worksheet cell::worksheet()
 {
-    return xlnt::worksheet(d_->parent_);
+    return xlnt::worksheet(impl(d_).parent_);
 }
 
 const worksheet cell::worksheet() const
 {
-    return xlnt::worksheet(d_->parent_);
+    return xlnt::worksheet(impl(d_).parent_);
 }
 
 workbook &cell::workbook()
@@ -528,14 +665,14 @@ std::pair<int, int> cell::anchor() const
 {
     double left = 0;
 
-    for (column_t column_index = 1; column_index <= d_->column_ - 1; column_index++)
+    for (column_t column_index = 1; column_index <= impl(d_).column_ - 1; column_index++)
     {
         left += worksheet().column_width(column_index);
     }
 
     double top = 0;
 
-    for (row_t row_index = 1; row_index <= d_->row_ - 1; row_index++)
+    for (row_t row_index = 1; row_index <= impl(d_).row_ - 1; row_index++)
     {
         top += worksheet().row_height(row_index);
     }
@@ -543,14 +680,33 @@ std::pair<int, int> cell::anchor() const
     return {static_cast<int>(left), static_cast<int>(top)};
 }
 
+void cell::notify_changed(bool formula)
+{
+    const auto &d = impl(d_);
+    d.parent_->changed();
+
+    auto &engine = d.parent_->parent_->d_->formula_engine_;
+
+    if (engine)
+    {
+        engine->value_changed(d.parent_, d.row_, d.column_.index);
+
+        if (formula)
+        {
+            engine->formula_changed();
+        }
+    }
+}
+
 cell::type cell::data_type() const
 {
-    return d_->type_;
+    return impl(d_).type_;
 }
 
 void cell::data_type(type t)
 {
-    d_->type_ = t;
+    impl(d_).type_ = t;
+    notify_changed(false);
 }
 
 number_format cell::computed_number_format() const
@@ -585,76 +741,77 @@ protection cell::computed_protection() const
 
 void cell::clear_value()
 {
-    d_->value_numeric_ = 0;
-    d_->value_text_.clear();
-    d_->type_ = cell::type::empty;
+    impl(d_).value_numeric_ = 0;
+    impl(d_).value_text_.clear();
+    impl(d_).type_ = cell::type::empty;
     clear_formula();
+    notify_changed(false);
 }
 
 template <>
 XLNT_API bool cell::value() const
 {
-    return d_->value_numeric_ != 0.0;
+    return impl(d_).value_numeric_ != 0.0;
 }
 
 template <>
 XLNT_API int cell::value() const
 {
-    return static_cast<int>(d_->value_numeric_);
+    return static_cast<int>(impl(d_).value_numeric_);
 }
 
 template <>
 XLNT_API long long int cell::value() const
 {
-    return static_cast<long long int>(d_->value_numeric_);
+    return static_cast<long long int>(impl(d_).value_numeric_);
 }
 
 template <>
 XLNT_API unsigned int cell::value() const
 {
-    return static_cast<unsigned int>(d_->value_numeric_);
+    return static_cast<unsigned int>(impl(d_).value_numeric_);
 }
 
 template <>
 XLNT_API unsigned long long cell::value() const
 {
-    return static_cast<unsigned long long>(d_->value_numeric_);
+    return static_cast<unsigned long long>(impl(d_).value_numeric_);
 }
 
 template <>
 XLNT_API float cell::value() const
 {
-    return static_cast<float>(d_->value_numeric_);
+    return static_cast<float>(impl(d_).value_numeric_);
 }
 
 template <>
 XLNT_API double cell::value() const
 {
-    return static_cast<double>(d_->value_numeric_);
+    return static_cast<double>(impl(d_).value_numeric_);
 }
 
 template <>
 XLNT_API time cell::value() const
 {
-    return time::from_number(d_->value_numeric_);
+    return time::from_number(impl(d_).value_numeric_);
 }
 
 template <>
 XLNT_API datetime cell::value() const
 {
-    return datetime::from_number(d_->value_numeric_, base_date());
+    return datetime::from_number(impl(d_).value_numeric_, base_date());
 }
 
 template <>
 XLNT_API date cell::value() const
 {
-    return date::from_number(static_cast<int>(d_->value_numeric_), base_date());
+    return date::from_number(static_cast<int>(impl(d_).value_numeric_), base_date());
 }
 
 template <>
 XLNT_API timedelta cell::value() const
 {
-    return timedelta::from_number(d_->value_numeric_);
+    return timedelta::from_number(impl(d_).value_numeric_);
 }
 
 void cell::alignment(const class alignment &alignment_)
@@ -704,15 +861,15 @@ XLNT_API rich_text cell::value() const
 {
     if (data_type() == cell::type::shared_string)
     {
-        return workbook().shared_strings(static_cast<std::size_t>(d_->value_numeric_));
+        return workbook().shared_strings(static_cast<std::size_t>(impl(d_).value_numeric_));
     }
 
-    return d_->value_text_;
+    return impl(d_).value_text_;
 }
 
 bool cell::has_value() const
 {
-    return d_->type_ != cell::type::empty;
+    return impl(d_).type_ != cell::type::empty;
 }
 
 std::string cell::to_string() const
@@ -740,23 +897,27 @@ std::string cell::to_string() const
 
 bool cell::has_format() const
 {
-    return d_->format_.is_set();
+    return impl(d_).format_.is_set();
 }
 
 void cell::format(const class format new_format)
 {
+    impl(d_).parent_->changed();
+
     if (has_format())
     {
         format().d_->references -= format().d_->references > 0 ? 1 : 0;
     }
 
     ++new_format.d_->references;
-    d_->format_ = new_format.d_;
+    impl(d_).format_ = new_format.d_;
 }
 
 calendar cell::base_date() const
 {
-    return workbook().base_date();
+    // read directly rather than through worksheet and workbook handles since
+    // value<datetime>() calls this for every cell
+    return impl(d_).parent_->parent_->d_->base_date_;
 }
 
 bool operator==(std::nullptr_t, const cell &cell)
@@ -799,8 +960,8 @@ void cell::value(const std::string &value_string, bool infer_type)
 
     if (percentage.first)
     {
-        d_->value_numeric_ = percentage.second;
-        d_->type_ = cell::type::number;
+        impl(d_).value_numeric_ = percentage.second;
+        impl(d_).type_ = cell::type::number;
         number_format(xlnt::number_format::percentage());
     }
     else
@@ -809,9 +970,9 @@ void cell::value(const std::string &value_string, bool infer_type)
 
         if (time.first)
         {
-            d_->type_ = cell::type::number;
+            impl(d_).type_ = cell::type::number;
             number_format(number_format::date_time6());
-            d_->value_numeric_ = time.second.to_number();
+            impl(d_).value_numeric_ = time.second.to_number();
         }
         else
         {
@@ -819,8 +980,8 @@ void cell::value(const std::string &value_string, bool infer_type)
 
             if (numeric.first)
             {
-                d_->value_numeric_ = numeric.second;
-                d_->type_ = cell::type::number;
+                impl(d_).value_numeric_ = numeric.second;
+                impl(d_).type_ = cell::type::number;
             }
         }
     }
@@ -828,10 +989,11 @@ void cell::value(const std::string &value_string, bool infer_type)
 
 void cell::clear_format()
 {
-    if (d_->format_.is_set())
+    if (impl(d_).format_.is_set())
     {
+        impl(d_).parent_->changed();
         format().d_->references -= format().d_->references > 0 ? 1 : 0;
-        d_->format_.clear();
+        impl(d_).format_.clear();
     }
 }
 
@@ -883,22 +1045,22 @@ bool cell::has_style() const
 
 format cell::modifiable_format()
 {
-    if (!d_->format_.is_set())
+    if (!impl(d_).format_.is_set())
     {
         throw invalid_attribute();
     }
 
-    return xlnt::format(d_->format_.get());
+    return xlnt::format(impl(d_).format_.get());
 }
 
 const format cell::format() const
 {
-    if (!d_->format_.is_set())
+    if (!impl(d_).format_.is_set())
     {
         throw invalid_attribute();
     }
 
-    return xlnt::format(d_->format_.get());
+    return xlnt::format(impl(d_).format_.get());
 }
 
 alignment cell::alignment() const
@@ -933,22 +1095,23 @@ protection cell::protection() const
 
 bool cell::has_hyperlink() const
 {
-    return d_->hyperlink_.is_set();
+    return impl(d_).hyperlink_.is_set();
 }
 
 // comment
 
 bool cell::has_comment()
 {
-    return d_->comment_.is_set();
+    return impl(d_).comment_;
 }
 
 void cell::clear_comment()
 {
     if (has_comment())
     {
-        d_->parent_->comments_.erase(reference().to_string());
-        d_->comment_.clear();
+        impl(d_).parent_->changed();
+        impl(d_).parent_->comments_.erase(reference().to_string());
+        impl(d_).comment_ = false;
     }
 }
 
@@ -959,7 +1122,7 @@ class comment cell::comment()
         throw xlnt::exception("cell has no comment");
     }
 
-    return *d_->comment_.get();
+    return impl(d_).parent_->comments_.at(reference().to_string());
 }
 
 void cell::comment(const std::string &text, const std::string &author)
@@ -975,23 +1138,19 @@ void cell::comment(const std::string &text, const class font &comment_font, cons
 
 void cell::comment(const class comment &new_comment)
 {
-    if (has_comment())
-    {
-        *d_->comment_.get() = new_comment;
-    }
-    else
-    {
-        d_->parent_->comments_[reference().to_string()] = new_comment;
-        d_->comment_.set(&d_->parent_->comments_[reference().to_string()]);
-    }
+    impl(d_).parent_->changed();
+
+    auto &stored = impl(d_).parent_->comments_[reference().to_string()];
+    stored = new_comment;
+    impl(d_).comment_ = true;
 
     // offset comment 5 pixels down and 5 pixels right of the top right corner of the cell
     auto cell_position = anchor();
     cell_position.first += static_cast<int>(width()) + 5;
     cell_position.second += 5;
 
-    d_->comment_.get()->position(cell_position.first, cell_position.second);
-    d_->comment_.get()->size(200, 100);
+    stored.position(cell_position.first, cell_position.second);
+    stored.size(200, 100);
 
     worksheet().register_comments_in_manifest();
 }
@@ -22,6 +22,7 @@
 // @license: http://www.opensource.org/licenses/mit-license.php
 // @author: see AUTHORS file
 #include <numeric>
+#include <utility>
 
 #include <xlnt/cell/rich_text.hpp>
 #include <xlnt/cell/rich_text_run.hpp>
@@ -45,11 +46,22 @@ rich_text::rich_text(const std::string &plain_text, const class font &text_font)
 {
 }
 
+rich_text::rich_text(std::string &&plain_text)
+{
+    const auto preserve_space = has_trailing_whitespace(plain_text);
+    add_run(rich_text_run{std::move(plain_text), optional<font>(), preserve_space});
+}
+
 rich_text::rich_text(const rich_text &other)
 {
     *this = other;
 }
 
+rich_text::rich_text(rich_text &&other) noexcept
+    : runs_(std::move(other.runs_))
+{
+}
+
 rich_text &rich_text::operator=(const rich_text &rhs)
 {
     runs_.clear();
@@ -57,6 +69,12 @@ rich_text &rich_text::operator=(const rich_text &rhs)
     return *this;
 }
 
+rich_text &rich_text::operator=(rich_text &&rhs) noexcept
+{
+    runs_ = std::move(rhs.runs_);
+    return *this;
+}
+
 rich_text::rich_text(const rich_text_run &single_run)
 {
     add_run(single_run);
@@ -99,6 +117,11 @@ void rich_text::add_run(const rich_text_run &t)
     runs_.push_back(t);
 }
 
+void rich_text::add_run(rich_text_run &&t)
+{
+    runs_.push_back(std::move(t));
+}
+
 bool rich_text::operator==(const rich_text &rhs) const
 {
     if (runs_.size() != rhs.runs_.size()) return false;
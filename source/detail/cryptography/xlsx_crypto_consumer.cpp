@@ -38,6 +38,7 @@
 #include <detail/serialization/vector_streambuf.hpp>
 #include <detail/serialization/xlsx_consumer.hpp>
 #include <xlnt/utils/exceptions.hpp>
+#include <xlnt/workbook/serialization_options.hpp>
 
 namespace {
 
@@ -306,15 +307,16 @@ encryption_info read_encryption_info(std::istream &info_stream, const std::u16st
 }
 
 std::vector<std::uint8_t> decrypt_xlsx(
-    const std::vector<std::uint8_t> &bytes,
+    const std::uint8_t *data,
+    std::size_t size,
     const std::u16string &password)
 {
-    if (bytes.empty())
+    if (size == 0)
     {
         throw xlnt::exception("empty file");
     }
 
-    xlnt::detail::vector_istreambuf buffer(bytes);
+    xlnt::detail::vector_istreambuf buffer(data, size);
     std::istream stream(&buffer);
     xlnt::detail::compound_document document(stream);
 
@@ -335,16 +337,19 @@ namespace detail {
 
 std::vector<std::uint8_t> XLNT_API decrypt_xlsx(const std::vector<std::uint8_t> &data, const std::string &password)
 {
-    return ::decrypt_xlsx(data, utf8_to_utf16(password));
+    return ::decrypt_xlsx(data.data(), data.size(), utf8_to_utf16(password));
 }
 
 void xlsx_consumer::read(std::istream &source, const std::string &password)
 {
     std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(source)), (std::istreambuf_iterator<char>()));
-    const auto decrypted = decrypt_xlsx(data, password);
-    vector_istreambuf decrypted_buffer(decrypted);
-    std::istream decrypted_stream(&decrypted_buffer);
-    read(decrypted_stream);
+    read(data.data(), data.size(), password);
+}
+
+void xlsx_consumer::read(const std::uint8_t *data, std::size_t size, const std::string &password)
+{
+    const auto decrypted = ::decrypt_xlsx(data, size, utf8_to_utf16(password));
+    read(decrypted.data(), decrypted.size(), load_options());
 }
 
 } // namespace detail
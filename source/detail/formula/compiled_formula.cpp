@@ -0,0 +1,87 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <utility>
+
+#include <detail/formula/compiled_formula.hpp>
+
+namespace xlnt {
+namespace detail {
+
+formula_value formula_value::from_number(double number)
+{
+    formula_value result;
+    result.type = formula_value_type::number;
+    result.number = number;
+
+    return result;
+}
+
+formula_value formula_value::from_string(std::string text)
+{
+    formula_value result;
+    result.type = formula_value_type::string;
+    result.text = std::move(text);
+
+    return result;
+}
+
+formula_value formula_value::from_boolean(bool boolean)
+{
+    formula_value result;
+    result.type = formula_value_type::boolean;
+    result.number = boolean ? 1.0 : 0.0;
+
+    return result;
+}
+
+formula_value formula_value::from_error(std::string code)
+{
+    formula_value result;
+    result.type = formula_value_type::error;
+    result.text = std::move(code);
+
+    return result;
+}
+
+bool operator==(const formula_value &lhs, const formula_value &rhs)
+{
+    return lhs.type == rhs.type
+        && lhs.number == rhs.number
+        && lhs.text == rhs.text;
+}
+
+bool formula_reference::is_single_cell() const
+{
+    return top == bottom && left == right;
+}
+
+bool formula_reference::contains(const worksheet_impl *other_sheet, row_t row, column_t::index_t column) const
+{
+    return sheet == other_sheet
+        && row >= top && row <= bottom
+        && column >= left && column <= right;
+}
+
+} // namespace detail
+} // namespace xlnt
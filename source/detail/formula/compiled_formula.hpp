@@ -0,0 +1,154 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <xlnt/cell/index_types.hpp>
+
+namespace xlnt {
+namespace detail {
+
+struct worksheet_impl;
+
+/// <summary>
+/// The type of a formula_value.
+/// </summary>
+enum class formula_value_type : std::uint8_t
+{
+    empty,
+    number,
+    string,
+    boolean,
+    error
+};
+
+/// <summary>
+/// The value of a cell or of an expression in a formula. Errors keep their code
+/// (e.g. "#DIV/0!") in text.
+/// </summary>
+struct formula_value
+{
+    formula_value_type type = formula_value_type::empty;
+    double number = 0.0;
+    std::string text;
+
+    static formula_value from_number(double number);
+    static formula_value from_string(std::string text);
+    static formula_value from_boolean(bool boolean);
+    static formula_value from_error(std::string code);
+};
+
+bool operator==(const formula_value &lhs, const formula_value &rhs);
+
+/// <summary>
+/// A rectangle of cells referred to by a formula. Bounds are inclusive and a
+/// whole column reference such as A:A extends to the last possible row.
+/// </summary>
+struct formula_reference
+{
+    const worksheet_impl *sheet;
+    row_t top;
+    column_t::index_t left;
+    row_t bottom;
+    column_t::index_t right;
+
+    bool is_single_cell() const;
+    bool contains(const worksheet_impl *other_sheet, row_t row, column_t::index_t column) const;
+};
+
+enum class formula_token_type : std::uint8_t
+{
+    number, // index into numbers
+    string, // index into strings
+    boolean, // code is 0 or 1
+    error, // index into strings
+    missing, // an omitted function argument
+    reference, // index into references
+    unary, // code is a formula_operator
+    binary, // code is a formula_operator
+    percent,
+    function // code is a formula_function, argument_count is set
+};
+
+enum class formula_operator : std::uint8_t
+{
+    add,
+    subtract,
+    multiply,
+    divide,
+    power,
+    concatenate,
+    equal,
+    not_equal,
+    less,
+    less_equal,
+    greater,
+    greater_equal,
+    negate,
+    plus
+};
+
+enum class formula_function : std::uint8_t
+{
+    sum,
+    average,
+    count,
+    min,
+    max,
+    if_,
+    vlookup,
+    index,
+    match,
+    unknown
+};
+
+/// <summary>
+/// One element of a formula in postfix order. Operands are pushed and operators
+/// and functions pop their arguments, so evaluation needs only a stack.
+/// </summary>
+struct formula_token
+{
+    formula_token_type type;
+    std::uint8_t code;
+    std::uint16_t argument_count;
+    std::uint32_t index;
+};
+
+/// <summary>
+/// A parsed formula. Literals and references are stored out of line so each token
+/// is eight bytes.
+/// </summary>
+struct compiled_formula
+{
+    std::vector<formula_token> tokens;
+    std::vector<double> numbers;
+    std::vector<std::string> strings;
+    std::vector<formula_reference> references;
+};
+
+} // namespace detail
+} // namespace xlnt
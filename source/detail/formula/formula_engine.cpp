@@ -0,0 +1,629 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <thread>
+
+#include <detail/constants.hpp>
+#include <detail/formula/formula_engine.hpp>
+#include <detail/formula/formula_parser.hpp>
+#include <detail/formula/shared_formula.hpp>
+#include <detail/implementations/heap_usage.hpp>
+#include <detail/implementations/workbook_impl.hpp>
+#include <detail/implementations/worksheet_impl.hpp>
+
+namespace {
+
+// Levels with fewer formulas than this aren't worth starting threads for.
+const std::size_t min_parallel_level = 256;
+
+std::string to_lower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), [](char c) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    });
+
+    return text;
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+formula_engine::formula_engine(workbook_impl &workbook)
+    : workbook_(workbook),
+      built_(false),
+      rebuild_(false)
+{
+}
+
+void formula_engine::calculate(std::size_t threads)
+{
+    if (sheets_changed())
+    {
+        reset();
+    }
+
+    std::vector<std::size_t> seeds;
+
+    if (!built_ || rebuild_)
+    {
+        seeds = build();
+    }
+
+    for (const auto &position : changed_)
+    {
+        const auto row = static_cast<row_t>(position.second >> 32);
+        const auto column = static_cast<column_t::index_t>(position.second & 0xffffffff);
+
+        const auto readers = cell_readers_.find(position.first);
+
+        if (readers != cell_readers_.end())
+        {
+            const auto found = readers->second.find(position.second);
+
+            if (found != readers->second.end())
+            {
+                seeds.insert(seeds.end(), found->second.begin(), found->second.end());
+            }
+        }
+
+        for (const auto &reader : range_readers_)
+        {
+            if (reader.first.contains(position.first, row, column))
+            {
+                seeds.push_back(reader.second);
+            }
+        }
+
+        const auto formula_cell = find(position.first, row, column);
+
+        if (formula_cell != nullptr)
+        {
+            seeds.push_back(static_cast<std::size_t>(formula_cell - nodes_.data()));
+        }
+    }
+
+    changed_.clear();
+    built_ = true;
+    rebuild_ = false;
+
+    update_extents();
+    evaluate(std::move(seeds), std::max(threads, std::size_t(1)));
+}
+
+void formula_engine::value_changed(const worksheet_impl *sheet, row_t row, column_t::index_t column)
+{
+    if (built_)
+    {
+        changed_.emplace_back(sheet, key(row, column));
+    }
+}
+
+void formula_engine::formula_changed()
+{
+    rebuild_ = true;
+}
+
+void formula_engine::reset()
+{
+    nodes_.clear();
+    formula_cells_.clear();
+    cell_readers_.clear();
+    range_readers_.clear();
+    sheets_.clear();
+    extents_.clear();
+    changed_.clear();
+    built_ = false;
+    rebuild_ = false;
+}
+
+std::size_t formula_engine::memory_usage() const
+{
+    auto bytes = heap_usage::of(nodes_) + heap_usage::of(range_readers_) + heap_usage::of(sheets_)
+        + heap_usage::of(changed_) + heap_usage::of_hash_table(extents_);
+
+    for (const auto &formula_cell : nodes_)
+    {
+        const auto &formula = formula_cell.formula;
+
+        bytes += heap_usage::of(formula_cell.source) + heap_usage::of(formula_cell.result.text)
+            + heap_usage::of(formula_cell.dependents) + heap_usage::of(formula.tokens)
+            + heap_usage::of(formula.numbers) + heap_usage::of(formula.strings) + heap_usage::of(formula.references);
+
+        for (const auto &text : formula.strings)
+        {
+            bytes += heap_usage::of(text);
+        }
+    }
+
+    bytes += heap_usage::of_hash_table(formula_cells_);
+
+    for (const auto &sheet : formula_cells_)
+    {
+        bytes += heap_usage::of_tree(sheet.second);
+
+        for (const auto &column : sheet.second)
+        {
+            bytes += heap_usage::of_tree(column.second);
+        }
+    }
+
+    bytes += heap_usage::of_hash_table(cell_readers_);
+
+    for (const auto &sheet : cell_readers_)
+    {
+        bytes += heap_usage::of_hash_table(sheet.second);
+
+        for (const auto &readers : sheet.second)
+        {
+            bytes += heap_usage::of(readers.second);
+        }
+    }
+
+    for (const auto &sheet : sheets_)
+    {
+        bytes += heap_usage::of(sheet.second);
+    }
+
+    return bytes;
+}
+
+formula_value formula_engine::value(const worksheet_impl *sheet, row_t row, column_t::index_t column) const
+{
+    const auto formula_cell = find(sheet, row, column);
+
+    if (formula_cell != nullptr)
+    {
+        return formula_cell->result;
+    }
+
+    const auto cell = sheet->cell_map_.find(row, column_t(column));
+
+    if (cell == nullptr)
+    {
+        return formula_value();
+    }
+
+    switch (cell->type_)
+    {
+    case cell_type::empty:
+        return formula_value();
+    case cell_type::boolean:
+        return formula_value::from_boolean(cell->value_numeric_ != 0.0);
+    case cell_type::date:
+    case cell_type::number:
+        return formula_value::from_number(cell->value_numeric_);
+    case cell_type::error:
+        return formula_value::from_error(cell->value_text_.plain_text());
+    case cell_type::shared_string:
+    {
+        const auto &strings = workbook_.shared_strings_.values();
+        const auto index = static_cast<std::size_t>(cell->value_numeric_);
+
+        return formula_value::from_string(index < strings.size() ? strings[index].plain_text() : std::string());
+    }
+    case cell_type::inline_string:
+    case cell_type::formula_string:
+        return formula_value::from_string(cell->value_text_.plain_text());
+    }
+
+    return formula_value();
+}
+
+std::pair<row_t, column_t::index_t> formula_engine::extent(const worksheet_impl *sheet) const
+{
+    const auto found = extents_.find(sheet);
+
+    if (found != extents_.end())
+    {
+        return found->second;
+    }
+
+    // Ranges on sheets without an entry are bounded, so there's nothing to clip.
+    return {std::numeric_limits<row_t>::max(), std::numeric_limits<column_t::index_t>::max()};
+}
+
+std::vector<std::size_t> formula_engine::build()
+{
+    std::unordered_map<std::string, const worksheet_impl *> sheets;
+    std::unordered_map<const worksheet_impl *, std::unordered_map<std::uint64_t, std::size_t>> previous;
+
+    for (std::size_t i = 0; i < nodes_.size(); ++i)
+    {
+        previous[nodes_[i].sheet][key(nodes_[i].row, nodes_[i].column)] = i;
+    }
+
+    sheets_.clear();
+
+    for (auto &sheet : workbook_.worksheets_)
+    {
+        sheets_.emplace_back(&sheet, sheet.title_);
+        sheets[to_lower(sheet.title_)] = &sheet;
+    }
+
+    std::vector<node> nodes;
+    std::vector<std::size_t> seeds;
+
+    for (auto &sheet : workbook_.worksheets_)
+    {
+        const auto &old_cells = previous[&sheet];
+
+        sheet.cell_map_.for_each_row([&](row_t row, const cell_store::row_type &cells) {
+            for (const auto &cell : cells)
+            {
+                if (!cell.second.formula_.is_set() && cell.second.shared_formula_ == 0) continue;
+
+                const auto source = cell_formula(sheet.shared_formulas_, cell.second);
+                const auto old = old_cells.find(key(row, cell.first.index));
+
+                if (old != old_cells.end() && nodes_[old->second].source == source)
+                {
+                    nodes.push_back(std::move(nodes_[old->second]));
+                    nodes.back().dependents.clear();
+                }
+                else
+                {
+                    node formula_cell;
+                    formula_cell.sheet = &sheet;
+                    formula_cell.row = row;
+                    formula_cell.column = cell.first.index;
+                    formula_cell.source = source;
+                    formula_cell.formula = formula_parser(source, &sheet, sheets).parse();
+
+                    seeds.push_back(nodes.size());
+                    nodes.push_back(std::move(formula_cell));
+                }
+            }
+        });
+    }
+
+    nodes_ = std::move(nodes);
+    formula_cells_.clear();
+    cell_readers_.clear();
+    range_readers_.clear();
+
+    for (std::size_t i = 0; i < nodes_.size(); ++i)
+    {
+        formula_cells_[nodes_[i].sheet][nodes_[i].column][nodes_[i].row] = i;
+    }
+
+    for (std::size_t i = 0; i < nodes_.size(); ++i)
+    {
+        for (const auto &reference : nodes_[i].formula.references)
+        {
+            if (reference.is_single_cell())
+            {
+                cell_readers_[reference.sheet][key(reference.top, reference.left)].push_back(i);
+            }
+            else
+            {
+                range_readers_.emplace_back(reference, i);
+            }
+
+            const auto sheet_cells = formula_cells_.find(reference.sheet);
+            if (sheet_cells == formula_cells_.end()) continue;
+
+            const auto &columns = sheet_cells->second;
+
+            for (auto column = columns.lower_bound(reference.left);
+                 column != columns.end() && column->first <= reference.right; ++column)
+            {
+                for (auto row = column->second.lower_bound(reference.top);
+                     row != column->second.end() && row->first <= reference.bottom; ++row)
+                {
+                    nodes_[row->second].dependents.push_back(i);
+                }
+            }
+        }
+    }
+
+    for (auto &formula_cell : nodes_)
+    {
+        auto &dependents = formula_cell.dependents;
+        std::sort(dependents.begin(), dependents.end());
+        dependents.erase(std::unique(dependents.begin(), dependents.end()), dependents.end());
+    }
+
+    assign_levels();
+
+    return seeds;
+}
+
+void formula_engine::assign_levels()
+{
+    std::vector<std::size_t> precedents(nodes_.size(), 0);
+
+    for (const auto &formula_cell : nodes_)
+    {
+        for (auto dependent : formula_cell.dependents)
+        {
+            ++precedents[dependent];
+        }
+    }
+
+    std::vector<std::size_t> ready;
+
+    for (std::size_t i = 0; i < nodes_.size(); ++i)
+    {
+        nodes_[i].level = 0;
+        nodes_[i].cyclic = true;
+
+        if (precedents[i] == 0)
+        {
+            ready.push_back(i);
+        }
+    }
+
+    while (!ready.empty())
+    {
+        const auto current = ready.back();
+        ready.pop_back();
+        nodes_[current].cyclic = false;
+
+        for (auto dependent : nodes_[current].dependents)
+        {
+            nodes_[dependent].level = std::max(nodes_[dependent].level, nodes_[current].level + 1);
+
+            if (--precedents[dependent] == 0)
+            {
+                ready.push_back(dependent);
+            }
+        }
+    }
+}
+
+void formula_engine::evaluate(std::vector<std::size_t> seeds, std::size_t threads)
+{
+    // Everything reachable from the seeds might need evaluating, but a formula is only
+    // evaluated if one of its precedents was, and only passes that on if its result changed.
+    std::vector<bool> candidate(nodes_.size(), false);
+    std::vector<bool> dirty(nodes_.size(), false);
+    std::vector<std::size_t> candidates;
+
+    for (auto seed : seeds)
+    {
+        dirty[seed] = true;
+
+        if (!candidate[seed])
+        {
+            candidate[seed] = true;
+            candidates.push_back(seed);
+        }
+    }
+
+    for (std::size_t i = 0; i < candidates.size(); ++i)
+    {
+        for (auto dependent : nodes_[candidates[i]].dependents)
+        {
+            if (!candidate[dependent])
+            {
+                candidate[dependent] = true;
+                candidates.push_back(dependent);
+            }
+        }
+    }
+
+    // Cyclic formulas have no meaningful level, so they're evaluated last.
+    const auto rank = [this](std::size_t index) {
+        return nodes_[index].cyclic ? std::numeric_limits<std::size_t>::max() : nodes_[index].level;
+    };
+
+    std::sort(candidates.begin(), candidates.end(),
+        [&rank](std::size_t a, std::size_t b) { return rank(a) < rank(b); });
+
+    std::vector<std::size_t> level;
+    std::vector<std::size_t> changed;
+
+    auto evaluate_range = [this, &level, &changed](std::size_t first, std::size_t last) {
+        formula_evaluator evaluator(*this);
+
+        for (auto i = first; i < last; ++i)
+        {
+            auto &formula_cell = nodes_[level[i]];
+            auto result = formula_cell.cyclic
+                ? formula_value::from_error("#REF!")
+                : evaluator.evaluate(formula_cell.formula);
+
+            if (!(result == formula_cell.result))
+            {
+                formula_cell.result = std::move(result);
+                changed[i] = true;
+            }
+        }
+    };
+
+    for (std::size_t first = 0; first < candidates.size();)
+    {
+        auto last = first;
+
+        while (last < candidates.size() && rank(candidates[last]) == rank(candidates[first]))
+        {
+            ++last;
+        }
+
+        level.clear();
+
+        for (auto i = first; i < last; ++i)
+        {
+            if (dirty[candidates[i]])
+            {
+                level.push_back(candidates[i]);
+            }
+        }
+
+        changed.assign(level.size(), false);
+
+        const auto workers = level.size() < min_parallel_level ? std::size_t(1) : std::min(threads, level.size());
+
+        if (workers == 1)
+        {
+            evaluate_range(0, level.size());
+        }
+        else
+        {
+            std::vector<std::thread> pool;
+            const auto chunk = (level.size() + workers - 1) / workers;
+
+            for (std::size_t start = 0; start < level.size(); start += chunk)
+            {
+                pool.emplace_back(evaluate_range, start, std::min(start + chunk, level.size()));
+            }
+
+            for (auto &thread : pool)
+            {
+                thread.join();
+            }
+        }
+
+        for (std::size_t i = 0; i < level.size(); ++i)
+        {
+            store(nodes_[level[i]]);
+
+            // New formulas start out empty, which no formula evaluates to, so they count as changed.
+            if (!changed[i]) continue;
+
+            for (auto dependent : nodes_[level[i]].dependents)
+            {
+                dirty[dependent] = true;
+            }
+        }
+
+        first = last;
+    }
+}
+
+void formula_engine::store(const node &formula_cell)
+{
+    auto &cell = formula_cell.sheet->cell_map_.existing_row(formula_cell.row).at(column_t(formula_cell.column));
+    const auto &result = formula_cell.result;
+    formula_cell.sheet->changed();
+
+    switch (result.type)
+    {
+    case formula_value_type::empty:
+    case formula_value_type::number:
+        cell.type_ = cell_type::number;
+        cell.value_numeric_ = result.number;
+        cell.value_text_.clear();
+        break;
+    case formula_value_type::boolean:
+        cell.type_ = cell_type::boolean;
+        cell.value_numeric_ = result.number;
+        cell.value_text_.clear();
+        break;
+    case formula_value_type::string:
+        cell.type_ = cell_type::formula_string;
+        cell.value_numeric_ = 0.0;
+        cell.value_text_ = rich_text(result.text);
+        break;
+    case formula_value_type::error:
+        cell.type_ = cell_type::error;
+        cell.value_numeric_ = 0.0;
+        cell.value_text_ = rich_text(result.text);
+        break;
+    }
+}
+
+bool formula_engine::sheets_changed() const
+{
+    if (!built_) return false;
+    if (sheets_.size() != workbook_.worksheets_.size()) return true;
+
+    auto expected = sheets_.begin();
+
+    for (const auto &sheet : workbook_.worksheets_)
+    {
+        if (expected->first != &sheet || expected->second != sheet.title_)
+        {
+            return true;
+        }
+
+        ++expected;
+    }
+
+    return false;
+}
+
+void formula_engine::update_extents()
+{
+    // Only ranges that are unbounded, such as A:A or 1:1, need clipping to the cells
+    // that actually exist.
+    std::unordered_map<const worksheet_impl *, std::pair<bool, bool>> unbounded;
+
+    for (const auto &reader : range_readers_)
+    {
+        auto &sheet = unbounded[reader.first.sheet];
+        sheet.first = sheet.first || reader.first.bottom == std::numeric_limits<row_t>::max();
+        sheet.second = sheet.second || reader.first.right == std::numeric_limits<column_t::index_t>::max();
+    }
+
+    extents_.clear();
+
+    for (const auto &sheet : unbounded)
+    {
+        if (!sheet.second.first && !sheet.second.second) continue;
+
+        row_t last_row = 0;
+        column_t::index_t last_column = 0;
+
+        sheet.first->cell_map_.for_each_row_index([&last_row](row_t row) { last_row = std::max(last_row, row); });
+
+        if (sheet.second.second)
+        {
+            auto lowest = constants::max_column();
+            auto highest = constants::min_column();
+            sheet.first->cell_map_.column_bounds(lowest, highest);
+            last_column = sheet.first->cell_map_.empty() ? 0 : highest.index;
+        }
+
+        extents_[sheet.first] = {
+            sheet.second.first ? last_row : std::numeric_limits<row_t>::max(),
+            sheet.second.second ? last_column : std::numeric_limits<column_t::index_t>::max()};
+    }
+}
+
+const formula_engine::node *formula_engine::find(const worksheet_impl *sheet, row_t row, column_t::index_t column) const
+{
+    const auto sheet_cells = formula_cells_.find(sheet);
+    if (sheet_cells == formula_cells_.end()) return nullptr;
+
+    const auto column_cells = sheet_cells->second.find(column);
+    if (column_cells == sheet_cells->second.end()) return nullptr;
+
+    const auto found = column_cells->second.find(row);
+    if (found == column_cells->second.end()) return nullptr;
+
+    return &nodes_[found->second];
+}
+
+std::uint64_t formula_engine::key(row_t row, column_t::index_t column)
+{
+    return (std::uint64_t(row) << 32) | column;
+}
+
+} // namespace detail
+} // namespace xlnt
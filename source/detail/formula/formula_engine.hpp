@@ -0,0 +1,167 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <detail/formula/compiled_formula.hpp>
+#include <detail/formula/formula_evaluator.hpp>
+
+namespace xlnt {
+namespace detail {
+
+struct workbook_impl;
+
+/// <summary>
+/// Calculates the formulas of a workbook and keeps the results up to date.
+/// Formulas are compiled once and linked into a dependency graph where each formula
+/// cell knows the formula cells that read it. Formulas are evaluated one level of the
+/// graph at a time, so formulas in the same level never depend on each other and can
+/// be evaluated in parallel. After the first calculation only formulas reading a cell
+/// that changed since, directly or through other formulas, are evaluated again.
+/// Results are stored as the cached values of the formula cells.
+/// </summary>
+class formula_engine : public formula_context
+{
+public:
+    explicit formula_engine(workbook_impl &workbook);
+
+    /// <summary>
+    /// Evaluates every formula that may have changed since the last call, using up to
+    /// threads threads, and stores the results in their cells.
+    /// </summary>
+    void calculate(std::size_t threads);
+
+    /// <summary>
+    /// Records that the value of the given cell changed.
+    /// </summary>
+    void value_changed(const worksheet_impl *sheet, row_t row, column_t::index_t column);
+
+    /// <summary>
+    /// Records that a formula was added, removed or changed, so the dependency
+    /// graph is rebuilt on the next calculation.
+    /// </summary>
+    void formula_changed();
+
+    /// <summary>
+    /// Forgets everything so the next calculation starts over. Used when cells move.
+    /// </summary>
+    void reset();
+
+    /// <summary>
+    /// Returns an estimate of the bytes used by the compiled formulas, the
+    /// dependency graph and the stored results.
+    /// </summary>
+    std::size_t memory_usage() const;
+
+    formula_value value(const worksheet_impl *sheet, row_t row, column_t::index_t column) const override;
+
+    std::pair<row_t, column_t::index_t> extent(const worksheet_impl *sheet) const override;
+
+private:
+    struct node
+    {
+        worksheet_impl *sheet;
+        row_t row;
+        column_t::index_t column;
+        std::string source;
+        compiled_formula formula;
+        formula_value result;
+        // formula cells whose formulas refer to this cell
+        std::vector<std::size_t> dependents;
+        std::size_t level;
+        bool cyclic;
+    };
+
+    // formula cells of one sheet by column and then by row, for finding those in a range
+    using column_index = std::map<column_t::index_t, std::map<row_t, std::size_t>>;
+
+    /// <summary>
+    /// Compiles every formula in the workbook, reusing previous compilations of
+    /// unchanged formulas, and links the dependency graph. Returns the nodes that
+    /// are new or whose formula changed.
+    /// </summary>
+    std::vector<std::size_t> build();
+
+    /// <summary>
+    /// Assigns each node a level one greater than the highest level among the formulas
+    /// it reads. Nodes in a cycle are marked cyclic.
+    /// </summary>
+    void assign_levels();
+
+    /// <summary>
+    /// Evaluates the given nodes and, as far as their results change, the nodes
+    /// depending on them, in order of level.
+    /// </summary>
+    void evaluate(std::vector<std::size_t> seeds, std::size_t threads);
+
+    /// <summary>
+    /// Writes the result of a node to its cell.
+    /// </summary>
+    void store(const node &formula_cell);
+
+    /// <summary>
+    /// Returns true if the worksheets or their titles changed since the graph was built.
+    /// </summary>
+    bool sheets_changed() const;
+
+    /// <summary>
+    /// Records the last row and column of every sheet with a whole row or column
+    /// referenced by a formula.
+    /// </summary>
+    void update_extents();
+
+    /// <summary>
+    /// Returns the node of the given cell or nullptr if it doesn't have a formula.
+    /// </summary>
+    const node *find(const worksheet_impl *sheet, row_t row, column_t::index_t column) const;
+
+    static std::uint64_t key(row_t row, column_t::index_t column);
+
+    workbook_impl &workbook_;
+
+    std::vector<node> nodes_;
+    std::unordered_map<const worksheet_impl *, column_index> formula_cells_;
+
+    // nodes reading a single cell, by sheet and position
+    std::unordered_map<const worksheet_impl *, std::unordered_map<std::uint64_t, std::vector<std::size_t>>> cell_readers_;
+    // nodes reading a range of more than one cell
+    std::vector<std::pair<formula_reference, std::size_t>> range_readers_;
+
+    std::vector<std::pair<const worksheet_impl *, std::string>> sheets_;
+    std::unordered_map<const worksheet_impl *, std::pair<row_t, column_t::index_t>> extents_;
+
+    std::vector<std::pair<const worksheet_impl *, std::uint64_t>> changed_;
+    bool built_;
+    bool rebuild_;
+};
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,788 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include <detail/formula/formula_evaluator.hpp>
+
+namespace {
+
+using xlnt::row_t;
+using xlnt::column_t;
+using xlnt::detail::formula_context;
+using xlnt::detail::formula_function;
+using xlnt::detail::formula_operator;
+using xlnt::detail::formula_reference;
+using xlnt::detail::formula_value;
+using xlnt::detail::formula_value_type;
+
+// An intermediate result, either a value or a reference that hasn't been read yet.
+struct operand
+{
+    bool is_reference = false;
+    bool missing = false;
+    formula_value value;
+    formula_reference reference;
+};
+
+operand from_value(formula_value value)
+{
+    operand result;
+    result.value = std::move(value);
+
+    return result;
+}
+
+operand from_reference(const formula_reference &reference)
+{
+    operand result;
+    result.is_reference = true;
+    result.reference = reference;
+
+    return result;
+}
+
+formula_value error(const char *code)
+{
+    return formula_value::from_error(code);
+}
+
+bool is_error(const formula_value &value)
+{
+    return value.type == formula_value_type::error;
+}
+
+// Returns the value of a single cell reference or the value itself. A reference
+// to more than one cell used as a single value is a #VALUE! error.
+formula_value to_scalar(const operand &argument, const formula_context &context)
+{
+    if (!argument.is_reference)
+    {
+        return argument.value;
+    }
+
+    if (argument.reference.is_single_cell())
+    {
+        return context.value(argument.reference.sheet, argument.reference.top, argument.reference.left);
+    }
+
+    return error("#VALUE!");
+}
+
+bool parse_number(const std::string &text, double &number)
+{
+    const auto first = text.find_first_not_of(" \t");
+    if (first == std::string::npos) return false;
+
+    const auto start = text.c_str() + first;
+    char *end = nullptr;
+    number = std::strtod(start, &end);
+
+    if (end == start) return false;
+    while (*end == ' ' || *end == '\t') ++end;
+
+    return *end == '\0';
+}
+
+formula_value to_number(const formula_value &value)
+{
+    switch (value.type)
+    {
+    case formula_value_type::number:
+        return value;
+    case formula_value_type::boolean:
+        return formula_value::from_number(value.number);
+    case formula_value_type::empty:
+        return formula_value::from_number(0.0);
+    case formula_value_type::string:
+    {
+        auto number = 0.0;
+        return parse_number(value.text, number) ? formula_value::from_number(number) : error("#VALUE!");
+    }
+    case formula_value_type::error:
+        return value;
+    }
+
+    return error("#VALUE!");
+}
+
+std::string number_to_text(double number)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.15G", number);
+
+    return buffer;
+}
+
+std::string to_lower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(),
+        [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+    return text;
+}
+
+formula_value to_text(const formula_value &value)
+{
+    switch (value.type)
+    {
+    case formula_value_type::number:
+        return formula_value::from_string(number_to_text(value.number));
+    case formula_value_type::boolean:
+        return formula_value::from_string(value.number != 0.0 ? "TRUE" : "FALSE");
+    case formula_value_type::empty:
+        return formula_value::from_string("");
+    case formula_value_type::string:
+    case formula_value_type::error:
+        return value;
+    }
+
+    return value;
+}
+
+formula_value to_boolean(const formula_value &value)
+{
+    switch (value.type)
+    {
+    case formula_value_type::number:
+    case formula_value_type::boolean:
+        return formula_value::from_boolean(value.number != 0.0);
+    case formula_value_type::empty:
+        return formula_value::from_boolean(false);
+    case formula_value_type::string:
+    {
+        const auto text = to_lower(value.text);
+        if (text == "true") return formula_value::from_boolean(true);
+        if (text == "false") return formula_value::from_boolean(false);
+        return error("#VALUE!");
+    }
+    case formula_value_type::error:
+        return value;
+    }
+
+    return error("#VALUE!");
+}
+
+// Excel orders numbers before text before booleans.
+int type_rank(formula_value_type type)
+{
+    switch (type)
+    {
+    case formula_value_type::string:
+        return 1;
+    case formula_value_type::boolean:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+formula_value empty_like(formula_value_type type)
+{
+    switch (type)
+    {
+    case formula_value_type::string:
+        return formula_value::from_string("");
+    case formula_value_type::boolean:
+        return formula_value::from_boolean(false);
+    default:
+        return formula_value::from_number(0.0);
+    }
+}
+
+// Compares two values that aren't errors the way Excel's comparison operators do.
+// Text is compared case-insensitively and an empty cell compares as 0, "" or FALSE
+// depending on the other value.
+int compare(const formula_value &a, const formula_value &b)
+{
+    const auto &left = a.type == formula_value_type::empty ? empty_like(b.type) : a;
+    const auto &right = b.type == formula_value_type::empty ? empty_like(left.type) : b;
+
+    const auto left_rank = type_rank(left.type);
+    const auto right_rank = type_rank(right.type);
+
+    if (left_rank != right_rank)
+    {
+        return left_rank < right_rank ? -1 : 1;
+    }
+
+    if (left.type == formula_value_type::string)
+    {
+        const auto comparison = to_lower(left.text).compare(to_lower(right.text));
+        return comparison < 0 ? -1 : (comparison > 0 ? 1 : 0);
+    }
+
+    return left.number < right.number ? -1 : (left.number > right.number ? 1 : 0);
+}
+
+// True for a value a lookup can match exactly: same kind and equal.
+bool lookup_equal(const formula_value &candidate, const formula_value &target)
+{
+    return candidate.type != formula_value_type::empty
+        && !is_error(candidate)
+        && type_rank(candidate.type) == type_rank(target.type)
+        && compare(candidate, target) == 0;
+}
+
+formula_reference clip(formula_reference reference, const formula_context &context)
+{
+    const auto extent = context.extent(reference.sheet);
+    reference.bottom = std::min(reference.bottom, extent.first);
+    reference.right = std::min(reference.right, extent.second);
+
+    return reference;
+}
+
+template <typename Visitor>
+void for_each_value(const formula_reference &reference, const formula_context &context, Visitor visit)
+{
+    const auto clipped = clip(reference, context);
+
+    for (std::uint64_t row = clipped.top; row <= clipped.bottom; ++row)
+    {
+        for (std::uint64_t column = clipped.left; column <= clipped.right; ++column)
+        {
+            visit(context.value(clipped.sheet, static_cast<row_t>(row), static_cast<column_t::index_t>(column)));
+        }
+    }
+}
+
+// The number of rows (or columns) in a reference after clipping.
+std::uint64_t length(row_t first, row_t last)
+{
+    return last < first ? 0 : std::uint64_t(last) - first + 1;
+}
+
+formula_value aggregate(formula_function function, const std::vector<operand> &arguments, const formula_context &context)
+{
+    const auto counting = function == formula_function::count;
+
+    auto sum = 0.0;
+    auto minimum = std::numeric_limits<double>::infinity();
+    auto maximum = -std::numeric_limits<double>::infinity();
+    std::size_t count = 0;
+    formula_value first_error;
+
+    auto add = [&](double number) {
+        sum += number;
+        minimum = std::min(minimum, number);
+        maximum = std::max(maximum, number);
+        ++count;
+    };
+
+    auto fail = [&](const formula_value &value) {
+        if (!counting && !is_error(first_error)) first_error = value;
+    };
+
+    for (const auto &argument : arguments)
+    {
+        if (argument.missing) continue;
+
+        if (argument.is_reference)
+        {
+            // only numbers are counted in ranges, text and booleans are skipped
+            for_each_value(argument.reference, context, [&](const formula_value &value) {
+                if (value.type == formula_value_type::number) add(value.number);
+                else if (is_error(value)) fail(value);
+            });
+
+            continue;
+        }
+
+        const auto &value = argument.value;
+
+        if (value.type == formula_value_type::number || value.type == formula_value_type::boolean)
+        {
+            add(value.number);
+        }
+        else if (value.type == formula_value_type::string)
+        {
+            auto number = 0.0;
+
+            if (parse_number(value.text, number)) add(number);
+            else fail(error("#VALUE!"));
+        }
+        else if (is_error(value))
+        {
+            fail(value);
+        }
+    }
+
+    if (is_error(first_error)) return first_error;
+
+    switch (function)
+    {
+    case formula_function::sum:
+        return formula_value::from_number(sum);
+    case formula_function::count:
+        return formula_value::from_number(static_cast<double>(count));
+    case formula_function::average:
+        return count == 0 ? error("#DIV/0!") : formula_value::from_number(sum / static_cast<double>(count));
+    case formula_function::min:
+        return formula_value::from_number(count == 0 ? 0.0 : minimum);
+    case formula_function::max:
+        return formula_value::from_number(count == 0 ? 0.0 : maximum);
+    default:
+        return error("#VALUE!");
+    }
+}
+
+// Returns the number in value truncated toward zero, or an error.
+formula_value to_integer(const operand &argument, const formula_context &context)
+{
+    auto number = to_number(to_scalar(argument, context));
+    if (!is_error(number)) number.number = std::trunc(number.number);
+
+    return number;
+}
+
+// Returns the index (from 0) of the last of count values (read with value_at)
+// that is less than or equal to target, assuming ascending order, or -1.
+template <typename ValueAt>
+std::int64_t approximate_match(std::uint64_t count, const formula_value &target, ValueAt value_at)
+{
+    std::int64_t low = 0;
+    auto high = static_cast<std::int64_t>(count) - 1;
+    std::int64_t found = -1;
+
+    while (low <= high)
+    {
+        const auto middle = low + (high - low) / 2;
+        const auto candidate = value_at(static_cast<std::uint64_t>(middle));
+
+        if (!is_error(candidate) && compare(candidate, target) <= 0)
+        {
+            found = middle;
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    if (found >= 0)
+    {
+        const auto candidate = value_at(static_cast<std::uint64_t>(found));
+
+        if (candidate.type == formula_value_type::empty || type_rank(candidate.type) != type_rank(target.type))
+        {
+            return -1;
+        }
+    }
+
+    return found;
+}
+
+operand if_function(const std::vector<operand> &arguments, const formula_context &context)
+{
+    if (arguments.empty() || arguments.size() > 3) return from_value(error("#VALUE!"));
+
+    const auto condition = to_boolean(to_scalar(arguments[0], context));
+    if (is_error(condition)) return from_value(condition);
+
+    const auto branch = condition.number != 0.0 ? std::size_t(1) : std::size_t(2);
+
+    if (branch >= arguments.size())
+    {
+        return from_value(formula_value::from_boolean(false));
+    }
+
+    if (arguments[branch].missing)
+    {
+        return from_value(formula_value::from_number(0.0));
+    }
+
+    return arguments[branch];
+}
+
+formula_value vlookup_function(const std::vector<operand> &arguments, const formula_context &context)
+{
+    if (arguments.size() < 3 || arguments.size() > 4) return error("#VALUE!");
+
+    const auto target = to_scalar(arguments[0], context);
+    if (is_error(target)) return target;
+    if (!arguments[1].is_reference) return error("#VALUE!");
+
+    const auto table = clip(arguments[1].reference, context);
+    const auto column = to_integer(arguments[2], context);
+    if (is_error(column)) return column;
+    if (column.number < 1) return error("#VALUE!");
+    if (column.number > static_cast<double>(length(arguments[1].reference.left, arguments[1].reference.right)))
+    {
+        return error("#REF!");
+    }
+
+    auto approximate = true;
+
+    if (arguments.size() == 4)
+    {
+        const auto flag = to_boolean(to_scalar(arguments[3], context));
+        if (is_error(flag)) return flag;
+        approximate = flag.number != 0.0;
+    }
+
+    const auto result_column = table.left + static_cast<column_t::index_t>(column.number) - 1;
+    const auto rows = length(table.top, table.bottom);
+
+    auto key_at = [&](std::uint64_t offset) {
+        return context.value(table.sheet, static_cast<row_t>(table.top + offset), table.left);
+    };
+
+    if (approximate)
+    {
+        const auto found = approximate_match(rows, target, key_at);
+        if (found < 0) return error("#N/A");
+
+        return context.value(table.sheet, static_cast<row_t>(table.top + static_cast<std::uint64_t>(found)), result_column);
+    }
+
+    for (std::uint64_t offset = 0; offset < rows; ++offset)
+    {
+        if (lookup_equal(key_at(offset), target))
+        {
+            return context.value(table.sheet, static_cast<row_t>(table.top + offset), result_column);
+        }
+    }
+
+    return error("#N/A");
+}
+
+operand index_function(const std::vector<operand> &arguments, const formula_context &context)
+{
+    if (arguments.size() < 2 || arguments.size() > 3) return from_value(error("#VALUE!"));
+
+    auto row = to_integer(arguments[1], context);
+    if (is_error(row)) return from_value(row);
+
+    auto column = arguments.size() == 3 ? to_integer(arguments[2], context) : formula_value::from_number(0.0);
+    if (is_error(column)) return from_value(column);
+
+    if (!arguments[0].is_reference)
+    {
+        if (row.number > 1 || column.number > 1) return from_value(error("#REF!"));
+        return arguments[0];
+    }
+
+    auto reference = arguments[0].reference;
+    const auto height = length(reference.top, reference.bottom);
+    const auto width = length(reference.left, reference.right);
+
+    // INDEX(B1:D1, 2) picks a column of a single row
+    if (arguments.size() == 2 && height == 1 && width > 1)
+    {
+        std::swap(row, column);
+    }
+
+    if (row.number < 0 || column.number < 0) return from_value(error("#VALUE!"));
+    if (row.number > static_cast<double>(height) || column.number > static_cast<double>(width))
+    {
+        return from_value(error("#REF!"));
+    }
+
+    if (row.number > 0)
+    {
+        reference.top = reference.bottom = reference.top + static_cast<row_t>(row.number) - 1;
+    }
+
+    if (column.number > 0)
+    {
+        reference.left = reference.right = reference.left + static_cast<column_t::index_t>(column.number) - 1;
+    }
+
+    return from_reference(reference);
+}
+
+formula_value match_function(const std::vector<operand> &arguments, const formula_context &context)
+{
+    if (arguments.size() < 2 || arguments.size() > 3) return error("#VALUE!");
+
+    const auto target = to_scalar(arguments[0], context);
+    if (is_error(target)) return target;
+    if (!arguments[1].is_reference) return error("#N/A");
+
+    const auto &unclipped = arguments[1].reference;
+    if (unclipped.top != unclipped.bottom && unclipped.left != unclipped.right) return error("#N/A");
+
+    const auto vertical = unclipped.left == unclipped.right;
+    const auto range = clip(unclipped, context);
+    const auto count = vertical ? length(range.top, range.bottom) : length(range.left, range.right);
+
+    auto type = 1.0;
+
+    if (arguments.size() == 3)
+    {
+        const auto value = to_integer(arguments[2], context);
+        if (is_error(value)) return value;
+        type = value.number;
+    }
+
+    auto value_at = [&](std::uint64_t offset) {
+        return vertical
+            ? context.value(range.sheet, static_cast<row_t>(range.top + offset), range.left)
+            : context.value(range.sheet, range.top, static_cast<column_t::index_t>(range.left + offset));
+    };
+
+    std::int64_t found = -1;
+
+    if (type == 0)
+    {
+        for (std::uint64_t offset = 0; offset < count && found < 0; ++offset)
+        {
+            if (lookup_equal(value_at(offset), target)) found = static_cast<std::int64_t>(offset);
+        }
+    }
+    else if (type > 0)
+    {
+        found = approximate_match(count, target, value_at);
+    }
+    else
+    {
+        // smallest value greater than or equal to target in descending order
+        for (std::uint64_t offset = 0; offset < count; ++offset)
+        {
+            const auto candidate = value_at(offset);
+            if (is_error(candidate) || compare(candidate, target) < 0) break;
+            found = static_cast<std::int64_t>(offset);
+        }
+    }
+
+    return found < 0 ? error("#N/A") : formula_value::from_number(static_cast<double>(found + 1));
+}
+
+formula_value arithmetic(formula_operator op, const formula_value &a, const formula_value &b)
+{
+    const auto left = to_number(a);
+    if (is_error(left)) return left;
+
+    const auto right = to_number(b);
+    if (is_error(right)) return right;
+
+    auto result = 0.0;
+
+    switch (op)
+    {
+    case formula_operator::add:
+        result = left.number + right.number;
+        break;
+    case formula_operator::subtract:
+        result = left.number - right.number;
+        break;
+    case formula_operator::multiply:
+        result = left.number * right.number;
+        break;
+    case formula_operator::divide:
+        if (right.number == 0.0) return error("#DIV/0!");
+        result = left.number / right.number;
+        break;
+    case formula_operator::power:
+        if (left.number == 0.0 && right.number == 0.0) return error("#NUM!");
+        result = std::pow(left.number, right.number);
+        break;
+    default:
+        return error("#VALUE!");
+    }
+
+    return std::isfinite(result) ? formula_value::from_number(result) : error("#NUM!");
+}
+
+formula_value binary(formula_operator op, const formula_value &a, const formula_value &b)
+{
+    switch (op)
+    {
+    case formula_operator::add:
+    case formula_operator::subtract:
+    case formula_operator::multiply:
+    case formula_operator::divide:
+    case formula_operator::power:
+        return arithmetic(op, a, b);
+    default:
+        break;
+    }
+
+    if (is_error(a)) return a;
+    if (is_error(b)) return b;
+
+    if (op == formula_operator::concatenate)
+    {
+        return formula_value::from_string(to_text(a).text + to_text(b).text);
+    }
+
+    const auto comparison = compare(a, b);
+
+    switch (op)
+    {
+    case formula_operator::equal:
+        return formula_value::from_boolean(comparison == 0);
+    case formula_operator::not_equal:
+        return formula_value::from_boolean(comparison != 0);
+    case formula_operator::less:
+        return formula_value::from_boolean(comparison < 0);
+    case formula_operator::less_equal:
+        return formula_value::from_boolean(comparison <= 0);
+    case formula_operator::greater:
+        return formula_value::from_boolean(comparison > 0);
+    case formula_operator::greater_equal:
+        return formula_value::from_boolean(comparison >= 0);
+    default:
+        return error("#VALUE!");
+    }
+}
+
+operand call(formula_function function, const std::vector<operand> &arguments, const formula_context &context)
+{
+    switch (function)
+    {
+    case formula_function::sum:
+    case formula_function::average:
+    case formula_function::count:
+    case formula_function::min:
+    case formula_function::max:
+        return from_value(aggregate(function, arguments, context));
+    case formula_function::if_:
+        return if_function(arguments, context);
+    case formula_function::vlookup:
+        return from_value(vlookup_function(arguments, context));
+    case formula_function::index:
+        return index_function(arguments, context);
+    case formula_function::match:
+        return from_value(match_function(arguments, context));
+    case formula_function::unknown:
+        break;
+    }
+
+    return from_value(error("#NAME?"));
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+formula_context::~formula_context()
+{
+}
+
+formula_evaluator::formula_evaluator(const formula_context &context)
+    : context_(context)
+{
+}
+
+formula_value formula_evaluator::evaluate(const compiled_formula &formula) const
+{
+    std::vector<operand> stack;
+    std::vector<operand> arguments;
+
+    for (const auto &token : formula.tokens)
+    {
+        switch (token.type)
+        {
+        case formula_token_type::number:
+            stack.push_back(from_value(formula_value::from_number(formula.numbers[token.index])));
+            break;
+
+        case formula_token_type::string:
+            stack.push_back(from_value(formula_value::from_string(formula.strings[token.index])));
+            break;
+
+        case formula_token_type::boolean:
+            stack.push_back(from_value(formula_value::from_boolean(token.code != 0)));
+            break;
+
+        case formula_token_type::error:
+            stack.push_back(from_value(formula_value::from_error(formula.strings[token.index])));
+            break;
+
+        case formula_token_type::missing:
+        {
+            operand missing;
+            missing.missing = true;
+            stack.push_back(missing);
+            break;
+        }
+
+        case formula_token_type::reference:
+            stack.push_back(from_reference(formula.references[token.index]));
+            break;
+
+        case formula_token_type::unary:
+        case formula_token_type::percent:
+        {
+            if (stack.empty()) return error("#VALUE!");
+
+            auto value = to_number(to_scalar(stack.back(), context_));
+
+            if (!is_error(value))
+            {
+                if (token.type == formula_token_type::percent) value.number /= 100.0;
+                else if (static_cast<formula_operator>(token.code) == formula_operator::negate) value.number = -value.number;
+            }
+
+            stack.back() = from_value(value);
+            break;
+        }
+
+        case formula_token_type::binary:
+        {
+            if (stack.size() < 2) return error("#VALUE!");
+
+            const auto right = to_scalar(stack.back(), context_);
+            stack.pop_back();
+            const auto left = to_scalar(stack.back(), context_);
+            stack.back() = from_value(binary(static_cast<formula_operator>(token.code), left, right));
+            break;
+        }
+
+        case formula_token_type::function:
+        {
+            if (stack.size() < token.argument_count) return error("#VALUE!");
+
+            const auto first = stack.end() - token.argument_count;
+            arguments.assign(first, stack.end());
+            stack.erase(first, stack.end());
+            stack.push_back(call(static_cast<formula_function>(token.code), arguments, context_));
+            break;
+        }
+        }
+    }
+
+    if (stack.size() != 1) return error("#VALUE!");
+
+    auto result = to_scalar(stack.back(), context_);
+
+    if (result.type == formula_value_type::empty)
+    {
+        result = formula_value::from_number(0.0);
+    }
+
+    return result;
+}
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,75 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <utility>
+
+#include <detail/formula/compiled_formula.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// Supplies cell values to a formula_evaluator.
+/// </summary>
+class formula_context
+{
+public:
+    virtual ~formula_context();
+
+    /// <summary>
+    /// Returns the value of the given cell.
+    /// </summary>
+    virtual formula_value value(const worksheet_impl *sheet, row_t row, column_t::index_t column) const = 0;
+
+    /// <summary>
+    /// Returns the last row and column that may contain a cell on sheet. Ranges are
+    /// clipped to these before their cells are visited.
+    /// </summary>
+    virtual std::pair<row_t, column_t::index_t> extent(const worksheet_impl *sheet) const = 0;
+};
+
+/// <summary>
+/// Evaluates compiled formulas. Supports the arithmetic, concatenation, comparison
+/// and percent operators and SUM, AVERAGE, COUNT, MIN, MAX, IF, VLOOKUP, INDEX and
+/// MATCH. Unknown functions evaluate to #NAME?. An evaluator only reads from its
+/// context, so several can run at once over the same context.
+/// </summary>
+class formula_evaluator
+{
+public:
+    explicit formula_evaluator(const formula_context &context);
+
+    /// <summary>
+    /// Returns the result of formula. A formula resulting in an empty cell
+    /// evaluates to 0, as in Excel.
+    /// </summary>
+    formula_value evaluate(const compiled_formula &formula) const;
+
+private:
+    const formula_context &context_;
+};
+
+} // namespace detail
+} // namespace xlnt
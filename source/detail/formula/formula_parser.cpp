@@ -0,0 +1,629 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <limits>
+
+#include <detail/formula/formula_parser.hpp>
+#include <xlnt/utils/exceptions.hpp>
+
+namespace {
+
+const char *const error_codes[] = {"#NULL!", "#DIV/0!", "#VALUE!", "#REF!", "#NAME?", "#NUM!", "#N/A"};
+
+bool is_letter(char c)
+{
+    return std::isalpha(static_cast<unsigned char>(c)) != 0;
+}
+
+bool is_digit(char c)
+{
+    return std::isdigit(static_cast<unsigned char>(c)) != 0;
+}
+
+bool is_name_character(char c)
+{
+    return is_letter(c) || is_digit(c) || c == '_' || c == '.';
+}
+
+std::string to_upper(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(),
+        [](char c) { return static_cast<char>(std::toupper(static_cast<unsigned char>(c))); });
+    return text;
+}
+
+std::string to_lower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(),
+        [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+    return text;
+}
+
+// Reads an optionally absolute column like $AB at position.
+bool read_column(const std::string &text, std::size_t &position, xlnt::column_t::index_t &column)
+{
+    auto current = position;
+    if (current < text.size() && text[current] == '$') ++current;
+
+    const auto start = current;
+    while (current < text.size() && is_letter(text[current]) && current - start < 3) ++current;
+
+    if (current == start || (current < text.size() && is_letter(text[current])))
+    {
+        return false;
+    }
+
+    column = xlnt::column_t::column_index_from_string(to_upper(text.substr(start, current - start)));
+    position = current;
+
+    return true;
+}
+
+// Reads an optionally absolute row like $12 at position.
+bool read_row(const std::string &text, std::size_t &position, xlnt::row_t &row)
+{
+    auto current = position;
+    if (current < text.size() && text[current] == '$') ++current;
+
+    const auto start = current;
+    std::uint64_t value = 0;
+
+    while (current < text.size() && is_digit(text[current]))
+    {
+        value = value * 10 + static_cast<std::uint64_t>(text[current] - '0');
+        if (value > std::numeric_limits<xlnt::row_t>::max()) return false;
+        ++current;
+    }
+
+    if (current == start || value == 0)
+    {
+        return false;
+    }
+
+    row = static_cast<xlnt::row_t>(value);
+    position = current;
+
+    return true;
+}
+
+xlnt::detail::formula_function function_from_name(const std::string &name)
+{
+    using xlnt::detail::formula_function;
+
+    if (name == "SUM") return formula_function::sum;
+    if (name == "AVERAGE") return formula_function::average;
+    if (name == "COUNT") return formula_function::count;
+    if (name == "MIN") return formula_function::min;
+    if (name == "MAX") return formula_function::max;
+    if (name == "IF") return formula_function::if_;
+    if (name == "VLOOKUP") return formula_function::vlookup;
+    if (name == "INDEX") return formula_function::index;
+    if (name == "MATCH") return formula_function::match;
+
+    return formula_function::unknown;
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+formula_parser::formula_parser(const std::string &formula, const worksheet_impl *sheet,
+    const std::unordered_map<std::string, const worksheet_impl *> &sheets)
+    : formula_(formula),
+      position_(0),
+      sheet_(sheet),
+      sheets_(sheets)
+{
+}
+
+compiled_formula formula_parser::parse()
+{
+    try
+    {
+        parse_comparison();
+        skip_whitespace();
+
+        if (position_ != formula_.size())
+        {
+            throw xlnt::exception("unexpected character in formula");
+        }
+    }
+    catch (const xlnt::exception &)
+    {
+        result_ = compiled_formula();
+        emit_error("#NAME?");
+    }
+
+    return std::move(result_);
+}
+
+void formula_parser::parse_comparison()
+{
+    parse_concatenation();
+
+    while (true)
+    {
+        skip_whitespace();
+        formula_operator op;
+
+        if (consume("<>")) op = formula_operator::not_equal;
+        else if (consume("<=")) op = formula_operator::less_equal;
+        else if (consume(">=")) op = formula_operator::greater_equal;
+        else if (consume('<')) op = formula_operator::less;
+        else if (consume('>')) op = formula_operator::greater;
+        else if (consume('=')) op = formula_operator::equal;
+        else return;
+
+        parse_concatenation();
+        emit(formula_token_type::binary, static_cast<std::uint8_t>(op));
+    }
+}
+
+void formula_parser::parse_concatenation()
+{
+    parse_additive();
+
+    while (skip_whitespace(), consume('&'))
+    {
+        parse_additive();
+        emit(formula_token_type::binary, static_cast<std::uint8_t>(formula_operator::concatenate));
+    }
+}
+
+void formula_parser::parse_additive()
+{
+    parse_multiplicative();
+
+    while (true)
+    {
+        skip_whitespace();
+        formula_operator op;
+
+        if (consume('+')) op = formula_operator::add;
+        else if (consume('-')) op = formula_operator::subtract;
+        else return;
+
+        parse_multiplicative();
+        emit(formula_token_type::binary, static_cast<std::uint8_t>(op));
+    }
+}
+
+void formula_parser::parse_multiplicative()
+{
+    parse_power();
+
+    while (true)
+    {
+        skip_whitespace();
+        formula_operator op;
+
+        if (consume('*')) op = formula_operator::multiply;
+        else if (consume('/')) op = formula_operator::divide;
+        else return;
+
+        parse_power();
+        emit(formula_token_type::binary, static_cast<std::uint8_t>(op));
+    }
+}
+
+void formula_parser::parse_power()
+{
+    parse_unary();
+
+    while (skip_whitespace(), consume('^'))
+    {
+        parse_unary();
+        emit(formula_token_type::binary, static_cast<std::uint8_t>(formula_operator::power));
+    }
+}
+
+void formula_parser::parse_unary()
+{
+    skip_whitespace();
+
+    // negation binds tighter than ^ in Excel, so -2^2 is 4
+    if (consume('-'))
+    {
+        parse_unary();
+        emit(formula_token_type::unary, static_cast<std::uint8_t>(formula_operator::negate));
+        return;
+    }
+
+    if (consume('+'))
+    {
+        parse_unary();
+        emit(formula_token_type::unary, static_cast<std::uint8_t>(formula_operator::plus));
+        return;
+    }
+
+    parse_primary();
+
+    while (skip_whitespace(), consume('%'))
+    {
+        emit(formula_token_type::percent);
+    }
+}
+
+void formula_parser::parse_primary()
+{
+    skip_whitespace();
+    const auto c = peek();
+
+    if (c == '(')
+    {
+        ++position_;
+        parse_comparison();
+        skip_whitespace();
+        expect(')');
+        return;
+    }
+
+    if (c == '"') return parse_string();
+    if (c == '#') return parse_error();
+
+    std::string sheet_name;
+
+    if (parse_sheet_name(sheet_name))
+    {
+        const auto match = sheets_.find(to_lower(sheet_name));
+
+        if (match == sheets_.end())
+        {
+            // still consume the reference so the rest of the formula parses
+            if (!parse_reference(sheet_)) throw xlnt::exception("expected reference");
+            result_.references.pop_back();
+            result_.tokens.pop_back();
+            emit_error("#REF!");
+            return;
+        }
+
+        if (!parse_reference(match->second)) throw xlnt::exception("expected reference");
+        return;
+    }
+
+    if (parse_reference(sheet_)) return;
+
+    if (is_digit(c) || c == '.') return parse_number();
+
+    if (is_letter(c) || c == '_')
+    {
+        const auto start = position_;
+        while (position_ < formula_.size() && is_name_character(formula_[position_])) ++position_;
+        const auto name = to_upper(formula_.substr(start, position_ - start));
+
+        skip_whitespace();
+
+        if (peek() == '(')
+        {
+            return parse_function(name);
+        }
+
+        if (name == "TRUE" || name == "FALSE")
+        {
+            emit(formula_token_type::boolean, name == "TRUE" ? 1 : 0);
+            return;
+        }
+
+        // defined names aren't supported
+        emit_error("#NAME?");
+        return;
+    }
+
+    throw xlnt::exception("unexpected character in formula");
+}
+
+void formula_parser::parse_string()
+{
+    expect('"');
+    std::string text;
+
+    while (true)
+    {
+        if (position_ >= formula_.size()) throw xlnt::exception("unterminated string in formula");
+
+        const auto c = formula_[position_++];
+
+        if (c == '"')
+        {
+            if (peek() != '"') break;
+            ++position_;
+        }
+
+        text.push_back(c);
+    }
+
+    result_.strings.push_back(std::move(text));
+    emit(formula_token_type::string, 0, 0, static_cast<std::uint32_t>(result_.strings.size() - 1));
+}
+
+void formula_parser::parse_error()
+{
+    for (auto code : error_codes)
+    {
+        if (consume(code))
+        {
+            emit_error(code);
+            return;
+        }
+    }
+
+    throw xlnt::exception("unknown error literal in formula");
+}
+
+void formula_parser::parse_number()
+{
+    const auto start = formula_.c_str() + position_;
+    char *end = nullptr;
+    const auto number = std::strtod(start, &end);
+
+    if (end == start) throw xlnt::exception("expected number in formula");
+
+    position_ += static_cast<std::size_t>(end - start);
+    result_.numbers.push_back(number);
+    emit(formula_token_type::number, 0, 0, static_cast<std::uint32_t>(result_.numbers.size() - 1));
+}
+
+void formula_parser::parse_function(const std::string &name)
+{
+    const auto prefix = std::string("_XLFN.");
+    const auto function = function_from_name(
+        name.compare(0, prefix.size(), prefix) == 0 ? name.substr(prefix.size()) : name);
+
+    expect('(');
+    std::size_t argument_count = 0;
+    skip_whitespace();
+
+    if (!consume(')'))
+    {
+        while (true)
+        {
+            skip_whitespace();
+
+            if (peek() == ',' || peek() == ')')
+            {
+                emit(formula_token_type::missing);
+            }
+            else
+            {
+                parse_comparison();
+                skip_whitespace();
+            }
+
+            ++argument_count;
+
+            if (consume(',')) continue;
+
+            expect(')');
+            break;
+        }
+    }
+
+    if (argument_count > std::numeric_limits<std::uint16_t>::max())
+    {
+        throw xlnt::exception("too many arguments in formula");
+    }
+
+    emit(formula_token_type::function, static_cast<std::uint8_t>(function),
+        static_cast<std::uint16_t>(argument_count));
+}
+
+bool formula_parser::parse_reference(const worksheet_impl *sheet)
+{
+    const auto start = position_;
+    auto current = position_;
+
+    formula_reference reference;
+    reference.sheet = sheet;
+
+    column_t::index_t first_column = 0;
+    row_t first_row = 0;
+    auto parsed = false;
+
+    if (read_column(formula_, current, first_column))
+    {
+        auto after_column = current;
+
+        if (read_row(formula_, current, first_row))
+        {
+            reference.top = reference.bottom = first_row;
+            reference.left = reference.right = first_column;
+
+            auto after_cell = current;
+            column_t::index_t second_column = 0;
+            row_t second_row = 0;
+
+            if (current < formula_.size() && formula_[current] == ':')
+            {
+                ++current;
+
+                if (read_column(formula_, current, second_column) && read_row(formula_, current, second_row))
+                {
+                    reference.top = std::min(first_row, second_row);
+                    reference.bottom = std::max(first_row, second_row);
+                    reference.left = std::min(first_column, second_column);
+                    reference.right = std::max(first_column, second_column);
+                }
+                else
+                {
+                    current = after_cell;
+                }
+            }
+
+            parsed = true;
+        }
+        else if (after_column < formula_.size() && formula_[after_column] == ':')
+        {
+            current = after_column + 1;
+            column_t::index_t second_column = 0;
+
+            if (read_column(formula_, current, second_column))
+            {
+                reference.top = 1;
+                reference.bottom = std::numeric_limits<row_t>::max();
+                reference.left = std::min(first_column, second_column);
+                reference.right = std::max(first_column, second_column);
+                parsed = true;
+            }
+        }
+    }
+    else if (read_row(formula_, current, first_row) && current < formula_.size() && formula_[current] == ':')
+    {
+        ++current;
+        row_t second_row = 0;
+
+        if (read_row(formula_, current, second_row))
+        {
+            reference.top = std::min(first_row, second_row);
+            reference.bottom = std::max(first_row, second_row);
+            reference.left = 1;
+            reference.right = std::numeric_limits<column_t::index_t>::max();
+            parsed = true;
+        }
+    }
+
+    // something like LOG10( or A1B isn't a reference
+    if (!parsed || (current < formula_.size() && (is_name_character(formula_[current]) || formula_[current] == '(')))
+    {
+        position_ = start;
+        return false;
+    }
+
+    position_ = current;
+    result_.references.push_back(reference);
+    emit(formula_token_type::reference, 0, 0, static_cast<std::uint32_t>(result_.references.size() - 1));
+
+    return true;
+}
+
+bool formula_parser::parse_sheet_name(std::string &name)
+{
+    auto current = position_;
+
+    if (peek() == '\'')
+    {
+        ++current;
+
+        while (true)
+        {
+            if (current >= formula_.size()) return false;
+
+            const auto c = formula_[current++];
+
+            if (c == '\'')
+            {
+                if (current < formula_.size() && formula_[current] == '\'')
+                {
+                    name.push_back('\'');
+                    ++current;
+                    continue;
+                }
+
+                break;
+            }
+
+            name.push_back(c);
+        }
+    }
+    else
+    {
+        while (current < formula_.size() && is_name_character(formula_[current]))
+        {
+            name.push_back(formula_[current++]);
+        }
+    }
+
+    if (name.empty() || current >= formula_.size() || formula_[current] != '!')
+    {
+        name.clear();
+        return false;
+    }
+
+    position_ = current + 1;
+
+    return true;
+}
+
+void formula_parser::skip_whitespace()
+{
+    while (position_ < formula_.size() && std::isspace(static_cast<unsigned char>(formula_[position_])))
+    {
+        ++position_;
+    }
+}
+
+char formula_parser::peek() const
+{
+    return position_ < formula_.size() ? formula_[position_] : '\0';
+}
+
+bool formula_parser::consume(char c)
+{
+    if (peek() != c || c == '\0') return false;
+
+    ++position_;
+
+    return true;
+}
+
+bool formula_parser::consume(const char *text)
+{
+    const auto length = std::char_traits<char>::length(text);
+
+    if (formula_.compare(position_, length, text) != 0) return false;
+
+    position_ += length;
+
+    return true;
+}
+
+void formula_parser::expect(char c)
+{
+    if (!consume(c))
+    {
+        throw xlnt::exception("unexpected character in formula");
+    }
+}
+
+void formula_parser::emit(formula_token_type type, std::uint8_t code, std::uint16_t argument_count, std::uint32_t index)
+{
+    formula_token token;
+    token.type = type;
+    token.code = code;
+    token.argument_count = argument_count;
+    token.index = index;
+
+    result_.tokens.push_back(token);
+}
+
+void formula_parser::emit_error(const char *code)
+{
+    result_.strings.push_back(code);
+    emit(formula_token_type::error, 0, 0, static_cast<std::uint32_t>(result_.strings.size() - 1));
+}
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,99 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+#include <detail/formula/compiled_formula.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// Parses the text of a formula (without the leading '=') into a compiled_formula.
+/// Supports numbers, strings, booleans, error literals, cell and range references
+/// (optionally qualified by a sheet name, and whole columns or rows), the arithmetic,
+/// concatenation, comparison and percent operators, and function calls.
+/// </summary>
+class formula_parser
+{
+public:
+    /// <summary>
+    /// Constructs a parser for formula, located on sheet. Sheet names in references are
+    /// looked up in sheets, which is keyed by lowercase title.
+    /// </summary>
+    formula_parser(const std::string &formula, const worksheet_impl *sheet,
+        const std::unordered_map<std::string, const worksheet_impl *> &sheets);
+
+    /// <summary>
+    /// Parses the formula. A formula that isn't valid compiles to a #NAME? error and
+    /// references to sheets that don't exist compile to #REF! errors.
+    /// </summary>
+    compiled_formula parse();
+
+private:
+    void parse_comparison();
+    void parse_concatenation();
+    void parse_additive();
+    void parse_multiplicative();
+    void parse_power();
+    void parse_unary();
+    void parse_primary();
+    void parse_string();
+    void parse_error();
+    void parse_number();
+    void parse_function(const std::string &name);
+
+    /// <summary>
+    /// Parses a reference on sheet at the current position. Returns false and leaves
+    /// the position unchanged if there isn't one.
+    /// </summary>
+    bool parse_reference(const worksheet_impl *sheet);
+
+    /// <summary>
+    /// Reads a sheet name followed by '!' at the current position into name and moves
+    /// past the '!'. Returns false and leaves the position unchanged if there isn't one.
+    /// </summary>
+    bool parse_sheet_name(std::string &name);
+
+    void skip_whitespace();
+    char peek() const;
+    bool consume(char c);
+    bool consume(const char *text);
+    void expect(char c);
+
+    void emit(formula_token_type type, std::uint8_t code = 0, std::uint16_t argument_count = 0, std::uint32_t index = 0);
+    void emit_error(const char *code);
+
+    const std::string &formula_;
+    std::size_t position_;
+    const worksheet_impl *sheet_;
+    const std::unordered_map<std::string, const worksheet_impl *> &sheets_;
+    compiled_formula result_;
+};
+
+} // namespace detail
+} // namespace xlnt
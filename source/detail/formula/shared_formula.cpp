@@ -0,0 +1,476 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+
+#include <detail/formula/shared_formula.hpp>
+#include <detail/implementations/cell_impl.hpp>
+
+namespace {
+
+using xlnt::detail::last_sheet_column;
+using xlnt::detail::last_sheet_row;
+
+bool is_letter(char c)
+{
+    return std::isalpha(static_cast<unsigned char>(c)) != 0;
+}
+
+bool is_digit(char c)
+{
+    return std::isdigit(static_cast<unsigned char>(c)) != 0;
+}
+
+// Characters that can be part of a name, a number or a reference.
+bool is_word_character(char c)
+{
+    return is_letter(c) || is_digit(c) || c == '_' || c == '.' || c == '$' || c == '\\';
+}
+
+// One part of a reference: an optionally absolute column, row, or both.
+struct reference_part
+{
+    bool has_column = false;
+    bool absolute_column = false;
+    std::string column;
+    bool has_row = false;
+    bool absolute_row = false;
+    std::string row;
+};
+
+// Splits word into a reference part, returning false if it isn't one. Parts off
+// the sheet, such as ABC12345678, are names rather than references.
+bool parse_part(const std::string &word, reference_part &part)
+{
+    std::size_t i = 0;
+
+    if (i < word.size() && word[i] == '$')
+    {
+        part.absolute_column = true;
+        ++i;
+    }
+
+    const auto column_start = i;
+    while (i < word.size() && is_letter(word[i])) ++i;
+    part.column = word.substr(column_start, i - column_start);
+    part.has_column = !part.column.empty();
+
+    if (part.column.size() > 3) return false;
+
+    if (i < word.size() && word[i] == '$')
+    {
+        // a lone '$' belongs to the row
+        if (!part.has_column)
+        {
+            part.absolute_column = false;
+        }
+
+        part.absolute_row = true;
+        ++i;
+    }
+    else if (!part.has_column && part.absolute_column)
+    {
+        part.absolute_column = false;
+        part.absolute_row = true;
+    }
+
+    const auto row_start = i;
+    while (i < word.size() && is_digit(word[i])) ++i;
+    part.row = word.substr(row_start, i - row_start);
+    part.has_row = !part.row.empty();
+
+    if (!part.has_row) part.absolute_row = false;
+
+    if (i != word.size() || !(part.has_column || part.has_row) || part.row.size() > 7)
+    {
+        return false;
+    }
+
+    if (part.has_column && xlnt::column_t::column_index_from_string(part.column) > last_sheet_column)
+    {
+        return false;
+    }
+
+    if (part.has_row)
+    {
+        const auto row = std::stoul(part.row);
+
+        if (row < 1 || row > last_sheet_row) return false;
+    }
+
+    return true;
+}
+
+// Returns the row, or the column if rows is false, of part.
+std::uint64_t line_of(const reference_part &part, bool rows)
+{
+    return rows ? std::stoull(part.row) : xlnt::column_t::column_index_from_string(part.column);
+}
+
+void set_line(reference_part &part, bool rows, std::uint64_t line)
+{
+    if (rows)
+    {
+        part.row = std::to_string(line);
+    }
+    else
+    {
+        part.column = xlnt::column_t::column_string_from_index(static_cast<xlnt::column_t::index_t>(line));
+    }
+}
+
+// Moves part by rows and columns, returning false if it would move off the sheet.
+bool translate_part(reference_part &part, std::int64_t rows, std::int64_t columns)
+{
+    if (part.has_column && !part.absolute_column && columns != 0)
+    {
+        const auto column = static_cast<std::int64_t>(line_of(part, false)) + columns;
+
+        if (column < 1 || column > last_sheet_column) return false;
+
+        set_line(part, false, static_cast<std::uint64_t>(column));
+    }
+
+    if (part.has_row && !part.absolute_row && rows != 0)
+    {
+        const auto row = static_cast<std::int64_t>(line_of(part, true)) + rows;
+
+        if (row < 1 || row > last_sheet_row) return false;
+
+        set_line(part, true, static_cast<std::uint64_t>(row));
+    }
+
+    return true;
+}
+
+// Moves the rows, or the columns if rows is false, of the reference from first to last
+// for lines inserted or deleted, returning false if every one of them was deleted or
+// moved off the sheet. first and last are the same part for a single cell.
+bool shift_parts(reference_part &first, reference_part &last, bool rows,
+    std::uint32_t position, std::uint32_t count, bool insert)
+{
+    // whole columns don't move when rows do, nor whole rows when columns do
+    if (rows ? !first.has_row : !first.has_column) return true;
+
+    auto from = line_of(first, rows);
+    auto to = line_of(last, rows);
+    const auto reversed = from > to;
+
+    if (reversed)
+    {
+        std::swap(from, to);
+    }
+
+    if (!xlnt::detail::shift_span(from, to, position, count, insert))
+    {
+        return false;
+    }
+
+    const auto limit = std::uint64_t(rows ? last_sheet_row : last_sheet_column);
+
+    if (from > limit) return false;
+    to = std::min(to, limit);
+
+    if (reversed)
+    {
+        std::swap(from, to);
+    }
+
+    set_line(first, rows, from);
+    set_line(last, rows, to);
+
+    return true;
+}
+
+std::string to_string(const reference_part &part)
+{
+    std::string result;
+
+    if (part.absolute_column) result.push_back('$');
+    result.append(part.column);
+    if (part.absolute_row) result.push_back('$');
+    result.append(part.row);
+
+    return result;
+}
+
+// Returns true if the sheet titles are equal, ignoring case as spreadsheet applications do.
+bool same_title(const std::string &lhs, const std::string &rhs)
+{
+    return lhs.size() == rhs.size()
+        && std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](char a, char b) {
+               return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+           });
+}
+
+// Calls rewrite with each reference in formula, the sheet it's qualified with or an
+// empty string, and its first and, for a range, second part. The reference is replaced
+// by the parts as rewrite leaves them, or by #REF! if it returns false. References to
+// other workbooks or to ranges of sheets get a sheet no worksheet can be titled.
+std::string rewrite_references(const std::string &formula,
+    const std::function<bool(const std::string &, reference_part &, reference_part *)> &rewrite)
+{
+    std::string result;
+    result.reserve(formula.size());
+
+    std::size_t i = 0;
+    std::string sheet;
+
+    // Copies a quoted string or sheet name, where a doubled quote is an escaped one.
+    auto copy_quoted = [&](char quote) {
+        result.push_back(formula[i++]);
+
+        while (i < formula.size())
+        {
+            result.push_back(formula[i]);
+
+            if (formula[i++] == quote)
+            {
+                if (i < formula.size() && formula[i] == quote)
+                {
+                    result.push_back(formula[i++]);
+                }
+                else
+                {
+                    break;
+                }
+            }
+        }
+    };
+
+    auto read_word = [&](std::size_t start) {
+        auto end = start;
+        while (end < formula.size() && is_word_character(formula[end])) ++end;
+        return formula.substr(start, end - start);
+    };
+
+    while (i < formula.size())
+    {
+        const auto c = formula[i];
+
+        if (c == '"' || c == '\'')
+        {
+            const auto start = i;
+            copy_quoted(c);
+            sheet.clear();
+
+            if (c == '\'' && i < formula.size() && formula[i] == '!')
+            {
+                for (auto j = start + 1; j + 1 < i; ++j)
+                {
+                    sheet.push_back(formula[j]);
+                    if (formula[j] == '\'') ++j;
+                }
+
+                result.push_back(formula[i++]);
+            }
+
+            continue;
+        }
+
+        if (c == '[')
+        {
+            // structured and external references are left alone
+            while (i < formula.size() && formula[i] != ']')
+            {
+                result.push_back(formula[i++]);
+            }
+
+            sheet.clear();
+            continue;
+        }
+
+        if (c == '#')
+        {
+            // error literals such as #REF! contain letters but aren't references
+            while (i < formula.size() && (c == formula[i] || is_letter(formula[i]) || formula[i] == '/' || is_digit(formula[i])))
+            {
+                result.push_back(formula[i++]);
+            }
+
+            sheet.clear();
+            continue;
+        }
+
+        if (!is_word_character(c))
+        {
+            result.push_back(c);
+            ++i;
+            sheet.clear();
+            continue;
+        }
+
+        const auto word = read_word(i);
+        const auto after = i + word.size();
+        const auto next = after < formula.size() ? formula[after] : '\0';
+
+        if (next == '!')
+        {
+            const auto previous = i > 0 ? formula[i - 1] : '\0';
+            sheet = previous == ']' || previous == ':' ? std::string(1, previous) + word : word;
+            result.append(word + "!");
+            i = after + 1;
+            continue;
+        }
+
+        reference_part first;
+
+        // words followed by '(' are functions
+        if (next == '(' || !parse_part(word, first))
+        {
+            result.append(word);
+            i = after;
+            sheet.clear();
+            continue;
+        }
+
+        if (next == ':')
+        {
+            const auto second_word = read_word(after + 1);
+            reference_part second;
+
+            if (!second_word.empty() && parse_part(second_word, second)
+                && first.has_column == second.has_column && first.has_row == second.has_row)
+            {
+                if (rewrite(sheet, first, &second))
+                {
+                    result.append(to_string(first) + ":" + to_string(second));
+                }
+                else
+                {
+                    result.append("#REF!");
+                }
+
+                i = after + 1 + second_word.size();
+                sheet.clear();
+                continue;
+            }
+        }
+
+        // a lone column or row isn't a reference, it's a name or a number
+        if (!first.has_column || !first.has_row)
+        {
+            result.append(word);
+        }
+        else if (rewrite(sheet, first, nullptr))
+        {
+            result.append(to_string(first));
+        }
+        else
+        {
+            result.append("#REF!");
+        }
+
+        i = after;
+        sheet.clear();
+    }
+
+    return result;
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+bool operator==(const shared_formula &lhs, const shared_formula &rhs)
+{
+    return lhs.anchor == rhs.anchor && lhs.formula == rhs.formula;
+}
+
+bool shift_span(std::uint64_t &first, std::uint64_t &last, std::uint64_t position, std::uint64_t count, bool insert)
+{
+    if (insert)
+    {
+        if (first >= position) first += count;
+        if (last >= position) last += count;
+
+        return true;
+    }
+
+    const auto end = position + count;
+
+    if (first >= position && last < end)
+    {
+        return false;
+    }
+
+    if (first >= end)
+    {
+        first -= count;
+    }
+    else if (first >= position)
+    {
+        first = position;
+    }
+
+    if (last >= end)
+    {
+        last -= count;
+    }
+    else if (last >= position)
+    {
+        last = position - 1;
+    }
+
+    return true;
+}
+
+std::string translate_formula(const std::string &formula, std::int64_t rows, std::int64_t columns)
+{
+    return rewrite_references(formula, [rows, columns](const std::string &, reference_part &first, reference_part *second) {
+        return translate_part(first, rows, columns) && (second == nullptr || translate_part(*second, rows, columns));
+    });
+}
+
+std::string shift_formula(const std::string &formula, const std::string &sheet, bool local,
+    bool rows, std::uint32_t position, std::uint32_t count, bool insert)
+{
+    return rewrite_references(formula, [&](const std::string &qualifier, reference_part &first, reference_part *second) {
+        if (qualifier.empty() ? !local : !same_title(qualifier, sheet))
+        {
+            return true;
+        }
+
+        return shift_parts(first, second == nullptr ? first : *second, rows, position, count, insert);
+    });
+}
+
+std::string cell_formula(const std::vector<shared_formula> &groups, const cell_impl &cell)
+{
+    if (cell.formula_.is_set())
+    {
+        return cell.formula_.get();
+    }
+
+    const auto &group = groups.at(cell.shared_formula_ - 1);
+
+    return translate_formula(group.formula,
+        static_cast<std::int64_t>(cell.row_) - group.anchor.row(),
+        static_cast<std::int64_t>(cell.column_.index) - group.anchor.column_index());
+}
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,89 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <xlnt/xlnt_config.hpp>
+#include <xlnt/cell/cell_reference.hpp>
+
+namespace xlnt {
+namespace detail {
+
+struct cell_impl;
+
+/// <summary>
+/// A formula shared by a group of cells, as in a formula filled down a column.
+/// Only the formula of the anchor cell is stored. The formula of every other cell
+/// in the group is the anchor's with its relative references moved by the offset
+/// between the cells.
+/// </summary>
+struct shared_formula
+{
+    cell_reference anchor;
+    std::string formula;
+};
+
+bool operator==(const shared_formula &lhs, const shared_formula &rhs);
+
+/// <summary>
+/// The last row and column a spreadsheet file can hold, A1:XFD1048576.
+/// </summary>
+const row_t last_sheet_row = 1048576;
+const column_t::index_t last_sheet_column = 16384;
+
+/// <summary>
+/// Moves the span [first, last] of row or column indices to account for count lines
+/// inserted before position, or deleted starting at position. Returns false if the
+/// whole span was deleted.
+/// </summary>
+bool shift_span(std::uint64_t &first, std::uint64_t &last, std::uint64_t position, std::uint64_t count, bool insert);
+
+/// <summary>
+/// Returns formula with each relative row of a reference moved by rows and
+/// each relative column moved by columns. References moved off the sheet
+/// become #REF!.
+/// </summary>
+XLNT_API std::string translate_formula(const std::string &formula, std::int64_t rows, std::int64_t columns);
+
+/// <summary>
+/// Returns formula with each reference to the worksheet titled sheet moved to account
+/// for count rows, or columns if rows is false, inserted before position or deleted
+/// starting at position. References without a sheet are included if local is true.
+/// Relative and absolute references move alike, ranges grow and shrink with the lines
+/// inside them, and references to cells that were all deleted become #REF!.
+/// </summary>
+XLNT_API std::string shift_formula(const std::string &formula, const std::string &sheet, bool local,
+    bool rows, std::uint32_t position, std::uint32_t count, bool insert);
+
+/// <summary>
+/// Returns the formula of cell, expanding it from groups, the shared formulas of
+/// its worksheet, if it's part of one. The cell must have a formula.
+/// </summary>
+std::string cell_formula(const std::vector<shared_formula> &groups, const cell_impl &cell);
+
+} // namespace detail
+} // namespace xlnt
@@ -31,11 +31,13 @@ namespace detail {
 
 cell_impl::cell_impl()
     : type_(cell_type::empty),
+      shared_formula_(0),
       parent_(nullptr),
+      generation_(0),
       column_(1),
       row_(1),
-      is_merged_(false),
-      value_numeric_(0)
+      value_numeric_(0),
+      comment_(false)
 {
 }
 
@@ -23,6 +23,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 
 #include <xlnt/cell/cell_type.hpp>
@@ -39,6 +40,10 @@ namespace detail {
 
 struct worksheet_impl;
 
+/// <summary>
+/// The data of a cell. Rows of cells can be shared between a worksheet and its
+/// copies, so parent_ is only meaningful to cell objects handed out for this cell.
+/// </summary>
 struct cell_impl
 {
     cell_impl();
@@ -49,35 +54,42 @@ struct cell_impl
     
     cell_type type_;
 
+    // One plus the index of this cell's group in its worksheet's shared formulas or
+    // zero if it isn't part of one. Kept next to type_ where it fits in padding.
+    std::uint32_t shared_formula_;
+
+    // The worksheet the last cell object referring to this cell was handed out for and
+    // the generation of its cell_store at that time. See cell_store::handed_out.
     worksheet_impl *parent_;
+    std::uint32_t generation_;
 
     column_t column_;
     row_t row_;
 
-    bool is_merged_;
-
     rich_text value_text_;
     double value_numeric_;
 
     optional<std::string> formula_;
     optional<hyperlink_impl> hyperlink_;
     optional<format_impl *> format_;
-    optional<comment *> comment_;
+
+    // True if the worksheet has a comment for this cell in its comments
+    bool comment_;
 };
 
 inline bool operator==(const cell_impl &lhs, const cell_impl &rhs)
 {
-    // not comparing parent
+    // not comparing parent, comments are compared with the rest of the worksheet
     return lhs.type_ == rhs.type_
         && lhs.column_ == rhs.column_
         && lhs.row_ == rhs.row_
-        && lhs.is_merged_ == rhs.is_merged_
         && lhs.value_text_ == rhs.value_text_
         && lhs.value_numeric_ == rhs.value_numeric_
         && lhs.formula_ == rhs.formula_
+        && lhs.shared_formula_ == rhs.shared_formula_
         && lhs.hyperlink_ == rhs.hyperlink_
         && (lhs.format_.is_set() == rhs.format_.is_set() && (!lhs.format_.is_set() || *lhs.format_.get() == *rhs.format_.get()))
-        && (lhs.comment_.is_set() == rhs.comment_.is_set() && (!lhs.comment_.is_set() || *lhs.comment_.get() == *rhs.comment_.get()));
+        && lhs.comment_ == rhs.comment_;
 }
 
 } // namespace detail
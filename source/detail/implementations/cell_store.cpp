@@ -0,0 +1,997 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <detail/constants.hpp>
+#include <detail/implementations/cell_store.hpp>
+#include <detail/implementations/heap_usage.hpp>
+#include <detail/serialization/binary_buffer.hpp>
+
+namespace {
+
+using xlnt::detail::cell_impl;
+using xlnt::detail::cell_store;
+using xlnt::detail::heap_usage;
+
+const xlnt::row_t no_block = std::numeric_limits<xlnt::row_t>::max();
+
+// The number of cells in memory counted between checks of the memory used by a store.
+const std::size_t min_check_interval = 4096;
+
+xlnt::row_t block_of(xlnt::row_t row)
+{
+    return row / cell_store::rows_per_block;
+}
+
+void measure(const cell_store::row_type &row, std::size_t &cells, std::size_t &formulas)
+{
+    cells += heap_usage::of_shared<cell_store::row_type>() + heap_usage::of_hash_table(row);
+
+    for (const auto &entry : row)
+    {
+        const auto &cell = entry.second;
+
+        cells += heap_usage::of(cell.value_text_);
+        formulas += heap_usage::of(cell.formula_);
+
+        if (cell.hyperlink_.is_set())
+        {
+            cells += heap_usage::of(cell.hyperlink_.get());
+        }
+    }
+}
+
+std::size_t measure(const cell_store::row_type &row)
+{
+    auto bytes = std::size_t(0);
+    measure(row, bytes, bytes);
+
+    return bytes;
+}
+
+// Paged out rows are stored as a count of rows followed by each row's index, its count
+// of cells and its cells. Numbers are stored in the byte order of the machine since
+// the file never outlives the process. Formats are stored as indices into the format
+// table of the file.
+class block_writer : public xlnt::detail::binary_writer
+{
+public:
+    block_writer(std::vector<std::uint8_t> &bytes, xlnt::detail::spill_file &file)
+        : binary_writer(bytes),
+          file_(file)
+    {
+    }
+
+    // Returns false without writing anything useful if the cell can't be paged out.
+    bool write_cell(const cell_impl &cell)
+    {
+        if (cell.hyperlink_.is_set() || cell.comment_) return false;
+
+        const auto runs = cell.value_text_.runs();
+
+        for (const auto &run : runs)
+        {
+            if (run.second.is_set()) return false;
+        }
+
+        write(static_cast<std::uint32_t>(cell.column_.index));
+        write(static_cast<std::uint8_t>(cell.type_));
+        write(cell.shared_formula_);
+        write(cell.value_numeric_);
+        write(static_cast<std::uint8_t>((cell.formula_.is_set() ? 1 : 0) | (cell.format_.is_set() ? 2 : 0)));
+        write(static_cast<std::uint32_t>(runs.size()));
+
+        for (const auto &run : runs)
+        {
+            write(run.first);
+            write(static_cast<std::uint8_t>(run.preserve_space));
+        }
+
+        if (cell.formula_.is_set())
+        {
+            write(cell.formula_.get());
+        }
+
+        if (cell.format_.is_set())
+        {
+            write(file_.format_index(cell.format_.get()));
+        }
+
+        return true;
+    }
+
+private:
+    xlnt::detail::spill_file &file_;
+};
+
+class block_reader : public xlnt::detail::binary_reader
+{
+public:
+    block_reader(const std::vector<std::uint8_t> &bytes, const xlnt::detail::spill_file &file)
+        : binary_reader(bytes.data(), bytes.size()),
+          file_(file)
+    {
+    }
+
+    void read_cell(cell_impl &cell)
+    {
+        cell.column_ = read<std::uint32_t>();
+        cell.type_ = static_cast<xlnt::cell_type>(read<std::uint8_t>());
+        cell.shared_formula_ = read<std::uint32_t>();
+        cell.value_numeric_ = read<double>();
+
+        const auto flags = read<std::uint8_t>();
+        const auto runs = read<std::uint32_t>();
+
+        for (auto i = std::uint32_t(0); i < runs; ++i)
+        {
+            auto text = read_string();
+            const auto preserve_space = read<std::uint8_t>() != 0;
+            cell.value_text_.add_run(xlnt::rich_text_run{std::move(text), xlnt::optional<xlnt::font>(), preserve_space});
+        }
+
+        if ((flags & 1) != 0)
+        {
+            cell.formula_ = read_string();
+        }
+
+        if ((flags & 2) != 0)
+        {
+            cell.format_ = file_.format(read<std::uint32_t>());
+        }
+    }
+
+private:
+    const xlnt::detail::spill_file &file_;
+};
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+const row_t cell_store::rows_per_block = 256;
+
+cell_store::cell_store()
+    : rows_(std::make_shared<row_map>()),
+      last_block_(no_block)
+{
+}
+
+cell_store::~cell_store()
+{
+    if (spill_)
+    {
+        release_records();
+        spill_->detach(this);
+    }
+}
+
+cell_store &cell_store::operator=(const cell_store &other)
+{
+    if (this == &other) return *this;
+
+    if (spill_)
+    {
+        release_records();
+    }
+
+    if (spill_ != other.spill_)
+    {
+        if (spill_) spill_->detach(this);
+        spill_ = other.spill_;
+        if (spill_) spill_->attach(this);
+    }
+
+    rows_ = other.rows_;
+    row_bound_ = other.row_bound_;
+    retired_.clear();
+
+    // Cell objects handed out by either store now refer to shared rows
+    ++generation_;
+    ++other.generation_;
+
+    spilled_ = other.spilled_;
+    clean_ = other.clean_;
+    spilled_rows_ = other.spilled_rows_;
+    last_use_ = other.last_use_;
+    last_block_ = no_block;
+    until_check_ = min_check_interval;
+
+    for (const auto &block : spilled_)
+    {
+        spill_->retain(block.second.extent);
+    }
+
+    for (const auto &block : clean_)
+    {
+        spill_->retain(block.second.extent);
+    }
+
+    return *this;
+}
+
+bool cell_store::operator==(const cell_store &other) const
+{
+    if (rows_ == other.rows_ && spilled_.empty() && other.spilled_.empty()) return true;
+    if (size() != other.size()) return false;
+
+    auto equal = true;
+
+    for_each_row([&other, &equal](row_t row, const row_type &cells) {
+        if (!equal) return;
+
+        const auto match = other.find_row(row);
+        equal = match != nullptr && cells == *match;
+    });
+
+    return equal;
+}
+
+void cell_store::spill(std::shared_ptr<spill_file> file)
+{
+    if (file == spill_) return;
+
+    if (spill_ && file)
+    {
+        move_records(*file);
+        spill_->detach(this);
+    }
+    else if (spill_)
+    {
+        page_in_all();
+        spill_->detach(this);
+        last_use_.clear();
+    }
+
+    spill_ = file;
+    last_block_ = no_block;
+    until_check_ = 1;
+
+    if (!spill_) return;
+
+    spill_->attach(this);
+
+    for (const auto &row : *rows_)
+    {
+        last_use_.emplace(block_of(row.first), 0);
+    }
+
+    // Counts this store right away, which pages blocks out if it's over budget already
+    modified(no_block);
+}
+
+std::size_t cell_store::spilled_bytes() const
+{
+    auto bytes = std::size_t(0);
+
+    for (const auto &block : spilled_)
+    {
+        bytes += static_cast<std::size_t>(block.second.extent.size);
+    }
+
+    return bytes;
+}
+
+bool cell_store::empty() const
+{
+    return rows_->empty() && spilled_rows_ == 0;
+}
+
+std::size_t cell_store::size() const
+{
+    return rows_->size() + spilled_rows_;
+}
+
+std::size_t cell_store::cell_count() const
+{
+    auto cells = std::size_t(0);
+
+    for (const auto &row : *rows_)
+    {
+        cells += row.second->size();
+    }
+
+    for (const auto &block : spilled_)
+    {
+        cells += block.second.cells;
+    }
+
+    return cells;
+}
+
+void cell_store::memory_usage(std::size_t &cells, std::size_t &formulas) const
+{
+    const auto map_owners = static_cast<std::size_t>(rows_.use_count());
+    auto cell_bytes = heap_usage::of_shared<row_map>() + heap_usage::of_hash_table(*rows_) * map_owners;
+    auto formula_bytes = std::size_t(0);
+
+    for (const auto &row : *rows_)
+    {
+        // The row map is divided by map_owners below, so shared rows are divided by both
+        const auto row_owners = static_cast<std::size_t>(row.second.use_count());
+        auto row_cell_bytes = std::size_t(0);
+        auto row_formula_bytes = std::size_t(0);
+
+        measure(*row.second, row_cell_bytes, row_formula_bytes);
+
+        cell_bytes += row_cell_bytes / row_owners;
+        formula_bytes += row_formula_bytes / row_owners;
+    }
+
+    cells += cell_bytes / map_owners;
+    formulas += formula_bytes / map_owners;
+}
+
+void cell_store::for_each_row(const std::function<void(row_t, const row_type &)> &visit) const
+{
+    if (!spill_)
+    {
+        for (const auto &row : *rows_)
+        {
+            visit(row.first, *row.second);
+        }
+
+        return;
+    }
+
+    // visit may page blocks in and out, so hold on to what is visited, including the
+    // records of blocks paged out, whose space could otherwise be reused
+    const std::vector<std::pair<row_t, std::shared_ptr<row_type>>> resident(rows_->begin(), rows_->end());
+    const auto spilled = spilled_;
+    const auto file = spill_;
+
+    for (const auto &block : spilled)
+    {
+        file->retain(block.second.extent);
+    }
+
+    try
+    {
+        for (const auto &row : resident)
+        {
+            visit(row.first, *row.second);
+        }
+
+        for (const auto &block : spilled)
+        {
+            read_block(*file, block.second, [&visit](row_t row, std::shared_ptr<row_type> cells) {
+                visit(row, *cells);
+            });
+        }
+    }
+    catch (...)
+    {
+        for (const auto &block : spilled)
+        {
+            file->release(block.second.extent);
+        }
+
+        throw;
+    }
+
+    for (const auto &block : spilled)
+    {
+        file->release(block.second.extent);
+    }
+}
+
+void cell_store::for_each_row_index(const std::function<void(row_t)> &visit) const
+{
+    for (const auto &row : *rows_)
+    {
+        visit(row.first);
+    }
+
+    for (const auto &block : spilled_)
+    {
+        for (auto row : block.second.rows)
+        {
+            visit(row);
+        }
+    }
+}
+
+row_t cell_store::row_bound() const
+{
+    return row_bound_;
+}
+
+void cell_store::column_bounds(column_t &lowest, column_t &highest) const
+{
+    for (const auto &row : *rows_)
+    {
+        for (const auto &cell : *row.second)
+        {
+            lowest = std::min(lowest, cell.first);
+            highest = std::max(highest, cell.first);
+        }
+    }
+
+    for (const auto &block : spilled_)
+    {
+        lowest = std::min(lowest, block.second.lowest);
+        highest = std::max(highest, block.second.highest);
+    }
+}
+
+const cell_store::row_type *cell_store::find_row(row_t row) const
+{
+    auto match = rows_->find(row);
+
+    if (spill_)
+    {
+        // Paging is invisible to readers, so a const store may still page rows in
+        auto &self = const_cast<cell_store &>(*this);
+
+        if (match != rows_->end())
+        {
+            self.used(block_of(row));
+        }
+        else if (spilled_.find(block_of(row)) != spilled_.end())
+        {
+            self.page_in(block_of(row));
+            match = rows_->find(row);
+        }
+    }
+
+    return match == rows_->end() ? nullptr : match->second.get();
+}
+
+const cell_impl *cell_store::find(row_t row, column_t column) const
+{
+    const auto cells = find_row(row);
+    if (cells == nullptr) return nullptr;
+
+    const auto match = cells->find(column);
+    return match == cells->end() ? nullptr : &match->second;
+}
+
+cell_store::row_type &cell_store::row(row_t row)
+{
+    if (spill_)
+    {
+        page_in(block_of(row));
+        modified(block_of(row));
+    }
+
+    auto &cells = unshared_rows()[row];
+
+    if (!cells)
+    {
+        cells = std::make_shared<row_type>();
+        row_bound_ = std::max(row_bound_, row);
+    }
+
+    return unshare(cells);
+}
+
+cell_store::row_type &cell_store::existing_row(row_t row)
+{
+    if (spill_)
+    {
+        page_in(block_of(row));
+        modified(block_of(row));
+    }
+
+    return unshare(unshared_rows().at(row));
+}
+
+void cell_store::erase(row_t row)
+{
+    if (spill_)
+    {
+        page_in(block_of(row));
+        modified(block_of(row));
+    }
+
+    auto &rows = unshared_rows();
+    const auto match = rows.find(row);
+    if (match == rows.end()) return;
+
+    rows.erase(match);
+}
+
+cell_impl &cell_store::cell(row_t row, column_t column)
+{
+    auto &cells = this->row(row);
+    auto match = cells.find(column);
+
+    if (match == cells.end())
+    {
+        match = cells.emplace(column, cell_impl()).first;
+        match->second.column_ = column;
+        match->second.row_ = row;
+    }
+
+    return match->second;
+}
+
+void cell_store::handed_out(cell_impl &cell, worksheet_impl *parent) const
+{
+    cell.parent_ = parent;
+    cell.generation_ = generation_;
+    owner_ = parent;
+}
+
+std::uint32_t cell_store::generation() const
+{
+    return generation_;
+}
+
+void cell_store::reserve(std::size_t n)
+{
+    unshared_rows().reserve(n);
+}
+
+void cell_store::insert_rows(row_t first, row_t count)
+{
+    shift_rows(first, count, true);
+}
+
+void cell_store::delete_rows(row_t first, row_t count)
+{
+    shift_rows(first, count, false);
+}
+
+void cell_store::insert_columns(column_t first, column_t::index_t count)
+{
+    shift_columns(first, count, true);
+}
+
+void cell_store::delete_columns(column_t first, column_t::index_t count)
+{
+    shift_columns(first, count, false);
+}
+
+void cell_store::resident_blocks(std::vector<std::pair<std::uint64_t, row_t>> &blocks) const
+{
+    for (const auto &block : last_use_)
+    {
+        blocks.emplace_back(block.second, block.first);
+    }
+}
+
+std::size_t cell_store::page_out(row_t block)
+{
+    const auto first = block * rows_per_block;
+    auto clean = clean_.find(block);
+    std::vector<std::uint8_t> bytes;
+    block_writer writer(bytes, *spill_);
+
+    spilled_block record;
+    record.lowest = constants::max_column();
+    record.highest = constants::min_column();
+    record.cells = 0;
+
+    if (clean == clean_.end())
+    {
+        writer.write(std::uint32_t(0));
+    }
+
+    for (auto row = first; row - first < rows_per_block && row >= first; ++row)
+    {
+        const auto match = rows_->find(row);
+        if (match == rows_->end()) continue;
+
+        record.rows.push_back(row);
+        if (clean != clean_.end()) continue;
+
+        writer.write(row);
+        writer.write(static_cast<std::uint32_t>(match->second->size()));
+
+        for (const auto &cell : *match->second)
+        {
+            if (!writer.write_cell(cell.second))
+            {
+                // Try again once other blocks have been paged out
+                last_use_[block] = spill_->tick();
+                return 0;
+            }
+
+            record.lowest = std::min(record.lowest, cell.first);
+            record.highest = std::max(record.highest, cell.first);
+            ++record.cells;
+        }
+    }
+
+    last_use_.erase(block);
+    if (last_block_ == block) last_block_ = no_block;
+
+    if (record.rows.empty()) return 0;
+
+    if (clean != clean_.end())
+    {
+        record = std::move(clean->second);
+        clean_.erase(clean);
+    }
+    else
+    {
+        const auto count = static_cast<std::uint32_t>(record.rows.size());
+        std::memcpy(bytes.data(), &count, sizeof(count));
+        record.extent = spill_->write(bytes);
+    }
+
+    auto &rows = unshared_rows();
+    auto freed = std::size_t(0);
+
+    for (auto row : record.rows)
+    {
+        const auto match = rows.find(row);
+        freed += measure(*match->second);
+        rows.erase(match);
+    }
+
+    spilled_rows_ += record.rows.size();
+    spilled_.emplace(block, std::move(record));
+
+    auto &resident = spill_->resident(this);
+    resident -= std::min(resident, freed);
+
+    return freed;
+}
+
+void cell_store::read_block(spill_file &file, const spilled_block &block,
+    const std::function<void(row_t, std::shared_ptr<row_type>)> &visit)
+{
+    std::vector<std::uint8_t> bytes;
+    file.read(block.extent, bytes);
+
+    block_reader reader(bytes, file);
+    const auto rows = reader.read<std::uint32_t>();
+
+    for (auto i = std::uint32_t(0); i < rows; ++i)
+    {
+        const auto row = reader.read<row_t>();
+        const auto cells = reader.read<std::uint32_t>();
+        auto loaded = std::make_shared<row_type>();
+        loaded->reserve(cells);
+
+        for (auto j = std::uint32_t(0); j < cells; ++j)
+        {
+            cell_impl cell;
+            reader.read_cell(cell);
+            cell.row_ = row;
+
+            const auto column = cell.column_;
+            loaded->emplace(column, std::move(cell));
+        }
+
+        visit(row, std::move(loaded));
+    }
+}
+
+void cell_store::page_in(row_t block)
+{
+    const auto found = spilled_.find(block);
+    if (found == spilled_.end()) return;
+
+    auto &rows = unshared_rows();
+    auto loaded = std::size_t(0);
+
+    read_block(*spill_, found->second, [&rows, &loaded](row_t row, std::shared_ptr<row_type> cells) {
+        loaded += measure(*cells);
+        rows[row] = std::move(cells);
+    });
+
+    spilled_rows_ -= found->second.rows.size();
+    clean_.emplace(block, std::move(found->second));
+    spilled_.erase(found);
+
+    last_block_ = no_block;
+    used(block);
+
+    spill_->resident(this) += loaded;
+    spill_->balance(this, block);
+}
+
+void cell_store::page_in_all()
+{
+    page_in_from(0);
+}
+
+void cell_store::page_in_from(row_t block)
+{
+    for (auto found = spilled_.lower_bound(block); found != spilled_.end();)
+    {
+        auto &rows = unshared_rows();
+
+        read_block(*spill_, found->second, [&rows](row_t row, std::shared_ptr<row_type> cells) {
+            rows[row] = std::move(cells);
+        });
+
+        spilled_rows_ -= found->second.rows.size();
+        spill_->release(found->second.extent);
+        last_use_[found->first] = spill_->tick();
+        found = spilled_.erase(found);
+    }
+
+    for (auto clean = clean_.begin(); clean != clean_.end();)
+    {
+        if (clean->first < block)
+        {
+            ++clean;
+            continue;
+        }
+
+        spill_->release(clean->second.extent);
+        clean = clean_.erase(clean);
+    }
+}
+
+void cell_store::release_records()
+{
+    for (const auto &block : spilled_)
+    {
+        spill_->release(block.second.extent);
+    }
+
+    for (const auto &block : clean_)
+    {
+        spill_->release(block.second.extent);
+    }
+
+    spilled_.clear();
+    clean_.clear();
+    spilled_rows_ = 0;
+}
+
+void cell_store::move_records(spill_file &file)
+{
+    for (auto &block : spilled_)
+    {
+        std::vector<std::uint8_t> bytes;
+        block_writer writer(bytes, file);
+        writer.write(static_cast<std::uint32_t>(block.second.rows.size()));
+
+        read_block(*spill_, block.second, [&writer](row_t row, std::shared_ptr<row_type> cells) {
+            writer.write(row);
+            writer.write(static_cast<std::uint32_t>(cells->size()));
+
+            for (const auto &cell : *cells)
+            {
+                writer.write_cell(cell.second);
+            }
+        });
+
+        const auto moved = file.write(bytes);
+        spill_->release(block.second.extent);
+        block.second.extent = moved;
+    }
+
+    // Blocks paged back in are written again if they're paged out
+    for (const auto &block : clean_)
+    {
+        spill_->release(block.second.extent);
+    }
+
+    clean_.clear();
+}
+
+void cell_store::used(row_t block)
+{
+    if (block == last_block_) return;
+
+    last_block_ = block;
+    last_use_[block] = spill_->tick();
+}
+
+void cell_store::modified(row_t block)
+{
+    if (!clean_.empty())
+    {
+        const auto clean = clean_.find(block);
+
+        if (clean != clean_.end())
+        {
+            spill_->release(clean->second.extent);
+            clean_.erase(clean);
+        }
+    }
+
+    if (block != no_block)
+    {
+        used(block);
+    }
+
+    if (--until_check_ != 0) return;
+
+    auto bytes = heap_usage::of_hash_table(*rows_);
+    auto cells = std::size_t(0);
+
+    for (const auto &row : *rows_)
+    {
+        bytes += measure(*row.second);
+        cells += row.second->size();
+    }
+
+    spill_->resident(this) = bytes;
+    until_check_ = std::max(min_check_interval, cells / 2);
+    spill_->balance(this, block);
+}
+
+cell_store::row_map &cell_store::unshared_rows()
+{
+    if (rows_.use_count() > 1)
+    {
+        rows_ = std::make_shared<row_map>(*rows_);
+    }
+
+    return *rows_;
+}
+
+cell_store::row_type &cell_store::unshare(std::shared_ptr<row_type> &row)
+{
+    if (row.use_count() > 1)
+    {
+        const auto owner = owner_;
+        const auto handed_out = owner != nullptr && std::any_of(row->begin(), row->end(),
+            [owner](const row_type::value_type &cell) { return cell.second.parent_ == owner; });
+
+        if (handed_out)
+        {
+            // Cell objects from before the last copy may still point into the row
+            if (retired_generation_ != generation_)
+            {
+                retired_.clear();
+                retired_generation_ = generation_;
+            }
+
+            retired_.push_back(row);
+        }
+
+        row = std::make_shared<row_type>(*row);
+    }
+
+    return *row;
+}
+
+void cell_store::shift_rows(row_t first, row_t count, bool insert)
+{
+    if (row_bound_ < first) return;
+
+    if (spill_)
+    {
+        page_in_from(block_of(first));
+    }
+
+    auto &rows = unshared_rows();
+    const auto end = std::uint64_t(first) + count;
+
+    // Take the affected rows out first so moved rows never collide with ones not yet moved.
+    std::vector<std::pair<row_t, std::shared_ptr<row_type>>> moved;
+
+    auto take = [&](row_map::iterator it) {
+        if (insert || it->first >= end)
+        {
+            moved.emplace_back(insert ? it->first + count : it->first - count, std::move(it->second));
+        }
+
+        return rows.erase(it);
+    };
+
+    // Look the rows up one by one unless there are fewer rows in the store than after first
+    if (std::uint64_t(row_bound_) - first < rows.size())
+    {
+        for (auto row = std::uint64_t(first); row <= row_bound_; ++row)
+        {
+            const auto match = rows.find(static_cast<row_t>(row));
+            if (match != rows.end()) take(match);
+        }
+    }
+    else
+    {
+        for (auto it = rows.begin(); it != rows.end();)
+        {
+            it = it->first < first ? std::next(it) : take(it);
+        }
+    }
+
+    row_bound_ = insert ? row_bound_ + count : (row_bound_ >= end ? row_t(row_bound_ - count) : first - 1);
+
+    for (auto &entry : moved)
+    {
+        auto &cells = rows[entry.first];
+        cells = std::move(entry.second);
+
+        for (auto &cell : unshare(cells))
+        {
+            cell.second.row_ = entry.first;
+        }
+    }
+
+    if (spill_)
+    {
+        // Rows moved to other blocks, which start out equally cold
+        for (auto it = last_use_.begin(); it != last_use_.end();)
+        {
+            it = it->first > block_of(first) ? last_use_.erase(it) : std::next(it);
+        }
+
+        for (const auto &entry : moved)
+        {
+            last_use_.emplace(block_of(entry.first), 0);
+        }
+
+        last_block_ = no_block;
+    }
+}
+
+void cell_store::shift_columns(column_t first, column_t::index_t count, bool insert)
+{
+    if (spill_)
+    {
+        page_in_all();
+    }
+
+    auto &rows = unshared_rows();
+    const auto end = first.index + count;
+
+    for (auto it = rows.begin(); it != rows.end();)
+    {
+        const auto affected = std::any_of(it->second->begin(), it->second->end(),
+            [first](const row_type::value_type &cell) { return cell.first >= first; });
+
+        if (!affected)
+        {
+            ++it;
+            continue;
+        }
+
+        auto &cells = unshare(it->second);
+        row_type shifted;
+        shifted.reserve(cells.size());
+
+        for (auto &cell : cells)
+        {
+            auto column = cell.first;
+
+            if (column >= first)
+            {
+                if (!insert && column.index < end) continue;
+
+                column = insert ? column.index + count : column.index - count;
+                cell.second.column_ = column;
+            }
+
+            shifted.emplace(column, std::move(cell.second));
+        }
+
+        if (shifted.empty())
+        {
+            it = rows.erase(it);
+            continue;
+        }
+
+        cells.swap(shifted);
+        ++it;
+    }
+}
+
+} // namespace detail
+} // namespace xlnt
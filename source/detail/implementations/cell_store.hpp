@@ -0,0 +1,338 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <xlnt/cell/index_types.hpp>
+#include <detail/implementations/cell_impl.hpp>
+#include <detail/implementations/spill_file.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// Copy-on-write storage for the cells of a worksheet, indexed by row and then by column.
+/// Copying a cell_store only shares the existing rows. The row index is copied the
+/// first time either copy is modified, and each row is copied the first time a cell
+/// in it is accessed for writing. Copying also starts a new generation of both stores.
+/// Cell objects remember the generation they were handed out in and, once it changed,
+/// look their cell up again for writing before using it, so they never write to a row
+/// shared with a copy. Rows copied away from are kept until the next generation so
+/// that those objects can still be used until their worksheet is copied again.
+/// When a spill_file is attached, blocks of rows_per_block rows are paged out to it
+/// once the attached stores use more memory than its budget, least recently used first,
+/// and paged back in when a row in them is accessed. Paging out a block invalidates
+/// pointers and references to its rows and cells.
+/// </summary>
+class cell_store
+{
+public:
+    using row_type = std::unordered_map<column_t, cell_impl>;
+    using row_map = std::unordered_map<row_t, std::shared_ptr<row_type>>;
+
+    /// <summary>
+    /// The number of consecutive rows paged in and out together.
+    /// </summary>
+    static const row_t rows_per_block;
+
+    cell_store();
+
+    cell_store(const cell_store &other) = delete;
+
+    /// <summary>
+    /// Detaches this store from its spill file.
+    /// </summary>
+    ~cell_store();
+
+    /// <summary>
+    /// Shares the rows of other with this store, including rows it has paged out,
+    /// attaches this store to the spill file of other and starts a new generation of both.
+    /// </summary>
+    cell_store &operator=(const cell_store &other);
+
+    /// <summary>
+    /// Returns true if the cells in both stores are equal.
+    /// </summary>
+    bool operator==(const cell_store &other) const;
+
+    /// <summary>
+    /// Attaches this store to file so that blocks of rows can be paged out to it, moving
+    /// the blocks paged out to the file it was attached to before into file. Passing
+    /// nullptr pages every row back in.
+    /// </summary>
+    void spill(std::shared_ptr<spill_file> file);
+
+    /// <summary>
+    /// Returns the bytes of the records holding the rows of this store that are paged out.
+    /// </summary>
+    std::size_t spilled_bytes() const;
+
+    /// <summary>
+    /// Returns true if there are no rows in this store.
+    /// </summary>
+    bool empty() const;
+
+    /// <summary>
+    /// Returns the number of rows in this store.
+    /// </summary>
+    std::size_t size() const;
+
+    /// <summary>
+    /// Returns the number of cells in this store.
+    /// </summary>
+    std::size_t cell_count() const;
+
+    /// <summary>
+    /// Adds an estimate of the bytes used by rows and cells to cells and by the text
+    /// of formulas to formulas. Rows shared with copies of this store count in
+    /// proportion to the number of stores sharing them. Rows paged out aren't counted.
+    /// </summary>
+    void memory_usage(std::size_t &cells, std::size_t &formulas) const;
+
+    /// <summary>
+    /// Calls visit with each row of this store in no particular order. Nothing is copied.
+    /// Rows paged out are read for the visit without being paged back in. visit may
+    /// access the store, but rows it adds may or may not be visited.
+    /// </summary>
+    void for_each_row(const std::function<void(row_t, const row_type &)> &visit) const;
+
+    /// <summary>
+    /// Calls visit with the index of each row of this store in no particular order
+    /// without reading rows that are paged out.
+    /// </summary>
+    void for_each_row_index(const std::function<void(row_t)> &visit) const;
+
+    /// <summary>
+    /// Returns a row at or after the last row of this store. Removing rows doesn't lower it.
+    /// </summary>
+    row_t row_bound() const;
+
+    /// <summary>
+    /// Lowers lowest to the lowest column and raises highest to the highest column
+    /// of any cell in this store without reading rows that are paged out.
+    /// </summary>
+    void column_bounds(column_t &lowest, column_t &highest) const;
+
+    /// <summary>
+    /// Returns the given row or nullptr if it doesn't exist. Nothing is copied, but the
+    /// block containing the row is paged back in if it was paged out.
+    /// </summary>
+    const row_type *find_row(row_t row) const;
+
+    /// <summary>
+    /// Returns the cell at the given position or nullptr if it doesn't exist.
+    /// Nothing is copied.
+    /// </summary>
+    const cell_impl *find(row_t row, column_t column) const;
+
+    /// <summary>
+    /// Returns the given row for writing, creating it if it doesn't exist.
+    /// </summary>
+    row_type &row(row_t row);
+
+    /// <summary>
+    /// Returns the given row for writing. Throws std::out_of_range if it doesn't exist.
+    /// </summary>
+    row_type &existing_row(row_t row);
+
+    /// <summary>
+    /// Removes the given row.
+    /// </summary>
+    void erase(row_t row);
+
+    /// <summary>
+    /// Returns the cell at the given position for writing, creating it if it doesn't exist.
+    /// </summary>
+    cell_impl &cell(row_t row, column_t column);
+
+    /// <summary>
+    /// Records that a cell object referring to cell, which must be in a row returned by
+    /// row or existing_row since, is handed out for parent, the worksheet of this store.
+    /// </summary>
+    void handed_out(cell_impl &cell, worksheet_impl *parent) const;
+
+    /// <summary>
+    /// Returns the current generation of this store. It changes whenever this store is
+    /// copied or copied from.
+    /// </summary>
+    std::uint32_t generation() const;
+
+    /// <summary>
+    /// Reserves space in the row index for n rows.
+    /// </summary>
+    void reserve(std::size_t n);
+
+    /// <summary>
+    /// Moves every row from first on down by count rows. Only rows from first on are
+    /// visited, and moved rows shared with another store are copied since their cells
+    /// store their row.
+    /// </summary>
+    void insert_rows(row_t first, row_t count);
+
+    /// <summary>
+    /// Removes count rows starting at first and moves the rows after them up by count rows.
+    /// </summary>
+    void delete_rows(row_t first, row_t count);
+
+    /// <summary>
+    /// Moves every cell from column first on right by count columns. Only rows with
+    /// a cell at or right of first are copied.
+    /// </summary>
+    void insert_columns(column_t first, column_t::index_t count);
+
+    /// <summary>
+    /// Removes count columns starting at first and moves the cells right of them
+    /// left by count columns.
+    /// </summary>
+    void delete_columns(column_t first, column_t::index_t count);
+
+    /// <summary>
+    /// Appends the last use and number of each block of rows in memory to blocks.
+    /// </summary>
+    void resident_blocks(std::vector<std::pair<std::uint64_t, row_t>> &blocks) const;
+
+    /// <summary>
+    /// Writes the given block of rows to the spill file and removes it from memory, unless
+    /// a cell in it has a comment, a hyperlink or formatted text. Returns an estimate
+    /// of the bytes freed.
+    /// </summary>
+    std::size_t page_out(row_t block);
+
+private:
+    /// <summary>
+    /// A block of rows in the spill file.
+    /// </summary>
+    struct spilled_block
+    {
+        spill_file::extent extent;
+        std::vector<row_t> rows;
+        column_t lowest;
+        column_t highest;
+        std::size_t cells;
+    };
+
+    /// <summary>
+    /// Reads the rows of block from file and calls visit with each of them.
+    /// </summary>
+    static void read_block(spill_file &file, const spilled_block &block,
+        const std::function<void(row_t, std::shared_ptr<row_type>)> &visit);
+
+    /// <summary>
+    /// Reads the given block back into memory if it was paged out.
+    /// </summary>
+    void page_in(row_t block);
+
+    /// <summary>
+    /// Reads every block paged out back into memory.
+    /// </summary>
+    void page_in_all();
+
+    /// <summary>
+    /// Reads every block from the given one on back into memory to be modified.
+    /// </summary>
+    void page_in_from(row_t block);
+
+    /// <summary>
+    /// Releases the records of every block paged out or paged back in and forgets them.
+    /// </summary>
+    void release_records();
+
+    /// <summary>
+    /// Writes every block paged out to file and releases it from the current spill file.
+    /// </summary>
+    void move_records(spill_file &file);
+
+    /// <summary>
+    /// Records that the given block was just accessed.
+    /// </summary>
+    void used(row_t block);
+
+    /// <summary>
+    /// Records that the given block is about to be modified and, every so often,
+    /// counts the memory used by this store and balances the spill file.
+    /// </summary>
+    void modified(row_t block);
+
+    /// <summary>
+    /// Ensures the row index isn't shared with another store.
+    /// </summary>
+    row_map &unshared_rows();
+
+    /// <summary>
+    /// Ensures the given row isn't shared with another store and returns it.
+    /// </summary>
+    row_type &unshare(std::shared_ptr<row_type> &row);
+
+    /// <summary>
+    /// Moves the rows from first on by count rows, down if insert is true, otherwise up
+    /// after removing the count rows starting at first.
+    /// </summary>
+    void shift_rows(row_t first, row_t count, bool insert);
+
+    /// <summary>
+    /// Moves the cells from column first on by count columns, right if insert is true,
+    /// otherwise left after removing the count columns starting at first.
+    /// </summary>
+    void shift_columns(column_t first, column_t::index_t count, bool insert);
+
+    std::shared_ptr<row_map> rows_;
+
+    // No row after this one exists, in memory or paged out
+    row_t row_bound_ = 0;
+
+    // Copying a store from a const reference starts a new generation of it too
+    mutable std::uint32_t generation_ = 0;
+
+    // The worksheet cell objects were last handed out for
+    mutable worksheet_impl *owner_ = nullptr;
+
+    // Rows with cells handed out for owner_ that were shared and copied away from in
+    // generation retired_generation_, kept for cell objects that may still refer to them
+    std::vector<std::shared_ptr<row_type>> retired_;
+    std::uint32_t retired_generation_ = 0;
+
+    std::shared_ptr<spill_file> spill_;
+
+    // Paged out blocks by block number, and blocks paged back in and not modified
+    // since, which can be paged out again without writing them.
+    std::map<row_t, spilled_block> spilled_;
+    std::unordered_map<row_t, spilled_block> clean_;
+    std::size_t spilled_rows_ = 0;
+
+    // The last use of each block in memory while a spill file is attached.
+    std::unordered_map<row_t, std::uint64_t> last_use_;
+    row_t last_block_ = 0;
+    std::size_t until_check_ = 0;
+};
+
+} // namespace detail
+} // namespace xlnt
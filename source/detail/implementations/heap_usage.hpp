@@ -0,0 +1,142 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <xlnt/cell/comment.hpp>
+#include <xlnt/cell/rich_text.hpp>
+#include <xlnt/utils/optional.hpp>
+#include <detail/implementations/hyperlink_impl.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// Estimates how many bytes objects allocate beyond their own size from the sizes and
+/// capacities of their containers. String and vector buffers are counted exactly. Nodes of
+/// lists, maps and hash tables are assumed to hold the usual pointers of the standard
+/// library next to the value. Bookkeeping of the allocator itself is not counted.
+/// </summary>
+class heap_usage
+{
+public:
+    /// <summary>
+    /// Returns the size of the buffer of a string or zero if it is stored in the string itself.
+    /// </summary>
+    static std::size_t of(const std::string &text)
+    {
+        const auto data = reinterpret_cast<const char *>(text.data());
+        const auto object = reinterpret_cast<const char *>(&text);
+
+        if (data >= object && data < object + sizeof(std::string))
+        {
+            return 0;
+        }
+
+        return text.capacity() + 1;
+    }
+
+    static std::size_t of(const optional<std::string> &text)
+    {
+        return text.is_set() ? of(text.get()) : 0;
+    }
+
+    static std::size_t of(const rich_text &text)
+    {
+        auto bytes = text.runs_.capacity() * sizeof(rich_text_run);
+
+        for (const auto &run : text.runs_)
+        {
+            bytes += of(run.first);
+        }
+
+        return bytes;
+    }
+
+    static std::size_t of(const comment &note)
+    {
+        return of(note.text_) + of(note.author_) + of(note.fill_);
+    }
+
+    static std::size_t of(const hyperlink_impl &link)
+    {
+        return of(link.location) + of(link.tooltip) + of(link.display);
+    }
+
+    /// <summary>
+    /// Returns the size of the buffer of a vector, not including what its elements allocate.
+    /// </summary>
+    template <typename T>
+    static std::size_t of(const std::vector<T> &values)
+    {
+        return values.capacity() * sizeof(T);
+    }
+
+    /// <summary>
+    /// Returns the size of the buckets and nodes of a std::unordered_map or std::unordered_set,
+    /// not including what its elements allocate.
+    /// </summary>
+    template <typename HashTable>
+    static std::size_t of_hash_table(const HashTable &table)
+    {
+        return table.bucket_count() * sizeof(void *)
+            + table.size() * (sizeof(typename HashTable::value_type) + sizeof(void *) + sizeof(std::size_t));
+    }
+
+    /// <summary>
+    /// Returns the size of the nodes of a std::map or std::set, not including what its elements allocate.
+    /// </summary>
+    template <typename Tree>
+    static std::size_t of_tree(const Tree &tree)
+    {
+        return tree.size() * (sizeof(typename Tree::value_type) + 4 * sizeof(void *));
+    }
+
+    /// <summary>
+    /// Returns the size of the nodes of a std::list, not including what its elements allocate.
+    /// </summary>
+    template <typename T>
+    static std::size_t of(const std::list<T> &values)
+    {
+        return values.size() * (sizeof(T) + 2 * sizeof(void *));
+    }
+
+    /// <summary>
+    /// Returns the size of an object created by std::make_shared including its control block.
+    /// </summary>
+    template <typename T>
+    static std::size_t of_shared()
+    {
+        return sizeof(T) + 2 * sizeof(void *);
+    }
+};
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,154 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <stdexcept>
+
+#include <detail/implementations/heap_usage.hpp>
+#include <detail/implementations/image_store.hpp>
+
+namespace xlnt {
+namespace detail {
+
+bool image_store::contains(const std::string &path) const
+{
+    return images_.count(path) > 0 || spilled_.count(path) > 0;
+}
+
+const std::vector<std::uint8_t> &image_store::at(const std::string &path) const
+{
+    const auto match = images_.find(path);
+    if (match != images_.end()) return match->second;
+
+    const auto spilled = spilled_.find(path);
+
+    if (spilled == spilled_.end())
+    {
+        throw std::out_of_range("no image at " + path);
+    }
+
+    if (read_path_ != path)
+    {
+        read_path_.clear();
+        spill_->read(spilled->second, read_);
+        read_path_ = path;
+    }
+
+    return read_;
+}
+
+void image_store::set(const std::string &path, std::vector<std::uint8_t> image)
+{
+    if (read_path_ == path)
+    {
+        read_path_.clear();
+    }
+
+    if (!spill_)
+    {
+        images_[path] = std::move(image);
+        return;
+    }
+
+    const auto replaced = spilled_.find(path);
+
+    if (replaced != spilled_.end())
+    {
+        spill_->release(replaced->second);
+    }
+
+    spilled_[path] = spill_->write(image);
+    images_.erase(path);
+}
+
+void image_store::spill(std::shared_ptr<spill_file> file)
+{
+    if (file == spill_) return;
+
+    for (const auto &image : spilled_)
+    {
+        spill_->read(image.second, images_[image.first]);
+        spill_->release(image.second);
+    }
+
+    spilled_.clear();
+    read_path_.clear();
+    read_ = std::vector<std::uint8_t>();
+    spill_ = file;
+
+    if (!spill_) return;
+
+    for (const auto &image : images_)
+    {
+        spilled_[image.first] = spill_->write(image.second);
+    }
+
+    images_.clear();
+}
+
+std::size_t image_store::memory_usage() const
+{
+    auto bytes = heap_usage::of_hash_table(images_) + heap_usage::of_hash_table(spilled_) + heap_usage::of(read_);
+
+    for (const auto &image : images_)
+    {
+        bytes += heap_usage::of(image.first) + heap_usage::of(image.second);
+    }
+
+    return bytes;
+}
+
+std::size_t image_store::spilled_bytes() const
+{
+    auto bytes = std::size_t(0);
+
+    for (const auto &image : spilled_)
+    {
+        bytes += static_cast<std::size_t>(image.second.size);
+    }
+
+    return bytes;
+}
+
+bool image_store::operator==(const image_store &other) const
+{
+    if (images_.size() + spilled_.size() != other.images_.size() + other.spilled_.size()) return false;
+
+    // other may be this store, so an image read back is copied before reading back the other
+    for (const auto &image : images_)
+    {
+        if (!other.contains(image.first) || other.at(image.first) != image.second) return false;
+    }
+
+    for (const auto &image : spilled_)
+    {
+        if (!other.contains(image.first)) return false;
+
+        const auto mine = at(image.first);
+        if (other.at(image.first) != mine) return false;
+    }
+
+    return true;
+}
+
+} // namespace detail
+} // namespace xlnt
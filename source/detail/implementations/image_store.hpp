@@ -0,0 +1,93 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <detail/implementations/spill_file.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// The images of a workbook by path. While a spill_file is attached, images are
+/// written to it as they are added and only read back when requested, one at a time.
+/// </summary>
+class image_store
+{
+public:
+    /// <summary>
+    /// Returns true if there is an image at path.
+    /// </summary>
+    bool contains(const std::string &path) const;
+
+    /// <summary>
+    /// Returns the image at path. Throws std::out_of_range if there isn't one. An image read
+    /// back from the spill file stays valid until the next image is read back.
+    /// </summary>
+    const std::vector<std::uint8_t> &at(const std::string &path) const;
+
+    /// <summary>
+    /// Adds or replaces the image at path.
+    /// </summary>
+    void set(const std::string &path, std::vector<std::uint8_t> image);
+
+    /// <summary>
+    /// Writes every image to file and releases them from memory. Passing nullptr
+    /// reads them back.
+    /// </summary>
+    void spill(std::shared_ptr<spill_file> file);
+
+    /// <summary>
+    /// Returns an estimate of the bytes used by the images in memory.
+    /// </summary>
+    std::size_t memory_usage() const;
+
+    /// <summary>
+    /// Returns the bytes of the images in the spill file.
+    /// </summary>
+    std::size_t spilled_bytes() const;
+
+    /// <summary>
+    /// Returns true if both stores have the same images at the same paths.
+    /// </summary>
+    bool operator==(const image_store &other) const;
+
+private:
+    std::unordered_map<std::string, std::vector<std::uint8_t>> images_;
+    std::unordered_map<std::string, spill_file::extent> spilled_;
+    std::shared_ptr<spill_file> spill_;
+
+    // The image most recently read back from the spill file
+    mutable std::string read_path_;
+    mutable std::vector<std::uint8_t> read_;
+};
+
+} // namespace detail
+} // namespace xlnt
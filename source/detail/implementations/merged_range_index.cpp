@@ -0,0 +1,333 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <cmath>
+
+#include <detail/implementations/heap_usage.hpp>
+#include <detail/implementations/merged_range_index.hpp>
+
+namespace {
+
+// The number of children of each node of the tree
+const std::size_t fanout = 16;
+
+bool covers(xlnt::row_t top, xlnt::row_t bottom, xlnt::column_t::index_t left, xlnt::column_t::index_t right,
+    xlnt::row_t row, xlnt::column_t::index_t column)
+{
+    return top <= row && row <= bottom && left <= column && column <= right;
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+std::size_t merged_range_index::reference_hash::operator()(const range_reference &reference) const
+{
+    const auto top_left = reference.top_left();
+    const auto bottom_right = reference.bottom_right();
+
+    auto hash = std::size_t(top_left.row());
+    hash = hash * 1000003 ^ top_left.column_index();
+    hash = hash * 1000003 ^ bottom_right.row();
+    hash = hash * 1000003 ^ bottom_right.column_index();
+
+    return hash;
+}
+
+bool merged_range_index::empty() const
+{
+    return size() == 0;
+}
+
+std::size_t merged_range_index::size() const
+{
+    return ranges_.size() - erased_count_;
+}
+
+std::size_t merged_range_index::memory_usage() const
+{
+    auto bytes = heap_usage::of(ranges_) + erased_.capacity() / 8 + heap_usage::of_hash_table(positions_)
+        + heap_usage::of(entries_) + heap_usage::of(levels_);
+
+    for (const auto &level : levels_)
+    {
+        bytes += heap_usage::of(level);
+    }
+
+    return bytes;
+}
+
+const std::vector<range_reference> &merged_range_index::ranges() const
+{
+    if (erased_count_ != 0)
+    {
+        compact();
+    }
+
+    return ranges_;
+}
+
+void merged_range_index::insert(const range_reference &reference)
+{
+    positions_.emplace(reference, ranges_.size());
+    ranges_.push_back(reference);
+    erased_.push_back(false);
+}
+
+bool merged_range_index::erase(const range_reference &reference)
+{
+    const auto candidates = positions_.equal_range(reference);
+
+    if (candidates.first == candidates.second)
+    {
+        return false;
+    }
+
+    // ranges can be added more than once, so remove the earliest
+    auto earliest = candidates.first;
+
+    for (auto candidate = candidates.first; candidate != candidates.second; ++candidate)
+    {
+        if (candidate->second < earliest->second)
+        {
+            earliest = candidate;
+        }
+    }
+
+    erased_[earliest->second] = true;
+    ++erased_count_;
+    positions_.erase(earliest);
+
+    // The tree refers to ranges by position, so erased ranges stay until they
+    // make up most of ranges_
+    if (erased_count_ > ranges_.size() / 2)
+    {
+        compact();
+    }
+
+    return true;
+}
+
+void merged_range_index::clear()
+{
+    ranges_.clear();
+    erased_.clear();
+    erased_count_ = 0;
+    positions_.clear();
+    entries_.clear();
+    levels_.clear();
+    indexed_ = 0;
+    dirty_ = false;
+}
+
+const range_reference *merged_range_index::find(row_t row, column_t column) const
+{
+    const auto position = locate(row, column.index);
+
+    return position == ranges_.size() ? nullptr : &ranges_[position];
+}
+
+bool merged_range_index::contains(row_t row, column_t column) const
+{
+    return find(row, column) != nullptr;
+}
+
+bool merged_range_index::operator==(const merged_range_index &other) const
+{
+    return ranges() == other.ranges();
+}
+
+std::size_t merged_range_index::locate(row_t row, column_t::index_t column) const
+{
+    // Ranges added since the tree was built are checked one at a time until there
+    // are enough of them to make rebuilding it worthwhile
+    if (dirty_ || ranges_.size() - indexed_ > std::max(fanout, indexed_ / 8))
+    {
+        build();
+    }
+
+    auto match = ranges_.size();
+
+    if (!levels_.empty())
+    {
+        visit(levels_.size(), 0, row, column, match);
+    }
+
+    for (auto position = indexed_; position < ranges_.size() && position < match; ++position)
+    {
+        if (erased_[position]) continue;
+
+        const auto first = ranges_[position].top_left();
+        const auto second = ranges_[position].bottom_right();
+
+        if (covers(std::min(first.row(), second.row()), std::max(first.row(), second.row()),
+                std::min(first.column_index(), second.column_index()),
+                std::max(first.column_index(), second.column_index()), row, column))
+        {
+            match = position;
+        }
+    }
+
+    return match;
+}
+
+void merged_range_index::visit(
+    std::size_t level, std::size_t node, row_t row, column_t::index_t column, std::size_t &match) const
+{
+    if (level == 0)
+    {
+        const auto &leaf = entries_[node];
+        const auto &bounds = leaf.bounds;
+
+        if (leaf.position < match && !erased_[leaf.position]
+            && covers(bounds.top, bounds.bottom, bounds.left, bounds.right, row, column))
+        {
+            match = leaf.position;
+        }
+
+        return;
+    }
+
+    const auto &bounds = levels_[level - 1][node];
+
+    if (!covers(bounds.top, bounds.bottom, bounds.left, bounds.right, row, column))
+    {
+        return;
+    }
+
+    const auto children = level == 1 ? entries_.size() : levels_[level - 2].size();
+    const auto last = std::min((node + 1) * fanout, children);
+
+    for (auto child = node * fanout; child < last; ++child)
+    {
+        visit(level - 1, child, row, column, match);
+    }
+}
+
+void merged_range_index::compact() const
+{
+    auto kept = std::size_t(0);
+
+    for (std::size_t position = 0; position < ranges_.size(); ++position)
+    {
+        if (erased_[position]) continue;
+
+        ranges_[kept++] = ranges_[position];
+    }
+
+    ranges_.resize(kept);
+    erased_.assign(kept, false);
+    erased_count_ = 0;
+
+    positions_.clear();
+
+    for (std::size_t position = 0; position < kept; ++position)
+    {
+        positions_.emplace(ranges_[position], position);
+    }
+
+    indexed_ = 0;
+    dirty_ = true;
+}
+
+void merged_range_index::build() const
+{
+    if (erased_count_ != 0)
+    {
+        compact();
+    }
+
+    entries_.clear();
+    levels_.clear();
+    entries_.reserve(ranges_.size());
+
+    for (std::size_t position = 0; position < ranges_.size(); ++position)
+    {
+        const auto first = ranges_[position].top_left();
+        const auto second = ranges_[position].bottom_right();
+
+        entry current;
+        current.bounds.top = std::min(first.row(), second.row());
+        current.bounds.bottom = std::max(first.row(), second.row());
+        current.bounds.left = std::min(first.column_index(), second.column_index());
+        current.bounds.right = std::max(first.column_index(), second.column_index());
+        current.position = position;
+
+        entries_.push_back(current);
+    }
+
+    // Sort-tile-recursive packing: entries are sorted into vertical slices by column,
+    // then each slice by row, so that consecutive entries are close to each other
+    const auto leaves = (entries_.size() + fanout - 1) / fanout;
+    const auto slices = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(leaves))));
+    const auto slice_size = std::max(std::size_t(1), slices == 0 ? 0 : (leaves + slices - 1) / slices) * fanout;
+
+    std::sort(entries_.begin(), entries_.end(), [](const entry &a, const entry &b) {
+        return std::uint64_t(a.bounds.left) + a.bounds.right < std::uint64_t(b.bounds.left) + b.bounds.right;
+    });
+
+    for (std::size_t first = 0; first < entries_.size(); first += slice_size)
+    {
+        const auto last = std::min(first + slice_size, entries_.size());
+
+        std::sort(entries_.begin() + static_cast<std::ptrdiff_t>(first),
+            entries_.begin() + static_cast<std::ptrdiff_t>(last), [](const entry &a, const entry &b) {
+                return std::uint64_t(a.bounds.top) + a.bounds.bottom < std::uint64_t(b.bounds.top) + b.bounds.bottom;
+            });
+    }
+
+    // Each level bounds groups of fanout consecutive children until a single root is left
+    while (!entries_.empty() && (levels_.empty() || levels_.back().size() > 1))
+    {
+        const auto children = levels_.empty() ? entries_.size() : levels_.back().size();
+        std::vector<box> nodes;
+        nodes.reserve((children + fanout - 1) / fanout);
+
+        for (std::size_t first = 0; first < children; first += fanout)
+        {
+            auto bounds = levels_.empty() ? entries_[first].bounds : levels_.back()[first];
+
+            for (auto child = first + 1; child < std::min(first + fanout, children); ++child)
+            {
+                const auto &other = levels_.empty() ? entries_[child].bounds : levels_.back()[child];
+
+                bounds.top = std::min(bounds.top, other.top);
+                bounds.bottom = std::max(bounds.bottom, other.bottom);
+                bounds.left = std::min(bounds.left, other.left);
+                bounds.right = std::max(bounds.right, other.right);
+            }
+
+            nodes.push_back(bounds);
+        }
+
+        levels_.push_back(std::move(nodes));
+    }
+
+    indexed_ = ranges_.size();
+    dirty_ = false;
+}
+
+} // namespace detail
+} // namespace xlnt
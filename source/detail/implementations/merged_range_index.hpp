@@ -0,0 +1,168 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <xlnt/cell/index_types.hpp>
+#include <xlnt/worksheet/range_reference.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// The merged ranges of a worksheet. Ranges are kept in the order they were merged
+/// and indexed by an R-tree over their rows and columns, packed into arrays with a
+/// fixed number of children per node, which answers which range contains a cell in
+/// logarithmic time without creating cells. Ranges merged since the tree was built
+/// are checked one by one until a lookup finds enough of them to rebuild it. Erasing
+/// a range only marks it as erased, so neither changes the tree.
+/// </summary>
+class merged_range_index
+{
+public:
+    /// <summary>
+    /// Returns true if there are no merged ranges.
+    /// </summary>
+    bool empty() const;
+
+    /// <summary>
+    /// Returns the number of merged ranges.
+    /// </summary>
+    std::size_t size() const;
+
+    /// <summary>
+    /// Returns an estimate of the bytes used by the ranges and the tree.
+    /// </summary>
+    std::size_t memory_usage() const;
+
+    /// <summary>
+    /// Returns the merged ranges in the order they were added.
+    /// </summary>
+    const std::vector<range_reference> &ranges() const;
+
+    /// <summary>
+    /// Adds a merged range.
+    /// </summary>
+    void insert(const range_reference &reference);
+
+    /// <summary>
+    /// Removes the earliest added merged range equal to reference. Returns false if
+    /// there isn't one.
+    /// </summary>
+    bool erase(const range_reference &reference);
+
+    /// <summary>
+    /// Removes every merged range.
+    /// </summary>
+    void clear();
+
+    /// <summary>
+    /// Returns the earliest added merged range containing the given cell or nullptr
+    /// if it isn't merged.
+    /// </summary>
+    const range_reference *find(row_t row, column_t column) const;
+
+    /// <summary>
+    /// Returns true if the given cell is part of a merged range.
+    /// </summary>
+    bool contains(row_t row, column_t column) const;
+
+    /// <summary>
+    /// Returns true if both indices contain the same ranges in the same order.
+    /// </summary>
+    bool operator==(const merged_range_index &other) const;
+
+private:
+    /// <summary>
+    /// The rows and columns covered by a range or by the ranges beneath a node.
+    /// </summary>
+    struct box
+    {
+        row_t top;
+        row_t bottom;
+        column_t::index_t left;
+        column_t::index_t right;
+    };
+
+    /// <summary>
+    /// A range in a leaf of the tree and its position in ranges_.
+    /// </summary>
+    struct entry
+    {
+        box bounds;
+        std::size_t position;
+    };
+
+    struct reference_hash
+    {
+        std::size_t operator()(const range_reference &reference) const;
+    };
+
+    /// <summary>
+    /// Returns the position in ranges_ of the earliest added range containing the cell
+    /// that isn't erased, or ranges_.size() if there is none.
+    /// </summary>
+    std::size_t locate(row_t row, column_t::index_t column) const;
+
+    /// <summary>
+    /// Visits the given node of the given level of the tree, or entry if level is 0,
+    /// and everything beneath it, lowering match to the position of each range found
+    /// containing the cell.
+    /// </summary>
+    void visit(std::size_t level, std::size_t node, row_t row, column_t::index_t column, std::size_t &match) const;
+
+    /// <summary>
+    /// Removes erased ranges from ranges_, moving the positions of the others.
+    /// The tree has to be rebuilt afterwards.
+    /// </summary>
+    void compact() const;
+
+    /// <summary>
+    /// Rebuilds the tree over every range.
+    /// </summary>
+    void build() const;
+
+    // Ranges in the order they were added, including erased ones until the next compact
+    mutable std::vector<range_reference> ranges_;
+    mutable std::vector<bool> erased_;
+    mutable std::size_t erased_count_ = 0;
+
+    // Positions in ranges_ by range, for erase
+    mutable std::unordered_multimap<range_reference, std::size_t, reference_hash> positions_;
+
+    // The leaves of the tree followed by each level of nodes above them, where node i of
+    // a level bounds children [i * fanout, (i + 1) * fanout) of the level below. Ranges
+    // at positions from indexed_ on were added after the tree was built.
+    mutable std::vector<entry> entries_;
+    mutable std::vector<std::vector<box>> levels_;
+    mutable std::size_t indexed_ = 0;
+    mutable bool dirty_ = false;
+};
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,244 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <functional>
+
+#include <detail/implementations/heap_usage.hpp>
+#include <detail/implementations/shared_string_table.hpp>
+
+namespace {
+
+// Smallest slot array allocated once the first string is added.
+const std::size_t initial_slot_count = 64;
+
+std::uint32_t tag_of(std::uint64_t hash)
+{
+    return static_cast<std::uint32_t>(hash >> 32);
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+const std::size_t shared_string_table::npos = static_cast<std::size_t>(-1);
+
+std::size_t shared_string_table::size() const
+{
+    return values_.size();
+}
+
+bool shared_string_table::empty() const
+{
+    return values_.empty();
+}
+
+const std::vector<rich_text> &shared_string_table::values() const
+{
+    return values_;
+}
+
+std::size_t shared_string_table::find(const rich_text &text) const
+{
+    return find(hash(text), [this, &text](std::size_t index) { return values_[index] == text; });
+}
+
+std::size_t shared_string_table::find(const std::string &plain_text) const
+{
+    return find(hash(plain_text), [this, &plain_text](std::size_t index) {
+        return plain_[index] != 0 && values_[index].runs_.front().first == plain_text;
+    });
+}
+
+std::size_t shared_string_table::append(const rich_text &text)
+{
+    const auto text_hash = hash(text);
+    values_.push_back(text);
+
+    return index_last(text_hash, is_plain(text));
+}
+
+std::size_t shared_string_table::append(rich_text &&text)
+{
+    const auto text_hash = hash(text);
+    const auto plain = is_plain(text);
+    values_.push_back(std::move(text));
+
+    return index_last(text_hash, plain);
+}
+
+std::size_t shared_string_table::memory_usage() const
+{
+    auto bytes = heap_usage::of(values_) + heap_usage::of(hashes_) + heap_usage::of(plain_) + heap_usage::of(slots_);
+
+    for (const auto &value : values_)
+    {
+        bytes += heap_usage::of(value);
+    }
+
+    return bytes;
+}
+
+void shared_string_table::reserve(std::size_t n)
+{
+    values_.reserve(n);
+    hashes_.reserve(n);
+    plain_.reserve(n);
+
+    auto slot_count = slots_.empty() ? initial_slot_count : slots_.size();
+
+    while (slot_count < n * 2)
+    {
+        slot_count *= 2;
+    }
+
+    if (slot_count != slots_.size())
+    {
+        slots_.assign(slot_count, slot{0, 0});
+
+        for (std::size_t i = 0; i < values_.size(); ++i)
+        {
+            insert_slot(i);
+        }
+    }
+}
+
+bool shared_string_table::operator==(const shared_string_table &other) const
+{
+    return values_ == other.values_;
+}
+
+std::uint64_t shared_string_table::hash(const rich_text &text)
+{
+    if (text.runs_.size() == 1)
+    {
+        return hash(text.runs_.front().first);
+    }
+
+    return hash(text.plain_text());
+}
+
+std::uint64_t shared_string_table::hash(const std::string &plain_text)
+{
+    // std::hash is only required to be std::size_t wide and is often the identity
+    // on the low bits, so finish it with the splitmix64 mixer to spread it over
+    // both the slot position (low bits) and the tag (high bits).
+    auto h = static_cast<std::uint64_t>(std::hash<std::string>()(plain_text));
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+
+    return h;
+}
+
+bool shared_string_table::is_plain(const rich_text &text)
+{
+    return text.runs_.size() == 1 && !text.runs_.front().second.is_set();
+}
+
+template <typename Predicate>
+std::size_t shared_string_table::find(std::uint64_t hash, Predicate matches) const
+{
+    if (slots_.empty())
+    {
+        return npos;
+    }
+
+    const auto mask = slots_.size() - 1;
+    const auto tag = tag_of(hash);
+
+    // Duplicates are inserted further along the probe sequence than the string
+    // they duplicate, so the first match is always the lowest index.
+    for (auto position = static_cast<std::size_t>(hash) & mask;; position = (position + 1) & mask)
+    {
+        const auto &current = slots_[position];
+
+        if (current.index_plus_one == 0)
+        {
+            return npos;
+        }
+
+        const auto index = static_cast<std::size_t>(current.index_plus_one - 1);
+
+        if (current.tag == tag && hashes_[index] == hash && matches(index))
+        {
+            return index;
+        }
+    }
+}
+
+std::size_t shared_string_table::index_last(std::uint64_t hash, bool plain)
+{
+    hashes_.push_back(hash);
+    plain_.push_back(plain ? 1 : 0);
+
+    const auto index = values_.size() - 1;
+
+    // Keep the load factor at or below one half.
+    if (values_.size() * 2 > slots_.size())
+    {
+        grow();
+    }
+    else
+    {
+        insert_slot(index);
+    }
+
+    return index;
+}
+
+void shared_string_table::insert_slot(std::size_t index)
+{
+    const auto mask = slots_.size() - 1;
+    auto position = static_cast<std::size_t>(hashes_[index]) & mask;
+
+    while (slots_[position].index_plus_one != 0)
+    {
+        position = (position + 1) & mask;
+    }
+
+    slots_[position].index_plus_one = static_cast<std::uint32_t>(index + 1);
+    slots_[position].tag = tag_of(hashes_[index]);
+}
+
+void shared_string_table::grow()
+{
+    auto slot_count = slots_.empty() ? initial_slot_count : slots_.size() * 2;
+
+    while (slot_count < values_.size() * 2)
+    {
+        slot_count *= 2;
+    }
+
+    slots_.assign(slot_count, slot{0, 0});
+
+    for (std::size_t i = 0; i < values_.size(); ++i)
+    {
+        insert_slot(i);
+    }
+}
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,154 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <xlnt/cell/rich_text.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// The shared string table of a workbook. Strings are stored in order of their index
+/// alongside a precomputed 64-bit hash. The index is an open-addressed (linear probing)
+/// array of 8-byte slots, each holding a string index and the high bits of its hash,
+/// so most failed probes are rejected without touching the strings themselves.
+/// Strings consisting of a single run without a font can be found from a std::string
+/// without constructing a rich_text.
+/// </summary>
+class shared_string_table
+{
+public:
+    /// <summary>
+    /// Returned by find when the string isn't in the table.
+    /// </summary>
+    static const std::size_t npos;
+
+    /// <summary>
+    /// Returns the number of strings in the table, including duplicates.
+    /// </summary>
+    std::size_t size() const;
+
+    /// <summary>
+    /// Returns true if the table is empty.
+    /// </summary>
+    bool empty() const;
+
+    /// <summary>
+    /// Returns the strings in the table in order of index.
+    /// </summary>
+    const std::vector<rich_text> &values() const;
+
+    /// <summary>
+    /// Returns the index of the first string equal to text or npos.
+    /// </summary>
+    std::size_t find(const rich_text &text) const;
+
+    /// <summary>
+    /// Returns the index of the first string equal to rich_text(plain_text) or npos.
+    /// </summary>
+    std::size_t find(const std::string &plain_text) const;
+
+    /// <summary>
+    /// Appends text to the table without checking for an existing copy and returns its index.
+    /// </summary>
+    std::size_t append(const rich_text &text);
+
+    /// <summary>
+    /// Moves text to the end of the table without checking for an existing copy
+    /// and returns its index.
+    /// </summary>
+    std::size_t append(rich_text &&text);
+
+    /// <summary>
+    /// Reserves space for n strings.
+    /// </summary>
+    void reserve(std::size_t n);
+
+    /// <summary>
+    /// Returns an estimate of the bytes used by the strings and the hash index.
+    /// </summary>
+    std::size_t memory_usage() const;
+
+    /// <summary>
+    /// Returns true if both tables contain the same strings in the same order.
+    /// </summary>
+    bool operator==(const shared_string_table &other) const;
+
+private:
+    struct slot
+    {
+        std::uint32_t index_plus_one;
+        std::uint32_t tag;
+    };
+
+    /// <summary>
+    /// Returns the hash of the plain text of text. A rich_text consisting of a single
+    /// unformatted run hashes the same as its string.
+    /// </summary>
+    static std::uint64_t hash(const rich_text &text);
+
+    /// <summary>
+    /// Returns the hash of plain_text.
+    /// </summary>
+    static std::uint64_t hash(const std::string &plain_text);
+
+    /// <summary>
+    /// Returns true if text is a single run without a font.
+    /// </summary>
+    static bool is_plain(const rich_text &text);
+
+    /// <summary>
+    /// Returns the index of the first entry with the given hash for which matches returns true.
+    /// </summary>
+    template <typename Predicate>
+    std::size_t find(std::uint64_t hash, Predicate matches) const;
+
+    /// <summary>
+    /// Records the string just appended at values_.back() in the index.
+    /// </summary>
+    std::size_t index_last(std::uint64_t hash, bool plain);
+
+    /// <summary>
+    /// Inserts the string at index into the slot array.
+    /// </summary>
+    void insert_slot(std::size_t index);
+
+    /// <summary>
+    /// Doubles the capacity of the slot array and reinserts every string.
+    /// </summary>
+    void grow();
+
+    std::vector<rich_text> values_;
+    std::vector<std::uint64_t> hashes_;
+    std::vector<std::uint8_t> plain_;
+    std::vector<slot> slots_;
+};
+
+} // namespace detail
+} // namespace xlnt
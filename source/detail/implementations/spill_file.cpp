@@ -0,0 +1,294 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+#include <iterator>
+
+#include <xlnt/utils/exceptions.hpp>
+#include <detail/implementations/cell_store.hpp>
+#include <detail/implementations/spill_file.hpp>
+
+namespace xlnt {
+namespace detail {
+
+spill_file::spill_file(const path &directory, std::size_t budget)
+    : directory_(directory),
+      budget_(budget)
+{
+    static std::atomic<std::uint64_t> files(0);
+    const auto now = static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+
+    for (auto attempt = 0; attempt < 100; ++attempt)
+    {
+        const auto name = "xlnt-" + std::to_string(now % 1000000007) + "-" + std::to_string(files++) + ".spill";
+        filename_ = directory.append(name);
+
+        if (!filename_.exists()) break;
+    }
+
+    stream_.open(filename_.string(), std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+
+    if (!stream_.is_open())
+    {
+        throw xlnt::exception("could not create scratch file " + filename_.string());
+    }
+}
+
+spill_file::~spill_file()
+{
+    stream_.close();
+    std::remove(filename_.string().c_str());
+}
+
+const path &spill_file::directory() const
+{
+    return directory_;
+}
+
+std::size_t spill_file::budget() const
+{
+    return budget_;
+}
+
+std::uint64_t spill_file::size() const
+{
+    return size_;
+}
+
+spill_file::extent spill_file::write(const std::vector<std::uint8_t> &bytes)
+{
+    extent written;
+    written.size = bytes.size();
+
+    if (bytes.empty()) return written;
+
+    // Use the smallest free space that fits, otherwise append
+    const auto fit = free_by_size_.lower_bound(written.size);
+
+    if (fit != free_by_size_.end())
+    {
+        written.offset = fit->second;
+        const auto left = fit->first - written.size;
+
+        free_.erase(fit->second);
+        free_by_size_.erase(fit);
+
+        if (left != 0)
+        {
+            free_space(written.offset + written.size, left);
+        }
+    }
+    else
+    {
+        written.offset = end_;
+        end_ += written.size;
+    }
+
+    stream_.seekp(static_cast<std::streamoff>(written.offset));
+    stream_.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+    if (!stream_)
+    {
+        stream_.clear();
+        free_space(written.offset, written.size);
+        throw xlnt::exception("could not write to scratch file " + filename_.string());
+    }
+
+    owners_[written.offset] = 1;
+    size_ += written.size;
+
+    return written;
+}
+
+void spill_file::read(const extent &where, std::vector<std::uint8_t> &bytes)
+{
+    bytes.resize(static_cast<std::size_t>(where.size));
+
+    if (bytes.empty()) return;
+
+    stream_.seekg(static_cast<std::streamoff>(where.offset));
+    stream_.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+    if (!stream_)
+    {
+        stream_.clear();
+        throw xlnt::exception("could not read from scratch file " + filename_.string());
+    }
+}
+
+void spill_file::retain(const extent &where)
+{
+    if (where.size == 0) return;
+
+    ++owners_.at(where.offset);
+}
+
+void spill_file::release(const extent &where)
+{
+    if (where.size == 0) return;
+
+    const auto owners = owners_.find(where.offset);
+    if (owners == owners_.end() || --owners->second != 0) return;
+
+    owners_.erase(owners);
+    size_ -= where.size;
+    free_space(where.offset, where.size);
+}
+
+std::uint32_t spill_file::format_index(format_impl *format)
+{
+    const auto match = format_indices_.find(format);
+    if (match != format_indices_.end()) return match->second;
+
+    const auto index = static_cast<std::uint32_t>(formats_.size());
+    formats_.push_back(format);
+    format_indices_.emplace(format, index);
+
+    return index;
+}
+
+format_impl *spill_file::format(std::uint32_t index) const
+{
+    return formats_.at(index);
+}
+
+void spill_file::free_space(std::uint64_t offset, std::uint64_t size)
+{
+    const auto forget = [this](std::map<std::uint64_t, std::uint64_t>::iterator space) {
+        const auto sizes = free_by_size_.equal_range(space->second);
+
+        for (auto match = sizes.first; match != sizes.second; ++match)
+        {
+            if (match->second == space->first)
+            {
+                free_by_size_.erase(match);
+                break;
+            }
+        }
+
+        free_.erase(space);
+    };
+
+    const auto next = free_.find(offset + size);
+
+    if (next != free_.end())
+    {
+        size += next->second;
+        forget(next);
+    }
+
+    const auto after = free_.lower_bound(offset);
+
+    if (after != free_.begin())
+    {
+        const auto previous = std::prev(after);
+
+        if (previous->first + previous->second == offset)
+        {
+            offset = previous->first;
+            size += previous->second;
+            forget(previous);
+        }
+    }
+
+    if (offset + size == end_)
+    {
+        end_ = offset;
+        return;
+    }
+
+    free_.emplace(offset, size);
+    free_by_size_.emplace(size, offset);
+}
+
+std::uint64_t spill_file::tick()
+{
+    return ++clock_;
+}
+
+void spill_file::attach(cell_store *store)
+{
+    resident_.emplace(store, 0);
+}
+
+void spill_file::detach(cell_store *store)
+{
+    resident_.erase(store);
+}
+
+std::size_t &spill_file::resident(cell_store *store)
+{
+    return resident_[store];
+}
+
+void spill_file::balance(cell_store *requester, row_t keep)
+{
+    auto total = std::size_t(0);
+
+    for (const auto &entry : resident_)
+    {
+        total += entry.second;
+    }
+
+    if (total <= budget_) return;
+
+    struct candidate
+    {
+        std::uint64_t last_use;
+        cell_store *store;
+        row_t block;
+    };
+
+    std::vector<candidate> candidates;
+    std::vector<std::pair<std::uint64_t, row_t>> blocks;
+
+    for (const auto &entry : resident_)
+    {
+        blocks.clear();
+        entry.first->resident_blocks(blocks);
+
+        for (const auto &block : blocks)
+        {
+            if (entry.first == requester && block.second == keep) continue;
+            candidates.push_back({block.first, entry.first, block.second});
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(),
+        [](const candidate &a, const candidate &b) { return a.last_use < b.last_use; });
+
+    const auto target = budget_ - budget_ / 4;
+
+    for (const auto &block : candidates)
+    {
+        if (total <= target) break;
+        total -= std::min(total, block.store->page_out(block.block));
+    }
+}
+
+} // namespace detail
+} // namespace xlnt
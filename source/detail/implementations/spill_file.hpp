@@ -0,0 +1,180 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <xlnt/xlnt_config.hpp>
+#include <xlnt/cell/index_types.hpp>
+#include <xlnt/utils/path.hpp>
+
+namespace xlnt {
+namespace detail {
+
+class cell_store;
+struct format_impl;
+
+/// <summary>
+/// A scratch file that the cells and images of a workbook are paged out to when
+/// workbook::memory_budget is set. Records can be shared by the stores of one workbook
+/// and are freed when their last owner releases them, and the space they used is
+/// reused by later records. Formats are written as indices into a table kept with the
+/// file. The file is removed when the last owner releases it. The file also keeps
+/// count of the memory used by the cell stores attached to it and pages out their
+/// least recently used blocks of rows when the total exceeds the budget.
+/// Not safe for concurrent use, so copies of a workbook get a file of their own.
+/// </summary>
+class XLNT_API spill_file
+{
+public:
+    /// <summary>
+    /// The position and length of a record in the file.
+    /// </summary>
+    struct extent
+    {
+        std::uint64_t offset = 0;
+        std::uint64_t size = 0;
+    };
+
+    /// <summary>
+    /// Creates a new file with a unique name in directory. Throws xlnt::exception
+    /// if it can't be created.
+    /// </summary>
+    spill_file(const path &directory, std::size_t budget);
+
+    spill_file(const spill_file &other) = delete;
+    spill_file &operator=(const spill_file &other) = delete;
+
+    /// <summary>
+    /// Closes and removes the file.
+    /// </summary>
+    ~spill_file();
+
+    /// <summary>
+    /// Returns the directory the file was created in.
+    /// </summary>
+    const path &directory() const;
+
+    /// <summary>
+    /// Returns the number of bytes the attached stores may use before blocks are paged out.
+    /// </summary>
+    std::size_t budget() const;
+
+    /// <summary>
+    /// Returns the number of bytes of the records that haven't been released.
+    /// </summary>
+    std::uint64_t size() const;
+
+    /// <summary>
+    /// Writes bytes to the file as a record with a single owner, in space freed by
+    /// released records if there is enough, and returns where they were written.
+    /// </summary>
+    extent write(const std::vector<std::uint8_t> &bytes);
+
+    /// <summary>
+    /// Replaces the contents of bytes with the record at where.
+    /// </summary>
+    void read(const extent &where, std::vector<std::uint8_t> &bytes);
+
+    /// <summary>
+    /// Adds an owner to the record at where.
+    /// </summary>
+    void retain(const extent &where);
+
+    /// <summary>
+    /// Removes an owner from the record at where, freeing its space once it has none.
+    /// </summary>
+    void release(const extent &where);
+
+    /// <summary>
+    /// Returns the index of format in the format table of this file, adding it if needed.
+    /// </summary>
+    std::uint32_t format_index(format_impl *format);
+
+    /// <summary>
+    /// Returns the format at index in the format table of this file.
+    /// </summary>
+    format_impl *format(std::uint32_t index) const;
+
+    /// <summary>
+    /// Returns a value greater than every value returned before, used to order blocks by last use.
+    /// </summary>
+    std::uint64_t tick();
+
+    /// <summary>
+    /// Starts counting the memory used by store. Stores detach themselves when destroyed.
+    /// </summary>
+    void attach(cell_store *store);
+
+    /// <summary>
+    /// Stops counting the memory used by store.
+    /// </summary>
+    void detach(cell_store *store);
+
+    /// <summary>
+    /// Returns the number of bytes store was last counted as using.
+    /// </summary>
+    std::size_t &resident(cell_store *store);
+
+    /// <summary>
+    /// If the attached stores use more than the budget, pages out their least recently
+    /// used blocks until they use three quarters of it. The block keep of requester is
+    /// never paged out since the caller is about to use it.
+    /// </summary>
+    void balance(cell_store *requester, row_t keep);
+
+private:
+    /// <summary>
+    /// Marks the given space free, merging it with free space next to it.
+    /// </summary>
+    void free_space(std::uint64_t offset, std::uint64_t size);
+
+    path directory_;
+    path filename_;
+    std::fstream stream_;
+    std::size_t budget_;
+
+    // The end of the space used so far and the bytes of records not yet released
+    std::uint64_t end_ = 0;
+    std::uint64_t size_ = 0;
+
+    // Free space before end_ by offset and by size, and the owners of each record by offset
+    std::map<std::uint64_t, std::uint64_t> free_;
+    std::multimap<std::uint64_t, std::uint64_t> free_by_size_;
+    std::unordered_map<std::uint64_t, std::size_t> owners_;
+
+    std::vector<format_impl *> formats_;
+    std::unordered_map<format_impl *, std::uint32_t> format_indices_;
+
+    std::uint64_t clock_ = 0;
+    std::unordered_map<cell_store *, std::size_t> resident_;
+};
+
+} // namespace detail
+} // namespace xlnt
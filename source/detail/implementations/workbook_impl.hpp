@@ -23,10 +23,15 @@
 #pragma once
 
 #include <list>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include <detail/formula/formula_engine.hpp>
+#include <detail/implementations/image_store.hpp>
+#include <detail/implementations/shared_string_table.hpp>
+#include <detail/implementations/spill_file.hpp>
 #include <detail/implementations/stylesheet.hpp>
 #include <detail/implementations/worksheet_impl.hpp>
 #include <xlnt/packaging/ext_list.hpp>
@@ -43,6 +48,7 @@
 namespace xlnt {
 namespace detail {
 
+struct source_package;
 struct worksheet_impl;
 
 struct workbook_impl
@@ -53,9 +59,9 @@ struct workbook_impl
 
     workbook_impl(const workbook_impl &other)
         : active_sheet_index_(other.active_sheet_index_),
+          spill_(other.spill_),
           worksheets_(other.worksheets_),
-          shared_strings_ids_(other.shared_strings_ids_),
-          shared_strings_values_(other.shared_strings_values_),
+          shared_strings_(other.shared_strings_),
           stylesheet_(other.stylesheet_),
           manifest_(other.manifest_),
           theme_(other.theme_),
@@ -66,15 +72,19 @@ struct workbook_impl
           code_name_(other.code_name_),
           file_version_(other.file_version_)
     {
+        unshare_spill();
     }
 
     workbook_impl &operator=(const workbook_impl &other)
     {
         active_sheet_index_ = other.active_sheet_index_;
+        spill_ = other.spill_;
         worksheets_.clear();
         std::copy(other.worksheets_.begin(), other.worksheets_.end(), back_inserter(worksheets_));
-        shared_strings_ids_ = other.shared_strings_ids_;
-        shared_strings_values_ = other.shared_strings_values_;
+        shared_strings_ = other.shared_strings_;
+        shared_strings_ids_.clear();
+        shared_strings_ids_count_ = 0;
+        shared_strings_values_.clear();
         theme_ = other.theme_;
         manifest_ = other.manifest_;
 
@@ -87,14 +97,35 @@ struct workbook_impl
         extended_properties_ = other.extended_properties_;
         custom_properties_ = other.custom_properties_;
 
+        formula_engine_.reset();
+        source_.reset();
+
+        unshare_spill();
+
         return *this;
     }
 
+    // A spill_file can't be used by two workbooks at once, so a copy gets a file of
+    // its own with the same budget and the blocks it shares are written to it.
+    void unshare_spill()
+    {
+        if (!spill_) return;
+
+        spill_ = std::make_shared<spill_file>(spill_->directory(), spill_->budget());
+
+        for (auto &ws : worksheets_)
+        {
+            ws.cell_map_.spill(spill_);
+        }
+
+        images_.spill(spill_);
+    }
+
     bool operator==(const workbook_impl &other)
     {
         return active_sheet_index_ == other.active_sheet_index_
             && worksheets_ == other.worksheets_
-            && shared_strings_ids_ == other.shared_strings_ids_
+            && shared_strings_ == other.shared_strings_
             && stylesheet_ == other.stylesheet_
             && base_date_ == other.base_date_
             && title_ == other.title_
@@ -116,8 +147,18 @@ struct workbook_impl
 
     optional<std::size_t> active_sheet_index_;
 
+    // The scratch file set by workbook::memory_budget. Declared before the worksheets
+    // and images since they page out to it.
+    std::shared_ptr<spill_file> spill_;
+
     std::list<worksheet_impl> worksheets_;
+    shared_string_table shared_strings_;
+
+    // Copies of shared_strings_ in the shape returned by workbook::shared_strings()
+    // and workbook::shared_strings_by_id(), only built and brought up to date when
+    // those are called. workbook::shared_strings_view() reads shared_strings_ directly.
     std::unordered_map<rich_text, std::size_t, rich_text_hash> shared_strings_ids_;
+    std::size_t shared_strings_ids_count_ = 0;
     std::map<std::size_t, rich_text> shared_strings_values_;
 
     optional<stylesheet> stylesheet_;
@@ -127,7 +168,11 @@ struct workbook_impl
 
     manifest manifest_;
     optional<theme> theme_;
-    std::unordered_map<std::string, std::vector<std::uint8_t>> images_;
+    image_store images_;
+
+    // The package this workbook was loaded from when load_options::keep_source is set.
+    // Not copied with the workbook.
+    std::shared_ptr<source_package> source_;
 
     std::vector<std::pair<xlnt::core_property, variant>> core_properties_;
     std::vector<std::pair<xlnt::extended_property, variant>> extended_properties_;
@@ -159,6 +204,9 @@ struct workbook_impl
     optional<std::string> abs_path_;
     optional<std::size_t> arch_id_flags_;
     optional<ext_list> extensions_;
+
+    // Created by the first call to workbook::calculate and never copied.
+    std::unique_ptr<formula_engine> formula_engine_;
 };
 
 } // namespace detail
@@ -28,6 +28,7 @@
 #include <vector>
 
 #include <xlnt/packaging/ext_list.hpp>
+#include <xlnt/utils/path.hpp>
 #include <xlnt/workbook/named_range.hpp>
 #include <xlnt/worksheet/column_properties.hpp>
 #include <xlnt/worksheet/header_footer.hpp>
@@ -39,7 +40,10 @@
 #include <xlnt/worksheet/sheet_view.hpp>
 #include <xlnt/worksheet/print_options.hpp>
 #include <xlnt/worksheet/sheet_pr.hpp>
+#include <detail/formula/shared_formula.hpp>
 #include <detail/implementations/cell_impl.hpp>
+#include <detail/implementations/cell_store.hpp>
+#include <detail/implementations/merged_range_index.hpp>
 
 namespace xlnt {
 
@@ -71,6 +75,7 @@ struct worksheet_impl
         column_properties_ = other.column_properties_;
         row_properties_ = other.row_properties_;
         cell_map_ = other.cell_map_;
+        shared_formulas_ = other.shared_formulas_;
         page_setup_ = other.page_setup_;
         auto_filter_ = other.auto_filter_;
         page_margins_ = other.page_margins_;
@@ -84,17 +89,11 @@ struct worksheet_impl
         views_ = other.views_;
         column_breaks_ = other.column_breaks_;
         row_breaks_ = other.row_breaks_;
+        comments_ = other.comments_;
         extension_list_ = other.extension_list_;
         sheet_properties_ = other.sheet_properties_;
         print_options_ = other.print_options_;
-
-        for (auto &row : cell_map_)
-        {
-            for (auto &cell : row.second)
-            {
-                cell.second.parent_ = this;
-            }
-        }
+        source_part_.clear();
     }
 
     workbook *parent_;
@@ -107,6 +106,7 @@ struct worksheet_impl
             && column_properties_ == rhs.column_properties_
             && row_properties_ == rhs.row_properties_
             && cell_map_ == rhs.cell_map_
+            && shared_formulas_ == rhs.shared_formulas_
             && page_setup_ == rhs.page_setup_
             && auto_filter_ == rhs.auto_filter_
             && page_margins_ == rhs.page_margins_
@@ -126,6 +126,29 @@ struct worksheet_impl
             && extension_list_ == rhs.extension_list_;
     }
 
+    /// <summary>
+    /// Records that this worksheet changed, so that saving writes it again instead of
+    /// copying the part it was read from.
+    /// </summary>
+    void changed()
+    {
+        source_part_.clear();
+    }
+
+    /// <summary>
+    /// Returns true if cell, a cell of this worksheet, has nothing that needs to be
+    /// kept or written.
+    /// </summary>
+    bool garbage_collectible(const cell_impl &cell) const
+    {
+        return cell.type_ == cell_type::empty
+            && !cell.formula_.is_set()
+            && cell.shared_formula_ == 0
+            && !cell.format_.is_set()
+            && !cell.hyperlink_.is_set()
+            && !merged_cells_.contains(cell.row_, cell.column_);
+    }
+
     std::size_t id_;
     std::string title_;
 
@@ -134,12 +157,16 @@ struct worksheet_impl
     std::unordered_map<column_t, column_properties> column_properties_;
     std::unordered_map<row_t, row_properties> row_properties_;
 
-    std::unordered_map<row_t, std::unordered_map<column_t, cell_impl>> cell_map_;
+    cell_store cell_map_;
+
+    // Groups are only ever appended since cells in rows shared with copies of this
+    // worksheet refer to them by index and must find the same group in every copy.
+    std::vector<shared_formula> shared_formulas_;
 
     optional<page_setup> page_setup_;
     optional<range_reference> auto_filter_;
     optional<page_margins> page_margins_;
-    std::vector<range_reference> merged_cells_;
+    merged_range_index merged_cells_;
     std::unordered_map<std::string, named_range> named_ranges_;
 
     optional<phonetic_pr> phonetic_properties_;
@@ -160,6 +187,10 @@ struct worksheet_impl
     optional<sheet_pr> sheet_properties_;
 
     optional<ext_list> extension_list_;
+
+    // The part this worksheet was read from if the workbook kept its source package
+    // and the worksheet hasn't changed since.
+    optional<path> source_part_;
 };
 
 } // namespace detail
@@ -0,0 +1,140 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <xlnt/utils/exceptions.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// Appends numbers and strings to a vector of bytes. Numbers are written in the
+/// byte order of the machine and strings as their 32-bit size followed by their bytes.
+/// </summary>
+class binary_writer
+{
+public:
+    explicit binary_writer(std::vector<std::uint8_t> &bytes)
+        : bytes_(bytes)
+    {
+    }
+
+    template <typename T>
+    void write(T value)
+    {
+        const auto at = bytes_.size();
+        bytes_.resize(at + sizeof(T));
+        std::memcpy(bytes_.data() + at, &value, sizeof(T));
+    }
+
+    void write(const std::string &text)
+    {
+        write(static_cast<std::uint32_t>(text.size()));
+        bytes_.insert(bytes_.end(), text.begin(), text.end());
+    }
+
+    void write(const std::uint8_t *data, std::size_t size)
+    {
+        bytes_.insert(bytes_.end(), data, data + size);
+    }
+
+    /// <summary>
+    /// Returns the number of bytes in the vector.
+    /// </summary>
+    std::size_t size() const
+    {
+        return bytes_.size();
+    }
+
+private:
+    std::vector<std::uint8_t> &bytes_;
+};
+
+/// <summary>
+/// Reads what a binary_writer wrote from a range of bytes it doesn't own.
+/// Throws invalid_file instead of reading past the end of the range.
+/// </summary>
+class binary_reader
+{
+public:
+    binary_reader(const std::uint8_t *data, std::size_t size)
+        : data_(data),
+          size_(size)
+    {
+    }
+
+    template <typename T>
+    T read()
+    {
+        T value;
+        std::memcpy(&value, skip(sizeof(T)), sizeof(T));
+
+        return value;
+    }
+
+    std::string read_string()
+    {
+        const auto size = read<std::uint32_t>();
+
+        return std::string(reinterpret_cast<const char *>(skip(size)), size);
+    }
+
+    /// <summary>
+    /// Returns a pointer to the next size bytes and moves past them.
+    /// </summary>
+    const std::uint8_t *skip(std::size_t size)
+    {
+        if (size > size_ - position_)
+        {
+            throw invalid_file("unexpected end of data");
+        }
+
+        const auto at = data_ + position_;
+        position_ += size;
+
+        return at;
+    }
+
+    /// <summary>
+    /// Returns the number of bytes left to read.
+    /// </summary>
+    std::size_t remaining() const
+    {
+        return size_ - position_;
+    }
+
+private:
+    const std::uint8_t *data_;
+    std::size_t size_;
+    std::size_t position_ = 0;
+};
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,317 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include <xlnt/cell/cell_type.hpp>
+#include <xlnt/styles/number_format.hpp>
+#include <xlnt/workbook/workbook.hpp>
+#include <xlnt/worksheet/range_reference.hpp>
+#include <detail/implementations/cell_impl.hpp>
+#include <detail/implementations/format_impl.hpp>
+#include <detail/implementations/stylesheet.hpp>
+#include <detail/implementations/worksheet_impl.hpp>
+#include <detail/number_format/number_formatter.hpp>
+#include <detail/serialization/csv_writer.hpp>
+#include <detail/serialization/pipeline.hpp>
+
+namespace {
+
+const std::size_t general_format_id = 0;
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+csv_writer::csv_writer(const worksheet_impl &ws, const stylesheet *styles, const csv_options &options)
+    : ws_(ws),
+      options_(options),
+      base_date_(ws.parent_->base_date())
+{
+    special_characters_.push_back(options_.delimiter);
+    special_characters_.push_back(options_.quote);
+    special_characters_.append("\r\n");
+
+    escaped_characters_.push_back(options_.delimiter);
+    escaped_characters_.append("\\\r\n");
+
+    format_strings_[general_format_id] = number_format::general().format_string();
+
+    if (styles == nullptr) return;
+
+    // Resolve every number format referenced by a cell format up front so that
+    // worker threads only ever read from format_strings_.
+    for (const auto &format : styles->format_impls)
+    {
+        if (!format.number_format_id.is_set()) continue;
+
+        const auto id = format.number_format_id.get();
+        if (format_strings_.count(id) > 0) continue;
+
+        if (number_format::is_builtin_format(id))
+        {
+            format_strings_[id] = number_format::from_builtin_id(id).format_string();
+            continue;
+        }
+
+        auto match = std::find_if(styles->number_formats.begin(), styles->number_formats.end(),
+            [id](const number_format &nf) { return nf.has_id() && nf.id() == id; });
+
+        if (match != styles->number_formats.end())
+        {
+            format_strings_[id] = match->format_string();
+        }
+    }
+}
+
+void csv_writer::write(const range_reference &reference, std::ostream &destination)
+{
+    const auto first_row = reference.top_left().row();
+    const auto last_row = reference.bottom_right().row();
+    const auto first_column = reference.top_left().column();
+    const auto last_column = reference.bottom_right().column();
+
+    const auto rows_per_block = static_cast<row_t>(std::max(options_.rows_per_block, std::size_t(1)));
+    const auto thread_count = std::max(options_.threads, std::size_t(1));
+    const auto block_count = static_cast<std::size_t>((last_row - first_row) / rows_per_block) + 1;
+
+    auto write_block = [&](std::size_t block, std::string &buffer, formatter_cache &cache) {
+        const auto block_first_row = first_row + static_cast<row_t>(block) * rows_per_block;
+        const auto block_last_row = block_first_row + std::min(rows_per_block - 1, last_row - block_first_row);
+
+        buffer.clear();
+        write_rows(block_first_row, block_last_row, first_column, last_column, buffer, cache);
+    };
+
+    if (thread_count == 1)
+    {
+        std::string buffer;
+        formatter_cache cache;
+
+        for (std::size_t block = 0; block < block_count; ++block)
+        {
+            write_block(block, buffer, cache);
+            destination.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        }
+
+        return;
+    }
+
+    // A block is only formatted once the one window blocks before it was written,
+    // so each slot of buffers and caches is used by one block at a time.
+    const auto window = thread_count * 2;
+    std::vector<std::string> buffers(window);
+    std::vector<formatter_cache> caches(window);
+
+    run_ordered(block_count, thread_count, window,
+        [&](std::size_t block) { write_block(block, buffers[block % window], caches[block % window]); },
+        [&](std::size_t block) {
+            const auto &buffer = buffers[block % window];
+            destination.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        });
+}
+
+void csv_writer::write_rows(row_t first_row, row_t last_row, column_t first_column, column_t last_column,
+    std::string &buffer, formatter_cache &cache) const
+{
+    for (auto row = first_row; row <= last_row; ++row)
+    {
+        const auto cells = ws_.cell_map_.find_row(row);
+
+        for (auto column = first_column; column <= last_column; ++column)
+        {
+            if (column != first_column)
+            {
+                buffer.push_back(options_.delimiter);
+            }
+
+            const cell_impl *cell = nullptr;
+
+            if (cells != nullptr)
+            {
+                const auto match = cells->find(column);
+                if (match != cells->end()) cell = &match->second;
+            }
+
+            if (cell == nullptr)
+            {
+                // a missing cell is written like an existing empty one
+                if (options_.quoting == csv_quoting::all)
+                {
+                    write_field(std::string(), false, buffer);
+                }
+
+                continue;
+            }
+
+            write_cell(*cell, buffer, cache);
+        }
+
+        buffer.append(options_.line_terminator);
+    }
+}
+
+void csv_writer::write_cell(const cell_impl &cell, std::string &buffer, formatter_cache &cache) const
+{
+    switch (cell.type_)
+    {
+    case cell_type::empty:
+        if (options_.quoting == csv_quoting::all)
+        {
+            write_field(std::string(), false, buffer);
+        }
+        break;
+
+    case cell_type::boolean:
+        write_field(cell.value_numeric_ == 0.0 ? "FALSE" : "TRUE", true, buffer);
+        break;
+
+    case cell_type::date:
+    case cell_type::number:
+        if (options_.formatted)
+        {
+            auto format_id = cell.format_.is_set() && cell.format_.get()->number_format_id.is_set()
+                ? cell.format_.get()->number_format_id.get()
+                : general_format_id;
+            write_field(formatter(format_id, cache).format_number(cell.value_numeric_), true, buffer);
+        }
+        else
+        {
+            char number[32];
+            auto length = std::snprintf(number, sizeof(number), "%.15g", cell.value_numeric_);
+            write_field(std::string(number, static_cast<std::size_t>(length)), true, buffer);
+        }
+        break;
+
+    case cell_type::shared_string:
+        write_field(ws_.parent_->shared_strings(static_cast<std::size_t>(cell.value_numeric_)).plain_text(),
+            false, buffer);
+        break;
+
+    case cell_type::inline_string:
+    case cell_type::formula_string:
+    case cell_type::error:
+        write_field(cell.value_text_.plain_text(), false, buffer);
+        break;
+    }
+}
+
+void csv_writer::write_field(const std::string &text, bool numeric, std::string &buffer) const
+{
+    auto quote = false;
+
+    switch (options_.quoting)
+    {
+    case csv_quoting::minimal:
+        quote = text.find_first_of(special_characters_) != std::string::npos;
+        break;
+    case csv_quoting::all:
+        quote = true;
+        break;
+    case csv_quoting::non_numeric:
+        quote = !numeric;
+        break;
+    case csv_quoting::none:
+        if (text.find_first_of(escaped_characters_) != std::string::npos)
+        {
+            write_escaped(text, buffer);
+            return;
+        }
+        break;
+    }
+
+    if (!quote)
+    {
+        buffer.append(text);
+        return;
+    }
+
+    buffer.push_back(options_.quote);
+
+    for (auto c : text)
+    {
+        if (c == options_.quote)
+        {
+            buffer.push_back(options_.quote);
+        }
+
+        buffer.push_back(c);
+    }
+
+    buffer.push_back(options_.quote);
+}
+
+void csv_writer::write_escaped(const std::string &text, std::string &buffer) const
+{
+    for (auto c : text)
+    {
+        switch (c)
+        {
+        case '\n':
+            buffer.append("\\n");
+            break;
+        case '\r':
+            buffer.append("\\r");
+            break;
+        case '\\':
+            buffer.append("\\\\");
+            break;
+        default:
+            if (c == options_.delimiter)
+            {
+                buffer.push_back('\\');
+                buffer.push_back(c == '\t' ? 't' : c);
+            }
+            else
+            {
+                buffer.push_back(c);
+            }
+        }
+    }
+}
+
+number_formatter &csv_writer::formatter(std::size_t number_format_id, formatter_cache &cache) const
+{
+    auto match = cache.find(number_format_id);
+
+    if (match != cache.end())
+    {
+        return *match->second;
+    }
+
+    auto format_string = format_strings_.find(number_format_id);
+    const auto &code = format_string == format_strings_.end()
+        ? format_strings_.at(general_format_id)
+        : format_string->second;
+
+    auto &compiled = cache[number_format_id];
+    compiled.reset(new number_formatter(code, base_date_));
+
+    return *compiled;
+}
+
+} // namespace detail
+} // namespace xlnt
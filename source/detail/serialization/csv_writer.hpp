@@ -0,0 +1,106 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <xlnt/cell/index_types.hpp>
+#include <xlnt/utils/calendar.hpp>
+#include <xlnt/worksheet/csv_options.hpp>
+
+namespace xlnt {
+
+class range_reference;
+
+namespace detail {
+
+class number_formatter;
+struct cell_impl;
+struct stylesheet;
+struct worksheet_impl;
+
+/// <summary>
+/// Writes the cells of a worksheet as delimited text. Number formats are
+/// compiled once per format id and rows are formatted in blocks into
+/// reusable buffers which may be filled concurrently.
+/// </summary>
+class csv_writer
+{
+public:
+    /// <summary>
+    /// Constructs a writer for the given worksheet. styles may be null if
+    /// the workbook has no stylesheet.
+    /// </summary>
+    csv_writer(const worksheet_impl &ws, const stylesheet *styles, const csv_options &options);
+
+    /// <summary>
+    /// Writes the cells within reference to destination.
+    /// </summary>
+    void write(const range_reference &reference, std::ostream &destination);
+
+private:
+    using formatter_cache = std::unordered_map<std::size_t, std::unique_ptr<number_formatter>>;
+
+    /// <summary>
+    /// Appends rows first_row through last_row (inclusive) to buffer.
+    /// </summary>
+    void write_rows(row_t first_row, row_t last_row, column_t first_column, column_t last_column,
+        std::string &buffer, formatter_cache &cache) const;
+
+    /// <summary>
+    /// Appends the displayed text of cell to buffer.
+    /// </summary>
+    void write_cell(const cell_impl &cell, std::string &buffer, formatter_cache &cache) const;
+
+    /// <summary>
+    /// Appends text to buffer, quoting it as required by the options.
+    /// </summary>
+    void write_field(const std::string &text, bool numeric, std::string &buffer) const;
+
+    /// <summary>
+    /// Appends text to buffer with backslash escapes for the characters that would
+    /// otherwise end the field or the row when fields aren't quoted.
+    /// </summary>
+    void write_escaped(const std::string &text, std::string &buffer) const;
+
+    /// <summary>
+    /// Returns the formatter for the number format with the given id, compiling
+    /// it into cache the first time it is requested.
+    /// </summary>
+    number_formatter &formatter(std::size_t number_format_id, formatter_cache &cache) const;
+
+    const worksheet_impl &ws_;
+    csv_options options_;
+    calendar base_date_;
+    std::string special_characters_;
+    std::string escaped_characters_;
+    std::unordered_map<std::size_t, std::string> format_strings_;
+};
+
+} // namespace detail
+} // namespace xlnt
@@ -175,7 +175,7 @@ pattern_fill_type from_string(const std::string &string)
 {
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wexit-time-destructors"
-    static std::unordered_map<std::string, pattern_fill_type> patternFill {
+    static const std::unordered_map<std::string, pattern_fill_type> patternFill {
         {"darkdown", pattern_fill_type::darkdown },
         { "darkgray", pattern_fill_type::darkgray },
         { "darkgrid", pattern_fill_type::darkgrid },
@@ -0,0 +1,122 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <iterator>
+
+#include <detail/serialization/instrumentation.hpp>
+
+#ifdef XLNT_INSTRUMENTATION
+
+namespace xlnt {
+namespace detail {
+
+void instrumentation::start(serialization_statistics *statistics)
+{
+    statistics_ = statistics;
+    start_ = now();
+    open_parts_.clear();
+}
+
+void instrumentation::finish()
+{
+    if (statistics_ == nullptr) return;
+
+    statistics_->seconds += std::chrono::duration<double>(now() - start_).count();
+    statistics_ = nullptr;
+}
+
+std::uint64_t instrumentation::allocations() const
+{
+    return statistics_->allocation_counter ? statistics_->allocation_counter() : 0;
+}
+
+std::size_t instrumentation::begin_part(const path &part)
+{
+    if (statistics_ == nullptr) return 0;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    part_statistics record;
+    record.part = part;
+    statistics_->parts.push_back(record);
+
+    const auto index = statistics_->parts.size() - 1;
+    open_parts_.push_back({index, now(), 0.0, allocations(), 0});
+
+    return index;
+}
+
+void instrumentation::end_part(std::size_t part, std::uint64_t compressed_bytes, std::uint64_t uncompressed_bytes)
+{
+    if (statistics_ == nullptr) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto open = std::find_if(open_parts_.begin(), open_parts_.end(),
+        [part](const open_part &candidate) { return candidate.index == part; });
+    if (open == open_parts_.end()) return;
+
+    const auto seconds = std::chrono::duration<double>(now() - open->start).count();
+    const auto allocated = allocations() - open->allocations;
+
+    auto &record = statistics_->parts[part];
+    record.seconds += seconds - open->nested_seconds;
+    record.compressed_bytes = compressed_bytes;
+    record.uncompressed_bytes = uncompressed_bytes;
+    record.allocations += allocated - open->nested_allocations;
+
+    open = open_parts_.erase(open);
+
+    // what happened in this part doesn't count for the enclosing one
+    if (open != open_parts_.begin())
+    {
+        std::prev(open)->nested_seconds += seconds;
+        std::prev(open)->nested_allocations += allocated;
+    }
+}
+
+void instrumentation::merge(const serialization_statistics &other)
+{
+    if (statistics_ == nullptr) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    statistics_->rows += other.rows;
+    statistics_->cells += other.cells;
+    statistics_->shared_strings += other.shared_strings;
+    statistics_->formats += other.formats;
+
+    for (const auto &part : other.parts)
+    {
+        auto record = std::find_if(statistics_->parts.rbegin(), statistics_->parts.rend(),
+            [&part](const part_statistics &candidate) { return candidate.part == part.part; });
+        if (record == statistics_->parts.rend()) continue;
+
+        record->seconds += part.seconds;
+        record->compression_seconds += part.compression_seconds;
+        record->allocations += part.allocations;
+    }
+}
+
+} // namespace detail
+} // namespace xlnt
+
+#endif
@@ -0,0 +1,198 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <xlnt/utils/path.hpp>
+#include <xlnt/workbook/serialization_statistics.hpp>
+
+namespace xlnt {
+namespace detail {
+
+#ifdef XLNT_INSTRUMENTATION
+
+/// <summary>
+/// Fills in a serialization_statistics while a package is read or written. Parts are
+/// timed from when they are opened until they are closed, less the time and allocations
+/// of parts opened in between, because the consumer reads worksheets while reading the workbook.
+/// Does nothing until started with non-null statistics. Part records are locked since a
+/// pipelined part is inflated or deflated on a thread of its own.
+/// </summary>
+class instrumentation
+{
+public:
+    static const bool enabled = true;
+
+    using time_point = std::chrono::steady_clock::time_point;
+
+    /// <summary>
+    /// Starts filling in statistics, which may be null.
+    /// </summary>
+    void start(serialization_statistics *statistics);
+
+    /// <summary>
+    /// Adds the time since start to the total time and stops filling in statistics.
+    /// </summary>
+    void finish();
+
+    time_point now() const
+    {
+        return statistics_ == nullptr ? time_point() : std::chrono::steady_clock::now();
+    }
+
+    /// <summary>
+    /// Starts timing a part. The returned index identifies it in calls to the functions below.
+    /// </summary>
+    std::size_t begin_part(const path &part);
+
+    /// <summary>
+    /// Stops timing a part and records its sizes.
+    /// </summary>
+    void end_part(std::size_t part, std::uint64_t compressed_bytes, std::uint64_t uncompressed_bytes);
+
+    /// <summary>
+    /// Adds the time since start to the time spent inflating or deflating a part.
+    /// </summary>
+    void add_compression_time(std::size_t part, time_point start)
+    {
+        if (statistics_ == nullptr) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        statistics_->parts[part].compression_seconds
+            += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /// <summary>
+    /// Adds the counters of other, collected while writing parts on another thread, and
+    /// the time and allocations of each of its parts to the latest record of the same part.
+    /// </summary>
+    void merge(const serialization_statistics &other);
+
+    void count_row()
+    {
+        if (statistics_ != nullptr) ++statistics_->rows;
+    }
+
+    void count_cell()
+    {
+        if (statistics_ != nullptr) ++statistics_->cells;
+    }
+
+    void count_shared_strings(std::size_t count)
+    {
+        if (statistics_ != nullptr) statistics_->shared_strings += count;
+    }
+
+    void count_formats(std::size_t count)
+    {
+        if (statistics_ != nullptr) statistics_->formats += count;
+    }
+
+private:
+    struct open_part
+    {
+        std::size_t index;
+        time_point start;
+        double nested_seconds;
+        std::uint64_t allocations;
+        std::uint64_t nested_allocations;
+    };
+
+    std::uint64_t allocations() const;
+
+    serialization_statistics *statistics_ = nullptr;
+    time_point start_;
+    std::vector<open_part> open_parts_;
+    std::mutex mutex_;
+};
+
+#else
+
+/// <summary>
+/// Does nothing when xlnt is built without instrumentation so every call compiles away.
+/// </summary>
+class instrumentation
+{
+public:
+    static const bool enabled = false;
+
+    struct time_point
+    {
+    };
+
+    void start(serialization_statistics *)
+    {
+    }
+
+    void finish()
+    {
+    }
+
+    time_point now() const
+    {
+        return time_point();
+    }
+
+    std::size_t begin_part(const path &)
+    {
+        return 0;
+    }
+
+    void end_part(std::size_t, std::uint64_t, std::uint64_t)
+    {
+    }
+
+    void add_compression_time(std::size_t, time_point)
+    {
+    }
+
+    void merge(const serialization_statistics &)
+    {
+    }
+
+    void count_row()
+    {
+    }
+
+    void count_cell()
+    {
+    }
+
+    void count_shared_strings(std::size_t)
+    {
+    }
+
+    void count_formats(std::size_t)
+    {
+    }
+};
+
+#endif
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,142 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <detail/serialization/mapped_file.hpp>
+#include <xlnt/utils/path.hpp>
+
+namespace xlnt {
+namespace detail {
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(const path &filename)
+{
+#ifdef _MSC_VER
+    auto file = CreateFileW(filename.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+#else
+    auto file = CreateFileA(filename.string().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+#endif
+
+    if (file == INVALID_HANDLE_VALUE) return;
+
+    LARGE_INTEGER file_size;
+
+    if (GetFileType(file) == FILE_TYPE_DISK && GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0
+        && static_cast<unsigned long long>(file_size.QuadPart) <= static_cast<std::size_t>(-1))
+    {
+        // the view keeps the mapping and the file open once their handles are closed
+        auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if (mapping != nullptr)
+        {
+            auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+            if (view != nullptr)
+            {
+                data_ = static_cast<const std::uint8_t *>(view);
+                size_ = static_cast<std::size_t>(file_size.QuadPart);
+            }
+
+            CloseHandle(mapping);
+        }
+    }
+
+    CloseHandle(file);
+}
+
+mapped_file::~mapped_file()
+{
+    if (data_ != nullptr)
+    {
+        UnmapViewOfFile(data_);
+    }
+}
+
+#else
+
+mapped_file::mapped_file(const path &filename)
+{
+    const auto file = open(filename.string().c_str(), O_RDONLY);
+
+    if (file == -1) return;
+
+    struct stat status;
+
+    if (fstat(file, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0
+        && static_cast<unsigned long long>(status.st_size) <= static_cast<std::size_t>(-1))
+    {
+        const auto size = static_cast<std::size_t>(status.st_size);
+
+        // the mapping keeps the file open once the descriptor is closed
+        auto view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+
+        if (view != MAP_FAILED)
+        {
+            data_ = static_cast<const std::uint8_t *>(view);
+            size_ = size;
+        }
+    }
+
+    close(file);
+}
+
+mapped_file::~mapped_file()
+{
+    if (data_ != nullptr)
+    {
+        munmap(const_cast<std::uint8_t *>(data_), size_);
+    }
+}
+
+#endif
+
+bool mapped_file::is_open() const
+{
+    return data_ != nullptr;
+}
+
+const std::uint8_t *mapped_file::data() const
+{
+    return data_;
+}
+
+std::size_t mapped_file::size() const
+{
+    return size_;
+}
+
+} // namespace detail
+} // namespace xlnt
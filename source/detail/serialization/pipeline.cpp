@@ -0,0 +1,362 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+
+#include <xlnt/utils/exceptions.hpp>
+#include <detail/serialization/pipeline.hpp>
+
+namespace xlnt {
+namespace detail {
+
+block_ring::block_ring(std::size_t block_size, std::size_t blocks)
+    : blocks_(blocks)
+{
+    for (auto &b : blocks_)
+    {
+        b.data.resize(block_size);
+        b.size = 0;
+    }
+}
+
+char *block_ring::begin_fill()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return closed_ || full_ < blocks_.size(); });
+
+    if (closed_) return nullptr;
+
+    // the filling side owns the first empty block until end_fill
+    return blocks_[(first_full_ + full_) % blocks_.size()].data.data();
+}
+
+void block_ring::end_fill(std::size_t size)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    blocks_[(first_full_ + full_) % blocks_.size()].size = size;
+    ++full_;
+    changed_.notify_all();
+}
+
+void block_ring::finish()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+    changed_.notify_all();
+}
+
+bool block_ring::begin_drain(const char *&data, std::size_t &size)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return closed_ || finished_ || full_ > 0; });
+
+    if (closed_ || full_ == 0) return false;
+
+    // the draining side owns the first full block, which still counts as full, until end_drain
+    const auto &first = blocks_[first_full_];
+    data = first.data.data();
+    size = first.size;
+
+    return true;
+}
+
+void block_ring::end_drain()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    first_full_ = (first_full_ + 1) % blocks_.size();
+    --full_;
+    changed_.notify_all();
+}
+
+void block_ring::close(std::exception_ptr error)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    if (!error_) error_ = error;
+    changed_.notify_all();
+}
+
+void block_ring::rethrow()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error_) std::rethrow_exception(error_);
+}
+
+pipelined_istreambuf::pipelined_istreambuf(std::unique_ptr<std::streambuf> source)
+    : source_(std::move(source)),
+      ring_(pipeline_block_size, pipeline_blocks)
+{
+    setg(nullptr, nullptr, nullptr);
+    setp(nullptr, nullptr);
+
+    reader_ = std::thread([this]() {
+        try
+        {
+            while (auto block = ring_.begin_fill())
+            {
+                const auto count = source_->sgetn(block, static_cast<std::streamsize>(pipeline_block_size));
+                if (count <= 0) break;
+                ring_.end_fill(static_cast<std::size_t>(count));
+            }
+
+            ring_.finish();
+        }
+        catch (...)
+        {
+            ring_.close(std::current_exception());
+        }
+    });
+}
+
+pipelined_istreambuf::~pipelined_istreambuf()
+{
+    ring_.close();
+    reader_.join();
+}
+
+pipelined_istreambuf::int_type pipelined_istreambuf::underflow()
+{
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+    if (draining_)
+    {
+        ring_.end_drain();
+        draining_ = false;
+    }
+
+    const char *data = nullptr;
+    std::size_t size = 0;
+
+    if (!ring_.begin_drain(data, size))
+    {
+        ring_.rethrow();
+        setg(nullptr, nullptr, nullptr);
+
+        return traits_type::eof();
+    }
+
+    draining_ = true;
+    auto begin = const_cast<char *>(data);
+    setg(begin, begin, begin + size);
+
+    return traits_type::to_int_type(*gptr());
+}
+
+pipelined_ostreambuf::pipelined_ostreambuf(std::unique_ptr<std::streambuf> destination)
+    : destination_(std::move(destination)),
+      ring_(pipeline_block_size, pipeline_blocks)
+{
+    setg(nullptr, nullptr, nullptr);
+
+    auto first = ring_.begin_fill();
+    setp(first, first + pipeline_block_size);
+
+    writer_ = std::thread([this]() {
+        try
+        {
+            const char *data = nullptr;
+            std::size_t size = 0;
+
+            while (ring_.begin_drain(data, size))
+            {
+                const auto written = destination_->sputn(data, static_cast<std::streamsize>(size));
+
+                if (written != static_cast<std::streamsize>(size))
+                {
+                    throw xlnt::exception("couldn't write pipelined part");
+                }
+
+                ring_.end_drain();
+            }
+        }
+        catch (...)
+        {
+            ring_.close(std::current_exception());
+        }
+    });
+}
+
+pipelined_ostreambuf::~pipelined_ostreambuf()
+{
+    stop();
+}
+
+void pipelined_ostreambuf::stop()
+{
+    if (!writer_.joinable()) return;
+
+    if (pptr() != nullptr && pptr() > pbase())
+    {
+        ring_.end_fill(static_cast<std::size_t>(pptr() - pbase()));
+    }
+
+    setp(nullptr, nullptr);
+    ring_.finish();
+    writer_.join();
+}
+
+void pipelined_ostreambuf::close()
+{
+    stop();
+    ring_.rethrow();
+
+    if (destination_->pubsync() == -1)
+    {
+        throw xlnt::exception("couldn't write pipelined part");
+    }
+}
+
+bool pipelined_ostreambuf::next_block()
+{
+    if (pptr() != nullptr && pptr() > pbase())
+    {
+        ring_.end_fill(static_cast<std::size_t>(pptr() - pbase()));
+        auto block = ring_.begin_fill();
+        setp(block, block == nullptr ? nullptr : block + pipeline_block_size);
+    }
+
+    if (pptr() == nullptr)
+    {
+        ring_.rethrow();
+        return false;
+    }
+
+    return true;
+}
+
+pipelined_ostreambuf::int_type pipelined_ostreambuf::overflow(int_type c)
+{
+    if (!next_block()) return traits_type::eof();
+
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+}
+
+int pipelined_ostreambuf::sync()
+{
+    return next_block() ? 0 : -1;
+}
+
+void run_ordered(std::size_t count, std::size_t threads, std::size_t window,
+    const std::function<void(std::size_t)> &produce, const std::function<void(std::size_t)> &consume)
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::size_t next = 0;
+    std::size_t consumed = 0;
+    bool stopped = false;
+    std::vector<bool> produced(count, false);
+    std::vector<std::exception_ptr> errors(count);
+
+    auto work = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (true)
+        {
+            changed.wait(lock, [&] { return stopped || next >= count || next < consumed + window; });
+            if (stopped || next >= count) return;
+
+            const auto index = next++;
+            lock.unlock();
+
+            std::exception_ptr error;
+
+            try
+            {
+                produce(index);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            lock.lock();
+            errors[index] = error;
+            produced[index] = true;
+            changed.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    // stops and joins the workers however this returns
+    struct joiner
+    {
+        ~joiner()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopped = true;
+                changed.notify_all();
+            }
+
+            for (auto &worker : workers)
+            {
+                worker.join();
+            }
+        }
+
+        std::mutex &mutex;
+        std::condition_variable &changed;
+        bool &stopped;
+        std::vector<std::thread> &workers;
+    } join_workers{mutex, changed, stopped, workers};
+
+    window = std::max(window, std::size_t(1));
+    threads = std::min(std::max(threads, std::size_t(1)), count);
+
+    for (std::size_t i = 0; i < threads; ++i)
+    {
+        workers.emplace_back(work);
+    }
+
+    for (std::size_t index = 0; index < count; ++index)
+    {
+        std::exception_ptr error;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return bool(produced[index]); });
+            error = errors[index];
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+
+        consume(index);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        consumed = index + 1;
+        changed.notify_all();
+    }
+}
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,198 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+#include <xlnt/xlnt_config.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// The size of each block passed between the threads of a pipelined streambuf.
+/// </summary>
+const std::size_t pipeline_block_size = 64 * 1024;
+
+/// <summary>
+/// The number of blocks a pipelined streambuf buffers, which bounds how far the
+/// producing thread can get ahead of the consuming one.
+/// </summary>
+const std::size_t pipeline_blocks = 8;
+
+/// <summary>
+/// A fixed ring of blocks of bytes passed from a thread which fills them to a thread
+/// which drains them. The filling thread waits while every block is full and the
+/// draining thread while every block is empty. Either side can close the ring, with
+/// an exception for the other side to rethrow, to make the other stop waiting.
+/// </summary>
+class block_ring
+{
+public:
+    block_ring(std::size_t block_size, std::size_t blocks);
+
+    /// <summary>
+    /// Waits for an empty block and returns it, or returns null once the ring is closed.
+    /// </summary>
+    char *begin_fill();
+
+    /// <summary>
+    /// Passes the block returned by begin_fill, holding size bytes, to the draining side.
+    /// </summary>
+    void end_fill(std::size_t size);
+
+    /// <summary>
+    /// Tells the draining side that no more blocks will be filled.
+    /// </summary>
+    void finish();
+
+    /// <summary>
+    /// Waits for a full block and points data and size at it. Returns false once the
+    /// blocks are drained after finish, or once the ring is closed.
+    /// </summary>
+    bool begin_drain(const char *&data, std::size_t &size);
+
+    /// <summary>
+    /// Returns the block from begin_drain to the filling side.
+    /// </summary>
+    void end_drain();
+
+    /// <summary>
+    /// Stops both sides, keeping error, if any, for rethrow.
+    /// </summary>
+    void close(std::exception_ptr error = nullptr);
+
+    /// <summary>
+    /// Rethrows the error the ring was closed with, if any.
+    /// </summary>
+    void rethrow();
+
+private:
+    struct block
+    {
+        std::vector<char> data;
+        std::size_t size;
+    };
+
+    std::vector<block> blocks_;
+    std::size_t first_full_ = 0;
+    std::size_t full_ = 0;
+    bool finished_ = false;
+    bool closed_ = false;
+    std::exception_ptr error_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+};
+
+/// <summary>
+/// Reads source on a separate thread, such as to inflate a part while the calling
+/// thread parses what was inflated so far. Errors reading source are rethrown by
+/// the reads which would have returned the missing data. Source is destroyed on the
+/// thread destroying this.
+/// </summary>
+class pipelined_istreambuf : public std::streambuf
+{
+public:
+    pipelined_istreambuf(std::unique_ptr<std::streambuf> source);
+
+    pipelined_istreambuf(const pipelined_istreambuf &) = delete;
+    pipelined_istreambuf &operator=(const pipelined_istreambuf &) = delete;
+
+    ~pipelined_istreambuf() override;
+
+private:
+    int_type underflow() override;
+
+    std::unique_ptr<std::streambuf> source_;
+    block_ring ring_;
+    bool draining_ = false;
+    std::thread reader_;
+};
+
+/// <summary>
+/// Writes to destination on a separate thread, such as to deflate a part while the
+/// calling thread serializes the rest of it. An error writing to destination is
+/// rethrown by the next write which needs an empty block, or by close for the last
+/// blocks. Destination is flushed and destroyed on the thread destroying this.
+/// </summary>
+class XLNT_API pipelined_ostreambuf : public std::streambuf
+{
+public:
+    pipelined_ostreambuf(std::unique_ptr<std::streambuf> destination);
+
+    pipelined_ostreambuf(const pipelined_ostreambuf &) = delete;
+    pipelined_ostreambuf &operator=(const pipelined_ostreambuf &) = delete;
+
+    ~pipelined_ostreambuf() override;
+
+    /// <summary>
+    /// Passes the bytes written so far to the writing thread, waits for it to write them
+    /// and syncs destination. Rethrows an error the writing thread ran into, which
+    /// the destructor can't report. Nothing can be written after this.
+    /// </summary>
+    void close();
+
+private:
+    int_type overflow(int_type c) override;
+
+    int sync() override;
+
+    /// <summary>
+    /// Passes the bytes written so far to the writing thread and starts a new block.
+    /// Returns false if the writing thread has stopped.
+    /// </summary>
+    bool next_block();
+
+    /// <summary>
+    /// Passes the bytes written so far to the writing thread and joins it once it
+    /// has written every block, unless this was already done.
+    /// </summary>
+    void stop();
+
+    std::unique_ptr<std::streambuf> destination_;
+    block_ring ring_;
+    std::thread writer_;
+};
+
+/// <summary>
+/// Calls produce for each index from 0 to count - 1 on up to threads worker threads and
+/// consume for each index, in order, on the calling thread as soon as its produce has
+/// returned. No more than window indices are produced ahead of the one being consumed,
+/// which bounds the results held between the two. An exception thrown by produce is
+/// rethrown in place of the consume of that index. Once either throws, the workers stop
+/// taking new indices and are joined before the exception propagates.
+/// </summary>
+void run_ordered(std::size_t count, std::size_t threads, std::size_t window,
+    const std::function<void(std::size_t)> &produce, const std::function<void(std::size_t)> &consume);
+
+} // namespace detail
+} // namespace xlnt
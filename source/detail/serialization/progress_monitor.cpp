@@ -0,0 +1,88 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+
+#include <detail/serialization/progress_monitor.hpp>
+
+namespace xlnt {
+namespace detail {
+
+void progress_monitor::start(const std::function<void(const serialization_progress &)> &callback,
+    std::uint64_t interval, const cancellation_token *cancellation, std::uint64_t total_bytes)
+{
+    callback_ = callback;
+    interval_ = std::max(interval, std::uint64_t(1));
+    cancellation_ = cancellation;
+    progress_ = serialization_progress();
+    progress_.total_bytes = total_bytes;
+    bytes_.store(0);
+    part_ended_ = false;
+}
+
+void progress_monitor::finish()
+{
+    if (callback_)
+    {
+        report();
+    }
+}
+
+void progress_monitor::check()
+{
+    if (cancellation_ != nullptr && cancellation_->cancelled())
+    {
+        throw operation_cancelled();
+    }
+
+    if (callback_ && part_ended_)
+    {
+        report();
+    }
+}
+
+void progress_monitor::add_rows(std::uint64_t rows)
+{
+    const auto intervals = progress_.rows / interval_;
+    progress_.rows += rows;
+
+    if (cancellation_ != nullptr && cancellation_->cancelled())
+    {
+        throw operation_cancelled();
+    }
+
+    if (callback_ && progress_.rows / interval_ != intervals)
+    {
+        report();
+    }
+}
+
+void progress_monitor::report()
+{
+    part_ended_ = false;
+    progress_.bytes = bytes_.load(std::memory_order_relaxed);
+    callback_(progress_);
+}
+
+} // namespace detail
+} // namespace xlnt
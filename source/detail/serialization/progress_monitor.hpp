@@ -0,0 +1,116 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#include <xlnt/utils/exceptions.hpp>
+#include <xlnt/workbook/serialization_options.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// Reports progress to the callback in load_options or save_options and stops the
+/// load or save when its cancellation_token is cancelled. Bytes and parts are counted
+/// by the zstream buffers, which can't throw, so the callback is only called and
+/// cancellation only checked from check and row. Bytes may be added from the thread
+/// of a pipelined part.
+/// </summary>
+class progress_monitor
+{
+public:
+    void start(const std::function<void(const serialization_progress &)> &callback,
+        std::uint64_t interval, const cancellation_token *cancellation, std::uint64_t total_bytes);
+
+    /// <summary>
+    /// Calls the callback a final time.
+    /// </summary>
+    void finish();
+
+    void add_bytes(std::uint64_t bytes)
+    {
+        bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void end_part()
+    {
+        ++progress_.parts;
+        part_ended_ = true;
+    }
+
+    /// <summary>
+    /// Throws operation_cancelled if cancelled. Otherwise calls the callback if a part
+    /// has ended since it was last called.
+    /// </summary>
+    void check();
+
+    /// <summary>
+    /// Counts a worksheet row, throwing operation_cancelled if cancelled and calling the
+    /// callback every interval rows.
+    /// </summary>
+    void row()
+    {
+        ++progress_.rows;
+
+        if (cancellation_ != nullptr && cancellation_->cancelled())
+        {
+            throw operation_cancelled();
+        }
+
+        if (callback_ && progress_.rows % interval_ == 0)
+        {
+            report();
+        }
+    }
+
+    /// <summary>
+    /// Returns the number of rows counted since start.
+    /// </summary>
+    std::uint64_t rows() const
+    {
+        return progress_.rows;
+    }
+
+    /// <summary>
+    /// Counts rows written elsewhere, such as by another thread, as if row had been
+    /// called for each of them, but calls the callback at most once.
+    /// </summary>
+    void add_rows(std::uint64_t rows);
+
+private:
+    void report();
+
+    std::function<void(const serialization_progress &)> callback_;
+    std::uint64_t interval_ = 1;
+    const cancellation_token *cancellation_ = nullptr;
+    serialization_progress progress_;
+    std::atomic<std::uint64_t> bytes_{0};
+    bool part_ended_ = false;
+};
+
+} // namespace detail
+} // namespace xlnt
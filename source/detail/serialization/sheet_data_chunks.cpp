@@ -0,0 +1,250 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <utility>
+
+#include <detail/serialization/sheet_data_chunks.hpp>
+
+namespace {
+
+/// <summary>
+/// Reads a sequence of ranges of bytes in memory as if they were contiguous.
+/// </summary>
+class segments_istreambuf : public std::streambuf
+{
+public:
+    segments_istreambuf(std::vector<std::pair<const char *, std::size_t>> segments)
+        : segments_(std::move(segments))
+    {
+    }
+
+private:
+    int_type underflow() override
+    {
+        while (next_ < segments_.size())
+        {
+            auto segment = segments_[next_++];
+            if (segment.second == 0) continue;
+
+            auto begin = const_cast<char *>(segment.first);
+            setg(begin, begin, begin + segment.second);
+
+            return traits_type::to_int_type(*gptr());
+        }
+
+        return traits_type::eof();
+    }
+
+    std::vector<std::pair<const char *, std::size_t>> segments_;
+    std::size_t next_ = 0;
+};
+
+bool ends_name(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '>' || c == '/';
+}
+
+/// <summary>
+/// Returns the position of the '>' closing the tag starting at begin, skipping any
+/// in quoted attribute values, or std::string::npos if there isn't one.
+/// </summary>
+std::size_t tag_end(const std::string &part, std::size_t begin)
+{
+    char quote = 0;
+
+    for (auto i = begin + 1; i < part.size(); ++i)
+    {
+        const auto c = part[i];
+
+        if (quote != 0)
+        {
+            if (c == quote) quote = 0;
+        }
+        else if (c == '"' || c == '\'')
+        {
+            quote = c;
+        }
+        else if (c == '>')
+        {
+            return i;
+        }
+    }
+
+    return std::string::npos;
+}
+
+/// <summary>
+/// Returns true if the tag at position is the start or empty tag of an element called name.
+/// </summary>
+bool is_start_tag(const std::string &part, std::size_t position, const std::string &name)
+{
+    const auto after = position + 1 + name.size();
+
+    return after < part.size()
+        && part.compare(position + 1, name.size(), name) == 0
+        && ends_name(part[after]);
+}
+
+/// <summary>
+/// If the markup at position is a comment, processing instruction or CDATA section,
+/// moves position past it and returns true.
+/// </summary>
+bool skip_non_element(const std::string &part, std::size_t &position)
+{
+    static const std::pair<std::string, std::string> kinds[] = {
+        {"<!--", "-->"}, {"<![CDATA[", "]]>"}, {"<?", "?>"}};
+
+    for (const auto &kind : kinds)
+    {
+        if (part.compare(position, kind.first.size(), kind.first) != 0) continue;
+
+        const auto end = part.find(kind.second, position + kind.first.size());
+        position = end == std::string::npos ? end : end + kind.second.size();
+
+        return true;
+    }
+
+    return false;
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+bool sheet_data_chunks::split(const std::string &part, std::size_t chunks)
+{
+    part_ = &part;
+    bounds_.clear();
+    outline_.clear();
+
+    // find the root element after the XML declaration and any comments
+    auto position = part.find('<');
+
+    while (position != std::string::npos && skip_non_element(part, position))
+    {
+        position = part.find('<', position);
+    }
+
+    // a document type declaration could declare entities used in the rows
+    if (position == std::string::npos || part.compare(position, 2, "<!") == 0) return false;
+
+    auto name_end = position + 1;
+    while (name_end < part.size() && !ends_name(part[name_end])) ++name_end;
+    const auto root = part.substr(position + 1, name_end - position - 1);
+    const auto colon = root.find(':');
+    const auto prefix = colon == std::string::npos ? std::string() : root.substr(0, colon + 1);
+
+    root_end_ = tag_end(part, position);
+    if (root_end_ == std::string::npos || part[root_end_ - 1] == '/') return false;
+    ++root_end_;
+
+    // sheetData is assumed to use the root's prefix, otherwise it isn't found
+    const auto sheet_data = prefix + "sheetData";
+    position = root_end_;
+
+    while (true)
+    {
+        position = part.find('<', position);
+        if (position == std::string::npos) return false;
+        if (skip_non_element(part, position)) continue;
+
+        const auto end = tag_end(part, position);
+        if (end == std::string::npos) return false;
+
+        if (is_start_tag(part, position, sheet_data))
+        {
+            if (part[end - 1] == '/') return false;
+
+            sheet_data_begin_ = position;
+            body_begin_ = end + 1;
+            break;
+        }
+
+        position = end + 1;
+    }
+
+    const auto body_end = part.find("</" + sheet_data, body_begin_);
+    if (body_end == std::string::npos) return false;
+
+    // without these, every '<' in the body starts a tag
+    const auto markup = part.find("<!", body_begin_);
+    const auto instruction = part.find("<?", body_begin_);
+    if ((markup != std::string::npos && markup < body_end)
+        || (instruction != std::string::npos && instruction < body_end))
+    {
+        return false;
+    }
+
+    const auto row = prefix + "row";
+    const auto body_size = body_end - body_begin_;
+    bounds_.push_back(body_begin_);
+
+    for (std::size_t i = 1; i < chunks; ++i)
+    {
+        position = std::max(bounds_.back() + 1, body_begin_ + body_size / chunks * i);
+        position = part.find("<" + row, position);
+
+        while (position < body_end && !is_start_tag(part, position, row))
+        {
+            position = part.find("<" + row, position + 1);
+        }
+
+        if (position >= body_end) break;
+        bounds_.push_back(position);
+    }
+
+    bounds_.push_back(body_end);
+
+    end_tags_ = "</" + sheet_data + "></" + root + ">";
+    outline_.reserve(part.size() - body_size);
+    outline_.append(part, 0, body_begin_);
+    outline_.append(part, body_end, std::string::npos);
+
+    return true;
+}
+
+std::size_t sheet_data_chunks::size() const
+{
+    return bounds_.empty() ? 0 : bounds_.size() - 1;
+}
+
+const std::string &sheet_data_chunks::outline() const
+{
+    return outline_;
+}
+
+std::unique_ptr<std::streambuf> sheet_data_chunks::open(std::size_t index) const
+{
+    const auto data = part_->data();
+
+    return std::unique_ptr<std::streambuf>(new segments_istreambuf({
+        {data, root_end_},
+        {data + sheet_data_begin_, body_begin_ - sheet_data_begin_},
+        {data + bounds_[index], bounds_[index + 1] - bounds_[index]},
+        {end_tags_.data(), end_tags_.size()}}));
+}
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,87 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// Divides the rows in the sheetData element of an inflated worksheet part into
+/// chunks which can be parsed independently of each other, each as a document of
+/// its own. Rows are found by their start tags without parsing the XML, so a part
+/// whose sheetData contains anything which could hide a tag, such as a comment or
+/// CDATA section, isn't divided.
+/// </summary>
+class sheet_data_chunks
+{
+public:
+    /// <summary>
+    /// Divides the sheetData of part, which must outlive this, into at most chunks
+    /// chunks of roughly equal size. Returns false if part can't be divided.
+    /// </summary>
+    bool split(const std::string &part, std::size_t chunks);
+
+    /// <summary>
+    /// Returns the number of chunks found by split.
+    /// </summary>
+    std::size_t size() const;
+
+    /// <summary>
+    /// Returns the part without the content of sheetData, to be parsed as usual.
+    /// </summary>
+    const std::string &outline() const;
+
+    /// <summary>
+    /// Returns a streambuf reading the rows of the chunk at index between the start
+    /// tags of the part's root and sheetData elements and the matching end tags.
+    /// </summary>
+    std::unique_ptr<std::streambuf> open(std::size_t index) const;
+
+private:
+    const std::string *part_ = nullptr;
+    std::size_t root_end_ = 0;
+    std::size_t sheet_data_begin_ = 0;
+    std::size_t body_begin_ = 0;
+
+    /// <summary>
+    /// The end tags of sheetData and the root element.
+    /// </summary>
+    std::string end_tags_;
+
+    /// <summary>
+    /// Chunk i holds the bytes of the part from bounds_[i] to bounds_[i + 1].
+    /// </summary>
+    std::vector<std::size_t> bounds_;
+
+    std::string outline_;
+};
+
+} // namespace detail
+} // namespace xlnt
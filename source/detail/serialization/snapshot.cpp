@@ -0,0 +1,535 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <xlnt/cell/rich_text.hpp>
+#include <xlnt/styles/color.hpp>
+#include <xlnt/styles/font.hpp>
+#include <xlnt/utils/exceptions.hpp>
+#include <xlnt/workbook/serialization_options.hpp>
+#include <xlnt/workbook/workbook.hpp>
+#include <detail/implementations/workbook_impl.hpp>
+#include <detail/implementations/worksheet_impl.hpp>
+#include <detail/serialization/binary_buffer.hpp>
+#include <detail/serialization/snapshot.hpp>
+#include <detail/serialization/vector_streambuf.hpp>
+#include <detail/serialization/xlsx_consumer.hpp>
+#include <detail/serialization/xlsx_producer.hpp>
+
+namespace {
+
+using xlnt::detail::binary_reader;
+using xlnt::detail::binary_writer;
+using xlnt::detail::cell_impl;
+
+const char magic[8] = {'X', 'L', 'N', 'T', 'S', 'N', 'A', 'P'};
+
+// Incremented whenever the layout below changes.
+const std::uint32_t version = 1;
+
+// Written as a number so that a snapshot from a machine with another byte order is recognised.
+const std::uint32_t byte_order = 0x01020304;
+
+// Flags of a cell record saying which optional fields follow.
+const std::uint8_t has_formula = 1;
+const std::uint8_t has_format = 2;
+const std::uint8_t has_hyperlink = 4;
+
+enum font_flags : std::uint16_t
+{
+    font_name = 1 << 0,
+    font_size = 1 << 1,
+    font_color = 1 << 2,
+    font_family = 1 << 3,
+    font_charset = 1 << 4,
+    font_scheme = 1 << 5,
+    font_bold = 1 << 6,
+    font_italic = 1 << 7,
+    font_superscript = 1 << 8,
+    font_subscript = 1 << 9,
+    font_strikethrough = 1 << 10,
+    font_outline = 1 << 11,
+    font_shadow = 1 << 12
+};
+
+void write_optional(binary_writer &writer, const xlnt::optional<std::string> &text)
+{
+    writer.write(static_cast<std::uint8_t>(text.is_set()));
+
+    if (text.is_set())
+    {
+        writer.write(text.get());
+    }
+}
+
+xlnt::optional<std::string> read_optional(binary_reader &reader)
+{
+    if (reader.read<std::uint8_t>() == 0)
+    {
+        return xlnt::optional<std::string>();
+    }
+
+    return reader.read_string();
+}
+
+void write_color(binary_writer &writer, const xlnt::color &color)
+{
+    writer.write(static_cast<std::uint8_t>(color.type()));
+    writer.write(static_cast<std::uint8_t>(color.auto_()));
+    writer.write(color.tint());
+
+    switch (color.type())
+    {
+    case xlnt::color_type::indexed:
+        writer.write(static_cast<std::uint32_t>(color.indexed().index()));
+        break;
+    case xlnt::color_type::theme:
+        writer.write(static_cast<std::uint32_t>(color.theme().index()));
+        break;
+    case xlnt::color_type::rgb:
+        writer.write(color.rgb().rgba());
+        break;
+    }
+}
+
+xlnt::color read_color(binary_reader &reader)
+{
+    const auto type = static_cast<xlnt::color_type>(reader.read<std::uint8_t>());
+    const auto automatic = reader.read<std::uint8_t>() != 0;
+    const auto tint = reader.read<double>();
+    xlnt::color color;
+
+    switch (type)
+    {
+    case xlnt::color_type::indexed:
+        color = xlnt::indexed_color(reader.read<std::uint32_t>());
+        break;
+    case xlnt::color_type::theme:
+        color = xlnt::theme_color(reader.read<std::uint32_t>());
+        break;
+    case xlnt::color_type::rgb:
+    {
+        const auto rgba = reader.read<std::array<std::uint8_t, 4>>();
+        color = xlnt::rgb_color(rgba[0], rgba[1], rgba[2], rgba[3]);
+        break;
+    }
+    default:
+        throw xlnt::invalid_file("unknown color type in snapshot");
+    }
+
+    color.auto_(automatic);
+    color.tint(tint);
+
+    return color;
+}
+
+void write_font(binary_writer &writer, const xlnt::font &font)
+{
+    auto flags = std::uint16_t(0);
+    if (font.has_name()) flags |= font_name;
+    if (font.has_size()) flags |= font_size;
+    if (font.has_color()) flags |= font_color;
+    if (font.has_family()) flags |= font_family;
+    if (font.has_charset()) flags |= font_charset;
+    if (font.has_scheme()) flags |= font_scheme;
+    if (font.bold()) flags |= font_bold;
+    if (font.italic()) flags |= font_italic;
+    if (font.superscript()) flags |= font_superscript;
+    if (font.subscript()) flags |= font_subscript;
+    if (font.strikethrough()) flags |= font_strikethrough;
+    if (font.outline()) flags |= font_outline;
+    if (font.shadow()) flags |= font_shadow;
+
+    writer.write(flags);
+    writer.write(static_cast<std::uint8_t>(font.underline()));
+
+    if (font.has_name()) writer.write(font.name());
+    if (font.has_size()) writer.write(font.size());
+    if (font.has_color()) write_color(writer, font.color());
+    if (font.has_family()) writer.write(static_cast<std::uint32_t>(font.family()));
+    if (font.has_charset()) writer.write(static_cast<std::uint32_t>(font.charset()));
+    if (font.has_scheme()) writer.write(font.scheme());
+}
+
+xlnt::font read_font(binary_reader &reader)
+{
+    const auto flags = reader.read<std::uint16_t>();
+    xlnt::font font;
+
+    font.underline(static_cast<xlnt::font::underline_style>(reader.read<std::uint8_t>()));
+    font.bold((flags & font_bold) != 0);
+    font.italic((flags & font_italic) != 0);
+    font.superscript((flags & font_superscript) != 0);
+    font.subscript((flags & font_subscript) != 0);
+    font.strikethrough((flags & font_strikethrough) != 0);
+    font.outline((flags & font_outline) != 0);
+    font.shadow((flags & font_shadow) != 0);
+
+    if ((flags & font_name) != 0) font.name(reader.read_string());
+    if ((flags & font_size) != 0) font.size(reader.read<double>());
+    if ((flags & font_color) != 0) font.color(read_color(reader));
+    if ((flags & font_family) != 0) font.family(reader.read<std::uint32_t>());
+    if ((flags & font_charset) != 0) font.charset(reader.read<std::uint32_t>());
+    if ((flags & font_scheme) != 0) font.scheme(reader.read_string());
+
+    return font;
+}
+
+void write_rich_text(binary_writer &writer, const xlnt::rich_text &text)
+{
+    const auto runs = text.runs();
+    writer.write(static_cast<std::uint32_t>(runs.size()));
+
+    for (const auto &run : runs)
+    {
+        writer.write(run.first);
+        writer.write(static_cast<std::uint8_t>(run.preserve_space));
+        writer.write(static_cast<std::uint8_t>(run.second.is_set()));
+
+        if (run.second.is_set())
+        {
+            write_font(writer, run.second.get());
+        }
+    }
+}
+
+xlnt::rich_text read_rich_text(binary_reader &reader)
+{
+    xlnt::rich_text text;
+    const auto runs = reader.read<std::uint32_t>();
+
+    for (auto i = std::uint32_t(0); i < runs; ++i)
+    {
+        xlnt::rich_text_run run;
+        run.first = reader.read_string();
+        run.preserve_space = reader.read<std::uint8_t>() != 0;
+
+        if (reader.read<std::uint8_t>() != 0)
+        {
+            run.second = read_font(reader);
+        }
+
+        text.add_run(std::move(run));
+    }
+
+    return text;
+}
+
+// A cell is its column, type, shared formula group, number, flags and text followed
+// by the optional fields given in the flags. The comment and hyperlink of a cell are
+// in the package, but the hyperlink's display text and tooltip are stored here since
+// reading them from the package depends on the cell's value.
+void write_cell(binary_writer &writer, const cell_impl &cell)
+{
+    auto flags = std::uint8_t(0);
+    if (cell.formula_.is_set()) flags |= has_formula;
+    if (cell.format_.is_set()) flags |= has_format;
+    if (cell.hyperlink_.is_set()) flags |= has_hyperlink;
+
+    writer.write(static_cast<std::uint32_t>(cell.column_.index));
+    writer.write(static_cast<std::uint8_t>(cell.type_));
+    writer.write(cell.shared_formula_);
+    writer.write(cell.value_numeric_);
+    writer.write(flags);
+    write_rich_text(writer, cell.value_text_);
+
+    if (cell.formula_.is_set())
+    {
+        writer.write(cell.formula_.get());
+    }
+
+    if (cell.format_.is_set())
+    {
+        writer.write(static_cast<std::uint32_t>(cell.format_.get()->id));
+    }
+
+    if (cell.hyperlink_.is_set())
+    {
+        write_optional(writer, cell.hyperlink_.get().display);
+        write_optional(writer, cell.hyperlink_.get().tooltip);
+    }
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+snapshot_producer::snapshot_producer(const workbook &target)
+    : source_(target)
+{
+}
+
+void snapshot_producer::write(std::vector<std::uint8_t> &destination)
+{
+    binary_writer writer(destination);
+    writer.write(reinterpret_cast<const std::uint8_t *>(magic), sizeof(magic));
+    writer.write(version);
+    writer.write(byte_order);
+
+    // The package is written first so that the ids of formats are final.
+    std::vector<std::uint8_t> package;
+    {
+        vector_ostreambuf buffer(package);
+        std::ostream stream(&buffer);
+        xlsx_producer producer(source_);
+        producer.write_snapshot(stream);
+    }
+
+    writer.write(static_cast<std::uint64_t>(package.size()));
+    writer.write(package.data(), package.size());
+
+    const auto &strings = source_.d_->shared_strings_.values();
+    writer.write(static_cast<std::uint64_t>(strings.size()));
+
+    for (const auto &string : strings)
+    {
+        write_rich_text(writer, string);
+    }
+
+    writer.write(static_cast<std::uint32_t>(source_.d_->worksheets_.size()));
+
+    for (const auto &ws : source_.d_->worksheets_)
+    {
+        writer.write(ws.title_);
+        writer.write(static_cast<std::uint32_t>(ws.shared_formulas_.size()));
+
+        for (const auto &group : ws.shared_formulas_)
+        {
+            writer.write(static_cast<std::uint32_t>(group.anchor.column_index()));
+            writer.write(static_cast<std::uint32_t>(group.anchor.row()));
+            writer.write(group.formula);
+        }
+
+        // the number of rows is filled in once they've been written
+        const auto row_count_at = writer.size();
+        auto rows = std::uint64_t(0);
+        writer.write(rows);
+
+        ws.cell_map_.for_each_row([&writer, &rows](row_t row, const cell_store::row_type &cells) {
+            writer.write(row);
+            writer.write(static_cast<std::uint32_t>(cells.size()));
+
+            for (const auto &cell : cells)
+            {
+                write_cell(writer, cell.second);
+            }
+
+            ++rows;
+        });
+
+        std::memcpy(destination.data() + row_count_at, &rows, sizeof(rows));
+    }
+}
+
+snapshot_consumer::snapshot_consumer(workbook &target)
+    : target_(target)
+{
+}
+
+void snapshot_consumer::read(const std::uint8_t *data, std::size_t size)
+{
+    binary_reader reader(data, size);
+
+    if (size < sizeof(magic) || std::memcmp(reader.skip(sizeof(magic)), magic, sizeof(magic)) != 0)
+    {
+        throw invalid_file("not a workbook snapshot");
+    }
+
+    if (reader.read<std::uint32_t>() != version)
+    {
+        throw unsupported("workbook snapshot version");
+    }
+
+    if (reader.read<std::uint32_t>() != byte_order)
+    {
+        throw unsupported("workbook snapshot from a machine with a different byte order");
+    }
+
+    const auto package_size = reader.read<std::uint64_t>();
+
+    if (package_size > size)
+    {
+        throw invalid_file("unexpected end of data");
+    }
+
+    const auto package = reader.skip(static_cast<std::size_t>(package_size));
+    xlsx_consumer consumer(target_);
+    consumer.read(package, static_cast<std::size_t>(package_size), load_options());
+
+    auto &impl = *target_.d_;
+    const auto string_count = reader.read<std::uint64_t>();
+    shared_string_table strings;
+    strings.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(string_count, reader.remaining())));
+
+    for (auto i = std::uint64_t(0); i < string_count; ++i)
+    {
+        strings.append(read_rich_text(reader));
+    }
+
+    impl.shared_strings_ = std::move(strings);
+
+    // formats are numbered in the order the package lists them
+    std::vector<format_impl *> formats;
+
+    if (impl.stylesheet_.is_set())
+    {
+        auto &format_impls = impl.stylesheet_.get().format_impls;
+        formats.resize(format_impls.size(), nullptr);
+
+        for (auto &format : format_impls)
+        {
+            if (format.id < formats.size())
+            {
+                formats[format.id] = &format;
+            }
+        }
+    }
+
+    const auto budgeted = impl.spill_ != nullptr;
+    const auto sheet_count = reader.read<std::uint32_t>();
+
+    for (auto i = std::uint32_t(0); i < sheet_count; ++i)
+    {
+        const auto title = reader.read_string();
+        const auto match = std::find_if(impl.worksheets_.begin(), impl.worksheets_.end(),
+            [&title](const worksheet_impl &ws) { return ws.title_ == title; });
+
+        if (match == impl.worksheets_.end())
+        {
+            throw invalid_file("workbook snapshot has cells of a missing worksheet");
+        }
+
+        auto &ws = *match;
+        const auto group_count = reader.read<std::uint32_t>();
+        ws.shared_formulas_.clear();
+        ws.shared_formulas_.reserve(std::min<std::size_t>(group_count, reader.remaining()));
+
+        for (auto j = std::uint32_t(0); j < group_count; ++j)
+        {
+            const auto column = reader.read<std::uint32_t>();
+            const auto row = reader.read<std::uint32_t>();
+            ws.shared_formulas_.push_back(shared_formula{cell_reference(column_t(column), row), reader.read_string()});
+        }
+
+        const auto row_count = reader.read<std::uint64_t>();
+
+        for (auto j = std::uint64_t(0); j < row_count; ++j)
+        {
+            const auto row = reader.read<row_t>();
+            const auto cell_count = reader.read<std::uint32_t>();
+            auto cells = &ws.cell_map_.row(row);
+            cells->reserve(cells->size() + std::min<std::size_t>(cell_count, reader.remaining()));
+
+            for (auto k = std::uint32_t(0); k < cell_count; ++k)
+            {
+                // Under a memory budget the row is looked up for every cell, as when
+                // cells are set one at a time, so that the budget is enforced as often.
+                if (budgeted && k != 0)
+                {
+                    cells = &ws.cell_map_.row(row);
+                }
+
+                const auto column = column_t(reader.read<std::uint32_t>());
+                auto match = cells->find(column);
+
+                // cells with a comment or a hyperlink already exist with a placeholder value
+                if (match == cells->end())
+                {
+                    match = cells->emplace(column, cell_impl()).first;
+                    match->second.column_ = column;
+                    match->second.row_ = row;
+                }
+
+                auto &cell = match->second;
+                const auto type = reader.read<std::uint8_t>();
+
+                if (type > static_cast<std::uint8_t>(cell_type::formula_string))
+                {
+                    throw invalid_file("unknown cell type in workbook snapshot");
+                }
+
+                cell.type_ = static_cast<cell_type>(type);
+                cell.shared_formula_ = reader.read<std::uint32_t>();
+
+                if (cell.shared_formula_ > group_count)
+                {
+                    throw invalid_file("unknown shared formula in workbook snapshot");
+                }
+
+                cell.value_numeric_ = reader.read<double>();
+
+                // shared string cells hold the index of their string as their number
+                if (cell.type_ == cell_type::shared_string
+                    && !(cell.value_numeric_ >= 0 && cell.value_numeric_ < static_cast<double>(string_count)
+                        && std::floor(cell.value_numeric_) == cell.value_numeric_))
+                {
+                    throw invalid_file("unknown shared string in workbook snapshot");
+                }
+
+                const auto flags = reader.read<std::uint8_t>();
+                cell.value_text_ = read_rich_text(reader);
+                cell.formula_.clear();
+
+                if ((flags & has_formula) != 0)
+                {
+                    cell.formula_ = reader.read_string();
+                }
+
+                if ((flags & has_format) != 0)
+                {
+                    const auto id = reader.read<std::uint32_t>();
+
+                    if (id >= formats.size() || formats[id] == nullptr)
+                    {
+                        throw invalid_file("unknown format in workbook snapshot");
+                    }
+
+                    cell.format_ = formats[id];
+                    ++formats[id]->references;
+                }
+
+                if ((flags & has_hyperlink) != 0)
+                {
+                    auto display = read_optional(reader);
+                    auto tooltip = read_optional(reader);
+
+                    if (cell.hyperlink_.is_set())
+                    {
+                        cell.hyperlink_.get().display = std::move(display);
+                        cell.hyperlink_.get().tooltip = std::move(tooltip);
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,78 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace xlnt {
+
+class workbook;
+
+namespace detail {
+
+/// <summary>
+/// Writes a snapshot of a workbook: a header, an uncompressed package holding
+/// everything but the cell values and shared strings, then the shared strings and
+/// the cells of each worksheet in a binary form that is read without parsing.
+/// Numbers are stored in the byte order of the machine which wrote the snapshot
+/// since a snapshot is meant to be a local cache, not a file to exchange.
+/// </summary>
+class snapshot_producer
+{
+public:
+    explicit snapshot_producer(const workbook &target);
+
+    /// <summary>
+    /// Appends the snapshot to destination.
+    /// </summary>
+    void write(std::vector<std::uint8_t> &destination);
+
+private:
+    const workbook &source_;
+};
+
+/// <summary>
+/// Reads a snapshot written by snapshot_producer into a new workbook.
+/// </summary>
+class snapshot_consumer
+{
+public:
+    explicit snapshot_consumer(workbook &target);
+
+    /// <summary>
+    /// Reads the snapshot in the given bytes, which must stay valid until this returns.
+    /// Throws invalid_file if they aren't a snapshot or are truncated and unsupported
+    /// if the snapshot was written by an incompatible version or on a machine with
+    /// a different byte order.
+    /// </summary>
+    void read(const std::uint8_t *data, std::size_t size);
+
+private:
+    workbook &target_;
+};
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,108 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <xlnt/packaging/manifest.hpp>
+#include <xlnt/packaging/relationship.hpp>
+#include <detail/implementations/workbook_impl.hpp>
+#include <detail/serialization/mapped_file.hpp>
+#include <detail/serialization/source_package.hpp>
+#include <detail/serialization/zstream.hpp>
+
+namespace xlnt {
+namespace detail {
+
+source_package::source_package(std::unique_ptr<mapped_file> mapping)
+    : mapping_(std::move(mapping)),
+      archive_(new izstream(mapping_->data(), mapping_->size()))
+{
+}
+
+source_package::source_package(std::vector<std::uint8_t> &&bytes)
+    : bytes_(std::move(bytes)),
+      archive_(new izstream(bytes_.data(), bytes_.size()))
+{
+}
+
+source_package::~source_package()
+{
+}
+
+const std::uint8_t *source_package::data() const
+{
+    return mapping_ ? mapping_->data() : bytes_.data();
+}
+
+std::size_t source_package::size() const
+{
+    return mapping_ ? mapping_->size() : bytes_.size();
+}
+
+bool source_package::styles_unchanged(const workbook_impl &wb) const
+{
+    return stylesheet_ == wb.stylesheet_ && view_ == wb.view_;
+}
+
+void source_package::unmap()
+{
+    if (!mapping_) return;
+
+    bytes_.assign(mapping_->data(), mapping_->data() + mapping_->size());
+    archive_.reset(new izstream(bytes_.data(), bytes_.size()));
+    mapping_.reset();
+}
+
+void attach_source(workbook_impl &loaded, std::shared_ptr<source_package> source)
+{
+    source->stylesheet_ = loaded.stylesheet_;
+    source->view_ = loaded.view_;
+    source->shared_strings_ = loaded.shared_strings_.size();
+
+    const auto &manifest = loaded.manifest_;
+    const auto workbook_rel = manifest.relationship(path("/"), relationship_type::office_document);
+    const auto workbook_part = workbook_rel.target().path();
+
+    for (auto &ws : loaded.worksheets_)
+    {
+        const auto rel_id = loaded.sheet_title_rel_id_map_.find(ws.title_);
+
+        if (rel_id == loaded.sheet_title_rel_id_map_.end()
+            || !manifest.has_relationship(workbook_part, rel_id->second))
+        {
+            continue;
+        }
+
+        // the same path the producer writes the worksheet to
+        const auto sheet_rel = manifest.relationship(workbook_part, rel_id->second);
+        const auto sheet_part = sheet_rel.source().path().parent().append(sheet_rel.target().path());
+
+        if (source->archive_->has_file(sheet_part))
+        {
+            ws.source_part_ = sheet_part;
+        }
+    }
+
+    loaded.source_ = std::move(source);
+}
+
+} // namespace detail
+} // namespace xlnt
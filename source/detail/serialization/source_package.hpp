@@ -0,0 +1,100 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <xlnt/utils/optional.hpp>
+#include <xlnt/workbook/workbook_view.hpp>
+#include <detail/implementations/stylesheet.hpp>
+
+namespace xlnt {
+namespace detail {
+
+class izstream;
+class mapped_file;
+struct workbook_impl;
+
+/// <summary>
+/// The package a workbook was loaded from, kept when load_options::keep_source is set
+/// so that parts which haven't changed since can be copied into the saved package
+/// as they are, still compressed, instead of being written and deflated again.
+/// </summary>
+struct source_package
+{
+    /// <summary>
+    /// Keeps a package which has been mapped into memory.
+    /// </summary>
+    explicit source_package(std::unique_ptr<mapped_file> mapping);
+
+    /// <summary>
+    /// Keeps a package held in a vector.
+    /// </summary>
+    explicit source_package(std::vector<std::uint8_t> &&bytes);
+
+    ~source_package();
+
+    /// <summary>
+    /// Returns the first byte of the package.
+    /// </summary>
+    const std::uint8_t *data() const;
+
+    /// <summary>
+    /// Returns the size of the package in bytes.
+    /// </summary>
+    std::size_t size() const;
+
+    /// <summary>
+    /// Returns true if the stylesheet and workbook view of wb are still as they were
+    /// when it was loaded, so the format indices and selected tabs in its unchanged
+    /// worksheets are still correct.
+    /// </summary>
+    bool styles_unchanged(const workbook_impl &wb) const;
+
+    /// <summary>
+    /// Reads the package into memory and releases the mapping, if it is mapped, so
+    /// that the file it was mapped from can be replaced.
+    /// </summary>
+    void unmap();
+
+    std::unique_ptr<mapped_file> mapping_;
+    std::vector<std::uint8_t> bytes_;
+    std::unique_ptr<izstream> archive_;
+
+    optional<stylesheet> stylesheet_;
+    optional<workbook_view> view_;
+    std::size_t shared_strings_ = 0;
+};
+
+/// <summary>
+/// Attaches source to loaded, which was just read from it, and records the state of
+/// loaded which unchanged worksheets rely on. Each worksheet is marked as unchanged
+/// since it was read from its part.
+/// </summary>
+void attach_source(workbook_impl &loaded, std::shared_ptr<source_package> source);
+
+} // namespace detail
+} // namespace xlnt
@@ -21,6 +21,8 @@
 // @license: http://www.opensource.org/licenses/mit-license.php
 // @author: see AUTHORS file
 
+#include <algorithm>
+
 #include <detail/serialization/vector_streambuf.hpp>
 #include <xlnt/utils/exceptions.hpp>
 
@@ -28,96 +30,81 @@ namespace xlnt {
 namespace detail {
 
 vector_istreambuf::vector_istreambuf(const std::vector<std::uint8_t> &data)
-    : data_(data),
-        position_(0)
+    : vector_istreambuf(data.data(), data.size())
 {
 }
 
-vector_istreambuf::int_type vector_istreambuf::underflow()
+vector_istreambuf::vector_istreambuf(const std::uint8_t *data, std::size_t size)
 {
-    if (position_ == data_.size())
-    {
-        return traits_type::eof();
-    }
-
-    return traits_type::to_int_type(static_cast<char>(data_[position_]));
+    // the buffer is never written through these pointers
+    auto begin = const_cast<char *>(reinterpret_cast<const char *>(data));
+    setg(begin, begin, begin + size);
 }
 
-vector_istreambuf::int_type vector_istreambuf::uflow()
+vector_istreambuf::int_type vector_istreambuf::underflow()
 {
-    if (position_ == data_.size())
+    if (gptr() == egptr())
     {
         return traits_type::eof();
     }
 
-    return traits_type::to_int_type(static_cast<char>(data_[position_++]));
+    return traits_type::to_int_type(*gptr());
 }
 
 std::streamsize vector_istreambuf::showmanyc()
 {
-    if (position_ == data_.size())
+    if (gptr() == egptr())
     {
         return static_cast<std::streamsize>(-1);
     }
 
-    return static_cast<std::streamsize>(data_.size() - position_);
+    return static_cast<std::streamsize>(egptr() - gptr());
 }
 
 std::streampos vector_istreambuf::seekoff(std::streamoff off, std::ios_base::seekdir way, std::ios_base::openmode)
 {
+    const auto size = static_cast<std::streamoff>(egptr() - eback());
+    auto position = static_cast<std::streamoff>(gptr() - eback());
+
     if (way == std::ios_base::beg)
     {
-        position_ = 0;
+        position = 0;
     }
     else if (way == std::ios_base::end)
     {
-        position_ = data_.size();
+        position = size;
     }
 
-    if (off < 0)
+    position += off;
+
+    if (position < 0 || position > size)
     {
-        if (static_cast<std::size_t>(-off) > position_)
-        {
-            position_ = 0;
-            return static_cast<std::ptrdiff_t>(-1);
-        }
-        else
-        {
-            position_ -= static_cast<std::size_t>(-off);
-        }
-    }
-    else if (off > 0)
-    {
-        if (static_cast<std::size_t>(off) + position_ > data_.size())
-        {
-            position_ = data_.size();
-            return static_cast<std::ptrdiff_t>(-1);
-        }
-        else
-        {
-            position_ += static_cast<std::size_t>(off);
-        }
+        setg(eback(), position < 0 ? eback() : egptr(), egptr());
+        return static_cast<std::ptrdiff_t>(-1);
     }
 
-    return static_cast<std::ptrdiff_t>(position_);
+    setg(eback(), eback() + position, egptr());
+
+    return static_cast<std::ptrdiff_t>(position);
 }
 
 std::streampos vector_istreambuf::seekpos(std::streampos sp, std::ios_base::openmode)
 {
-    if (sp < 0)
-    {
-        position_ = 0;
-    }
-    else if (static_cast<std::size_t>(sp) > data_.size())
+    const auto size = static_cast<std::streamoff>(egptr() - eback());
+    auto position = static_cast<std::streamoff>(sp);
+
+    if (position < 0)
     {
-        position_ = data_.size();
+        position = 0;
     }
-    else
+    else if (position > size)
     {
-        position_ = static_cast<std::size_t>(sp);
+        position = size;
     }
-        
-    return static_cast<std::ptrdiff_t>(position_);
+
+    setg(eback(), eback() + position, egptr());
+
+    return static_cast<std::ptrdiff_t>(position);
 }
 
 vector_ostreambuf::vector_ostreambuf(std::vector<std::uint8_t> &data)
@@ -220,9 +207,22 @@ XLNT_API std::vector<std::uint8_t> to_vector(std::istream &in_stream)
         throw xlnt::exception("bad stream");
     }
 
-    return std::vector<std::uint8_t>(
-        std::istreambuf_iterator<char>(in_stream),
-        std::istreambuf_iterator<char>());
+    // read in blocks rather than a character at a time through istreambuf_iterator
+    std::vector<std::uint8_t> bytes;
+    auto size = std::size_t(0);
+    auto count = std::streamsize(0);
+
+    do
+    {
+        size += static_cast<std::size_t>(count);
+        bytes.resize(std::max(size + 64 * 1024, bytes.size()));
+        count = in_stream.rdbuf()->sgetn(reinterpret_cast<char *>(bytes.data() + size),
+            static_cast<std::streamsize>(bytes.size() - size));
+    } while (count > 0);
+
+    bytes.resize(size);
+
+    return bytes;
 }
 
 XLNT_API void to_stream(const std::vector<std::uint8_t> &bytes, std::ostream &out_stream)
@@ -33,7 +33,9 @@ namespace xlnt {
 namespace detail {
 
 /// <summary>
-/// Allows a std::vector to be read through a std::istream.
+/// Allows a std::vector, or any other bytes held in memory such as a mapped file,
+/// to be read through a std::istream. The whole buffer is the get area so reads
+/// are copied straight out of it.
 /// </summary>
 class XLNT_API vector_istreambuf : public std::streambuf
 {
@@ -42,23 +44,19 @@ class XLNT_API vector_istreambuf : public std::streambuf
 public:
     vector_istreambuf(const std::vector<std::uint8_t> &data);
 
+    vector_istreambuf(const std::uint8_t *data, std::size_t size);
+
     vector_istreambuf(const vector_istreambuf &) = delete;
     vector_istreambuf &operator=(const vector_istreambuf &) = delete;
 
 private:
     int_type underflow();
 
-    int_type uflow();
-
     std::streamsize showmanyc();
 
     std::streampos seekoff(std::streamoff off, std::ios_base::seekdir way, std::ios_base::openmode);
 
     std::streampos seekpos(std::streampos sp, std::ios_base::openmode);
-
-private:
-    const std::vector<std::uint8_t> &data_;
-    std::size_t position_;
 };
 
 /// <summary>
@@ -24,6 +24,7 @@
 #include <cctype>
 #include <numeric> // for std::accumulate
 #include <sstream>
+#include <thread>
 #include <unordered_map>
 
 #include <xlnt/cell/cell.hpp>
@@ -32,6 +33,7 @@
 #include <xlnt/packaging/manifest.hpp>
 #include <xlnt/utils/optional.hpp>
 #include <xlnt/utils/path.hpp>
+#include <xlnt/workbook/serialization_options.hpp>
 #include <xlnt/workbook/workbook.hpp>
 #include <xlnt/worksheet/selection.hpp>
 #include <xlnt/worksheet/worksheet.hpp>
@@ -39,8 +41,12 @@
 #include <detail/header_footer/header_footer_code.hpp>
 #include <detail/implementations/workbook_impl.hpp>
 #include <detail/serialization/custom_value_traits.hpp>
+#include <detail/serialization/pipeline.hpp>
+#include <detail/serialization/sheet_data_chunks.hpp>
+#include <detail/serialization/source_package.hpp>
 #include <detail/serialization/vector_streambuf.hpp>
 #include <detail/serialization/xlsx_consumer.hpp>
+#include <detail/serialization/xml_vocabulary.hpp>
 #include <detail/serialization/zstream.hpp>
 
 namespace std {
@@ -62,21 +68,6 @@ struct hash<xml::qname>
 
 namespace {
 
-xml::qname &qn(const std::string &namespace_, const std::string &name)
-{
-    using qname_map = std::unordered_map<std::string, xml::qname>;
-    static auto &memo = *new std::unordered_map<std::string, qname_map>();
-
-    auto &ns_memo = memo[namespace_];
-
-    if (ns_memo.find(name) == ns_memo.end())
-    {
-        return ns_memo.emplace(name, xml::qname(xlnt::constants::ns(namespace_), name)).first->second;
-    }
-
-    return ns_memo[name];
-}
-
 #ifdef THROW_ON_INVALID_XML
 #define unexpected_element(element) throw xlnt::exception(element.string());
 #else
@@ -106,24 +97,11 @@ bool is_true(const std::string &bool_string)
 #endif
 }
 
-struct number_converter
-{
-    number_converter()
-    {
-        stream.imbue(std::locale("C"));
-    }
-
-    double stold(const std::string &s)
-    {
-        stream.str(s);
-        stream.clear();
-        stream >> result;
-        return result;
-    }
-
-    std::istringstream stream;
-    double result;
-};
+/// <summary>
+/// Worksheet parts smaller than this are parsed on the loading thread even if
+/// load_options::parse_threads asks for more.
+/// </summary>
+const std::size_t parallel_parse_min_size = 1024 * 1024;
 
 using style_id_pair = std::pair<xlnt::detail::style_impl, std::size_t>;
 
@@ -164,6 +142,25 @@ private:
 namespace xlnt {
 namespace detail {
 
+struct number_converter
+{
+    number_converter()
+    {
+        stream.imbue(std::locale("C"));
+    }
+
+    double stold(const std::string &s)
+    {
+        stream.str(s);
+        stream.clear();
+        stream >> result;
+        return result;
+    }
+
+    std::istringstream stream;
+    double result;
+};
+
 xlsx_consumer::xlsx_consumer(workbook &target)
     : target_(target),
       parser_(nullptr)
@@ -176,8 +173,42 @@ xlsx_consumer::~xlsx_consumer()
 
 void xlsx_consumer::read(std::istream &source)
 {
+    read(source, load_options());
+}
+
+void xlsx_consumer::read(std::istream &source, const load_options &options)
+{
+    instrumentation_.start(options.statistics);
     archive_.reset(new izstream(source));
+    read_archive(options);
+}
+
+void xlsx_consumer::read(const std::uint8_t *data, std::size_t size, const load_options &options)
+{
+    instrumentation_.start(options.statistics);
+    archive_.reset(new izstream(data, size));
+    read_archive(options);
+}
+
+void xlsx_consumer::read(std::shared_ptr<source_package> source, const load_options &options)
+{
+    read(source->data(), source->size(), options);
+    attach_source(*target_.d_, std::move(source));
+}
+
+void xlsx_consumer::read_archive(const load_options &options)
+{
+    archive_->instrument(&instrumentation_);
+    archive_->monitor(&progress_);
+    pipeline_ = options.pipeline;
+    parse_threads_ = options.parse_threads == 0
+        ? std::max(std::thread::hardware_concurrency(), 1u)
+        : options.parse_threads;
+    progress_.start(options.progress, options.progress_interval, options.cancellation,
+        archive_->uncompressed_size());
     populate_workbook(false);
+    progress_.finish();
+    instrumentation_.finish();
 }
 
 void xlsx_consumer::open(std::istream &source)
@@ -195,9 +226,9 @@ cell xlsx_consumer::read_cell()
 
     auto ws = worksheet(current_worksheet_);
 
-    if (in_element(qn("spreadsheetml", "sheetData")))
+    if (in_element(xml_token::spreadsheetml_sheetData))
     {
-        expect_start_element(qn("spreadsheetml", "row"), xml::content::complex); // CT_Row
+        expect_start_element(xml_token::spreadsheetml_row, xml::content::complex); // CT_Row
         auto row_index = static_cast<row_t>(std::stoul(parser().attribute("r")));
         auto &row_properties = ws.row_properties(row_index);
 
@@ -216,9 +247,9 @@ cell xlsx_consumer::read_cell()
             row_properties.hidden = true;
         }
 
-        if (parser().attribute_present(qn("x14ac", "dyDescent")))
+        if (parser().attribute_present(qn(xml_token::x14ac_dyDescent)))
         {
-            row_properties.dy_descent = parser().attribute<double>(qn("x14ac", "dyDescent"));
+            row_properties.dy_descent = parser().attribute<double>(qn(xml_token::x14ac_dyDescent));
         }
 
         skip_attributes({"customFormat", "s", "customFont",
@@ -226,20 +257,26 @@ cell xlsx_consumer::read_cell()
             "ph", "spans"});
     }
 
-    if (!in_element(qn("spreadsheetml", "row")))
+    if (!in_element(xml_token::spreadsheetml_row))
     {
         return cell(nullptr);
     }
 
-    expect_start_element(qn("spreadsheetml", "c"), xml::content::complex);
+    expect_start_element(xml_token::spreadsheetml_c, xml::content::complex);
+
+    if (streaming_)
+    {
+        current_worksheet_->cell_map_.handed_out(*streaming_cell_, current_worksheet_);
+    }
 
     auto cell = streaming_
         ? xlnt::cell(streaming_cell_.get())
         : ws.cell(cell_reference(parser().attribute("r")));
     auto reference = cell_reference(parser().attribute("r"));
-    cell.d_->parent_ = current_worksheet_;
     cell.d_->column_ = reference.column_index();
     cell.d_->row_ = reference.row();
+    cell.d_->formula_.clear();
+    cell.d_->shared_formula_ = 0;
 
     auto has_type = parser().attribute_present("t");
     auto type = has_type ? parser().attribute("t") : "n";
@@ -254,19 +291,21 @@ cell xlsx_consumer::read_cell()
 
     auto has_formula = false;
     auto has_shared_formula = false;
+    auto shared_formula_index = std::string();
     auto formula_value_string = std::string();
 
-    while (in_element(qn("spreadsheetml", "c")))
+    while (in_element(xml_token::spreadsheetml_c))
     {
         auto current_element = expect_start_element(xml::content::mixed);
 
-        if (current_element == qn("spreadsheetml", "v")) // s:ST_Xstring
+        switch (tokens_.back())
         {
+        case xml_token::spreadsheetml_v: // s:ST_Xstring
             has_value = true;
             value_string = read_text();
-        }
-        else if (current_element == qn("spreadsheetml", "f")) // CT_CellFormula
-        {
+            break;
+
+        case xml_token::spreadsheetml_f: // CT_CellFormula
             has_formula = true;
 
             if (parser().attribute_present("t"))
@@ -274,28 +313,38 @@ cell xlsx_consumer::read_cell()
                 has_shared_formula = parser().attribute("t") == "shared";
             }
 
+            if (has_shared_formula && parser().attribute_present("si"))
+            {
+                shared_formula_index = parser().attribute("si");
+            }
+
             skip_attributes({"aca", "ref", "dt2D", "dtr", "del1",
                 "del2", "r1", "r2", "ca", "si", "bx"});
 
             formula_value_string = read_text();
-        }
-        else if (current_element == qn("spreadsheetml", "is")) // CT_Rst
-        {
-            expect_start_element(qn("spreadsheetml", "t"), xml::content::simple);
+            break;
+
+        case xml_token::spreadsheetml_is: // CT_Rst
+            expect_start_element(xml_token::spreadsheetml_t, xml::content::simple);
             value_string = read_text();
-            expect_end_element(qn("spreadsheetml", "t"));
-        }
-        else
-        {
+            expect_end_element(xml_token::spreadsheetml_t);
+            break;
+
+        default:
             unexpected_element(current_element);
+            break;
         }
 
         expect_end_element(current_element);
     }
 
-    expect_end_element(qn("spreadsheetml", "c"));
+    expect_end_element(xml_token::spreadsheetml_c);
 
-    if (has_formula && !has_shared_formula)
+    if (has_formula && has_shared_formula)
+    {
+        read_shared_formula(*cell.d_, shared_formula_index, formula_value_string);
+    }
+    else if (has_formula)
     {
         cell.formula(formula_value_string);
     }
@@ -333,13 +382,13 @@ cell xlsx_consumer::read_cell()
         }
     }
 
-    if (!in_element(qn("spreadsheetml", "row")))
+    if (!in_element(xml_token::spreadsheetml_row))
     {
-        expect_end_element(qn("spreadsheetml", "row"));
+        expect_end_element(xml_token::spreadsheetml_row);
 
-        if (!in_element(qn("spreadsheetml", "sheetData")))
+        if (!in_element(xml_token::spreadsheetml_sheetData))
         {
-            expect_end_element(qn("spreadsheetml", "sheetData"));
+            expect_end_element(xml_token::spreadsheetml_sheetData);
         }
     }
 
@@ -371,15 +420,16 @@ std::string xlsx_consumer::read_worksheet_begin(const std::string &rel_id)
         })->first;
 
     auto ws = worksheet(current_worksheet_);
+    shared_formula_groups_.clear();
 
-    expect_start_element(qn("spreadsheetml", "worksheet"), xml::content::complex); // CT_Worksheet
-    skip_attributes({qn("mc", "Ignorable")});
+    expect_start_element(xml_token::spreadsheetml_worksheet, xml::content::complex); // CT_Worksheet
+    skip_attributes({qn(xml_token::mc_Ignorable)});
 
-    while (in_element(qn("spreadsheetml", "worksheet")))
+    while (in_element(xml_token::spreadsheetml_worksheet))
     {
         auto current_worksheet_element = expect_start_element(xml::content::complex);
 
-        if (current_worksheet_element == qn("spreadsheetml", "sheetPr")) // CT_SheetPr 0-1
+        if (current_worksheet_element == qn(xml_token::spreadsheetml_sheetPr)) // CT_SheetPr 0-1
         {
             sheet_pr props;
             if (parser().attribute_present("syncHorizontal"))
@@ -423,18 +473,18 @@ std::string xlsx_consumer::read_worksheet_begin(const std::string &rel_id)
             {
                 auto sheet_pr_child_element = expect_start_element(xml::content::simple);
 
-                if (sheet_pr_child_element == qn("spreadsheetml", "tabColor")) // CT_Color 0-1
+                if (sheet_pr_child_element == qn(xml_token::spreadsheetml_tabColor)) // CT_Color 0-1
                 {
                     read_color();
                 }
-                else if (sheet_pr_child_element == qn("spreadsheetml", "outlinePr")) // CT_OutlinePr 0-1
+                else if (sheet_pr_child_element == qn(xml_token::spreadsheetml_outlinePr)) // CT_OutlinePr 0-1
                 {
                     skip_attribute("applyStyles"); // optional, boolean, false
                     skip_attribute("summaryBelow"); // optional, boolean, true
                     skip_attribute("summaryRight"); // optional, boolean, true
                     skip_attribute("showOutlineSymbols"); // optional, boolean, true
                 }
-                else if (sheet_pr_child_element == qn("spreadsheetml", "pageSetUpPr")) // CT_PageSetUpPr 0-1
+                else if (sheet_pr_child_element == qn(xml_token::spreadsheetml_pageSetUpPr)) // CT_PageSetUpPr 0-1
                 {
                     skip_attribute("autoPageBreaks"); // optional, boolean, true
                     skip_attribute("fitToPage"); // optional, boolean, false
@@ -447,15 +497,15 @@ std::string xlsx_consumer::read_worksheet_begin(const std::string &rel_id)
                 expect_end_element(sheet_pr_child_element);
             }
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "dimension")) // CT_SheetDimension 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_dimension)) // CT_SheetDimension 0-1
         {
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "sheetViews")) // CT_SheetViews 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_sheetViews)) // CT_SheetViews 0-1
         {
             while (in_element(current_worksheet_element))
             {
-                expect_start_element(qn("spreadsheetml", "sheetView"), xml::content::complex); // CT_SheetView 1+
+                expect_start_element(xml_token::spreadsheetml_sheetView, xml::content::complex); // CT_SheetView 1+
 
                 sheet_view new_view;
                 new_view.id(parser().attribute<std::size_t>("workbookViewId"));
@@ -492,11 +542,11 @@ std::string xlsx_consumer::read_worksheet_begin(const std::string &rel_id)
                     "view", "topLeftCell", "colorId", "zoomScale", "zoomScaleNormal", "zoomScaleSheetLayoutView",
                     "zoomScalePageLayoutView"});
 
-                while (in_element(qn("spreadsheetml", "sheetView")))
+                while (in_element(xml_token::spreadsheetml_sheetView))
                 {
                     auto sheet_view_child_element = expect_start_element(xml::content::simple);
 
-                    if (sheet_view_child_element == qn("spreadsheetml", "pane")) // CT_Pane 0-1
+                    if (sheet_view_child_element == qn(xml_token::spreadsheetml_pane)) // CT_Pane 0-1
                     {
                         pane new_pane;
 
@@ -527,7 +577,7 @@ std::string xlsx_consumer::read_worksheet_begin(const std::string &rel_id)
 
                         new_view.pane(new_pane);
                     }
-                    else if (sheet_view_child_element == qn("spreadsheetml", "selection")) // CT_Selection 0-4
+                    else if (sheet_view_child_element == qn(xml_token::spreadsheetml_selection)) // CT_Selection 0-4
                     {
                         selection current_selection;
 
@@ -548,11 +598,11 @@ std::string xlsx_consumer::read_worksheet_begin(const std::string &rel_id)
 
                         skip_remaining_content(sheet_view_child_element);
                     }
-                    else if (sheet_view_child_element == qn("spreadsheetml", "pivotSelection")) // CT_PivotSelection 0-4
+                    else if (sheet_view_child_element == qn(xml_token::spreadsheetml_pivotSelection)) // CT_PivotSelection 0-4
                     {
                         skip_remaining_content(sheet_view_child_element);
                     }
-                    else if (sheet_view_child_element == qn("spreadsheetml", "extLst")) // CT_ExtensionList 0-1
+                    else if (sheet_view_child_element == qn(xml_token::spreadsheetml_extLst)) // CT_ExtensionList 0-1
                     {
                         skip_remaining_content(sheet_view_child_element);
                     }
@@ -564,12 +614,12 @@ std::string xlsx_consumer::read_worksheet_begin(const std::string &rel_id)
                     expect_end_element(sheet_view_child_element);
                 }
 
-                expect_end_element(qn("spreadsheetml", "sheetView"));
+                expect_end_element(xml_token::spreadsheetml_sheetView);
 
                 ws.d_->views_.push_back(new_view);
             }
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "sheetFormatPr")) // CT_SheetFormatPr 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_sheetFormatPr)) // CT_SheetFormatPr 0-1
         {
             if (parser().attribute_present("baseColWidth"))
             {
@@ -587,19 +637,19 @@ std::string xlsx_consumer::read_worksheet_begin(const std::string &rel_id)
                     parser().attribute<double>("defaultRowHeight");
             }
 
-            if (parser().attribute_present(qn("x14ac", "dyDescent")))
+            if (parser().attribute_present(qn(xml_token::x14ac_dyDescent)))
             {
                 ws.d_->format_properties_.dy_descent =
-                    parser().attribute<double>(qn("x14ac", "dyDescent"));
+                    parser().attribute<double>(qn(xml_token::x14ac_dyDescent));
             }
 
             skip_attributes();
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "cols")) // CT_Cols 0+
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_cols)) // CT_Cols 0+
         {
-            while (in_element(qn("spreadsheetml", "cols")))
+            while (in_element(xml_token::spreadsheetml_cols))
             {
-                expect_start_element(qn("spreadsheetml", "col"), xml::content::simple);
+                expect_start_element(xml_token::spreadsheetml_col, xml::content::simple);
 
                 skip_attributes(std::vector<std::string>{"collapsed", "outlineLevel"});
 
@@ -633,7 +683,7 @@ std::string xlsx_consumer::read_worksheet_begin(const std::string &rel_id)
                     ? is_true(parser().attribute("bestFit"))
                     : false;
 
-                expect_end_element(qn("spreadsheetml", "col"));
+                expect_end_element(xml_token::spreadsheetml_col);
 
                 for (auto column = min; column <= max; column++)
                 {
@@ -656,7 +706,7 @@ std::string xlsx_consumer::read_worksheet_begin(const std::string &rel_id)
                 }
             }
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "sheetData")) // CT_SheetData 1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_sheetData)) // CT_SheetData 1
         {
             return title;
         }
@@ -669,154 +719,306 @@ std::string xlsx_consumer::read_worksheet_begin(const std::string &rel_id)
 
 void xlsx_consumer::read_worksheet_sheetdata()
 {
-    auto ws = worksheet(current_worksheet_);
-
-    if (stack_.back() != qn("spreadsheetml", "sheetData"))
+    if (tokens_.back() != xml_token::spreadsheetml_sheetData)
     {
         return;
     }
 
+    if (sheet_data_ != nullptr)
+    {
+        read_sheet_data_chunks();
+    }
+
     number_converter converter;
+    sheet_row row;
 
-    while (in_element(qn("spreadsheetml", "sheetData")))
+    while (in_element(xml_token::spreadsheetml_sheetData))
     {
-        expect_start_element(qn("spreadsheetml", "row"), xml::content::complex); // CT_Row
-        auto row_index = parser().attribute<row_t>("r");
-        auto &row_properties = ws.row_properties(row_index);
+        read_row(row, converter);
+        add_row(row);
+    }
 
-        if (parser().attribute_present("ht"))
+    expect_end_element(xml_token::spreadsheetml_sheetData);
+}
+
+void xlsx_consumer::read_row(sheet_row &row, number_converter &converter)
+{
+    expect_start_element(xml_token::spreadsheetml_row, xml::content::complex); // CT_Row
+    row.index = parser().attribute<row_t>("r");
+    row.properties = row_properties();
+    row.cells.clear();
+
+    auto &row_properties = row.properties;
+
+    if (parser().attribute_present("ht"))
+    {
+        row_properties.height = parser().attribute<double>("ht");
+    }
+
+    if (parser().attribute_present("customHeight"))
+    {
+        row_properties.custom_height = is_true(parser().attribute("customHeight"));
+    }
+
+    if (parser().attribute_present("hidden") && is_true(parser().attribute("hidden")))
+    {
+        row_properties.hidden = true;
+    }
+
+    if (parser().attribute_present(qn(xml_token::x14ac_dyDescent)))
+    {
+        row_properties.dy_descent = parser().attribute<double>(qn(xml_token::x14ac_dyDescent));
+    }
+
+    if (parser().attribute_present("s"))
+    {
+        row_properties.style.set(static_cast<std::size_t>(std::stoull(parser().attribute("s"))));
+    }
+    if (parser().attribute_present("customFormat"))
+    {
+        row_properties.custom_format.set(parser().attribute<bool>("customFormat"));
+    }
+
+    skip_attributes({"customFont",
+        "outlineLevel", "collapsed", "thickTop", "thickBot",
+        "ph", "spans"});
+
+    while (in_element(xml_token::spreadsheetml_row))
+    {
+        expect_start_element(xml_token::spreadsheetml_c, xml::content::complex);
+        row.cells.emplace_back();
+        auto &cell = row.cells.back();
+        cell.reference = cell_reference(parser().attribute("r"));
+
+        auto has_type = parser().attribute_present("t");
+        cell.type = has_type ? parser().attribute("t") : "n";
+
+        if (parser().attribute_present("s"))
         {
-            row_properties.height = parser().attribute<double>("ht");
+            cell.has_format = true;
+            cell.format = static_cast<std::size_t>(std::stoull(parser().attribute("s")));
         }
 
-        if (parser().attribute_present("customHeight"))
+        while (in_element(xml_token::spreadsheetml_c))
         {
-            row_properties.custom_height = is_true(parser().attribute("customHeight"));
+            auto current_element = expect_start_element(xml::content::mixed);
+
+            switch (tokens_.back())
+            {
+            case xml_token::spreadsheetml_v: // s:ST_Xstring
+                cell.has_value = true;
+                cell.value = read_text();
+                break;
+
+            case xml_token::spreadsheetml_f: // CT_CellFormula
+                cell.has_formula = true;
+
+                if (parser().attribute_present("t"))
+                {
+                    cell.has_shared_formula = parser().attribute("t") == "shared";
+                }
+
+                if (cell.has_shared_formula && parser().attribute_present("si"))
+                {
+                    cell.shared_formula_index = parser().attribute("si");
+                }
+
+                skip_attributes(
+                    {"aca", "ref", "dt2D", "dtr", "del1", "del2", "r1", "r2", "ca", "si", "bx"});
+
+                cell.formula = read_text();
+                break;
+
+            case xml_token::spreadsheetml_is: // CT_Rst
+                expect_start_element(xml_token::spreadsheetml_t, xml::content::simple);
+                cell.value = read_text();
+                expect_end_element(xml_token::spreadsheetml_t);
+                break;
+
+            default:
+                unexpected_element(current_element);
+                break;
+            }
+
+            expect_end_element(current_element);
         }
 
-        if (parser().attribute_present("hidden") && is_true(parser().attribute("hidden")))
+        expect_end_element(xml_token::spreadsheetml_c);
+
+        if (cell.has_value && (cell.type == "s" || cell.type == "n"))
         {
-            row_properties.hidden = true;
+            cell.number = converter.stold(cell.value);
         }
+    }
+
+    expect_end_element(xml_token::spreadsheetml_row);
+}
+
+void xlsx_consumer::add_row(sheet_row &row)
+{
+    auto ws = worksheet(current_worksheet_);
+    auto &row_properties = ws.row_properties(row.index);
+    instrumentation_.count_row();
+    progress_.row();
+
+    const auto &read_properties = row.properties;
+
+    if (read_properties.height.is_set())
+    {
+        row_properties.height = read_properties.height;
+    }
+
+    row_properties.custom_height = row_properties.custom_height || read_properties.custom_height;
+    row_properties.hidden = row_properties.hidden || read_properties.hidden;
+
+    if (read_properties.dy_descent.is_set())
+    {
+        row_properties.dy_descent = read_properties.dy_descent;
+    }
+
+    if (read_properties.style.is_set())
+    {
+        row_properties.style = read_properties.style;
+    }
+
+    if (read_properties.custom_format.is_set())
+    {
+        row_properties.custom_format = read_properties.custom_format;
+    }
+
+    for (auto &read_cell : row.cells)
+    {
+        auto cell = ws.cell(read_cell.reference);
+        instrumentation_.count_cell();
 
-        if (parser().attribute_present(qn("x14ac", "dyDescent")))
+        if (read_cell.has_format)
         {
-            row_properties.dy_descent = parser().attribute<double>(qn("x14ac", "dyDescent"));
+            cell.format(target_.format(read_cell.format));
         }
 
-        if (parser().attribute_present("s"))
+        if (read_cell.has_formula && read_cell.has_shared_formula)
         {
-            row_properties.style.set(static_cast<std::size_t>(std::stoull(parser().attribute("s"))));
+            read_shared_formula(*cell.d_, read_cell.shared_formula_index, read_cell.formula);
         }
-        if (parser().attribute_present("customFormat"))
+        else if (read_cell.has_formula)
         {
-            row_properties.custom_format.set(parser().attribute<bool>("customFormat"));
+            cell.formula(read_cell.formula);
         }
 
-        skip_attributes({"customFont",
-            "outlineLevel", "collapsed", "thickTop", "thickBot",
-            "ph", "spans"});
-
-        while (in_element(qn("spreadsheetml", "row")))
+        if (read_cell.has_value)
         {
-            expect_start_element(qn("spreadsheetml", "c"), xml::content::complex);
-            auto cell = ws.cell(cell_reference(parser().attribute("r")));
-
-            auto has_type = parser().attribute_present("t");
-            auto type = has_type ? parser().attribute("t") : "n";
+            const auto &type = read_cell.type;
 
-            if (parser().attribute_present("s"))
+            if (type == "str")
             {
-                cell.format(target_.format(static_cast<std::size_t>(std::stoull(parser().attribute("s")))));
+                cell.d_->value_text_ = std::move(read_cell.value);
+                cell.data_type(cell::type::formula_string);
             }
-
-            auto has_value = false;
-            auto value_string = std::string();
-
-            auto has_formula = false;
-            auto has_shared_formula = false;
-            auto formula_value_string = std::string();
-
-            while (in_element(qn("spreadsheetml", "c")))
+            else if (type == "inlineStr")
             {
-                auto current_element = expect_start_element(xml::content::mixed);
+                cell.d_->value_text_ = std::move(read_cell.value);
+                cell.data_type(cell::type::inline_string);
+            }
+            else if (type == "s")
+            {
+                cell.d_->value_numeric_ = read_cell.number;
+                cell.data_type(cell::type::shared_string);
+            }
+            else if (type == "b") // boolean
+            {
+                cell.value(is_true(read_cell.value));
+            }
+            else if (type == "n") // numeric
+            {
+                cell.value(read_cell.number);
+            }
+            else if (!read_cell.value.empty() && read_cell.value[0] == '#')
+            {
+                cell.error(read_cell.value);
+            }
+        }
+    }
+}
 
-                if (current_element == qn("spreadsheetml", "v")) // s:ST_Xstring
-                {
-                    has_value = true;
-                    value_string = read_text();
-                }
-                else if (current_element == qn("spreadsheetml", "f")) // CT_CellFormula
-                {
-                    has_formula = true;
+bool xlsx_consumer::read_worksheet_in_parallel(const path &part_path, const std::string &rel_id)
+{
+    if (parse_threads_ < 2 || streaming_
+        || archive_->header(part_path).uncompressed_size < parallel_parse_min_size)
+    {
+        return false;
+    }
 
-                    if (parser().attribute_present("t"))
-                    {
-                        has_shared_formula = parser().attribute("t") == "shared";
-                    }
+    const auto part = archive_->read(part_path);
+    sheet_data_chunks chunks;
+    const auto divided = chunks.split(part, parse_threads_ * 4);
+    const auto &document = divided ? chunks.outline() : part;
 
-                    skip_attributes(
-                        {"aca", "ref", "dt2D", "dtr", "del1", "del2", "r1", "r2", "ca", "si", "bx"});
+    vector_istreambuf document_streambuf(
+        reinterpret_cast<const std::uint8_t *>(document.data()), document.size());
+    std::istream document_stream(&document_streambuf);
+    xml::parser parser(document_stream, part_path.string());
+    parser_ = &parser;
+    sheet_data_ = divided ? &chunks : nullptr;
 
-                    formula_value_string = read_text();
-                }
-                else if (current_element == qn("spreadsheetml", "is")) // CT_Rst
-                {
-                    expect_start_element(qn("spreadsheetml", "t"), xml::content::simple);
-                    value_string = read_text();
-                    expect_end_element(qn("spreadsheetml", "t"));
-                }
-                else
-                {
-                    unexpected_element(current_element);
-                }
+    try
+    {
+        read_worksheet(rel_id);
+    }
+    catch (...)
+    {
+        sheet_data_ = nullptr;
+        throw;
+    }
 
-                expect_end_element(current_element);
-            }
+    sheet_data_ = nullptr;
 
-            expect_end_element(qn("spreadsheetml", "c"));
+    return true;
+}
 
-            if (has_formula && !has_shared_formula)
+void xlsx_consumer::read_sheet_data_chunks()
+{
+    const auto &chunks = *sheet_data_;
+    std::vector<std::vector<sheet_row>> rows(chunks.size());
+
+    run_ordered(chunks.size(), parse_threads_, parse_threads_ * 2,
+        [&](std::size_t index) {
+            // a consumer of its own for the parser state, sharing nothing with this one
+            xlsx_consumer chunk_consumer(target_);
+            auto chunk = chunks.open(index);
+            chunk_consumer.read_sheet_data_chunk(*chunk, rows[index]);
+        },
+        [&](std::size_t index) {
+            for (auto &row : rows[index])
             {
-                cell.formula(formula_value_string);
+                add_row(row);
             }
 
-            if (has_value)
-            {
-                if (type == "str")
-                {
-                    cell.d_->value_text_ = value_string;
-                    cell.data_type(cell::type::formula_string);
-                }
-                else if (type == "inlineStr")
-                {
-                    cell.d_->value_text_ = value_string;
-                    cell.data_type(cell::type::inline_string);
-                }
-                else if (type == "s")
-                {
-                    cell.d_->value_numeric_ = converter.stold(value_string);
-                    cell.data_type(cell::type::shared_string);
-                }
-                else if (type == "b") // boolean
-                {
-                    cell.value(is_true(value_string));
-                }
-                else if (type == "n") // numeric
-                {
-                    cell.value(converter.stold(value_string));
-                }
-                else if (!value_string.empty() && value_string[0] == '#')
-                {
-                    cell.error(value_string);
-                }
-            }
-        }
+            std::vector<sheet_row>().swap(rows[index]);
+        });
+}
 
-        expect_end_element(qn("spreadsheetml", "row"));
+void xlsx_consumer::read_sheet_data_chunk(std::streambuf &chunk, std::vector<sheet_row> &rows)
+{
+    std::istream chunk_stream(&chunk);
+    xml::parser parser(chunk_stream, "sheetData");
+    parser_ = &parser;
+
+    expect_start_element(xml_token::spreadsheetml_worksheet, xml::content::complex);
+    skip_attributes();
+    expect_start_element(xml_token::spreadsheetml_sheetData, xml::content::complex);
+    skip_attributes();
+
+    number_converter converter;
+
+    while (in_element(xml_token::spreadsheetml_sheetData))
+    {
+        rows.emplace_back();
+        read_row(rows.back(), converter);
     }
 
-    expect_end_element(qn("spreadsheetml", "sheetData"));
+    expect_end_element(xml_token::spreadsheetml_sheetData);
+    expect_end_element(xml_token::spreadsheetml_worksheet);
+    parser_ = nullptr;
 }
 
 worksheet xlsx_consumer::read_worksheet_end(const std::string &rel_id)
@@ -830,53 +1032,53 @@ worksheet xlsx_consumer::read_worksheet_end(const std::string &rel_id)
 
     auto ws = worksheet(current_worksheet_);
 
-    while (in_element(qn("spreadsheetml", "worksheet")))
+    while (in_element(xml_token::spreadsheetml_worksheet))
     {
         auto current_worksheet_element = expect_start_element(xml::content::complex);
 
-        if (current_worksheet_element == qn("spreadsheetml", "sheetCalcPr")) // CT_SheetCalcPr 0-1
+        if (current_worksheet_element == qn(xml_token::spreadsheetml_sheetCalcPr)) // CT_SheetCalcPr 0-1
         {
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "sheetProtection")) // CT_SheetProtection 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_sheetProtection)) // CT_SheetProtection 0-1
         {
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "protectedRanges")) // CT_ProtectedRanges 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_protectedRanges)) // CT_ProtectedRanges 0-1
         {
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "scenarios")) // CT_Scenarios 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_scenarios)) // CT_Scenarios 0-1
         {
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "autoFilter")) // CT_AutoFilter 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_autoFilter)) // CT_AutoFilter 0-1
         {
             ws.auto_filter(xlnt::range_reference(parser().attribute("ref")));
             // auto filter complex
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "sortState")) // CT_SortState 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_sortState)) // CT_SortState 0-1
         {
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "dataConsolidate")) // CT_DataConsolidate 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_dataConsolidate)) // CT_DataConsolidate 0-1
         {
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "customSheetViews")) // CT_CustomSheetViews 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_customSheetViews)) // CT_CustomSheetViews 0-1
         {
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "mergeCells")) // CT_MergeCells 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_mergeCells)) // CT_MergeCells 0-1
         {
             auto count = std::stoull(parser().attribute("count"));
 
-            while (in_element(qn("spreadsheetml", "mergeCells")))
+            while (in_element(xml_token::spreadsheetml_mergeCells))
             {
-                expect_start_element(qn("spreadsheetml", "mergeCell"), xml::content::simple);
+                expect_start_element(xml_token::spreadsheetml_mergeCell, xml::content::simple);
                 ws.merge_cells(range_reference(parser().attribute("ref")));
-                expect_end_element(qn("spreadsheetml", "mergeCell"));
+                expect_end_element(xml_token::spreadsheetml_mergeCell);
 
                 count--;
             }
@@ -886,7 +1088,7 @@ worksheet xlsx_consumer::read_worksheet_end(const std::string &rel_id)
                 throw invalid_file("sizes don't match");
             }
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "phoneticPr")) // CT_PhoneticPr 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_phoneticPr)) // CT_PhoneticPr 0-1
         {
             phonetic_pr phonetic_properties(parser().attribute<std::uint32_t>("fontId"));
             if (parser().attribute_present("type"))
@@ -899,26 +1101,26 @@ worksheet xlsx_consumer::read_worksheet_end(const std::string &rel_id)
             }
             current_worksheet_->phonetic_properties_.set(phonetic_properties);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "conditionalFormatting")) // CT_ConditionalFormatting 0+
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_conditionalFormatting)) // CT_ConditionalFormatting 0+
         {
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "dataValidations")) // CT_DataValidations 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_dataValidations)) // CT_DataValidations 0-1
         {
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "hyperlinks")) // CT_Hyperlinks 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_hyperlinks)) // CT_Hyperlinks 0-1
         {
             while (in_element(current_worksheet_element))
             {
                 // CT_Hyperlink
-                expect_start_element(qn("spreadsheetml", "hyperlink"), xml::content::simple);
+                expect_start_element(xml_token::spreadsheetml_hyperlink, xml::content::simple);
 
                 auto cell = ws.cell(parser().attribute("ref"));
 
-                if (parser().attribute_present(qn("r", "id")))
+                if (parser().attribute_present(qn(xml_token::r_id)))
                 {
-                    auto hyperlink_rel_id = parser().attribute(qn("r", "id"));
+                    auto hyperlink_rel_id = parser().attribute(qn(xml_token::r_id));
                     auto hyperlink_rel = std::find_if(hyperlinks.begin(), hyperlinks.end(),
                         [&](const relationship &r) { return r.id() == hyperlink_rel_id; });
 
@@ -957,10 +1159,10 @@ worksheet xlsx_consumer::read_worksheet_end(const std::string &rel_id)
                     cell.d_->hyperlink_ = hyperlink;
                 }
 
-                expect_end_element(qn("spreadsheetml", "hyperlink"));
+                expect_end_element(xml_token::spreadsheetml_hyperlink);
             }
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "printOptions")) // CT_PrintOptions 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_printOptions)) // CT_PrintOptions 0-1
         {
             print_options opts;
             if (parser().attribute_present("gridLines"))
@@ -986,7 +1188,7 @@ worksheet xlsx_consumer::read_worksheet_end(const std::string &rel_id)
             ws.d_->print_options_.set(opts);
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "pageMargins")) // CT_PageMargins 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_pageMargins)) // CT_PageMargins 0-1
         {
             page_margins margins;
 
@@ -999,7 +1201,7 @@ worksheet xlsx_consumer::read_worksheet_end(const std::string &rel_id)
 
             ws.page_margins(margins);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "pageSetup")) // CT_PageSetup 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_pageSetup)) // CT_PageSetup 0-1
         {
             page_setup setup;
             if (parser().attribute_present("orientation"))
@@ -1017,7 +1219,7 @@ worksheet xlsx_consumer::read_worksheet_end(const std::string &rel_id)
             ws.page_setup(setup);
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "headerFooter")) // CT_HeaderFooter 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_headerFooter)) // CT_HeaderFooter 0-1
         {
             header_footer hf;
 
@@ -1043,27 +1245,27 @@ worksheet xlsx_consumer::read_worksheet_end(const std::string &rel_id)
             {
                 auto current_hf_element = expect_start_element(xml::content::simple);
 
-                if (current_hf_element == qn("spreadsheetml", "oddHeader"))
+                if (current_hf_element == qn(xml_token::spreadsheetml_oddHeader))
                 {
                     odd_header = decode_header_footer(read_text());
                 }
-                else if (current_hf_element == qn("spreadsheetml", "oddFooter"))
+                else if (current_hf_element == qn(xml_token::spreadsheetml_oddFooter))
                 {
                     odd_footer = decode_header_footer(read_text());
                 }
-                else if (current_hf_element == qn("spreadsheetml", "evenHeader"))
+                else if (current_hf_element == qn(xml_token::spreadsheetml_evenHeader))
                 {
                     even_header = decode_header_footer(read_text());
                 }
-                else if (current_hf_element == qn("spreadsheetml", "evenFooter"))
+                else if (current_hf_element == qn(xml_token::spreadsheetml_evenFooter))
                 {
                     even_footer = decode_header_footer(read_text());
                 }
-                else if (current_hf_element == qn("spreadsheetml", "firstHeader"))
+                else if (current_hf_element == qn(xml_token::spreadsheetml_firstHeader))
                 {
                     first_header = decode_header_footer(read_text());
                 }
-                else if (current_hf_element == qn("spreadsheetml", "firstFooter"))
+                else if (current_hf_element == qn(xml_token::spreadsheetml_firstFooter))
                 {
                     first_footer = decode_header_footer(read_text());
                 }
@@ -1118,16 +1320,16 @@ worksheet xlsx_consumer::read_worksheet_end(const std::string &rel_id)
 
             ws.header_footer(hf);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "rowBreaks")) // CT_PageBreak 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_rowBreaks)) // CT_PageBreak 0-1
         {
             auto count = parser().attribute_present("count") ? parser().attribute<std::size_t>("count") : 0;
             auto manual_break_count = parser().attribute_present("manualBreakCount")
                 ? parser().attribute<std::size_t>("manualBreakCount")
                 : 0;
 
-            while (in_element(qn("spreadsheetml", "rowBreaks")))
+            while (in_element(xml_token::spreadsheetml_rowBreaks))
             {
-                expect_start_element(qn("spreadsheetml", "brk"), xml::content::simple);
+                expect_start_element(xml_token::spreadsheetml_brk, xml::content::simple);
 
                 if (parser().attribute_present("id"))
                 {
@@ -1141,19 +1343,19 @@ worksheet xlsx_consumer::read_worksheet_end(const std::string &rel_id)
                 }
 
                 skip_attributes({"min", "max", "pt"});
-                expect_end_element(qn("spreadsheetml", "brk"));
+                expect_end_element(xml_token::spreadsheetml_brk);
             }
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "colBreaks")) // CT_PageBreak 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_colBreaks)) // CT_PageBreak 0-1
         {
             auto count = parser().attribute_present("count") ? parser().attribute<std::size_t>("count") : 0;
             auto manual_break_count = parser().attribute_present("manualBreakCount")
                 ? parser().attribute<std::size_t>("manualBreakCount")
                 : 0;
 
-            while (in_element(qn("spreadsheetml", "colBreaks")))
+            while (in_element(xml_token::spreadsheetml_colBreaks))
             {
-                expect_start_element(qn("spreadsheetml", "brk"), xml::content::simple);
+                expect_start_element(xml_token::spreadsheetml_brk, xml::content::simple);
 
                 if (parser().attribute_present("id"))
                 {
@@ -1167,34 +1369,34 @@ worksheet xlsx_consumer::read_worksheet_end(const std::string &rel_id)
                 }
 
                 skip_attributes({"min", "max", "pt"});
-                expect_end_element(qn("spreadsheetml", "brk"));
+                expect_end_element(xml_token::spreadsheetml_brk);
             }
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "customProperties")) // CT_CustomProperties 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_customProperties)) // CT_CustomProperties 0-1
         {
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "cellWatches")) // CT_CellWatches 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_cellWatches)) // CT_CellWatches 0-1
         {
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "ignoredErrors")) // CT_IgnoredErrors 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_ignoredErrors)) // CT_IgnoredErrors 0-1
         {
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "smartTags")) // CT_SmartTags 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_smartTags)) // CT_SmartTags 0-1
         {
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "drawing")) // CT_Drawing 0-1
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_drawing)) // CT_Drawing 0-1
         {
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "legacyDrawing"))
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_legacyDrawing))
         {
             skip_remaining_content(current_worksheet_element);
         }
-        else if (current_worksheet_element == qn("spreadsheetml", "extLst"))
+        else if (current_worksheet_element == qn(xml_token::spreadsheetml_extLst))
         {
             ext_list extensions(parser(), current_worksheet_element.namespace_());
             ws.d_->extension_list_.set(extensions);
@@ -1207,7 +1409,7 @@ worksheet xlsx_consumer::read_worksheet_end(const std::string &rel_id)
         expect_end_element(current_worksheet_element);
     }
 
-    expect_end_element(qn("spreadsheetml", "worksheet"));
+    expect_end_element(xml_token::spreadsheetml_worksheet);
 
     if (manifest.has_relationship(sheet_path, xlnt::relationship_type::comments))
     {
@@ -1246,8 +1448,8 @@ xml::parser &xlsx_consumer::parser()
 
 bool xlsx_consumer::has_cell()
 {
-    return in_element(qn("spreadsheetml", "row"))
-        || in_element(qn("spreadsheetml", "sheetData"));
+    return in_element(xml_token::spreadsheetml_row)
+        || in_element(xml_token::spreadsheetml_sheetData);
 }
 
 std::vector<relationship> xlsx_consumer::read_relationships(const path &part)
@@ -1262,11 +1464,11 @@ std::vector<relationship> xlsx_consumer::read_relationships(const path &part)
     xml::parser parser(rels_stream, part_rels_path.string());
     parser_ = &parser;
 
-    expect_start_element(qn("relationships", "Relationships"), xml::content::complex);
+    expect_start_element(xml_token::relationships_Relationships, xml::content::complex);
 
-    while (in_element(qn("relationships", "Relationships")))
+    while (in_element(xml_token::relationships_Relationships))
     {
-        expect_start_element(qn("relationships", "Relationship"), xml::content::simple);
+        expect_start_element(xml_token::relationships_Relationship, xml::content::simple);
 
         const auto target_mode = parser.attribute_present("TargetMode")
             ? parser.attribute<xlnt::target_mode>("TargetMode")
@@ -1282,10 +1484,10 @@ std::vector<relationship> xlsx_consumer::read_relationships(const path &part)
             parser.attribute<xlnt::relationship_type>("Type"),
             xlnt::uri(part.string()), target, target_mode);
 
-        expect_end_element(qn("relationships", "Relationship"));
+        expect_end_element(xml_token::relationships_Relationship);
     }
 
-    expect_end_element(qn("relationships", "Relationships"));
+    expect_end_element(xml_token::relationships_Relationships);
     parser_ = nullptr;
 
     return relationships;
@@ -1293,9 +1495,22 @@ std::vector<relationship> xlsx_consumer::read_relationships(const path &part)
 
 void xlsx_consumer::read_part(const std::vector<relationship> &rel_chain)
 {
+    progress_.check();
+
     const auto &manifest = target_.manifest();
     const auto part_path = manifest.canonicalize(rel_chain);
-    auto part_streambuf = archive_->open(part_path);
+
+    if (rel_chain.back().type() == relationship_type::worksheet
+        && read_worksheet_in_parallel(part_path, rel_chain.back().id()))
+    {
+        parser_ = nullptr;
+        return;
+    }
+
+    // parts which fit in the pipeline's blocks would be inflated before the thread got going
+    const auto pipelined = pipeline_
+        && archive_->header(part_path).uncompressed_size >= pipeline_block_size * pipeline_blocks;
+    auto part_streambuf = archive_->open(part_path, pipelined);
     std::istream part_stream(part_streambuf.get());
     xml::parser parser(part_stream, part_path.string());
     parser_ = &parser;
@@ -1474,19 +1689,19 @@ void xlsx_consumer::read_content_types()
     xml::parser parser(content_types_stream, "[Content_Types].xml");
     parser_ = &parser;
 
-    expect_start_element(qn("content-types", "Types"), xml::content::complex);
+    expect_start_element(xml_token::content_types_Types, xml::content::complex);
 
-    while (in_element(qn("content-types", "Types")))
+    while (in_element(xml_token::content_types_Types))
     {
         auto current_element = expect_start_element(xml::content::complex);
 
-        if (current_element == qn("content-types", "Default"))
+        if (current_element == qn(xml_token::content_types_Default))
         {
             auto extension = parser.attribute("Extension");
             auto content_type = parser.attribute("ContentType");
             manifest.register_default_type(extension, content_type);
         }
-        else if (current_element == qn("content-types", "Override"))
+        else if (current_element == qn(xml_token::content_types_Override))
         {
             auto part_name = parser.attribute("PartName");
             auto content_type = parser.attribute("ContentType");
@@ -1500,35 +1715,35 @@ void xlsx_consumer::read_content_types()
         expect_end_element(current_element);
     }
 
-    expect_end_element(qn("content-types", "Types"));
+    expect_end_element(xml_token::content_types_Types);
 }
 
 void xlsx_consumer::read_core_properties()
 {
-    //qn("extended-properties", "Properties");
-    //qn("custom-properties", "Properties");
-    expect_start_element(qn("core-properties", "coreProperties"), xml::content::complex);
+    //qn(xml_token::extended_properties_Properties);
+    //qn(xml_token::custom_properties_Properties);
+    expect_start_element(xml_token::core_properties_coreProperties, xml::content::complex);
 
-    while (in_element(qn("core-properties", "coreProperties")))
+    while (in_element(xml_token::core_properties_coreProperties))
     {
         const auto property_element = expect_start_element(xml::content::simple);
         const auto prop = detail::from_string<core_property>(property_element.name());
         if (prop == core_property::created || prop == core_property::modified)
         {
-            skip_attribute(qn("xsi", "type"));
+            skip_attribute(qn(xml_token::xsi_type));
         }
         target_.core_property(prop, read_text());
         expect_end_element(property_element);
     }
 
-    expect_end_element(qn("core-properties", "coreProperties"));
+    expect_end_element(xml_token::core_properties_coreProperties);
 }
 
 void xlsx_consumer::read_extended_properties()
 {
-    expect_start_element(qn("extended-properties", "Properties"), xml::content::complex);
+    expect_start_element(xml_token::extended_properties_Properties, xml::content::complex);
 
-    while (in_element(qn("extended-properties", "Properties")))
+    while (in_element(xml_token::extended_properties_Properties))
     {
         const auto property_element = expect_start_element(xml::content::mixed);
         const auto prop = detail::from_string<extended_property>(property_element.name());
@@ -1536,14 +1751,14 @@ void xlsx_consumer::read_extended_properties()
         expect_end_element(property_element);
     }
 
-    expect_end_element(qn("extended-properties", "Properties"));
+    expect_end_element(xml_token::extended_properties_Properties);
 }
 
 void xlsx_consumer::read_custom_properties()
 {
-    expect_start_element(qn("custom-properties", "Properties"), xml::content::complex);
+    expect_start_element(xml_token::custom_properties_Properties, xml::content::complex);
 
-    while (in_element(qn("custom-properties", "Properties")))
+    while (in_element(xml_token::custom_properties_Properties))
     {
         const auto property_element = expect_start_element(xml::content::complex);
         const auto prop = parser().attribute("name");
@@ -1553,7 +1768,7 @@ void xlsx_consumer::read_custom_properties()
         expect_end_element(property_element);
     }
 
-    expect_end_element(qn("custom-properties", "Properties"));
+    expect_end_element(xml_token::custom_properties_Properties);
 }
 
 void xlsx_consumer::read_office_document(const std::string &content_type) // CT_Workbook
@@ -1570,14 +1785,14 @@ void xlsx_consumer::read_office_document(const std::string &content_type) // CT_
 
     target_.d_->calculation_properties_.clear();
 
-    expect_start_element(qn("workbook", "workbook"), xml::content::complex);
-    skip_attribute(qn("mc", "Ignorable"));
+    expect_start_element(xml_token::spreadsheetml_workbook, xml::content::complex);
+    skip_attribute(qn(xml_token::mc_Ignorable));
 
-    while (in_element(qn("workbook", "workbook")))
+    while (in_element(xml_token::spreadsheetml_workbook))
     {
         auto current_workbook_element = expect_start_element(xml::content::complex);
 
-        if (current_workbook_element == qn("workbook", "fileVersion")) // CT_FileVersion 0-1
+        if (current_workbook_element == qn(xml_token::spreadsheetml_fileVersion)) // CT_FileVersion 0-1
         {
             detail::workbook_impl::file_version_t file_version;
 
@@ -1605,23 +1820,23 @@ void xlsx_consumer::read_office_document(const std::string &content_type) // CT_
 
             target_.d_->file_version_ = file_version;
         }
-        else if (current_workbook_element == qn("workbook", "fileSharing")) // CT_FileSharing 0-1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_fileSharing)) // CT_FileSharing 0-1
         {
             skip_remaining_content(current_workbook_element);
         }
-        else if (current_workbook_element == qn("mc", "AlternateContent"))
+        else if (current_workbook_element == qn(xml_token::mc_AlternateContent))
         {
-            while (in_element(qn("mc", "AlternateContent")))
+            while (in_element(xml_token::mc_AlternateContent))
             {
                 auto alternate_content_element = expect_start_element(xml::content::complex);
 
-                if (alternate_content_element == qn("mc", "Choice")
+                if (alternate_content_element == qn(xml_token::mc_Choice)
                     && parser().attribute_present("Requires")
                     && parser().attribute("Requires") == "x15")
                 {
                     auto x15_element = expect_start_element(xml::content::simple);
 
-                    if (x15_element == qn("x15ac", "absPath"))
+                    if (x15_element == qn(xml_token::x15ac_absPath))
                     {
                         target_.d_->abs_path_ = parser().attribute("url");
                     }
@@ -1634,7 +1849,7 @@ void xlsx_consumer::read_office_document(const std::string &content_type) // CT_
                 expect_end_element(alternate_content_element);
             }
         }
-        else if (current_workbook_element == qn("workbook", "workbookPr")) // CT_WorkbookPr 0-1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_workbookPr)) // CT_WorkbookPr 0-1
         {
             target_.base_date(parser().attribute_present("date1904") // optional, bool=false
                         && is_true(parser().attribute("date1904"))
@@ -1659,15 +1874,15 @@ void xlsx_consumer::read_office_document(const std::string &content_type) // CT_
             skip_attribute("defaultThemeVersion"); // optional, uint
             skip_attribute("dateCompatibility"); // optional, bool (undocumented)
         }
-        else if (current_workbook_element == qn("workbook", "workbookProtection")) // CT_WorkbookProtection 0-1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_workbookProtection)) // CT_WorkbookProtection 0-1
         {
             skip_remaining_content(current_workbook_element);
         }
-        else if (current_workbook_element == qn("workbook", "bookViews")) // CT_BookViews 0-1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_bookViews)) // CT_BookViews 0-1
         {
-            while (in_element(qn("workbook", "bookViews")))
+            while (in_element(xml_token::spreadsheetml_bookViews))
             {
-                expect_start_element(qn("workbook", "workbookView"), xml::content::simple);
+                expect_start_element(xml_token::spreadsheetml_workbookView, xml::content::simple);
                 skip_attributes({"firstSheet", "showHorizontalScroll",
                     "showSheetTabs", "showVerticalScroll"});
 
@@ -1706,40 +1921,40 @@ void xlsx_consumer::read_office_document(const std::string &content_type) // CT_
                 target_.view(view);
 
                 skip_attributes();
-                expect_end_element(qn("workbook", "workbookView"));
+                expect_end_element(xml_token::spreadsheetml_workbookView);
             }
         }
-        else if (current_workbook_element == qn("workbook", "sheets")) // CT_Sheets 1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_sheets)) // CT_Sheets 1
         {
             std::size_t index = 0;
 
-            while (in_element(qn("workbook", "sheets")))
+            while (in_element(xml_token::spreadsheetml_sheets))
             {
-                expect_start_element(qn("spreadsheetml", "sheet"), xml::content::simple);
+                expect_start_element(xml_token::spreadsheetml_sheet, xml::content::simple);
 
                 auto title = parser().attribute("name");
                 skip_attribute("state");
 
                 sheet_title_index_map_[title] = index++;
                 sheet_title_id_map_[title] = parser().attribute<std::size_t>("sheetId");
-                target_.d_->sheet_title_rel_id_map_[title] = parser().attribute(qn("r", "id"));
+                target_.d_->sheet_title_rel_id_map_[title] = parser().attribute(qn(xml_token::r_id));
 
-                expect_end_element(qn("spreadsheetml", "sheet"));
+                expect_end_element(xml_token::spreadsheetml_sheet);
             }
         }
-        else if (current_workbook_element == qn("workbook", "functionGroups")) // CT_FunctionGroups 0-1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_functionGroups)) // CT_FunctionGroups 0-1
         {
             skip_remaining_content(current_workbook_element);
         }
-        else if (current_workbook_element == qn("workbook", "externalReferences")) // CT_ExternalReferences 0-1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_externalReferences)) // CT_ExternalReferences 0-1
         {
             skip_remaining_content(current_workbook_element);
         }
-        else if (current_workbook_element == qn("workbook", "definedNames")) // CT_DefinedNames 0-1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_definedNames)) // CT_DefinedNames 0-1
         {
             skip_remaining_content(current_workbook_element);
         }
-        else if (current_workbook_element == qn("workbook", "calcPr")) // CT_CalcPr 0-1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_calcPr)) // CT_CalcPr 0-1
         {
             xlnt::calculation_properties calc_props;
             if (parser().attribute_present("calcId"))
@@ -1753,51 +1968,51 @@ void xlsx_consumer::read_office_document(const std::string &content_type) // CT_
             target_.calculation_properties(calc_props);
             parser().attribute_map(); // skip remaining
         }
-        else if (current_workbook_element == qn("workbook", "oleSize")) // CT_OleSize 0-1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_oleSize)) // CT_OleSize 0-1
         {
             skip_remaining_content(current_workbook_element);
         }
-        else if (current_workbook_element == qn("workbook", "customWorkbookViews")) // CT_CustomWorkbookViews 0-1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_customWorkbookViews)) // CT_CustomWorkbookViews 0-1
         {
             skip_remaining_content(current_workbook_element);
         }
-        else if (current_workbook_element == qn("workbook", "pivotCaches")) // CT_PivotCaches 0-1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_pivotCaches)) // CT_PivotCaches 0-1
         {
             skip_remaining_content(current_workbook_element);
         }
-        else if (current_workbook_element == qn("workbook", "smartTagPr")) // CT_SmartTagPr 0-1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_smartTagPr)) // CT_SmartTagPr 0-1
         {
             skip_remaining_content(current_workbook_element);
         }
-        else if (current_workbook_element == qn("workbook", "smartTagTypes")) // CT_SmartTagTypes 0-1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_smartTagTypes)) // CT_SmartTagTypes 0-1
         {
             skip_remaining_content(current_workbook_element);
         }
-        else if (current_workbook_element == qn("workbook", "webPublishing")) // CT_WebPublishing 0-1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_webPublishing)) // CT_WebPublishing 0-1
         {
             skip_remaining_content(current_workbook_element);
         }
-        else if (current_workbook_element == qn("workbook", "fileRecoveryPr")) // CT_FileRecoveryPr 0+
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_fileRecoveryPr)) // CT_FileRecoveryPr 0+
         {
             skip_remaining_content(current_workbook_element);
         }
-        else if (current_workbook_element == qn("workbook", "webPublishObjects")) // CT_WebPublishObjects 0-1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_webPublishObjects)) // CT_WebPublishObjects 0-1
         {
             skip_remaining_content(current_workbook_element);
         }
-        else if (current_workbook_element == qn("workbook", "extLst")) // CT_ExtensionList 0-1
+        else if (current_workbook_element == qn(xml_token::spreadsheetml_extLst)) // CT_ExtensionList 0-1
         {
-            while (in_element(qn("workbook", "extLst")))
+            while (in_element(xml_token::spreadsheetml_extLst))
             {
                 auto extension_element = expect_start_element(xml::content::complex);
 
-                if (extension_element == qn("workbook", "ext")
+                if (extension_element == qn(xml_token::spreadsheetml_ext)
                     && parser().attribute_present("uri")
                     && parser().attribute("uri") == "{7523E5D3-25F3-A5E0-1632-64F254C22452}")
                 {
                     auto arch_id_extension_element = expect_start_element(xml::content::simple);
 
-                    if (arch_id_extension_element == qn("mx", "ArchID"))
+                    if (arch_id_extension_element == qn(xml_token::mx_ArchID))
                     {
                         target_.d_->arch_id_flags_ = parser().attribute<std::size_t>("Flags");
                     }
@@ -1818,7 +2033,7 @@ void xlsx_consumer::read_office_document(const std::string &content_type) // CT_
         expect_end_element(current_workbook_element);
     }
 
-    expect_end_element(qn("workbook", "workbook"));
+    expect_end_element(xml_token::spreadsheetml_workbook);
 
     auto workbook_rel = manifest().relationship(path("/"), relationship_type::office_document);
     auto workbook_path = workbook_rel.target().path();
@@ -1863,6 +2078,7 @@ void xlsx_consumer::read_office_document(const std::string &content_type) // CT_
         }
 
         current_worksheet_ = &*target_.d_->worksheets_.emplace(insertion_iter, &target_, id, title);
+        current_worksheet_->cell_map_.spill(target_.d_->spill_);
 
         if (!streaming_)
         {
@@ -1907,7 +2123,7 @@ void xlsx_consumer::read_pivot_table()
 
 void xlsx_consumer::read_shared_string_table()
 {
-    expect_start_element(qn("spreadsheetml", "sst"), xml::content::complex);
+    expect_start_element(xml_token::spreadsheetml_sst, xml::content::complex);
     skip_attributes({"count"});
 
     bool has_unique_count = false;
@@ -1917,22 +2133,26 @@ void xlsx_consumer::read_shared_string_table()
     {
         has_unique_count = true;
         unique_count = parser().attribute<std::size_t>("uniqueCount");
+        target_.d_->shared_strings_.reserve(unique_count);
     }
 
-    while (in_element(qn("spreadsheetml", "sst")))
+    while (in_element(xml_token::spreadsheetml_sst))
     {
-        expect_start_element(qn("spreadsheetml", "si"), xml::content::complex);
-        auto rt = read_rich_text(qn("spreadsheetml", "si"));
-        target_.add_shared_string(rt);
-        expect_end_element(qn("spreadsheetml", "si"));
+        expect_start_element(xml_token::spreadsheetml_si, xml::content::complex);
+        auto rt = read_rich_text(xml_token::spreadsheetml_si);
+        // cells refer to strings by position, so keep any repeated entries
+        target_.add_shared_string(std::move(rt), true);
+        expect_end_element(xml_token::spreadsheetml_si);
     }
 
-    expect_end_element(qn("spreadsheetml", "sst"));
+    expect_end_element(xml_token::spreadsheetml_sst);
 
-    if (has_unique_count && unique_count != target_.shared_strings().size())
+    if (has_unique_count && unique_count != target_.d_->shared_strings_.size())
     {
         throw invalid_file("sizes don't match");
     }
+
+    instrumentation_.count_shared_strings(target_.d_->shared_strings_.size());
 }
 
 void xlsx_consumer::read_shared_workbook_revision_headers()
@@ -1952,28 +2172,28 @@ void xlsx_consumer::read_stylesheet()
     target_.impl().stylesheet_ = detail::stylesheet();
     auto &stylesheet = target_.impl().stylesheet_.get();
 
-    expect_start_element(qn("spreadsheetml", "styleSheet"), xml::content::complex);
-    skip_attributes({qn("mc", "Ignorable")});
+    expect_start_element(xml_token::spreadsheetml_styleSheet, xml::content::complex);
+    skip_attributes({qn(xml_token::mc_Ignorable)});
 
     std::vector<std::pair<style_impl, std::size_t>> styles;
     std::vector<std::pair<format_impl, std::size_t>> format_records;
     std::vector<std::pair<format_impl, std::size_t>> style_records;
 
-    while (in_element(qn("spreadsheetml", "styleSheet")))
+    while (in_element(xml_token::spreadsheetml_styleSheet))
     {
         auto current_style_element = expect_start_element(xml::content::complex);
 
-        if (current_style_element == qn("spreadsheetml", "borders"))
+        if (current_style_element == qn(xml_token::spreadsheetml_borders))
         {
             auto &borders = stylesheet.borders;
             auto count = parser().attribute<std::size_t>("count");
 
-            while (in_element(qn("spreadsheetml", "borders")))
+            while (in_element(xml_token::spreadsheetml_borders))
             {
                 borders.push_back(xlnt::border());
                 auto &border = borders.back();
 
-                expect_start_element(qn("spreadsheetml", "border"), xml::content::complex);
+                expect_start_element(xml_token::spreadsheetml_border, xml::content::complex);
 
                 auto diagonal = diagonal_direction::neither;
 
@@ -1992,7 +2212,7 @@ void xlsx_consumer::read_stylesheet()
                     border.diagonal(diagonal);
                 }
 
-                while (in_element(qn("spreadsheetml", "border")))
+                while (in_element(xml_token::spreadsheetml_border))
                 {
                     auto current_side_element = expect_start_element(xml::content::complex);
 
@@ -2005,9 +2225,9 @@ void xlsx_consumer::read_stylesheet()
 
                     if (in_element(current_side_element))
                     {
-                        expect_start_element(qn("spreadsheetml", "color"), xml::content::complex);
+                        expect_start_element(xml_token::spreadsheetml_color, xml::content::complex);
                         side.color(read_color());
-                        expect_end_element(qn("spreadsheetml", "color"));
+                        expect_end_element(xml_token::spreadsheetml_color);
                     }
 
                     expect_end_element(current_side_element);
@@ -2016,7 +2236,7 @@ void xlsx_consumer::read_stylesheet()
                     border.side(side_type, side);
                 }
 
-                expect_end_element(qn("spreadsheetml", "border"));
+                expect_end_element(xml_token::spreadsheetml_border);
             }
 
             if (count != borders.size())
@@ -2024,20 +2244,20 @@ void xlsx_consumer::read_stylesheet()
                 throw xlnt::exception("border counts don't match");
             }
         }
-        else if (current_style_element == qn("spreadsheetml", "fills"))
+        else if (current_style_element == qn(xml_token::spreadsheetml_fills))
         {
             auto &fills = stylesheet.fills;
             auto count = parser().attribute<std::size_t>("count");
 
-            while (in_element(qn("spreadsheetml", "fills")))
+            while (in_element(xml_token::spreadsheetml_fills))
             {
                 fills.push_back(xlnt::fill());
                 auto &new_fill = fills.back();
 
-                expect_start_element(qn("spreadsheetml", "fill"), xml::content::complex);
+                expect_start_element(xml_token::spreadsheetml_fill, xml::content::complex);
                 auto fill_element = expect_start_element(xml::content::complex);
 
-                if (fill_element == qn("spreadsheetml", "patternFill"))
+                if (fill_element == qn(xml_token::spreadsheetml_patternFill))
                 {
                     xlnt::pattern_fill pattern;
 
@@ -2045,15 +2265,15 @@ void xlsx_consumer::read_stylesheet()
                     {
                         pattern.type(parser().attribute<xlnt::pattern_fill_type>("patternType"));
 
-                        while (in_element(qn("spreadsheetml", "patternFill")))
+                        while (in_element(xml_token::spreadsheetml_patternFill))
                         {
                             auto pattern_type_element = expect_start_element(xml::content::complex);
 
-                            if (pattern_type_element == qn("spreadsheetml", "fgColor"))
+                            if (pattern_type_element == qn(xml_token::spreadsheetml_fgColor))
                             {
                                 pattern.foreground(read_color());
                             }
-                            else if (pattern_type_element == qn("spreadsheetml", "bgColor"))
+                            else if (pattern_type_element == qn(xml_token::spreadsheetml_bgColor))
                             {
                                 pattern.background(read_color());
                             }
@@ -2068,7 +2288,7 @@ void xlsx_consumer::read_stylesheet()
 
                     new_fill = pattern;
                 }
-                else if (fill_element == qn("spreadsheetml", "gradientFill"))
+                else if (fill_element == qn(xml_token::spreadsheetml_gradientFill))
                 {
                     xlnt::gradient_fill gradient;
 
@@ -2081,14 +2301,14 @@ void xlsx_consumer::read_stylesheet()
                         gradient.type(xlnt::gradient_fill_type::linear);
                     }
 
-                    while (in_element(qn("spreadsheetml", "gradientFill")))
+                    while (in_element(xml_token::spreadsheetml_gradientFill))
                     {
-                        expect_start_element(qn("spreadsheetml", "stop"), xml::content::complex);
+                        expect_start_element(xml_token::spreadsheetml_stop, xml::content::complex);
                         auto position = parser().attribute<double>("position");
-                        expect_start_element(qn("spreadsheetml", "color"), xml::content::complex);
+                        expect_start_element(xml_token::spreadsheetml_color, xml::content::complex);
                         auto color = read_color();
-                        expect_end_element(qn("spreadsheetml", "color"));
-                        expect_end_element(qn("spreadsheetml", "stop"));
+                        expect_end_element(xml_token::spreadsheetml_color);
+                        expect_end_element(xml_token::spreadsheetml_stop);
 
                         gradient.add_stop(position, color);
                     }
@@ -2101,7 +2321,7 @@ void xlsx_consumer::read_stylesheet()
                 }
 
                 expect_end_element(fill_element);
-                expect_end_element(qn("spreadsheetml", "fill"));
+                expect_end_element(xml_token::spreadsheetml_fill);
             }
 
             if (count != fills.size())
@@ -2109,48 +2329,48 @@ void xlsx_consumer::read_stylesheet()
                 throw xlnt::exception("counts don't match");
             }
         }
-        else if (current_style_element == qn("spreadsheetml", "fonts"))
+        else if (current_style_element == qn(xml_token::spreadsheetml_fonts))
         {
             auto &fonts = stylesheet.fonts;
             auto count = parser().attribute<std::size_t>("count");
 
-            if (parser().attribute_present(qn("x14ac", "knownFonts")))
+            if (parser().attribute_present(qn(xml_token::x14ac_knownFonts)))
             {
                 target_.enable_known_fonts();
             }
 
-            while (in_element(qn("spreadsheetml", "fonts")))
+            while (in_element(xml_token::spreadsheetml_fonts))
             {
                 fonts.push_back(xlnt::font());
                 auto &new_font = stylesheet.fonts.back();
 
-                expect_start_element(qn("spreadsheetml", "font"), xml::content::complex);
+                expect_start_element(xml_token::spreadsheetml_font, xml::content::complex);
 
-                while (in_element(qn("spreadsheetml", "font")))
+                while (in_element(xml_token::spreadsheetml_font))
                 {
                     auto font_property_element = expect_start_element(xml::content::simple);
 
-                    if (font_property_element == qn("spreadsheetml", "sz"))
+                    if (font_property_element == qn(xml_token::spreadsheetml_sz))
                     {
                         new_font.size(parser().attribute<double>("val"));
                     }
-                    else if (font_property_element == qn("spreadsheetml", "name"))
+                    else if (font_property_element == qn(xml_token::spreadsheetml_name))
                     {
                         new_font.name(parser().attribute("val"));
                     }
-                    else if (font_property_element == qn("spreadsheetml", "color"))
+                    else if (font_property_element == qn(xml_token::spreadsheetml_color))
                     {
                         new_font.color(read_color());
                     }
-                    else if (font_property_element == qn("spreadsheetml", "family"))
+                    else if (font_property_element == qn(xml_token::spreadsheetml_family))
                     {
                         new_font.family(parser().attribute<std::size_t>("val"));
                     }
-                    else if (font_property_element == qn("spreadsheetml", "scheme"))
+                    else if (font_property_element == qn(xml_token::spreadsheetml_scheme))
                     {
                         new_font.scheme(parser().attribute("val"));
                     }
-                    else if (font_property_element == qn("spreadsheetml", "b"))
+                    else if (font_property_element == qn(xml_token::spreadsheetml_b))
                     {
                         if (parser().attribute_present("val"))
                         {
@@ -2161,7 +2381,7 @@ void xlsx_consumer::read_stylesheet()
                             new_font.bold(true);
                         }
                     }
-                    else if (font_property_element == qn("spreadsheetml", "vertAlign"))
+                    else if (font_property_element == qn(xml_token::spreadsheetml_vertAlign))
                     {
                         auto vert_align = parser().attribute("val");
 
@@ -2174,7 +2394,7 @@ void xlsx_consumer::read_stylesheet()
                             new_font.subscript(true);
                         }
                     }
-                    else if (font_property_element == qn("spreadsheetml", "strike"))
+                    else if (font_property_element == qn(xml_token::spreadsheetml_strike))
                     {
                         if (parser().attribute_present("val"))
                         {
@@ -2185,7 +2405,7 @@ void xlsx_consumer::read_stylesheet()
                             new_font.strikethrough(true);
                         }
                     }
-                    else if (font_property_element == qn("spreadsheetml", "outline"))
+                    else if (font_property_element == qn(xml_token::spreadsheetml_outline))
                     {
                         if (parser().attribute_present("val"))
                         {
@@ -2196,7 +2416,7 @@ void xlsx_consumer::read_stylesheet()
                             new_font.outline(true);
                         }
                     }
-                    else if (font_property_element == qn("spreadsheetml", "shadow"))
+                    else if (font_property_element == qn(xml_token::spreadsheetml_shadow))
                     {
                         if (parser().attribute_present("val"))
                         {
@@ -2207,7 +2427,7 @@ void xlsx_consumer::read_stylesheet()
                             new_font.shadow(true);
                         }
                     }
-                    else if (font_property_element == qn("spreadsheetml", "i"))
+                    else if (font_property_element == qn(xml_token::spreadsheetml_i))
                     {
                         if (parser().attribute_present("val"))
                         {
@@ -2218,7 +2438,7 @@ void xlsx_consumer::read_stylesheet()
                             new_font.italic(true);
                         }
                     }
-                    else if (font_property_element == qn("spreadsheetml", "u"))
+                    else if (font_property_element == qn(xml_token::spreadsheetml_u))
                     {
                         if (parser().attribute_present("val"))
                         {
@@ -2229,7 +2449,7 @@ void xlsx_consumer::read_stylesheet()
                             new_font.underline(xlnt::font::underline_style::single);
                         }
                     }
-                    else if (font_property_element == qn("spreadsheetml", "charset"))
+                    else if (font_property_element == qn(xml_token::spreadsheetml_charset))
                     {
                         if (parser().attribute_present("val"))
                         {
@@ -2244,7 +2464,7 @@ void xlsx_consumer::read_stylesheet()
                     expect_end_element(font_property_element);
                 }
 
-                expect_end_element(qn("spreadsheetml", "font"));
+                expect_end_element(xml_token::spreadsheetml_font);
             }
 
             if (count != stylesheet.fonts.size())
@@ -2252,14 +2472,14 @@ void xlsx_consumer::read_stylesheet()
                 throw xlnt::exception("counts don't match");
             }
         }
-        else if (current_style_element == qn("spreadsheetml", "numFmts"))
+        else if (current_style_element == qn(xml_token::spreadsheetml_numFmts))
         {
             auto &number_formats = stylesheet.number_formats;
             auto count = parser().attribute<std::size_t>("count");
 
-            while (in_element(qn("spreadsheetml", "numFmts")))
+            while (in_element(xml_token::spreadsheetml_numFmts))
             {
-                expect_start_element(qn("spreadsheetml", "numFmt"), xml::content::simple);
+                expect_start_element(xml_token::spreadsheetml_numFmt, xml::content::simple);
 
                 auto format_string = parser().attribute("formatCode");
 
@@ -2273,7 +2493,7 @@ void xlsx_consumer::read_stylesheet()
                 nf.format_string(format_string);
                 nf.id(parser().attribute<std::size_t>("numFmtId"));
 
-                expect_end_element(qn("spreadsheetml", "numFmt"));
+                expect_end_element(xml_token::spreadsheetml_numFmt);
 
                 number_formats.push_back(nf);
             }
@@ -2283,15 +2503,15 @@ void xlsx_consumer::read_stylesheet()
                 throw xlnt::exception("counts don't match");
             }
         }
-        else if (current_style_element == qn("spreadsheetml", "cellStyles"))
+        else if (current_style_element == qn(xml_token::spreadsheetml_cellStyles))
         {
             auto count = parser().attribute<std::size_t>("count");
 
-            while (in_element(qn("spreadsheetml", "cellStyles")))
+            while (in_element(xml_token::spreadsheetml_cellStyles))
             {
                 auto &data = *styles.emplace(styles.end());
 
-                expect_start_element(qn("spreadsheetml", "cellStyle"), xml::content::simple);
+                expect_start_element(xml_token::spreadsheetml_cellStyle, xml::content::simple);
 
                 data.first.name = parser().attribute("name");
                 data.second = parser().attribute<std::size_t>("xfId");
@@ -2311,7 +2531,7 @@ void xlsx_consumer::read_stylesheet()
                     data.first.custom_builtin = is_true(parser().attribute("customBuiltin"));
                 }
 
-                expect_end_element(qn("spreadsheetml", "cellStyle"));
+                expect_end_element(xml_token::spreadsheetml_cellStyle);
             }
 
             if (count != styles.size())
@@ -2319,15 +2539,15 @@ void xlsx_consumer::read_stylesheet()
                 throw xlnt::exception("counts don't match");
             }
         }
-        else if (current_style_element == qn("spreadsheetml", "cellStyleXfs")
-            || current_style_element == qn("spreadsheetml", "cellXfs"))
+        else if (current_style_element == qn(xml_token::spreadsheetml_cellStyleXfs)
+            || current_style_element == qn(xml_token::spreadsheetml_cellXfs))
         {
             auto in_style_records = current_style_element.name() == "cellStyleXfs";
             auto count = parser().attribute<std::size_t>("count");
 
             while (in_element(current_style_element))
             {
-                expect_start_element(qn("spreadsheetml", "xf"), xml::content::complex);
+                expect_start_element(xml_token::spreadsheetml_xf, xml::content::complex);
 
                 auto &record = *(!in_style_records
                         ? format_records.emplace(format_records.end())
@@ -2387,11 +2607,11 @@ void xlsx_consumer::read_stylesheet()
                     record.second = parser().attribute<std::size_t>("xfId");
                 }
 
-                while (in_element(qn("spreadsheetml", "xf")))
+                while (in_element(xml_token::spreadsheetml_xf))
                 {
                     auto xf_child_element = expect_start_element(xml::content::simple);
 
-                    if (xf_child_element == qn("spreadsheetml", "alignment"))
+                    if (xf_child_element == qn(xml_token::spreadsheetml_alignment))
                     {
                         record.first.alignment_id = stylesheet.alignments.size();
                         auto &alignment = *stylesheet.alignments.emplace(stylesheet.alignments.end());
@@ -2431,7 +2651,7 @@ void xlsx_consumer::read_stylesheet()
                             parser().attribute<int>("readingOrder");
                         }
                     }
-                    else if (xf_child_element == qn("spreadsheetml", "protection"))
+                    else if (xf_child_element == qn(xml_token::spreadsheetml_protection))
                     {
                         record.first.protection_id = stylesheet.protections.size();
                         auto &protection = *stylesheet.protections.emplace(stylesheet.protections.end());
@@ -2449,7 +2669,7 @@ void xlsx_consumer::read_stylesheet()
                     expect_end_element(xf_child_element);
                 }
 
-                expect_end_element(qn("spreadsheetml", "xf"));
+                expect_end_element(xml_token::spreadsheetml_xf);
             }
 
             if ((in_style_records && count != style_records.size())
@@ -2458,7 +2678,7 @@ void xlsx_consumer::read_stylesheet()
                 throw xlnt::exception("counts don't match");
             }
         }
-        else if (current_style_element == qn("spreadsheetml", "dxfs"))
+        else if (current_style_element == qn(xml_token::spreadsheetml_dxfs))
         {
             auto count = parser().attribute<std::size_t>("count");
             std::size_t processed = 0;
@@ -2476,7 +2696,7 @@ void xlsx_consumer::read_stylesheet()
                 throw xlnt::exception("counts don't match");
             }
         }
-        else if (current_style_element == qn("spreadsheetml", "tableStyles"))
+        else if (current_style_element == qn(xml_token::spreadsheetml_tableStyles))
         {
             skip_attribute("defaultTableStyle");
             skip_attribute("defaultPivotStyle");
@@ -2484,7 +2704,7 @@ void xlsx_consumer::read_stylesheet()
             auto count = parser().attribute<std::size_t>("count");
             std::size_t processed = 0;
 
-            while (in_element(qn("spreadsheetml", "tableStyles")))
+            while (in_element(xml_token::spreadsheetml_tableStyles))
             {
                 auto current_element = expect_start_element(xml::content::complex);
                 skip_remaining_content(current_element);
@@ -2497,44 +2717,44 @@ void xlsx_consumer::read_stylesheet()
                 throw xlnt::exception("counts don't match");
             }
         }
-        else if (current_style_element == qn("spreadsheetml", "extLst"))
+        else if (current_style_element == qn(xml_token::spreadsheetml_extLst))
         {
-            while (in_element(qn("spreadsheetml", "extLst")))
+            while (in_element(xml_token::spreadsheetml_extLst))
             {
-                expect_start_element(qn("spreadsheetml", "ext"), xml::content::complex);
+                expect_start_element(xml_token::spreadsheetml_ext, xml::content::complex);
 
                 const auto uri = parser().attribute("uri");
 
                 if (uri == "{EB79DEF2-80B8-43e5-95BD-54CBDDF9020C}") // slicerStyles
                 {
-                    expect_start_element(qn("x14", "slicerStyles"), xml::content::simple);
+                    expect_start_element(xml_token::x14_slicerStyles, xml::content::simple);
                     stylesheet.default_slicer_style = parser().attribute("defaultSlicerStyle");
-                    expect_end_element(qn("x14", "slicerStyles"));
+                    expect_end_element(xml_token::x14_slicerStyles);
                 }
                 else
                 {
-                    skip_remaining_content(qn("spreadsheetml", "ext"));
+                    skip_remaining_content(qn(xml_token::spreadsheetml_ext));
                 }
 
-                expect_end_element(qn("spreadsheetml", "ext"));
+                expect_end_element(xml_token::spreadsheetml_ext);
             }
         }
-        else if (current_style_element == qn("spreadsheetml", "colors")) // CT_Colors 0-1
+        else if (current_style_element == qn(xml_token::spreadsheetml_colors)) // CT_Colors 0-1
         {
-            while (in_element(qn("spreadsheetml", "colors")))
+            while (in_element(xml_token::spreadsheetml_colors))
             {
                 auto colors_child_element = expect_start_element(xml::content::complex);
 
-                if (colors_child_element == qn("spreadsheetml", "indexedColors")) // CT_IndexedColors 0-1
+                if (colors_child_element == qn(xml_token::spreadsheetml_indexedColors)) // CT_IndexedColors 0-1
                 {
                     while (in_element(colors_child_element))
                     {
-                        expect_start_element(qn("spreadsheetml", "rgbColor"), xml::content::simple);
+                        expect_start_element(xml_token::spreadsheetml_rgbColor, xml::content::simple);
                         stylesheet.colors.push_back(read_color());
-                        expect_end_element(qn("spreadsheetml", "rgbColor"));
+                        expect_end_element(xml_token::spreadsheetml_rgbColor);
                     }
                 }
-                else if (colors_child_element == qn("spreadsheetml", "mruColors")) // CT_MRUColors
+                else if (colors_child_element == qn(xml_token::spreadsheetml_mruColors)) // CT_MRUColors
                 {
                     skip_remaining_content(colors_child_element);
                 }
@@ -2554,7 +2774,7 @@ void xlsx_consumer::read_stylesheet()
         expect_end_element(current_style_element);
     }
 
-    expect_end_element(qn("spreadsheetml", "styleSheet"));
+    expect_end_element(xml_token::spreadsheetml_styleSheet);
 
     std::size_t xf_id = 0;
 
@@ -2618,6 +2838,8 @@ void xlsx_consumer::read_stylesheet()
 
         set_style_by_xfid(styles, record.second, new_format.style);
     }
+
+    instrumentation_.count_formats(format_records.size());
 }
 
 void xlsx_consumer::read_theme()
@@ -2652,47 +2874,47 @@ void xlsx_consumer::read_comments(worksheet ws)
 {
     std::vector<std::string> authors;
 
-    expect_start_element(qn("spreadsheetml", "comments"), xml::content::complex);
+    expect_start_element(xml_token::spreadsheetml_comments, xml::content::complex);
     // name space can be ignored
-    skip_attribute(qn("mc", "Ignorable"));
-    expect_start_element(qn("spreadsheetml", "authors"), xml::content::complex);
+    skip_attribute(qn(xml_token::mc_Ignorable));
+    expect_start_element(xml_token::spreadsheetml_authors, xml::content::complex);
 
-    while (in_element(qn("spreadsheetml", "authors")))
+    while (in_element(xml_token::spreadsheetml_authors))
     {
-        expect_start_element(qn("spreadsheetml", "author"), xml::content::simple);
+        expect_start_element(xml_token::spreadsheetml_author, xml::content::simple);
         authors.push_back(read_text());
-        expect_end_element(qn("spreadsheetml", "author"));
+        expect_end_element(xml_token::spreadsheetml_author);
     }
 
-    expect_end_element(qn("spreadsheetml", "authors"));
-    expect_start_element(qn("spreadsheetml", "commentList"), xml::content::complex);
+    expect_end_element(xml_token::spreadsheetml_authors);
+    expect_start_element(xml_token::spreadsheetml_commentList, xml::content::complex);
 
-    while (in_element(xml::qname(qn("spreadsheetml", "commentList"))))
+    while (in_element(xml_token::spreadsheetml_commentList))
     {
-        expect_start_element(qn("spreadsheetml", "comment"), xml::content::complex);
+        expect_start_element(xml_token::spreadsheetml_comment, xml::content::complex);
 
         skip_attribute("shapeId");
         auto cell_ref = parser().attribute("ref");
         auto author_id = parser().attribute<std::size_t>("authorId");
 
-        expect_start_element(qn("spreadsheetml", "text"), xml::content::complex);
+        expect_start_element(xml_token::spreadsheetml_text, xml::content::complex);
 
-        ws.cell(cell_ref).comment(comment(read_rich_text(qn("spreadsheetml", "text")), authors.at(author_id)));
+        ws.cell(cell_ref).comment(comment(read_rich_text(xml_token::spreadsheetml_text), authors.at(author_id)));
 
-        expect_end_element(qn("spreadsheetml", "text"));
+        expect_end_element(xml_token::spreadsheetml_text);
 
-        if (in_element(xml::qname(qn("spreadsheetml", "comment"))))
+        if (in_element(xml_token::spreadsheetml_comment))
         {
-            expect_start_element(qn("mc", "AlternateContent"), xml::content::complex);
-            skip_remaining_content(qn("mc", "AlternateContent"));
-            expect_end_element(qn("mc", "AlternateContent"));
+            expect_start_element(xml_token::mc_AlternateContent, xml::content::complex);
+            skip_remaining_content(qn(xml_token::mc_AlternateContent));
+            expect_end_element(xml_token::mc_AlternateContent);
         }
 
-        expect_end_element(qn("spreadsheetml", "comment"));
+        expect_end_element(xml_token::spreadsheetml_comment);
     }
 
-    expect_end_element(qn("spreadsheetml", "commentList"));
-    expect_end_element(qn("spreadsheetml", "comments"));
+    expect_end_element(xml_token::spreadsheetml_commentList);
+    expect_end_element(xml_token::spreadsheetml_comments);
 }
 
 void xlsx_consumer::read_drawings()
@@ -2712,9 +2934,11 @@ void xlsx_consumer::read_unknown_relationships()
 void xlsx_consumer::read_image(const xlnt::path &image_path)
 {
     auto image_streambuf = archive_->open(image_path);
-    vector_ostreambuf buffer(target_.d_->images_[image_path.string()]);
+    std::vector<std::uint8_t> image;
+    vector_ostreambuf buffer(image);
     std::ostream out_stream(&buffer);
     out_stream << image_streambuf.get();
+    target_.d_->images_.set(image_path.string(), std::move(image));
 }
 
 std::string xlsx_consumer::read_text()
@@ -2739,19 +2963,19 @@ variant xlsx_consumer::read_variant()
         auto element = expect_start_element(xml::content::mixed);
         auto text = read_text();
 
-        if (element == qn("vt", "lpwstr") || element == qn("vt", "lpstr"))
+        if (element == qn(xml_token::vt_lpwstr) || element == qn(xml_token::vt_lpstr))
         {
             value = variant(text);
         }
-        if (element == qn("vt", "i4"))
+        if (element == qn(xml_token::vt_i4))
         {
             value = variant(std::stoi(text));
         }
-        if (element == qn("vt", "bool"))
+        if (element == qn(xml_token::vt_bool))
         {
             value = variant(is_true(text));
         }
-        else if (element == qn("vt", "vector"))
+        else if (element == qn(xml_token::vt_vector))
         {
             auto size = parser().attribute<std::size_t>("size");
             auto base_type = parser().attribute("baseType");
@@ -2762,14 +2986,14 @@ variant xlsx_consumer::read_variant()
             {
                 if (base_type == "variant")
                 {
-                    expect_start_element(qn("vt", "variant"), xml::content::complex);
+                    expect_start_element(xml_token::vt_variant, xml::content::complex);
                 }
 
                 vector.push_back(read_variant());
 
                 if (base_type == "variant")
                 {
-                    expect_end_element(qn("vt", "variant"));
+                    expect_end_element(xml_token::vt_variant);
                     read_text();
                 }
             }
@@ -2850,13 +3074,20 @@ bool xlsx_consumer::in_element(const xml::qname &name)
         && stack_.back() == name;
 }
 
+bool xlsx_consumer::in_element(xml_token name)
+{
+    return parser().peek() != xml::parser::event_type::end_element
+        && tokens_.back() == name;
+}
+
 xml::qname xlsx_consumer::expect_start_element(xml::content content)
 {
     parser().next_expect(xml::parser::event_type::start_element);
     parser().content(content);
     stack_.push_back(parser().qname());
+    tokens_.push_back(token(stack_.back()));
 
-    const auto xml_space = qn("xml", "space");
+    const auto &xml_space = qn(xml_token::xml_space);
     preserve_space_ = parser().attribute_present(xml_space) ? parser().attribute(xml_space) == "preserve" : false;
 
     return stack_.back();
@@ -2867,8 +3098,20 @@ void xlsx_consumer::expect_start_element(const xml::qname &name, xml::content co
     parser().next_expect(xml::parser::event_type::start_element, name);
     parser().content(content);
     stack_.push_back(name);
+    tokens_.push_back(token(name));
 
-    const auto xml_space = qn("xml", "space");
+    const auto &xml_space = qn(xml_token::xml_space);
+    preserve_space_ = parser().attribute_present(xml_space) ? parser().attribute(xml_space) == "preserve" : false;
+}
+
+void xlsx_consumer::expect_start_element(xml_token name, xml::content content)
+{
+    parser().next_expect(xml::parser::event_type::start_element, qn(name));
+    parser().content(content);
+    stack_.push_back(qn(name));
+    tokens_.push_back(name);
+
+    const auto &xml_space = qn(xml_token::xml_space);
     preserve_space_ = parser().attribute_present(xml_space) ? parser().attribute(xml_space) == "preserve" : false;
 }
 
@@ -2877,127 +3120,140 @@ void xlsx_consumer::expect_end_element(const xml::qname &name)
     parser().attribute_map();
     parser().next_expect(xml::parser::event_type::end_element, name);
     stack_.pop_back();
+    tokens_.pop_back();
+}
+
+void xlsx_consumer::expect_end_element(xml_token name)
+{
+    parser().attribute_map();
+    parser().next_expect(xml::parser::event_type::end_element, qn(name));
+    stack_.pop_back();
+    tokens_.pop_back();
 }
 
-rich_text xlsx_consumer::read_rich_text(const xml::qname &parent)
+rich_text xlsx_consumer::read_rich_text(xml_token parent)
 {
-    const auto &xmlns = parent.namespace_();
     rich_text t;
 
     while (in_element(parent))
     {
         auto text_element = expect_start_element(xml::content::mixed);
-        const auto xml_space = qn("xml", "space");
+        const auto &xml_space = qn(xml_token::xml_space);
         const auto preserve_space = parser().attribute_present(xml_space)
             ? parser().attribute(xml_space) == "preserve"
             : false;
         skip_attributes();
         auto text = read_text();
 
-        if (text_element == xml::qname(xmlns, "t"))
+        switch (tokens_.back())
         {
+        case xml_token::spreadsheetml_t:
             t.plain_text(text, preserve_space);
-        }
-        else if (text_element == xml::qname(xmlns, "r"))
-        {
-            rich_text_run run;
+            break;
 
-            while (in_element(xml::qname(xmlns, "r")))
+        case xml_token::spreadsheetml_r:
             {
-                auto run_element = expect_start_element(xml::content::mixed);
-                auto run_text = read_text();
+                rich_text_run run;
 
-                if (run_element == xml::qname(xmlns, "rPr"))
+                while (in_element(xml_token::spreadsheetml_r))
                 {
-                    run.second = xlnt::font();
+                    auto run_element = expect_start_element(xml::content::mixed);
+                    auto run_text = read_text();
 
-                    while (in_element(xml::qname(xmlns, "rPr")))
+                    switch (tokens_.back())
                     {
-                        auto current_run_property_element = expect_start_element(xml::content::simple);
+                    case xml_token::spreadsheetml_rPr:
+                        run.second = xlnt::font();
 
-                        if (current_run_property_element == xml::qname(xmlns, "sz"))
-                        {
-                            run.second.get().size(parser().attribute<double>("val"));
-                        }
-                        else if (current_run_property_element == xml::qname(xmlns, "rFont"))
-                        {
-                            run.second.get().name(parser().attribute("val"));
-                        }
-                        else if (current_run_property_element == xml::qname(xmlns, "color"))
-                        {
-                            run.second.get().color(read_color());
-                        }
-                        else if (current_run_property_element == xml::qname(xmlns, "family"))
-                        {
-                            run.second.get().family(parser().attribute<std::size_t>("val"));
-                        }
-                        else if (current_run_property_element == xml::qname(xmlns, "charset"))
-                        {
-                            run.second.get().charset(parser().attribute<std::size_t>("val"));
-                        }
-                        else if (current_run_property_element == xml::qname(xmlns, "scheme"))
-                        {
-                            run.second.get().scheme(parser().attribute("val"));
-                        }
-                        else if (current_run_property_element == xml::qname(xmlns, "b"))
-                        {
-                            run.second.get().bold(parser().attribute_present("val")
-                                    ? is_true(parser().attribute("val"))
-                                    : true);
-                        }
-                        else if (current_run_property_element == xml::qname(xmlns, "i"))
-                        {
-                            run.second.get().italic(parser().attribute_present("val")
-                                    ? is_true(parser().attribute("val"))
-                                    : true);
-                        }
-                        else if (current_run_property_element == xml::qname(xmlns, "u"))
+                        while (in_element(xml_token::spreadsheetml_rPr))
                         {
-                            if (parser().attribute_present("val"))
-                            {
-                                run.second.get().underline(parser().attribute<font::underline_style>("val"));
-                            }
-                            else
+                            auto current_run_property_element = expect_start_element(xml::content::simple);
+
+                            switch (tokens_.back())
                             {
-                                run.second.get().underline(font::underline_style::single);
+                            case xml_token::spreadsheetml_sz:
+                                run.second.get().size(parser().attribute<double>("val"));
+                                break;
+
+                            case xml_token::spreadsheetml_rFont:
+                                run.second.get().name(parser().attribute("val"));
+                                break;
+
+                            case xml_token::spreadsheetml_color:
+                                run.second.get().color(read_color());
+                                break;
+
+                            case xml_token::spreadsheetml_family:
+                                run.second.get().family(parser().attribute<std::size_t>("val"));
+                                break;
+
+                            case xml_token::spreadsheetml_charset:
+                                run.second.get().charset(parser().attribute<std::size_t>("val"));
+                                break;
+
+                            case xml_token::spreadsheetml_scheme:
+                                run.second.get().scheme(parser().attribute("val"));
+                                break;
+
+                            case xml_token::spreadsheetml_b:
+                                run.second.get().bold(parser().attribute_present("val")
+                                        ? is_true(parser().attribute("val"))
+                                        : true);
+                                break;
+
+                            case xml_token::spreadsheetml_i:
+                                run.second.get().italic(parser().attribute_present("val")
+                                        ? is_true(parser().attribute("val"))
+                                        : true);
+                                break;
+
+                            case xml_token::spreadsheetml_u:
+                                if (parser().attribute_present("val"))
+                                {
+                                    run.second.get().underline(parser().attribute<font::underline_style>("val"));
+                                }
+                                else
+                                {
+                                    run.second.get().underline(font::underline_style::single);
+                                }
+                                break;
+
+                            default:
+                                unexpected_element(current_run_property_element);
+                                break;
                             }
+
+                            expect_end_element(current_run_property_element);
+                            read_text();
                         }
-                        else
-                        {
-                            unexpected_element(current_run_property_element);
-                        }
+                        break;
 
-                        expect_end_element(current_run_property_element);
-                        read_text();
+                    case xml_token::spreadsheetml_t:
+                        run.first = run_text;
+                        break;
+
+                    default:
+                        unexpected_element(run_element);
+                        break;
                     }
-                }
-                else if (run_element == xml::qname(xmlns, "t"))
-                {
-                    run.first = run_text;
-                }
-                else
-                {
-                    unexpected_element(run_element);
+
+                    read_text();
+                    expect_end_element(run_element);
+                    read_text();
                 }
 
-                read_text();
-                expect_end_element(run_element);
-                read_text();
+                t.add_run(run);
+                break;
             }
 
-            t.add_run(run);
-        }
-        else if (text_element == xml::qname(xmlns, "rPh"))
-        {
+        case xml_token::spreadsheetml_rPh:
+        case xml_token::spreadsheetml_phoneticPr:
             skip_remaining_content(text_element);
-        }
-        else if (text_element == xml::qname(xmlns, "phoneticPr"))
-        {
-            skip_remaining_content(text_element);
-        }
-        else
-        {
+            break;
+
+        default:
             unexpected_element(text_element);
+            break;
         }
 
         read_text();
@@ -3038,6 +3294,28 @@ xlnt::color xlsx_consumer::read_color()
     return result;
 }
 
+void xlsx_consumer::read_shared_formula(cell_impl &cell, const std::string &index, const std::string &formula)
+{
+    if (!formula.empty())
+    {
+        auto &groups = current_worksheet_->shared_formulas_;
+        groups.push_back({cell_reference(cell.column_, cell.row_), formula});
+
+        xlnt::cell(&cell).formula(formula);
+        cell.shared_formula_ = static_cast<std::uint32_t>(groups.size());
+        shared_formula_groups_[index] = cell.shared_formula_;
+
+        return;
+    }
+
+    auto group = shared_formula_groups_.find(index);
+
+    if (group != shared_formula_groups_.end())
+    {
+        cell.shared_formula_ = group->second;
+    }
+}
+
 manifest &xlsx_consumer::manifest()
 {
     return target_.manifest();
@@ -32,13 +32,20 @@
 #include <unordered_map>
 #include <vector>
 
+#include <xlnt/cell/cell_reference.hpp>
+#include <xlnt/utils/optional.hpp>
+#include <xlnt/worksheet/row_properties.hpp>
 #include <detail/external/include_libstudxml.hpp>
+#include <detail/serialization/instrumentation.hpp>
+#include <detail/serialization/progress_monitor.hpp>
+#include <detail/serialization/xml_vocabulary.hpp>
 #include <detail/serialization/zstream.hpp>
 
 namespace xlnt {
 
 class cell;
 class color;
+class load_options;
 class rich_text;
 class manifest;
 template<typename T>
@@ -53,9 +60,43 @@ class worksheet;
 namespace detail {
 
 class izstream;
+class sheet_data_chunks;
 struct cell_impl;
+struct number_converter;
+struct source_package;
 struct worksheet_impl;
 
+/// <summary>
+/// A CT_Cell read from sheetData but not yet added to a worksheet.
+/// </summary>
+struct sheet_cell
+{
+    cell_reference reference;
+    std::string type;
+    bool has_format = false;
+    std::size_t format = 0;
+    bool has_value = false;
+    std::string value;
+    /// <summary>
+    /// The value converted to a number for the numeric and shared string types.
+    /// </summary>
+    double number = 0;
+    bool has_formula = false;
+    bool has_shared_formula = false;
+    std::string shared_formula_index;
+    std::string formula;
+};
+
+/// <summary>
+/// A CT_Row read from sheetData but not yet added to a worksheet.
+/// </summary>
+struct sheet_row
+{
+    row_t index = 0;
+    row_properties properties;
+    std::vector<sheet_cell> cells;
+};
+
 /// <summary>
 /// Handles writing a workbook into an XLSX file.
 /// </summary>
@@ -68,8 +109,23 @@ public:
 
 	void read(std::istream &source);
 
+	void read(std::istream &source, const load_options &options);
+
 	void read(std::istream &source, const std::string &password);
 
+	/// <summary>
+	/// Reads a package held in memory, such as a mapped file, straight from memory.
+	/// </summary>
+	void read(const std::uint8_t *data, std::size_t size, const load_options &options);
+
+	void read(const std::uint8_t *data, std::size_t size, const std::string &password);
+
+	/// <summary>
+	/// Reads source and attaches it to the workbook for xlsx_producer to copy
+	/// unchanged parts from.
+	/// </summary>
+	void read(std::shared_ptr<source_package> source, const load_options &options);
+
 private:
     friend class xlnt::streaming_workbook_reader;
 
@@ -90,6 +146,11 @@ private:
 	/// </summary>
 	void populate_workbook(bool streaming);
 
+	/// <summary>
+	/// Reads the workbook from archive_ which has just been opened.
+	/// </summary>
+	void read_archive(const load_options &options);
+
     /// <summary>
     ///
     /// </summary>
@@ -212,6 +273,34 @@ private:
     /// </summary>
     void read_worksheet_sheetdata();
 
+    /// <summary>
+    /// Reads the next CT_Row in sheetData into row, reusing its cells.
+    /// </summary>
+    void read_row(sheet_row &row, number_converter &converter);
+
+    /// <summary>
+    /// Adds row, as read by read_row, to the current worksheet.
+    /// </summary>
+    void add_row(sheet_row &row);
+
+    /// <summary>
+    /// Inflates the worksheet part at part_path and, if it can be divided into chunks of
+    /// rows, reads them on parse_threads_ threads. Returns false, having read nothing,
+    /// if the part is too small for this to be worthwhile.
+    /// </summary>
+    bool read_worksheet_in_parallel(const path &part_path, const std::string &rel_id);
+
+    /// <summary>
+    /// Reads sheet_data_ on parse_threads_ threads and adds its rows to the current
+    /// worksheet in order.
+    /// </summary>
+    void read_sheet_data_chunks();
+
+    /// <summary>
+    /// Reads all the rows of a chunk from sheet_data_chunks::open into rows.
+    /// </summary>
+    void read_sheet_data_chunk(std::streambuf &chunk, std::vector<sheet_row> &rows);
+
     /// <summary>
     /// xl/sheets/*.xml
     /// </summary>
@@ -267,7 +356,13 @@ private:
     /// <summary>
     /// Read a rich text CT_RElt from the document currently being parsed.
     /// </summary>
-    rich_text read_rich_text(const xml::qname &parent);
+    rich_text read_rich_text(xml_token parent);
+
+    /// <summary>
+    /// Adds cell to the shared formula group identified in the worksheet part by index.
+    /// The first cell of a group carries its formula and becomes its anchor.
+    /// </summary>
+    void read_shared_formula(cell_impl &cell, const std::string &index, const std::string &formula);
 
     /// <summary>
     /// Returns true if the givent document type represents an XLSX file.
@@ -345,18 +440,33 @@ private:
     /// </summary>
     void expect_start_element(const xml::qname &name, xml::content content);
 
+    /// <summary>
+    /// Same as above but avoids looking up the token of name.
+    /// </summary>
+    void expect_start_element(xml_token name, xml::content content);
+
     /// <summary>
     /// Throws an exception if the next event in the XML parser is not
     /// the end of element called name.
     /// </summary>
     void expect_end_element(const xml::qname &name);
 
+    /// <summary>
+    /// Same as above for a name in the vocabulary.
+    /// </summary>
+    void expect_end_element(xml_token name);
+
     /// <summary>
     /// Returns true if the top of the parsing stack is called name and
     /// the end of that element hasn't been reached in the XML document.
     /// </summary>
     bool in_element(const xml::qname &name);
 
+    /// <summary>
+    /// Same as above but compares tokens instead of qualified names.
+    /// </summary>
+    bool in_element(xml_token name);
+
     // Properties
 
 	/// <summary>
@@ -375,6 +485,31 @@ private:
 	/// </summary>
 	std::unique_ptr<izstream> archive_;
 
+	/// <summary>
+	/// Collects statistics about the parts read if requested in the load_options.
+	/// </summary>
+	instrumentation instrumentation_;
+
+	/// <summary>
+	/// Reports progress and checks for cancellation as requested in the load_options.
+	/// </summary>
+	progress_monitor progress_;
+
+	/// <summary>
+	/// True if large parts should be inflated on a separate thread as requested in the load_options.
+	/// </summary>
+	bool pipeline_ = false;
+
+	/// <summary>
+	/// The number of threads which read the rows of a large worksheet as requested in the load_options.
+	/// </summary>
+	std::size_t parse_threads_ = 1;
+
+	/// <summary>
+	/// The rows of the worksheet being read when they are read in parallel, otherwise null.
+	/// </summary>
+	const sheet_data_chunks *sheet_data_ = nullptr;
+
 	/// <summary>
 	/// Map of sheet titles to relationship IDs.
 	/// </summary>
@@ -400,6 +535,12 @@ private:
 
     std::vector<xml::qname> stack_;
 
+    /// <summary>
+    /// The token of each element in stack_, xml_token::unknown if it isn't
+    /// in the vocabulary.
+    /// </summary>
+    std::vector<xml_token> tokens_;
+
     bool preserve_space_ = false;
 
     bool streaming_ = false;
@@ -409,6 +550,12 @@ private:
     detail::cell_impl *current_cell_;
 
     detail::worksheet_impl *current_worksheet_;
+
+    /// <summary>
+    /// Maps the si attribute of shared formulas in the current worksheet part to
+    /// one plus the index of their group in the worksheet.
+    /// </summary>
+    std::unordered_map<std::string, std::uint32_t> shared_formula_groups_;
 };
 
 } // namespace detail
@@ -21,15 +21,20 @@
 // @license: http://www.opensource.org/licenses/mit-license.php
 // @author: see AUTHORS file
 
+#include <algorithm>
 #include <cmath>
 #include <numeric> // for std::accumulate
 #include <string>
+#include <thread>
 #include <unordered_set>
 
 #include <detail/constants.hpp>
+#include <detail/formula/shared_formula.hpp>
 #include <detail/implementations/workbook_impl.hpp>
 #include <detail/header_footer/header_footer_code.hpp>
 #include <detail/serialization/custom_value_traits.hpp>
+#include <detail/serialization/pipeline.hpp>
+#include <detail/serialization/source_package.hpp>
 #include <detail/serialization/vector_streambuf.hpp>
 #include <detail/serialization/xlsx_producer.hpp>
 #include <detail/serialization/zstream.hpp>
@@ -39,6 +44,7 @@
 #include <xlnt/utils/path.hpp>
 #include <xlnt/utils/scoped_enum_hash.hpp>
 #include <xlnt/utils/serialisation_utils.hpp>
+#include <xlnt/workbook/serialization_options.hpp>
 #include <xlnt/workbook/workbook.hpp>
 #include <xlnt/workbook/workbook_view.hpp>
 #include <xlnt/worksheet/header_footer.hpp>
@@ -73,6 +79,155 @@ std::vector<std::pair<std::string, std::string>> core_property_namespace(xlnt::c
     return {{constants::ns("core-properties"), "cp"}};
 }
 
+// Same as cell::garbage_collectible, but looks up whether the cell is merged in ws.
+// Cells read without copying may still be parented to the worksheet ws was copied from.
+// How a shared formula group is written: the first cell of the group in the
+// sheet carries the formula and the range covering every cell in the group.
+struct shared_formula_group
+{
+    std::size_t index;
+    std::size_t cells;
+    xlnt::row_t top;
+    xlnt::column_t::index_t left;
+    xlnt::row_t bottom;
+    xlnt::column_t::index_t right;
+    xlnt::cell_reference first;
+};
+
+// Returns the shared formula groups of ws with more than one cell, keyed by the
+// group number stored in their cells, numbered in the order they'll be written.
+std::unordered_map<std::uint32_t, shared_formula_group> find_shared_formula_groups(const xlnt::detail::worksheet_impl &ws)
+{
+    std::unordered_map<std::uint32_t, shared_formula_group> groups;
+
+    ws.cell_map_.for_each_row([&groups](xlnt::row_t row, const xlnt::detail::cell_store::row_type &cells) {
+        for (const auto &cell : cells)
+        {
+            const auto id = cell.second.shared_formula_;
+            if (id == 0) continue;
+
+            const auto column = cell.first.index;
+            const auto reference = xlnt::cell_reference(cell.first, row);
+            auto found = groups.find(id);
+
+            if (found == groups.end())
+            {
+                groups[id] = {0, 1, row, column, row, column, reference};
+                continue;
+            }
+
+            auto &group = found->second;
+            ++group.cells;
+            group.top = std::min(group.top, row);
+            group.bottom = std::max(group.bottom, row);
+            group.left = std::min(group.left, column);
+            group.right = std::max(group.right, column);
+
+            if (row < group.first.row()
+                || (row == group.first.row() && cell.first < group.first.column()))
+            {
+                group.first = reference;
+            }
+        }
+    });
+
+    std::vector<std::pair<xlnt::cell_reference, std::uint32_t>> order;
+
+    for (auto it = groups.begin(); it != groups.end();)
+    {
+        if (it->second.cells < 2)
+        {
+            it = groups.erase(it);
+            continue;
+        }
+
+        order.emplace_back(it->second.first, it->first);
+        ++it;
+    }
+
+    std::sort(order.begin(), order.end(), [](const std::pair<xlnt::cell_reference, std::uint32_t> &a,
+        const std::pair<xlnt::cell_reference, std::uint32_t> &b) {
+        return a.first.row() < b.first.row()
+            || (a.first.row() == b.first.row() && a.first.column() < b.first.column());
+    });
+
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        groups[order[i].second].index = i;
+    }
+
+    return groups;
+}
+
+// Returns the path in the package of the internal target of rel, a relationship of source.
+xlnt::path resolve_part(const xlnt::path &source, const xlnt::relationship &rel)
+{
+    const auto &target = rel.target().path();
+    auto archive_path = target.is_absolute() || source == xlnt::path("/")
+        ? target
+        : source.parent().append(target);
+
+    std::vector<std::string> components;
+
+    for (const auto &component : archive_path.split())
+    {
+        if (component.empty() || component == ".") continue;
+
+        if (component == "..")
+        {
+            if (!components.empty()) components.pop_back();
+            continue;
+        }
+
+        components.push_back(component);
+    }
+
+    return std::accumulate(components.begin(), components.end(), xlnt::path(""),
+        [](const xlnt::path &a, const std::string &b) { return a.append(b); });
+}
+
+void check_compression(const xlnt::compression_options &compression)
+{
+    if (compression.level < -1 || compression.level > 9 || compression.buffer_size < 64)
+    {
+        throw xlnt::invalid_parameter();
+    }
+}
+
+// Returns the parts reachable from the package root through internal relationships along
+// with their relationship parts. The calculation chain is left out since it's never
+// written and would be stale if any formula changed.
+std::unordered_set<std::string> reachable_parts(const xlnt::manifest &manifest)
+{
+    std::unordered_set<std::string> reachable{"_rels/.rels"};
+    std::vector<xlnt::path> pending{xlnt::path("/")};
+
+    while (!pending.empty())
+    {
+        const auto part = pending.back();
+        pending.pop_back();
+
+        for (const auto &rel : manifest.relationships(part))
+        {
+            if (rel.target_mode() == xlnt::target_mode::external
+                || rel.type() == xlnt::relationship_type::calculation_chain)
+            {
+                continue;
+            }
+
+            const auto target = resolve_part(part, rel);
+
+            if (reachable.insert(target.string()).second)
+            {
+                reachable.insert(target.parent().append("_rels").append(target.filename() + ".rels").string());
+                pending.push_back(target);
+            }
+        }
+    }
+
+    return reachable;
+}
+
 } // namespace
 
 namespace xlnt {
@@ -80,20 +235,86 @@ namespace detail {
 
 xlsx_producer::xlsx_producer(const workbook &target)
     : source_(target),
+      source_package_(target.d_->source_.get()),
       current_part_stream_(nullptr)
 {
 }
 
 xlsx_producer::~xlsx_producer()
 {
-    end_part();
+    // not end_part, which may throw
+    current_part_serializer_.reset();
+    current_part_streambuf_.reset();
     archive_.reset();
 }
 
 void xlsx_producer::write(std::ostream &destination)
 {
+    write(destination, save_options());
+}
+
+void xlsx_producer::write(std::ostream &destination, const save_options &options)
+{
+    check_compression(options.compression);
+    compression_ = options.compression;
+    pipeline_ = options.pipeline;
+    options_ = &options;
+    write_threads_ = options.write_threads == 0
+        ? std::max(std::thread::hardware_concurrency(), 1u)
+        : options.write_threads;
+
+    // Reading a cell may page rows in and out, which isn't safe to do on several threads
+    if (source_.d_->spill_)
+    {
+        write_threads_ = 1;
+    }
+
+    for (const auto &type_compression : options.part_compression)
+    {
+        check_compression(type_compression.second);
+    }
+
+    if (!options.part_compression.empty())
+    {
+        const auto &manifest = source_.manifest();
+
+        for (const auto &part : manifest.parts())
+        {
+            for (const auto &rel : manifest.relationships(part))
+            {
+                const auto match = options.part_compression.find(rel.type());
+
+                if (rel.target_mode() == target_mode::internal && match != options.part_compression.end())
+                {
+                    part_compression_[resolve_part(part, rel).string()] = match->second;
+                }
+            }
+        }
+    }
+
+    instrumentation_.start(options.statistics);
     archive_.reset(new ozstream(destination));
+    archive_->instrument(&instrumentation_);
+    archive_->monitor(&progress_);
+    progress_.start(options.progress, options.progress_interval, options.cancellation, 0);
     populate_archive(false);
+    end_part();
+    archive_.reset();
+    progress_.finish();
+    instrumentation_.finish();
+    options_ = nullptr;
+}
+
+void xlsx_producer::write_snapshot(std::ostream &destination)
+{
+    save_options options;
+    options.compression = compression_options::stored();
+
+    // every part is written since the parts of a kept source package have cells in them
+    source_package_ = nullptr;
+    snapshot_ = true;
+    write(destination, options);
+    snapshot_ = false;
 }
 
 void xlsx_producer::open(std::ostream &destination)
@@ -106,6 +327,7 @@ cell xlsx_producer::add_cell(const cell_reference &ref)
 {
     current_cell_->column_ = ref.column();
     current_cell_->row_ = ref.row();
+    current_worksheet_->cell_map_.handed_out(*current_cell_, current_worksheet_);
 
     return cell(current_cell_);
 }
@@ -158,8 +380,8 @@ void xlsx_producer::populate_archive(bool streaming)
 
     // Unknown Parts
 
-    void write_unknown_parts();
-    void write_unknown_relationships();
+    write_unknown_parts();
+    write_unknown_relationships();
 
     end_part();
 }
@@ -171,17 +393,93 @@ void xlsx_producer::end_part()
         current_part_serializer_.reset();
     }
 
-    current_part_streambuf_.reset();
+    auto streambuf = std::move(current_part_streambuf_);
+    auto pipeline = current_part_pipeline_;
+    current_part_pipeline_ = nullptr;
+
+    if (pipeline != nullptr)
+    {
+        // an error writing the last blocks can only be reported from here
+        pipeline->close();
+    }
 }
 
-void xlsx_producer::begin_part(const path &part)
+void xlsx_producer::begin_part(const path &part, bool pipelined)
 {
     end_part();
-    current_part_streambuf_ = archive_->open(part);
+    progress_.check();
+    written_parts_.insert(part.string());
+    current_part_streambuf_ = archive_->open(part, part_compression(part), pipelined && pipeline_);
+    current_part_pipeline_ = pipelined && pipeline_
+        ? static_cast<pipelined_ostreambuf *>(current_part_streambuf_.get())
+        : nullptr;
     current_part_stream_.rdbuf(current_part_streambuf_.get());
     current_part_serializer_.reset(new xml::serializer(current_part_stream_, part.string()));
 }
 
+bool xlsx_producer::copy_part(const path &part)
+{
+    if (source_package_ == nullptr
+        || !source_package_->archive_->has_file(part)
+        || written_parts_.count(part.string()) != 0)
+    {
+        return false;
+    }
+
+    end_part();
+    progress_.check();
+    written_parts_.insert(part.string());
+    archive_->copy(*source_package_->archive_, part);
+
+    return true;
+}
+
+bool xlsx_producer::copy_unchanged_part(const relationship &rel, const path &part)
+{
+    if (source_package_ == nullptr) return false;
+
+    switch (rel.type())
+    {
+    case relationship_type::worksheet:
+        // the worksheet's relationships and their targets are copied by write_unknown_parts
+        return worksheet_unchanged(part) && copy_part(part);
+
+    case relationship_type::stylesheet:
+        return source_package_->styles_unchanged(*source_.d_) && copy_part(part);
+
+    case relationship_type::shared_string_table:
+        // strings are only ever appended so the indices in unchanged worksheets stay valid
+        return source_.d_->shared_strings_.size() == source_package_->shared_strings_
+            && copy_part(part);
+
+    case relationship_type::theme:
+        return false;
+
+    default:
+        // parts xlnt doesn't read, which it would otherwise write empty
+        return copy_part(part);
+    }
+}
+
+const compression_options &xlsx_producer::part_compression(const path &part) const
+{
+    const auto match = part_compression_.find(part.string());
+    return match == part_compression_.end() ? compression_ : match->second;
+}
+
+bool xlsx_producer::worksheet_unchanged(const path &part) const
+{
+    if (source_package_ == nullptr) return false;
+
+    auto ws = std::find_if(source_.d_->worksheets_.begin(), source_.d_->worksheets_.end(),
+        [&](const worksheet_impl &impl) {
+            return impl.source_part_.is_set() && impl.source_part_.get() == part;
+        });
+
+    return ws != source_.d_->worksheets_.end()
+        && source_package_->styles_unchanged(*source_.d_);
+}
+
 // Package Parts
 
 void xlsx_producer::write_content_types()
@@ -670,108 +968,224 @@ void xlsx_producer::write_workbook(const relationship &rel)
     auto workbook_rels = source_.manifest().relationships(rel.target().path());
     write_relationships(workbook_rels, rel.target().path());
 
-    for (const auto &child_rel : workbook_rels)
+    // worksheets which have to be written, written on other threads if there are enough
+    std::vector<std::size_t> rendered_rels;
+
+    for (std::size_t i = 0; write_threads_ > 1 && !streaming_ && i < workbook_rels.size(); ++i)
     {
-        if (child_rel.type() == relationship_type::calculation_chain) continue;
+        const auto &child_rel = workbook_rels[i];
+        if (child_rel.type() != relationship_type::worksheet) continue;
 
         path archive_path(child_rel.source().path().parent().append(child_rel.target().path()));
-        begin_part(archive_path);
+        if (worksheet_unchanged(archive_path)) continue;
 
-        switch (child_rel.type())
-        {
-        case relationship_type::chartsheet:
-            write_chartsheet(child_rel);
-            break;
+        rendered_rels.push_back(i);
+    }
 
-        case relationship_type::connections:
-            write_connections(child_rel);
-            break;
+    if (rendered_rels.size() < 2)
+    {
+        rendered_rels.clear();
+    }
 
-        case relationship_type::custom_xml_mappings:
-            write_custom_xml_mappings(child_rel);
-            break;
+    std::vector<std::vector<std::uint8_t>> rendered(rendered_rels.size());
+    std::vector<serialization_statistics> rendered_statistics(rendered_rels.size());
+    std::vector<std::uint64_t> rendered_rows(rendered_rels.size());
+    std::size_t next_rel = 0;
 
-        case relationship_type::dialogsheet:
-            write_dialogsheet(child_rel);
-            break;
+    // the other parts are written on this thread in between
+    run_ordered(rendered_rels.size(), write_threads_, write_threads_,
+        [&](std::size_t index) {
+            auto statistics = options_->statistics == nullptr ? nullptr : &rendered_statistics[index];
+            xlsx_producer worker(source_);
+            rendered_rows[index] = worker.render_worksheet(
+                *this, workbook_rels[rendered_rels[index]], rendered[index], statistics);
+        },
+        [&](std::size_t index) {
+            for (; next_rel < rendered_rels[index]; ++next_rel)
+            {
+                write_workbook_part(workbook_rels[next_rel]);
+            }
 
-        case relationship_type::external_workbook_references:
-            write_external_workbook_references(child_rel);
-            break;
+            copy_rendered(rendered[index]);
+            instrumentation_.merge(rendered_statistics[index]);
+            progress_.add_rows(rendered_rows[index]);
+            std::vector<std::uint8_t>().swap(rendered[index]);
+            ++next_rel;
+        });
 
-        case relationship_type::pivot_table:
-            write_pivot_table(child_rel);
-            break;
+    for (; next_rel < workbook_rels.size(); ++next_rel)
+    {
+        write_workbook_part(workbook_rels[next_rel]);
+    }
+}
 
-        case relationship_type::shared_string_table:
-            write_shared_string_table(child_rel);
-            break;
+void xlsx_producer::write_workbook_part(const relationship &child_rel)
+{
+    if (child_rel.type() == relationship_type::calculation_chain) return;
 
-        case relationship_type::shared_workbook_revision_headers:
-            write_shared_workbook_revision_headers(child_rel);
-            break;
+    path archive_path(child_rel.source().path().parent().append(child_rel.target().path()));
 
-        case relationship_type::stylesheet:
-            write_styles(child_rel);
-            break;
+    if (copy_unchanged_part(child_rel, archive_path)) return;
 
-        case relationship_type::theme:
-            write_theme(child_rel);
-            break;
+    begin_part(archive_path, child_rel.type() == relationship_type::worksheet
+            || child_rel.type() == relationship_type::shared_string_table);
 
-        case relationship_type::volatile_dependencies:
-            write_volatile_dependencies(child_rel);
-            break;
+    switch (child_rel.type())
+    {
+    case relationship_type::chartsheet:
+        write_chartsheet(child_rel);
+        break;
 
-        case relationship_type::worksheet:
-            write_worksheet(child_rel);
-            break;
+    case relationship_type::connections:
+        write_connections(child_rel);
+        break;
 
-        case relationship_type::calculation_chain:
-            break;
-        case relationship_type::office_document:
-            break;
-        case relationship_type::thumbnail:
-            break;
-        case relationship_type::extended_properties:
-            break;
-        case relationship_type::core_properties:
-            break;
-        case relationship_type::hyperlink:
-            break;
-        case relationship_type::comments:
-            break;
-        case relationship_type::vml_drawing:
-            break;
-        case relationship_type::unknown:
-            break;
-        case relationship_type::custom_properties:
-            break;
-        case relationship_type::printer_settings:
-            break;
-        case relationship_type::custom_property:
-            break;
-        case relationship_type::drawings:
-            break;
-        case relationship_type::pivot_table_cache_definition:
-            break;
-        case relationship_type::pivot_table_cache_records:
-            break;
-        case relationship_type::query_table:
-            break;
-        case relationship_type::shared_workbook:
-            break;
-        case relationship_type::revision_log:
-            break;
-        case relationship_type::shared_workbook_user_data:
-            break;
-        case relationship_type::single_cell_table_definitions:
-            break;
-        case relationship_type::table_definition:
-            break;
-        case relationship_type::image:
-            break;
-        }
+    case relationship_type::custom_xml_mappings:
+        write_custom_xml_mappings(child_rel);
+        break;
+
+    case relationship_type::dialogsheet:
+        write_dialogsheet(child_rel);
+        break;
+
+    case relationship_type::external_workbook_references:
+        write_external_workbook_references(child_rel);
+        break;
+
+    case relationship_type::pivot_table:
+        write_pivot_table(child_rel);
+        break;
+
+    case relationship_type::shared_string_table:
+        write_shared_string_table(child_rel);
+        break;
+
+    case relationship_type::shared_workbook_revision_headers:
+        write_shared_workbook_revision_headers(child_rel);
+        break;
+
+    case relationship_type::stylesheet:
+        write_styles(child_rel);
+        break;
+
+    case relationship_type::theme:
+        write_theme(child_rel);
+        break;
+
+    case relationship_type::volatile_dependencies:
+        write_volatile_dependencies(child_rel);
+        break;
+
+    case relationship_type::worksheet:
+        write_worksheet(child_rel);
+        break;
+
+    case relationship_type::calculation_chain:
+        break;
+    case relationship_type::office_document:
+        break;
+    case relationship_type::thumbnail:
+        break;
+    case relationship_type::extended_properties:
+        break;
+    case relationship_type::core_properties:
+        break;
+    case relationship_type::hyperlink:
+        break;
+    case relationship_type::comments:
+        break;
+    case relationship_type::vml_drawing:
+        break;
+    case relationship_type::unknown:
+        break;
+    case relationship_type::custom_properties:
+        break;
+    case relationship_type::printer_settings:
+        break;
+    case relationship_type::custom_property:
+        break;
+    case relationship_type::drawings:
+        break;
+    case relationship_type::pivot_table_cache_definition:
+        break;
+    case relationship_type::pivot_table_cache_records:
+        break;
+    case relationship_type::query_table:
+        break;
+    case relationship_type::shared_workbook:
+        break;
+    case relationship_type::revision_log:
+        break;
+    case relationship_type::shared_workbook_user_data:
+        break;
+    case relationship_type::single_cell_table_definitions:
+        break;
+    case relationship_type::table_definition:
+        break;
+    case relationship_type::image:
+        break;
+    }
+}
+
+std::uint64_t xlsx_producer::render_worksheet(const xlsx_producer &parent, const relationship &rel,
+    std::vector<std::uint8_t> &rendered, serialization_statistics *statistics)
+{
+    compression_ = parent.compression_;
+    part_compression_ = parent.part_compression_;
+
+    if (statistics != nullptr)
+    {
+        statistics->allocation_counter = parent.options_->statistics->allocation_counter;
+    }
+
+    instrumentation_.start(statistics);
+    progress_.start(nullptr, 1, parent.options_->cancellation, 0);
+
+    vector_ostreambuf rendered_buffer(rendered);
+    std::ostream rendered_stream(&rendered_buffer);
+    archive_.reset(new ozstream(rendered_stream));
+    archive_->instrument(&instrumentation_);
+
+    path archive_path(rel.source().path().parent().append(rel.target().path()));
+
+    try
+    {
+        begin_part(archive_path);
+        write_worksheet(rel);
+    }
+    catch (...)
+    {
+        // the archive writes to rendered_stream as it's closed
+        end_part();
+        archive_.reset();
+        throw;
+    }
+
+    end_part();
+    archive_.reset();
+    instrumentation_.finish();
+
+    return progress_.rows();
+}
+
+void xlsx_producer::copy_rendered(const std::vector<std::uint8_t> &rendered)
+{
+    end_part();
+
+    const izstream package(rendered.data(), rendered.size());
+    auto files = package.files();
+
+    std::sort(files.begin(), files.end(), [&package](const path &a, const path &b) {
+        return package.header(a).header_offset < package.header(b).header_offset;
+    });
+
+    for (const auto &file : files)
+    {
+        // a part referred to by several worksheets, such as an image, is written once
+        if (!written_parts_.insert(file.string()).second) continue;
+
+        progress_.check();
+        archive_->copy(package, file);
     }
 }
 
@@ -820,6 +1234,16 @@ void xlsx_producer::write_shared_string_table(const relationship & /*rel*/)
     write_start_element(xmlns, "sst");
     write_namespace(xmlns, "");
 
+    // a snapshot stores the strings itself
+    if (snapshot_)
+    {
+        write_attribute("count", 0);
+        write_attribute("uniqueCount", 0);
+        write_end_element(xmlns, "sst");
+
+        return;
+    }
+
     // todo: is there a more elegant way to get this number?
     std::size_t string_count = 0;
 
@@ -850,16 +1274,16 @@ void xlsx_producer::write_shared_string_table(const relationship & /*rel*/)
 #pragma clang diagnostic pop
 
     write_attribute("count", string_count);
-    write_attribute("uniqueCount", source_.shared_strings_by_id().size());
+    write_attribute("uniqueCount", source_.d_->shared_strings_.size());
 
-    for (const auto &string : source_.shared_strings_by_id())
+    for (const auto &string : source_.d_->shared_strings_.values())
     {
-        if (string.second.runs().size() == 1 && !string.second.runs().at(0).second.is_set())
+        if (string.runs().size() == 1 && !string.runs().at(0).second.is_set())
         {
             write_start_element(xmlns, "si");
             write_start_element(xmlns, "t");
 
-            write_characters(string.second.plain_text(), string.second.runs().front().preserve_space);
+            write_characters(string.plain_text(), string.runs().front().preserve_space);
 
             write_end_element(xmlns, "t");
             write_end_element(xmlns, "si");
@@ -869,7 +1293,7 @@ void xlsx_producer::write_shared_string_table(const relationship & /*rel*/)
 
         write_start_element(xmlns, "si");
 
-        for (const auto &run : string.second.runs())
+        for (const auto &run : string.runs())
         {
             write_start_element(xmlns, "r");
 
@@ -931,6 +1355,8 @@ void xlsx_producer::write_shared_string_table(const relationship & /*rel*/)
     }
 
     write_end_element(xmlns, "sst");
+
+    instrumentation_.count_shared_strings(source_.d_->shared_strings_.size());
 }
 
 void xlsx_producer::write_shared_workbook_revision_headers(const relationship & /*rel*/)
@@ -1434,6 +1860,7 @@ void xlsx_producer::write_styles(const relationship & /*rel*/)
 
     write_start_element(xmlns, "cellXfs");
     write_attribute("count", stylesheet.format_impls.size());
+    instrumentation_.count_formats(stylesheet.format_impls.size());
 
     for (auto &current_format_impl : stylesheet.format_impls)
     {
@@ -2180,7 +2607,10 @@ void xlsx_producer::write_worksheet(const relationship &rel)
                 return true;
             }
 
-            for (auto row = ws.lowest_row(); row <= ws.highest_row(); ++row)
+            // highest_row looks at every row so it's only called once
+            const auto last_row = ws.highest_row();
+
+            for (auto row = ws.lowest_row(); row <= last_row; ++row)
             {
                 if (ws.has_row_properties(row) && ws.row_properties(row).dy_descent.is_set())
                 {
@@ -2423,6 +2853,46 @@ void xlsx_producer::write_worksheet(const relationship &rel)
 
     std::vector<std::pair<std::string, hyperlink>> hyperlinks;
     std::vector<cell_reference> cells_with_comments;
+    const auto shared_formulas = snapshot_
+        ? std::unordered_map<std::uint32_t, shared_formula_group>()
+        : find_shared_formula_groups(*ws.d_);
+
+    // A snapshot stores the cells itself, so only the comments and hyperlinks
+    // referring to them are written, including those of otherwise empty cells.
+    if (snapshot_)
+    {
+        std::vector<const detail::cell_impl *> referred;
+
+        ws.d_->cell_map_.for_each_row([&referred](row_t, const detail::cell_store::row_type &cells) {
+            for (const auto &entry : cells)
+            {
+                if (entry.second.comment_ || entry.second.hyperlink_.is_set())
+                {
+                    referred.push_back(&entry.second);
+                }
+            }
+        });
+
+        std::sort(referred.begin(), referred.end(), [](const detail::cell_impl *a, const detail::cell_impl *b) {
+            return a->row_ < b->row_ || (a->row_ == b->row_ && a->column_ < b->column_);
+        });
+
+        for (auto impl : referred)
+        {
+            const auto reference = cell_reference(impl->column_, impl->row_);
+
+            if (impl->comment_)
+            {
+                cells_with_comments.push_back(reference);
+            }
+
+            if (impl->hyperlink_.is_set())
+            {
+                hyperlinks.push_back(std::make_pair(reference.to_string(),
+                    xlnt::hyperlink(const_cast<detail::hyperlink_impl *>(&impl->hyperlink_.get()))));
+            }
+        }
+    }
 
     write_start_element(xmlns, "sheetData");
     auto first_row = ws.lowest_row_or_props();
@@ -2445,16 +2915,15 @@ void xlsx_producer::write_worksheet(const relationship &rel)
             last_check_row = ((row / 16) + 1) * 16;
         }
 
-        for (auto check_row = first_check_row; check_row <= last_check_row; ++check_row)
+        for (auto check_row = first_check_row; !snapshot_ && check_row <= last_check_row; ++check_row)
         {
             for (auto column = dimension.top_left().column(); column <= dimension.bottom_right().column(); ++column)
             {
-                if (!ws.has_cell(cell_reference(column, row))) continue;
-                auto cell = ws.cell(cell_reference(column, row));
-                if (cell.garbage_collectible()) continue;
+                auto impl = ws.d_->cell_map_.find(row, column);
+                if (impl == nullptr || ws.d_->garbage_collectible(*impl)) continue;
 
-                first_block_column = std::min(first_block_column, cell.column());
-                last_block_column = std::max(last_block_column, cell.column());
+                first_block_column = std::min(first_block_column, impl->column_);
+                last_block_column = std::max(last_block_column, impl->column_);
 
                 if (row == check_row)
                 {
@@ -2467,6 +2936,8 @@ void xlsx_producer::write_worksheet(const relationship &rel)
 
         write_start_element(xmlns, "row");
         write_attribute("r", row);
+        instrumentation_.count_row();
+        progress_.row();
 
         auto span_string = std::to_string(first_block_column.index) + ":"
             + std::to_string(last_block_column.index);
@@ -2511,36 +2982,39 @@ void xlsx_producer::write_worksheet(const relationship &rel)
         {
             for (auto column = dimension.top_left().column(); column <= dimension.bottom_right().column(); ++column)
             {
-                if (!ws.has_cell(cell_reference(column, row))) continue;
+                // Read the cell without copying rows shared with another worksheet, so not
+                // through a cell object, which may only refer to a cell in a row of its own
+                auto impl = ws.d_->cell_map_.find(row, column);
+                if (impl == nullptr || ws.d_->garbage_collectible(*impl)) continue;
 
-                auto cell = ws.cell(cell_reference(column, row));
-
-                if (cell.garbage_collectible()) continue;
+                const auto reference = cell_reference(impl->column_, impl->row_);
 
                 // record data about the cell needed later
 
-                if (cell.has_comment())
+                if (impl->comment_)
                 {
-                    cells_with_comments.push_back(cell.reference());
+                    cells_with_comments.push_back(reference);
                 }
 
-                if (cell.has_hyperlink())
+                if (impl->hyperlink_.is_set())
                 {
-                    hyperlinks.push_back(std::make_pair(cell.reference().to_string(), cell.hyperlink()));
+                    hyperlinks.push_back(std::make_pair(reference.to_string(),
+                        xlnt::hyperlink(const_cast<detail::hyperlink_impl *>(&impl->hyperlink_.get()))));
                 }
 
                 write_start_element(xmlns, "c");
+                instrumentation_.count_cell();
 
                 // begin cell attributes
 
-                write_attribute("r", cell.reference().to_string());
+                write_attribute("r", reference.to_string());
 
-                if (cell.has_format())
+                if (impl->format_.is_set())
                 {
-                    write_attribute("s", cell.format().d_->id);
+                    write_attribute("s", impl->format_.get()->id);
                 }
 
-                switch (cell.data_type())
+                switch (impl->type_)
                 {
                 case cell::type::empty:
                     break;
@@ -2580,47 +3054,72 @@ void xlsx_producer::write_worksheet(const relationship &rel)
 
                 // begin child elements
 
-                if (cell.has_formula())
+                const auto shared_formula = impl->shared_formula_ == 0
+                    ? shared_formulas.end()
+                    : shared_formulas.find(impl->shared_formula_);
+
+                if (shared_formula != shared_formulas.end())
+                {
+                    const auto &group = shared_formula->second;
+
+                    write_start_element(xmlns, "f");
+                    write_attribute("t", "shared");
+
+                    if (group.first == reference)
+                    {
+                        write_attribute("ref", range_reference(
+                            column_t(group.left), group.top, column_t(group.right), group.bottom).to_string());
+                        write_attribute("si", group.index);
+                        write_characters(detail::cell_formula(ws.d_->shared_formulas_, *impl));
+                    }
+                    else
+                    {
+                        write_attribute("si", group.index);
+                    }
+
+                    write_end_element(xmlns, "f");
+                }
+                else if (impl->formula_.is_set() || impl->shared_formula_ != 0)
                 {
-                    write_element(xmlns, "f", cell.formula());
+                    write_element(xmlns, "f", detail::cell_formula(ws.d_->shared_formulas_, *impl));
                 }
 
-                switch (cell.data_type())
+                switch (impl->type_)
                 {
                 case cell::type::empty:
                     break;
 
                 case cell::type::boolean:
-                    write_element(xmlns, "v", write_bool(cell.value<bool>()));
+                    write_element(xmlns, "v", write_bool(impl->value_numeric_ != 0.0));
                     break;
 
                 case cell::type::date:
-                    write_element(xmlns, "v", cell.value<std::string>());
+                    write_element(xmlns, "v", impl->value_text_.plain_text());
                     break;
 
                 case cell::type::error:
-                    write_element(xmlns, "v", cell.value<std::string>());
+                    write_element(xmlns, "v", impl->value_text_.plain_text());
                     break;
 
                 case cell::type::inline_string:
                     write_start_element(xmlns, "is");
                     // TODO: make a write_rich_text method and use that here
-                    write_element(xmlns, "t", cell.value<std::string>());
+                    write_element(xmlns, "t", impl->value_text_.plain_text());
                     write_end_element(xmlns, "is");
                     break;
 
                 case cell::type::number:
                     write_start_element(xmlns, "v");
-                    write_characters(serialize_number_to_string(cell.value<double>()));
+                    write_characters(serialize_number_to_string(impl->value_numeric_));
                     write_end_element(xmlns, "v");
                     break;
 
                 case cell::type::shared_string:
-                    write_element(xmlns, "v", static_cast<std::size_t>(cell.d_->value_numeric_));
+                    write_element(xmlns, "v", static_cast<std::size_t>(impl->value_numeric_));
                     break;
 
                 case cell::type::formula_string:
-                    write_element(xmlns, "v", cell.value<std::string>());
+                    write_element(xmlns, "v", impl->value_text_.plain_text());
                     break;
                 }
 
@@ -2988,25 +3487,15 @@ void xlsx_producer::write_worksheet(const relationship &rel)
         {
             if (child_rel.target_mode() == target_mode::external) continue;
 
-            // todo: this is ugly
-            path archive_path(worksheet_part.parent().append(child_rel.target().path()));
-            auto split_part_path = archive_path.split();
-            auto part_path_iter = split_part_path.begin();
+            const auto archive_path = resolve_part(worksheet_part, child_rel);
 
-            while (part_path_iter != split_part_path.end())
+            if (child_rel.type() != relationship_type::comments
+                && child_rel.type() != relationship_type::vml_drawing
+                && copy_part(archive_path))
             {
-                if (*part_path_iter == "..")
-                {
-                    part_path_iter = split_part_path.erase(part_path_iter - 1, part_path_iter + 1);
-                    continue;
-                }
-
-                ++part_path_iter;
+                continue;
             }
 
-            archive_path = std::accumulate(split_part_path.begin(), split_part_path.end(), path(""),
-                [](const path &a, const std::string &b) { return a.append(b); });
-
             begin_part(archive_path);
 
             if (child_rel.type() == relationship_type::comments)
@@ -3280,6 +3769,24 @@ void xlsx_producer::write_custom_property()
 
 void xlsx_producer::write_unknown_parts()
 {
+    if (source_package_ == nullptr) return;
+
+    const auto &archive = *source_package_->archive_;
+    const auto reachable = reachable_parts(source_.manifest());
+
+    // copy in the order of the source package so saves are repeatable
+    auto files = archive.files();
+    std::sort(files.begin(), files.end(), [&archive](const path &a, const path &b) {
+        return archive.header(a).header_offset < archive.header(b).header_offset;
+    });
+
+    for (const auto &file : files)
+    {
+        if (reachable.count(file.string()) != 0)
+        {
+            copy_part(file);
+        }
+    }
 }
 
 void xlsx_producer::write_unknown_relationships()
@@ -3288,10 +3795,19 @@ void xlsx_producer::write_unknown_relationships()
 
 void xlsx_producer::write_image(const path &image_path)
 {
+    const auto &image = source_.d_->images_.at(image_path.string());
+
+    if (source_package_ != nullptr && source_package_->archive_->matches(image_path, image)
+        && copy_part(image_path))
+    {
+        return;
+    }
+
     end_part();
+    written_parts_.insert(image_path.string());
 
-    vector_istreambuf buffer(source_.d_->images_.at(image_path.string()));
-    auto image_streambuf = archive_->open(image_path);
+    vector_istreambuf buffer(image);
+    auto image_streambuf = archive_->open(image_path, part_compression(image_path));
     std::ostream(image_streambuf.get()) << &buffer;
 }
 
@@ -26,10 +26,16 @@
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include <xlnt/workbook/serialization_options.hpp>
 #include <detail/constants.hpp>
 #include <detail/external/include_libstudxml.hpp>
+#include <detail/serialization/instrumentation.hpp>
+#include <detail/serialization/progress_monitor.hpp>
 
 namespace xml {
 class serializer;
@@ -53,7 +59,9 @@ class worksheet;
 namespace detail {
 
 class ozstream;
+class pipelined_ostreambuf;
 struct cell_impl;
+struct source_package;
 struct worksheet_impl;
 
 /// <summary>
@@ -70,6 +78,15 @@ public:
 
     void write(std::ostream &destination, const std::string &password);
 
+    void write(std::ostream &destination, const save_options &options);
+
+    /// <summary>
+    /// Writes an uncompressed package with everything but the cell values and
+    /// shared strings, which a snapshot stores separately. Cells are only referred
+    /// to by their comments and hyperlinks.
+    /// </summary>
+    void write_snapshot(std::ostream &destination);
+
 private:
     friend class xlnt::streaming_workbook_writer;
 
@@ -85,9 +102,37 @@ private:
 	/// </summary>
 	void populate_archive(bool streaming);
 
-    void begin_part(const path &part);
+    /// <summary>
+    /// Opens part for writing, on a separate thread if pipelined is true and the
+    /// save_options asked for it.
+    /// </summary>
+    void begin_part(const path &part, bool pipelined = false);
     void end_part();
 
+    /// <summary>
+    /// Copies part as it is stored in the package the workbook was loaded from if the
+    /// workbook kept it and it hasn't been written yet. Returns false if it wasn't
+    /// copied so that it can be written instead.
+    /// </summary>
+    bool copy_part(const path &part);
+
+    /// <summary>
+    /// Copies the target part of rel, a relationship of the workbook part, if it hasn't
+    /// changed since the workbook was loaded or xlnt can't write it.
+    /// </summary>
+    bool copy_unchanged_part(const relationship &rel, const path &part);
+
+    /// <summary>
+    /// Returns how part should be compressed according to the save_options.
+    /// </summary>
+    const compression_options &part_compression(const path &part) const;
+
+    /// <summary>
+    /// Returns true if the worksheet at part in the kept source package can be copied
+    /// instead of written.
+    /// </summary>
+    bool worksheet_unchanged(const path &part) const;
+
 	// Package Parts
 
 	void write_content_types();
@@ -101,6 +146,25 @@ private:
 
 	void write_workbook(const relationship &rel);
 
+    /// <summary>
+    /// Writes or copies the target of child_rel, a relationship of the workbook part.
+    /// </summary>
+    void write_workbook_part(const relationship &child_rel);
+
+    /// <summary>
+    /// Writes the worksheet which is the target of rel, along with the parts it refers
+    /// to, into a package of its own in rendered. Called on a producer of its own by the
+    /// threads in save_options::write_threads. Returns the number of rows written.
+    /// </summary>
+    std::uint64_t render_worksheet(const xlsx_producer &parent, const relationship &rel,
+        std::vector<std::uint8_t> &rendered, serialization_statistics *statistics);
+
+    /// <summary>
+    /// Copies the parts in a package from render_worksheet into the archive in the
+    /// order they were written, leaving out any which were written already.
+    /// </summary>
+    void copy_rendered(const std::vector<std::uint8_t> &rendered);
+
 	// Workbook Relationship Target Parts
 
 	void write_connections(const relationship &rel);
@@ -194,12 +258,69 @@ private:
 	const workbook &source_;
     
 	std::unique_ptr<ozstream> archive_;
+
+    /// <summary>
+    /// Collects statistics about the parts written if requested in the save_options.
+    /// </summary>
+    instrumentation instrumentation_;
+
+    /// <summary>
+    /// Reports progress and checks for cancellation as requested in the save_options.
+    /// </summary>
+    progress_monitor progress_;
+
+    /// <summary>
+    /// The package the workbook was loaded from if it was kept, otherwise null.
+    /// </summary>
+    const source_package *source_package_ = nullptr;
+
+    /// <summary>
+    /// The parts written or copied so far.
+    /// </summary>
+    std::unordered_set<std::string> written_parts_;
+
+    /// <summary>
+    /// How parts are compressed unless part_compression_ has an entry for them.
+    /// </summary>
+    compression_options compression_;
+
+    /// <summary>
+    /// The compression of each part whose relationship type has its own entry in
+    /// save_options::part_compression.
+    /// </summary>
+    std::unordered_map<std::string, compression_options> part_compression_;
+
+    /// <summary>
+    /// True if large parts should be deflated on a separate thread as requested in the save_options.
+    /// </summary>
+    bool pipeline_ = false;
+
+    /// <summary>
+    /// The options of the save in progress, null outside of write.
+    /// </summary>
+    const save_options *options_ = nullptr;
+
+    /// <summary>
+    /// The number of threads which write worksheets as requested in the save_options.
+    /// </summary>
+    std::size_t write_threads_ = 1;
+
     std::unique_ptr<xml::serializer> current_part_serializer_;
     std::unique_ptr<std::streambuf> current_part_streambuf_;
+
+    /// <summary>
+    /// current_part_streambuf_ if the current part is written on a separate thread.
+    /// </summary>
+    pipelined_ostreambuf *current_part_pipeline_ = nullptr;
     std::ostream current_part_stream_;
 
     bool streaming_ = false;
 
+    /// <summary>
+    /// True if the package is being written for a snapshot by write_snapshot.
+    /// </summary>
+    bool snapshot_ = false;
+
     std::unique_ptr<detail::cell_impl> streaming_cell_;
 
     detail::cell_impl *current_cell_;
@@ -0,0 +1,94 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <detail/constants.hpp>
+#include <detail/serialization/xml_vocabulary.hpp>
+
+namespace {
+
+#define XLNT_XML_NAMESPACE_KEY(id, key) const char *const id##_key = key;
+XLNT_XML_NAMESPACES(XLNT_XML_NAMESPACE_KEY)
+#undef XLNT_XML_NAMESPACE_KEY
+
+struct vocabulary
+{
+    vocabulary()
+    {
+#define XLNT_XML_NAME(id, name) names.emplace_back(xlnt::constants::ns(id##_key), #name);
+        XLNT_XML_VOCABULARY(XLNT_XML_NAME)
+#undef XLNT_XML_NAME
+
+        for (std::size_t i = 0; i < names.size(); ++i)
+        {
+            tokens[names[i].name()].push_back(static_cast<xlnt::detail::xml_token>(i));
+        }
+    }
+
+    // indexed by token
+    std::vector<xml::qname> names;
+
+    // local name to the tokens with that local name, usually only one
+    std::unordered_map<std::string, std::vector<xlnt::detail::xml_token>> tokens;
+};
+
+const vocabulary &instance()
+{
+    static const vocabulary *v = new vocabulary();
+    return *v;
+}
+
+} // namespace
+
+namespace xlnt {
+namespace detail {
+
+const xml::qname &qn(xml_token token)
+{
+    return instance().names[static_cast<std::size_t>(token)];
+}
+
+xml_token token(const xml::qname &name)
+{
+    const auto &v = instance();
+    const auto match = v.tokens.find(name.name());
+
+    if (match != v.tokens.end())
+    {
+        for (auto candidate : match->second)
+        {
+            if (v.names[static_cast<std::size_t>(candidate)].namespace_() == name.namespace_())
+            {
+                return candidate;
+            }
+        }
+    }
+
+    return xml_token::unknown;
+}
+
+} // namespace detail
+} // namespace xlnt
@@ -0,0 +1,241 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#pragma once
+
+#include <cstdint>
+
+#include <xlnt/xlnt_config.hpp>
+#include <detail/external/include_libstudxml.hpp>
+
+namespace xlnt {
+namespace detail {
+
+/// <summary>
+/// X(id, key) for each namespace in the vocabulary where key is the namespace's
+/// key in constants::namespaces(). The "workbook" key is omitted since it maps
+/// to the same URI as "spreadsheetml".
+/// </summary>
+#define XLNT_XML_NAMESPACES(X)                    \
+    X(content_types, "content-types")             \
+    X(core_properties, "core-properties")         \
+    X(custom_properties, "custom-properties")     \
+    X(extended_properties, "extended-properties") \
+    X(mc, "mc")                                   \
+    X(mx, "mx")                                   \
+    X(r, "r")                                     \
+    X(relationships, "relationships")             \
+    X(spreadsheetml, "spreadsheetml")             \
+    X(vt, "vt")                                   \
+    X(x14, "x14")                                 \
+    X(x14ac, "x14ac")                             \
+    X(x15ac, "x15ac")                             \
+    X(xml, "xml")                                 \
+    X(xsi, "xsi")
+
+/// <summary>
+/// X(namespace id, local name) for each qualified name read by xlsx_consumer.
+/// </summary>
+#define XLNT_XML_VOCABULARY(X)              \
+    X(content_types, Default)               \
+    X(content_types, Override)              \
+    X(content_types, Types)                 \
+    X(core_properties, coreProperties)      \
+    X(custom_properties, Properties)        \
+    X(extended_properties, Properties)      \
+    X(mc, AlternateContent)                 \
+    X(mc, Choice)                           \
+    X(mc, Ignorable)                        \
+    X(mx, ArchID)                           \
+    X(r, id)                                \
+    X(relationships, Relationship)          \
+    X(relationships, Relationships)         \
+    X(spreadsheetml, alignment)             \
+    X(spreadsheetml, author)                \
+    X(spreadsheetml, authors)               \
+    X(spreadsheetml, autoFilter)            \
+    X(spreadsheetml, b)                     \
+    X(spreadsheetml, bgColor)               \
+    X(spreadsheetml, bookViews)             \
+    X(spreadsheetml, border)                \
+    X(spreadsheetml, borders)               \
+    X(spreadsheetml, brk)                   \
+    X(spreadsheetml, c)                     \
+    X(spreadsheetml, calcPr)                \
+    X(spreadsheetml, cellStyle)             \
+    X(spreadsheetml, cellStyleXfs)          \
+    X(spreadsheetml, cellStyles)            \
+    X(spreadsheetml, cellWatches)           \
+    X(spreadsheetml, cellXfs)               \
+    X(spreadsheetml, charset)               \
+    X(spreadsheetml, col)                   \
+    X(spreadsheetml, colBreaks)             \
+    X(spreadsheetml, color)                 \
+    X(spreadsheetml, colors)                \
+    X(spreadsheetml, cols)                  \
+    X(spreadsheetml, comment)               \
+    X(spreadsheetml, commentList)           \
+    X(spreadsheetml, comments)              \
+    X(spreadsheetml, conditionalFormatting) \
+    X(spreadsheetml, customProperties)      \
+    X(spreadsheetml, customSheetViews)      \
+    X(spreadsheetml, customWorkbookViews)   \
+    X(spreadsheetml, dataConsolidate)       \
+    X(spreadsheetml, dataValidations)       \
+    X(spreadsheetml, definedNames)          \
+    X(spreadsheetml, dimension)             \
+    X(spreadsheetml, drawing)               \
+    X(spreadsheetml, dxfs)                  \
+    X(spreadsheetml, evenFooter)            \
+    X(spreadsheetml, evenHeader)            \
+    X(spreadsheetml, ext)                   \
+    X(spreadsheetml, extLst)                \
+    X(spreadsheetml, externalReferences)    \
+    X(spreadsheetml, f)                     \
+    X(spreadsheetml, family)                \
+    X(spreadsheetml, fgColor)               \
+    X(spreadsheetml, fileRecoveryPr)        \
+    X(spreadsheetml, fileSharing)           \
+    X(spreadsheetml, fileVersion)           \
+    X(spreadsheetml, fill)                  \
+    X(spreadsheetml, fills)                 \
+    X(spreadsheetml, firstFooter)           \
+    X(spreadsheetml, firstHeader)           \
+    X(spreadsheetml, font)                  \
+    X(spreadsheetml, fonts)                 \
+    X(spreadsheetml, functionGroups)        \
+    X(spreadsheetml, gradientFill)          \
+    X(spreadsheetml, headerFooter)          \
+    X(spreadsheetml, hyperlink)             \
+    X(spreadsheetml, hyperlinks)            \
+    X(spreadsheetml, i)                     \
+    X(spreadsheetml, ignoredErrors)         \
+    X(spreadsheetml, indexedColors)         \
+    X(spreadsheetml, is)                    \
+    X(spreadsheetml, legacyDrawing)         \
+    X(spreadsheetml, mergeCell)             \
+    X(spreadsheetml, mergeCells)            \
+    X(spreadsheetml, mruColors)             \
+    X(spreadsheetml, name)                  \
+    X(spreadsheetml, numFmt)                \
+    X(spreadsheetml, numFmts)               \
+    X(spreadsheetml, oddFooter)             \
+    X(spreadsheetml, oddHeader)             \
+    X(spreadsheetml, oleSize)               \
+    X(spreadsheetml, outline)               \
+    X(spreadsheetml, outlinePr)             \
+    X(spreadsheetml, pageMargins)           \
+    X(spreadsheetml, pageSetUpPr)           \
+    X(spreadsheetml, pageSetup)             \
+    X(spreadsheetml, pane)                  \
+    X(spreadsheetml, patternFill)           \
+    X(spreadsheetml, phoneticPr)            \
+    X(spreadsheetml, pivotCaches)           \
+    X(spreadsheetml, pivotSelection)        \
+    X(spreadsheetml, printOptions)          \
+    X(spreadsheetml, protectedRanges)       \
+    X(spreadsheetml, protection)            \
+    X(spreadsheetml, r)                     \
+    X(spreadsheetml, rFont)                 \
+    X(spreadsheetml, rPh)                   \
+    X(spreadsheetml, rPr)                   \
+    X(spreadsheetml, rgbColor)              \
+    X(spreadsheetml, row)                   \
+    X(spreadsheetml, rowBreaks)             \
+    X(spreadsheetml, scenarios)             \
+    X(spreadsheetml, scheme)                \
+    X(spreadsheetml, selection)             \
+    X(spreadsheetml, shadow)                \
+    X(spreadsheetml, sheet)                 \
+    X(spreadsheetml, sheetCalcPr)           \
+    X(spreadsheetml, sheetData)             \
+    X(spreadsheetml, sheetFormatPr)         \
+    X(spreadsheetml, sheetPr)               \
+    X(spreadsheetml, sheetProtection)       \
+    X(spreadsheetml, sheetView)             \
+    X(spreadsheetml, sheetViews)            \
+    X(spreadsheetml, sheets)                \
+    X(spreadsheetml, si)                    \
+    X(spreadsheetml, smartTagPr)            \
+    X(spreadsheetml, smartTagTypes)         \
+    X(spreadsheetml, smartTags)             \
+    X(spreadsheetml, sortState)             \
+    X(spreadsheetml, sst)                   \
+    X(spreadsheetml, stop)                  \
+    X(spreadsheetml, strike)                \
+    X(spreadsheetml, styleSheet)            \
+    X(spreadsheetml, sz)                    \
+    X(spreadsheetml, t)                     \
+    X(spreadsheetml, tabColor)              \
+    X(spreadsheetml, tableStyles)           \
+    X(spreadsheetml, text)                  \
+    X(spreadsheetml, u)                     \
+    X(spreadsheetml, v)                     \
+    X(spreadsheetml, vertAlign)             \
+    X(spreadsheetml, webPublishObjects)     \
+    X(spreadsheetml, webPublishing)         \
+    X(spreadsheetml, workbook)              \
+    X(spreadsheetml, workbookPr)            \
+    X(spreadsheetml, workbookProtection)    \
+    X(spreadsheetml, workbookView)          \
+    X(spreadsheetml, worksheet)             \
+    X(spreadsheetml, xf)                    \
+    X(vt, bool)                             \
+    X(vt, i4)                               \
+    X(vt, lpstr)                            \
+    X(vt, lpwstr)                           \
+    X(vt, variant)                          \
+    X(vt, vector)                           \
+    X(x14, slicerStyles)                    \
+    X(x14ac, dyDescent)                     \
+    X(x14ac, knownFonts)                    \
+    X(x15ac, absPath)                       \
+    X(xml, space)                           \
+    X(xsi, type)
+
+/// <summary>
+/// An interned qualified name from the vocabulary above. Tokens are small
+/// integers so elements can be dispatched with a switch rather than by comparing
+/// namespace URIs and local names as strings.
+/// </summary>
+enum class xml_token : std::uint16_t
+{
+#define XLNT_XML_TOKEN(ns, name) ns##_##name,
+    XLNT_XML_VOCABULARY(XLNT_XML_TOKEN)
+#undef XLNT_XML_TOKEN
+    unknown
+};
+
+/// <summary>
+/// Returns the qualified name of token. The names are built once and live for
+/// the rest of the program so the reference is always valid.
+/// </summary>
+XLNT_API const xml::qname &qn(xml_token token);
+
+/// <summary>
+/// Returns the token for name or xml_token::unknown if it isn't in the vocabulary.
+/// </summary>
+XLNT_API xml_token token(const xml::qname &name);
+
+} // namespace detail
+} // namespace xlnt
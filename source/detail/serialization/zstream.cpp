@@ -34,21 +34,30 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
 */
 
 #include <algorithm>
-#include <array>
 #include <cassert>
 #include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <iterator> // for std::back_inserter
+#include <limits>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include <xlnt/utils/exceptions.hpp>
-#include <detail/serialization/miniz.hpp>
+#include <detail/serialization/instrumentation.hpp>
+#include <detail/serialization/pipeline.hpp>
+#include <detail/serialization/progress_monitor.hpp>
 #include <detail/serialization/vector_streambuf.hpp>
 #include <detail/serialization/zstream.hpp>
 
+#ifdef XLNT_SYSTEM_ZLIB
+#include <zlib.h>
+#else
+#include <detail/serialization/miniz.hpp>
+#endif
+
 namespace {
 
 template <class T>
@@ -60,12 +69,74 @@ T read_int(std::istream &stream)
     return value;
 }
 
+template <class T>
+T read_little_endian(const std::uint8_t *data)
+{
+    T value = 0;
+
+    for (std::size_t i = 0; i < sizeof(T); ++i)
+    {
+        value = static_cast<T>(value | (static_cast<T>(data[i]) << (8 * i)));
+    }
+
+    return value;
+}
+
 template <class T>
 void write_int(std::ostream &stream, T value)
 {
     stream.write(reinterpret_cast<char *>(&value), sizeof(T));
 }
 
+// The value of 32-bit sizes and offsets, and 16-bit counts, that are stored in ZIP64 records instead.
+const std::uint64_t zip64_marker = 0xffffffff;
+const std::uint64_t zip64_count_marker = 0xffff;
+
+// Replaces the sizes and offset of header that are too large for their fields, as
+// given, with the ones in its ZIP64 extended information extra field, which holds
+// just those in that order.
+void read_zip64_extra(xlnt::detail::zheader &header, bool uncompressed, bool compressed, bool offset)
+{
+    if (!uncompressed && !compressed && !offset) return;
+
+    const auto &extra = header.extra;
+    std::size_t i = 0;
+
+    while (i + 4 <= extra.size())
+    {
+        const auto id = read_little_endian<std::uint16_t>(extra.data() + i);
+        const auto size = std::size_t(read_little_endian<std::uint16_t>(extra.data() + i + 2));
+        i += 4;
+
+        if (size > extra.size() - i) break;
+
+        if (id == 0x0001)
+        {
+            auto field = i;
+
+            auto next = [&](std::uint64_t &value) {
+                if (field + 8 > i + size)
+                {
+                    throw xlnt::exception("ZIP64 extra field is too short, possibly corrupted");
+                }
+
+                value = read_little_endian<std::uint64_t>(extra.data() + field);
+                field += 8;
+            };
+
+            if (uncompressed) next(header.uncompressed_size);
+            if (compressed) next(header.compressed_size);
+            if (offset) next(header.header_offset);
+
+            return;
+        }
+
+        i += size;
+    }
+
+    throw xlnt::exception("missing ZIP64 extra field, possibly corrupted");
+}
+
 xlnt::detail::zheader read_header(std::istream &istream, const bool global)
 {
     xlnt::detail::zheader header;
@@ -94,8 +165,11 @@ xlnt::detail::zheader read_header(std::istream &istream, const bool global)
     header.stamp_date = read_int<std::uint16_t>(istream);
     header.stamp_time = read_int<std::uint16_t>(istream);
     header.crc = read_int<std::uint32_t>(istream);
-    header.compressed_size = read_int<std::uint32_t>(istream);
-    header.uncompressed_size = read_int<std::uint32_t>(istream);
+    const auto compressed_size = read_int<std::uint32_t>(istream);
+    const auto uncompressed_size = read_int<std::uint32_t>(istream);
+    header.compressed_size = compressed_size;
+    header.uncompressed_size = uncompressed_size;
+    std::uint32_t header_offset = 0;
 
     auto filename_length = read_int<std::uint16_t>(istream);
     auto extra_length = read_int<std::uint16_t>(istream);
@@ -108,7 +182,8 @@ xlnt::detail::zheader read_header(std::istream &istream, const bool global)
         /*std::uint16_t disk_number_start = */ read_int<std::uint16_t>(istream);
         /*std::uint16_t int_file_attrib = */ read_int<std::uint16_t>(istream);
         /*std::uint32_t ext_file_attrib = */ read_int<std::uint32_t>(istream);
-        header.header_offset = read_int<std::uint32_t>(istream);
+        header_offset = read_int<std::uint32_t>(istream);
+        header.header_offset = header_offset;
     }
 
     header.filename.resize(filename_length, '\0');
@@ -121,33 +196,53 @@ xlnt::detail::zheader read_header(std::istream &istream, const bool global)
     {
         header.comment.resize(comment_length, '\0');
         istream.read(&header.comment[0], comment_length);
+
+        read_zip64_extra(header, uncompressed_size == zip64_marker,
+            compressed_size == zip64_marker, header_offset == zip64_marker);
     }
 
     return header;
 }
 
+// Writes a size or offset, or zip64_marker if it's too large and stored in a ZIP64 record.
+void write_int32(std::ostream &ostream, std::uint64_t value)
+{
+    write_int(ostream, static_cast<std::uint32_t>(std::min(value, zip64_marker)));
+}
+
+// Writes header, where the central directory has a ZIP64 extra field for sizes and
+// offsets too large for their fields. The local header has no extra field so that it
+// can be written again with the final sizes, so those only appear in the central one.
 void write_header(const xlnt::detail::zheader &header, std::ostream &ostream, const bool global)
 {
+    std::vector<std::uint64_t> zip64;
+
+    if (header.uncompressed_size >= zip64_marker) zip64.push_back(header.uncompressed_size);
+    if (header.compressed_size >= zip64_marker) zip64.push_back(header.compressed_size);
+    if (global && header.header_offset >= zip64_marker) zip64.push_back(header.header_offset);
+
+    const auto version = zip64.empty() ? header.version : std::max(header.version, std::uint16_t(45));
+
     if (global)
     {
         write_int(ostream, static_cast<std::uint32_t>(0x02014b50)); // header sig
-        write_int(ostream, static_cast<std::uint16_t>(20)); // version made by
+        write_int(ostream, version); // version made by
     }
     else
     {
         write_int(ostream, static_cast<std::uint32_t>(0x04034b50));
     }
 
-    write_int(ostream, header.version);
+    write_int(ostream, version);
     write_int(ostream, header.flags);
     write_int(ostream, header.compression_type);
     write_int(ostream, header.stamp_date);
     write_int(ostream, header.stamp_time);
     write_int(ostream, header.crc);
-    write_int(ostream, header.compressed_size);
-    write_int(ostream, header.uncompressed_size);
+    write_int32(ostream, header.compressed_size);
+    write_int32(ostream, header.uncompressed_size);
     write_int(ostream, static_cast<std::uint16_t>(header.filename.length()));
-    write_int(ostream, static_cast<std::uint16_t>(0)); // extra lengthx
+    write_int(ostream, static_cast<std::uint16_t>(global && !zip64.empty() ? 4 + 8 * zip64.size() : 0)); // extra length
 
     if (global)
     {
@@ -155,13 +250,43 @@ void write_header(const xlnt::detail::zheader &header, std::ostream &ostream, co
         write_int(ostream, static_cast<std::uint16_t>(0)); // disk# start
         write_int(ostream, static_cast<std::uint16_t>(0)); // internal file
         write_int(ostream, static_cast<std::uint32_t>(0)); // ext final
-        write_int(ostream, static_cast<std::uint32_t>(header.header_offset)); // rel offset
+        write_int32(ostream, header.header_offset); // rel offset
     }
 
     for (auto c : header.filename)
     {
         write_int(ostream, c);
     }
+
+    if (global && !zip64.empty())
+    {
+        write_int(ostream, static_cast<std::uint16_t>(0x0001)); // ZIP64 extended information
+        write_int(ostream, static_cast<std::uint16_t>(8 * zip64.size()));
+
+        for (auto value : zip64)
+        {
+            write_int(ostream, value);
+        }
+    }
+}
+
+int zlib_strategy(xlnt::compression_strategy strategy)
+{
+    switch (strategy)
+    {
+    case xlnt::compression_strategy::filtered:
+        return Z_FILTERED;
+    case xlnt::compression_strategy::huffman_only:
+        return Z_HUFFMAN_ONLY;
+    case xlnt::compression_strategy::rle:
+        return Z_RLE;
+    case xlnt::compression_strategy::fixed:
+        return Z_FIXED;
+    case xlnt::compression_strategy::default_strategy:
+        break;
+    }
+
+    return Z_DEFAULT_STRATEGY;
 }
 
 } // namespace
@@ -169,31 +294,36 @@ void write_header(const xlnt::detail::zheader &header, std::ostream &ostream, co
 namespace xlnt {
 namespace detail {
 
-static const std::size_t buffer_size = 512;
+// Parts are inflated, and read from a stream, in chunks this large so that refilling
+// the parser's buffer rarely needs to call into the decompressor.
+static const std::size_t buffer_size = 64 * 1024;
 
 class zip_streambuf_decompress : public std::streambuf
 {
     std::istream &istream;
 
     z_stream strm;
-    std::array<char, buffer_size> in;
-    std::array<char, buffer_size> out;
+    std::vector<char> in;
+    std::vector<char> out;
     zheader header;
     std::size_t total_read;
     std::size_t total_uncompressed;
     bool valid;
     bool compressed_data;
+    xlnt::detail::instrumentation *instrumentation;
+    std::size_t part;
+    xlnt::detail::progress_monitor *progress;
 
     static const unsigned short DEFLATE = 8;
     static const unsigned short UNCOMPRESSED = 0;
 
 public:
-    zip_streambuf_decompress(std::istream &stream, zheader central_header)
-        : istream(stream), header(central_header), total_read(0), total_uncompressed(0), valid(true)
+    zip_streambuf_decompress(std::istream &stream, zheader central_header,
+        xlnt::detail::instrumentation *parts = nullptr, std::size_t part_index = 0,
+        xlnt::detail::progress_monitor *monitor = nullptr)
+        : istream(stream), in(buffer_size), out(buffer_size), header(central_header), total_read(0),
+          total_uncompressed(0), valid(true), instrumentation(parts), part(part_index), progress(monitor)
     {
-        in.fill(0);
-        out.fill(0);
-
         strm.zalloc = nullptr;
         strm.zfree = nullptr;
         strm.opaque = nullptr;
@@ -243,6 +373,16 @@ public:
         {
             inflateEnd(&strm);
         }
+
+        if (xlnt::detail::instrumentation::enabled && instrumentation != nullptr)
+        {
+            instrumentation->end_part(part, header.compressed_size, header.uncompressed_size);
+        }
+
+        if (progress != nullptr)
+        {
+            progress->end_part();
+        }
     }
 
     int process()
@@ -259,8 +399,8 @@ public:
                 if (strm.avail_in == 0)
                 {
                     // buffer empty, read some more from file
-                    istream.read(in.data(),
-                        static_cast<std::streamsize>(std::min(buffer_size, header.compressed_size - total_read)));
+                    istream.read(in.data(), static_cast<std::streamsize>(
+                        std::min(std::uint64_t(buffer_size), header.compressed_size - total_read)));
                     strm.avail_in = static_cast<unsigned int>(istream.gcount());
                     total_read += strm.avail_in;
                     strm.next_in = reinterpret_cast<Bytef *>(in.data());
@@ -282,8 +422,8 @@ public:
         }
 
         // uncompressed, so just read
-        istream.read(out.data() + 4,
-            static_cast<std::streamsize>(std::min(buffer_size - 4, header.uncompressed_size - total_read)));
+        istream.read(out.data() + 4, static_cast<std::streamsize>(
+            std::min(std::uint64_t(buffer_size - 4), header.uncompressed_size - total_read)));
         auto count = istream.gcount();
         total_read += static_cast<std::size_t>(count);
         return static_cast<int>(count);
@@ -297,7 +437,18 @@ public:
         if (put_back_count > 4) put_back_count = 4;
         std::memmove(
             out.data() + (4 - put_back_count), gptr() - put_back_count, static_cast<std::size_t>(put_back_count));
+        const auto start = xlnt::detail::instrumentation::enabled && instrumentation != nullptr
+            ? instrumentation->now()
+            : xlnt::detail::instrumentation::time_point();
         int num = process();
+        if (xlnt::detail::instrumentation::enabled && instrumentation != nullptr)
+        {
+            instrumentation->add_compression_time(part, start);
+        }
+        if (progress != nullptr && num > 0)
+        {
+            progress->add_bytes(static_cast<std::uint64_t>(num));
+        }
         setg(out.data() + 4 - put_back_count, out.data() + 4, out.data() + 4 + num);
         if (num <= 0) return EOF;
         return traits_type::to_int_type(*gptr());
@@ -311,47 +462,210 @@ int zip_streambuf_decompress::overflow(int)
     throw xlnt::exception("writing to read-only buffer");
 }
 
+/// <summary>
+/// Reads a file from a ZIP archive held in memory, such as a mapped file. Stored files are
+/// read in place without copying and deflated files are inflated straight from the archive
+/// in large chunks. Since nothing is shared between instances, several can be read at once.
+/// </summary>
+class zip_streambuf_memory : public std::streambuf
+{
+    z_stream strm;
+    std::vector<char> out;
+    zheader header;
+    std::uint64_t unread;
+    bool compressed_data;
+    bool finished;
+    xlnt::detail::instrumentation *instrumentation;
+    std::size_t part;
+    xlnt::detail::progress_monitor *progress;
+
+public:
+    zip_streambuf_memory(const std::uint8_t *data, zheader central_header,
+        xlnt::detail::instrumentation *parts, std::size_t part_index, xlnt::detail::progress_monitor *monitor)
+        : header(central_header), unread(0), compressed_data(false), finished(false), instrumentation(parts),
+          part(part_index), progress(monitor)
+    {
+        setp(nullptr, nullptr);
+
+        if (header.compression_type == 0)
+        {
+            auto begin = const_cast<char *>(reinterpret_cast<const char *>(data));
+            setg(begin, begin, begin + static_cast<std::size_t>(header.uncompressed_size));
+
+            if (progress != nullptr)
+            {
+                progress->add_bytes(header.uncompressed_size);
+            }
+
+            return;
+        }
+
+        if (header.compression_type != 8)
+        {
+            throw xlnt::exception("unsupported compression type, should be DEFLATE or uncompressed");
+        }
+
+        strm.zalloc = nullptr;
+        strm.zfree = nullptr;
+        strm.opaque = nullptr;
+        strm.next_in = const_cast<Bytef *>(data);
+        strm.avail_in = 0;
+        unread = header.compressed_size;
+        refill();
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wold-style-cast"
+        int result = inflateInit2(&strm, -MAX_WBITS);
+#pragma clang diagnostic pop
+
+        if (result != Z_OK)
+        {
+            throw xlnt::exception("couldn't inflate ZIP, possibly corrupted");
+        }
+
+        compressed_data = true;
+        out.resize(buffer_size + 4);
+        setg(out.data() + 4, out.data() + 4, out.data() + 4);
+    }
+
+    virtual ~zip_streambuf_memory()
+    {
+        if (compressed_data)
+        {
+            inflateEnd(&strm);
+        }
+
+        if (xlnt::detail::instrumentation::enabled && instrumentation != nullptr)
+        {
+            instrumentation->end_part(part, header.compressed_size, header.uncompressed_size);
+        }
+
+        if (progress != nullptr)
+        {
+            progress->end_part();
+        }
+    }
+
+    virtual int underflow()
+    {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        if (!compressed_data || finished) return EOF;
+
+        // keep up to four characters for putback as zip_streambuf_decompress does
+        auto put_back_count = std::min(gptr() - eback(), std::ptrdiff_t(4));
+        std::memmove(out.data() + (4 - put_back_count), gptr() - put_back_count,
+            static_cast<std::size_t>(put_back_count));
+
+        const auto start = xlnt::detail::instrumentation::enabled && instrumentation != nullptr
+            ? instrumentation->now()
+            : xlnt::detail::instrumentation::time_point();
+
+        strm.next_out = reinterpret_cast<Bytef *>(out.data() + 4);
+        strm.avail_out = static_cast<unsigned int>(buffer_size);
+
+        if (strm.avail_in == 0)
+        {
+            refill();
+        }
+
+        const auto ret = inflate(&strm, Z_NO_FLUSH);
+
+        if (ret == Z_STREAM_ERROR || ret == Z_NEED_DICT || ret == Z_DATA_ERROR || ret == Z_MEM_ERROR)
+        {
+            throw xlnt::exception("couldn't inflate ZIP, possibly corrupted");
+        }
+
+        // a truncated stream stops making progress with Z_BUF_ERROR
+        finished = ret == Z_STREAM_END || ret == Z_BUF_ERROR;
+        const auto count = buffer_size - strm.avail_out;
+
+        if (xlnt::detail::instrumentation::enabled && instrumentation != nullptr)
+        {
+            instrumentation->add_compression_time(part, start);
+        }
+
+        if (progress != nullptr)
+        {
+            progress->add_bytes(count);
+        }
+
+        setg(out.data() + 4 - put_back_count, out.data() + 4, out.data() + 4 + count);
+        if (count == 0) return EOF;
+
+        return traits_type::to_int_type(*gptr());
+    }
+
+    virtual int overflow(int)
+    {
+        throw xlnt::exception("writing to read-only buffer");
+    }
+
+private:
+    // Gives zlib as much of the rest of the file as it takes at once, which is less than
+    // all of it for files over 4 GB.
+    void refill()
+    {
+        const auto count = std::min(unread, std::uint64_t(std::numeric_limits<unsigned int>::max()));
+        strm.avail_in = static_cast<unsigned int>(count);
+        unread -= count;
+    }
+};
+
 class zip_streambuf_compress : public std::streambuf
 {
     std::ostream &ostream; // owned when header==0 (when not part of zip file)
 
     z_stream strm;
-    std::array<char, buffer_size> in;
-    std::array<char, buffer_size> out;
+    std::vector<char> in;
+    std::vector<char> out;
 
     zheader *header;
-    std::uint32_t uncompressed_size;
+    std::uint64_t uncompressed_size;
     std::uint32_t crc;
 
     bool valid;
+    bool stored;
+
+    xlnt::detail::instrumentation *instrumentation;
+    std::size_t part;
+    xlnt::detail::progress_monitor *progress;
 
 public:
-    zip_streambuf_compress(zheader *central_header, std::ostream &stream)
-        : ostream(stream), header(central_header), valid(true)
+    zip_streambuf_compress(zheader *central_header, std::ostream &stream,
+        const xlnt::compression_options &compression = xlnt::compression_options(),
+        xlnt::detail::instrumentation *parts = nullptr, std::size_t part_index = 0,
+        xlnt::detail::progress_monitor *monitor = nullptr)
+        : ostream(stream), in(compression.buffer_size), out(compression.buffer_size), header(central_header),
+          valid(true), stored(compression.level == 0 && central_header != nullptr), instrumentation(parts),
+          part(part_index), progress(monitor)
     {
         strm.zalloc = nullptr;
         strm.zfree = nullptr;
         strm.opaque = nullptr;
 
+        if (!stored)
+        {
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wold-style-cast"
-        int ret = deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+            int ret = deflateInit2(&strm, compression.level, Z_DEFLATED, -MAX_WBITS, 8, zlib_strategy(compression.strategy));
 #pragma clang diagnostic pop
 
-        if (ret != Z_OK)
-        {
-            std::cerr << "libz: failed to deflateInit" << std::endl;
-            valid = false;
-            return;
+            if (ret != Z_OK)
+            {
+                std::cerr << "libz: failed to deflateInit" << std::endl;
+                valid = false;
+                return;
+            }
         }
 
         setg(nullptr, nullptr, nullptr);
-        setp(in.data(), in.data() + buffer_size - 4); // we want to be 4 aligned
+        setp(in.data(), in.data() + in.size() - 4); // we want to be 4 aligned
 
         // Write appropriate header
         if (header)
         {
-            header->header_offset = static_cast<std::uint32_t>(stream.tellp());
+            header->compression_type = stored ? 0 : 8;
+            header->header_offset = static_cast<std::uint64_t>(stream.tellp());
             write_header(*header, ostream, false);
         }
 
@@ -363,20 +677,30 @@ public:
         if (valid)
         {
             process(true);
-            deflateEnd(&strm);
+            if (!stored) deflateEnd(&strm);
             if (header)
             {
                 auto final_position = ostream.tellp();
                 header->uncompressed_size = uncompressed_size;
                 header->crc = crc;
-                ostream.seekp(header->header_offset);
+                ostream.seekp(static_cast<std::streamoff>(header->header_offset));
                 write_header(*header, ostream, false);
                 ostream.seekp(final_position);
+
+                if (xlnt::detail::instrumentation::enabled && instrumentation != nullptr)
+                {
+                    instrumentation->end_part(part, header->compressed_size, header->uncompressed_size);
+                }
+
+                if (progress != nullptr)
+                {
+                    progress->end_part();
+                }
             }
             else
             {
                 write_int(ostream, crc);
-                write_int(ostream, uncompressed_size);
+                write_int(ostream, static_cast<std::uint32_t>(uncompressed_size));
             }
         }
         if (!header) delete &ostream;
@@ -387,12 +711,22 @@ protected:
     {
         if (!valid) return -1;
 
+        const auto start = xlnt::detail::instrumentation::enabled && instrumentation != nullptr
+            ? instrumentation->now()
+            : xlnt::detail::instrumentation::time_point();
+
+        if (stored)
+        {
+            ostream.write(pbase(), pptr() - pbase());
+            header->compressed_size += static_cast<std::uint64_t>(pptr() - pbase());
+        }
+
         strm.next_in = reinterpret_cast<Bytef *>(pbase());
-        strm.avail_in = static_cast<unsigned int>(pptr() - pbase());
+        strm.avail_in = stored ? 0 : static_cast<unsigned int>(pptr() - pbase());
 
-        while (strm.avail_in != 0 || flush)
+        while (!stored && (strm.avail_in != 0 || flush))
         {
-            strm.avail_out = buffer_size;
+            strm.avail_out = static_cast<unsigned int>(out.size());
             strm.next_out = reinterpret_cast<Bytef *>(out.data());
 
             int ret = deflate(&strm, flush ? Z_FINISH : Z_NO_FLUSH);
@@ -407,15 +741,21 @@ protected:
 
             auto generated_output = static_cast<int>(strm.next_out - reinterpret_cast<std::uint8_t *>(out.data()));
             ostream.write(out.data(), generated_output);
-            if (header) header->compressed_size += static_cast<std::uint32_t>(generated_output);
+            if (header) header->compressed_size += static_cast<std::uint64_t>(generated_output);
             if (ret == Z_STREAM_END) break;
         }
 
         // update counts, crc's and buffers
         auto consumed_input = static_cast<std::uint32_t>(pptr() - pbase());
         uncompressed_size += consumed_input;
+        if (progress != nullptr) progress->add_bytes(consumed_input);
         crc = static_cast<std::uint32_t>(crc32(crc, reinterpret_cast<Bytef *>(in.data()), consumed_input));
-        setp(pbase(), pbase() + buffer_size - 4);
+        setp(pbase(), pbase() + in.size() - 4);
+
+        if (xlnt::detail::instrumentation::enabled && instrumentation != nullptr)
+        {
+            instrumentation->add_compression_time(part, start);
+        }
 
         return 1;
     }
@@ -466,25 +806,96 @@ ozstream::~ozstream()
 
     auto central_end = destination_stream_.tellp();
 
+    const auto entries = static_cast<std::uint64_t>(file_headers_.size());
+    const auto central_size = static_cast<std::uint64_t>(central_end - final_position);
+    const auto central_offset = static_cast<std::uint64_t>(final_position);
+
+    if (entries >= zip64_count_marker || central_size >= zip64_marker || central_offset >= zip64_marker)
+    {
+        // Write ZIP64 end of central and its locator
+        write_int(destination_stream_, static_cast<std::uint32_t>(0x06064b50)); // ZIP64 end of central
+        write_int(destination_stream_, static_cast<std::uint64_t>(44)); // size of the rest of this record
+        write_int(destination_stream_, static_cast<std::uint16_t>(45)); // version made by
+        write_int(destination_stream_, static_cast<std::uint16_t>(45)); // version needed
+        write_int(destination_stream_, static_cast<std::uint32_t>(0)); // this disk number
+        write_int(destination_stream_, static_cast<std::uint32_t>(0)); // disk with central
+        write_int(destination_stream_, entries); // entries in center in this disk
+        write_int(destination_stream_, entries); // entries in center
+        write_int(destination_stream_, central_size); // size of header
+        write_int(destination_stream_, central_offset); // offset to header
+
+        write_int(destination_stream_, static_cast<std::uint32_t>(0x07064b50)); // ZIP64 end of central locator
+        write_int(destination_stream_, static_cast<std::uint32_t>(0)); // disk with ZIP64 end of central
+        write_int(destination_stream_, static_cast<std::uint64_t>(central_end)); // offset to ZIP64 end of central
+        write_int(destination_stream_, static_cast<std::uint32_t>(1)); // number of disks
+    }
+
     // Write end of central
     write_int(destination_stream_, static_cast<std::uint32_t>(0x06054b50)); // end of central
     write_int(destination_stream_, static_cast<std::uint16_t>(0)); // this disk number
     write_int(destination_stream_, static_cast<std::uint16_t>(0)); // this disk number
-    write_int(destination_stream_, static_cast<std::uint16_t>(file_headers_.size())); // one entry in center in this disk
-    write_int(destination_stream_, static_cast<std::uint16_t>(file_headers_.size())); // one entry in center
-    write_int(destination_stream_, static_cast<std::uint32_t>(central_end - final_position)); // size of header
-    write_int(destination_stream_, static_cast<std::uint32_t>(final_position)); // offset to header
+    write_int(destination_stream_, static_cast<std::uint16_t>(std::min(entries, zip64_count_marker))); // entries in center in this disk
+    write_int(destination_stream_, static_cast<std::uint16_t>(std::min(entries, zip64_count_marker))); // entries in center
+    write_int32(destination_stream_, central_size); // size of header
+    write_int32(destination_stream_, central_offset); // offset to header
     write_int(destination_stream_, static_cast<std::uint16_t>(0)); // zip comment
 }
 
-std::unique_ptr<std::streambuf> ozstream::open(const path &filename)
+std::unique_ptr<std::streambuf> ozstream::open(
+    const path &filename, const compression_options &compression, bool pipelined)
 {
     zheader header;
     header.filename = filename.string();
     file_headers_.push_back(header);
-    auto buffer = new zip_streambuf_compress(&file_headers_.back(), destination_stream_);
 
-    return std::unique_ptr<zip_streambuf_compress>(buffer);
+    const auto part = instrumentation::enabled && instrumentation_ != nullptr
+        ? instrumentation_->begin_part(filename)
+        : 0;
+    auto buffer = std::unique_ptr<std::streambuf>(new zip_streambuf_compress(
+        &file_headers_.back(), destination_stream_, compression, instrumentation_, part, progress_));
+
+    return pipelined ? std::unique_ptr<std::streambuf>(new pipelined_ostreambuf(std::move(buffer)))
+                     : std::move(buffer);
+}
+
+void ozstream::copy(const izstream &source, const path &filename)
+{
+    auto header = source.header(filename);
+
+    // the sizes are known up front so no data descriptor follows the stored bytes
+    header.flags = static_cast<std::uint16_t>(header.flags & ~0x8);
+    header.extra.clear();
+    header.comment.clear();
+    header.header_offset = static_cast<std::uint64_t>(destination_stream_.tellp());
+
+    const auto part = instrumentation::enabled && instrumentation_ != nullptr
+        ? instrumentation_->begin_part(filename)
+        : 0;
+
+    write_header(header, destination_stream_, false);
+    source.read_raw(filename, destination_stream_);
+    file_headers_.push_back(header);
+
+    if (instrumentation::enabled && instrumentation_ != nullptr)
+    {
+        instrumentation_->end_part(part, header.compressed_size, header.uncompressed_size);
+    }
+
+    if (progress_ != nullptr)
+    {
+        progress_->add_bytes(header.uncompressed_size);
+        progress_->end_part();
+    }
+}
+
+void ozstream::instrument(instrumentation *parts)
+{
+    instrumentation_ = parts;
+}
+
+void ozstream::monitor(progress_monitor *progress)
+{
+    progress_ = progress;
 }
 
 izstream::izstream(std::istream &stream)
@@ -498,6 +909,16 @@ izstream::izstream(std::istream &stream)
     read_central_header();
 }
 
+izstream::izstream(const std::uint8_t *data, std::size_t size)
+    : data_(data),
+      size_(size),
+      data_buffer_(new vector_istreambuf(data, size)),
+      data_stream_(new std::istream(data_buffer_.get())),
+      source_stream_(*data_stream_)
+{
+    read_central_header();
+}
+
 izstream::~izstream()
 {
 }
@@ -554,7 +975,8 @@ bool izstream::read_central_header()
     }
 
     // seek to end of central header and read
-    source_stream_.seekg(end_position - (read_start - static_cast<std::ptrdiff_t>(header_index)));
+    const auto central_end = end_position - (read_start - header_index);
+    source_stream_.seekg(static_cast<std::streamoff>(central_end));
 
     /*auto word = */ read_int<std::uint32_t>(source_stream_);
     auto disk_number1 = read_int<std::uint16_t>(source_stream_);
@@ -565,21 +987,64 @@ bool izstream::read_central_header()
         throw xlnt::exception("multiple disk zip files are not supported");
     }
 
-    auto num_files = read_int<std::uint16_t>(source_stream_); // one entry in center in this disk
-    auto num_files_this_disk = read_int<std::uint16_t>(source_stream_); // one entry in center
+    auto num_files = std::uint64_t(read_int<std::uint16_t>(source_stream_)); // one entry in center in this disk
+    auto num_files_this_disk = std::uint64_t(read_int<std::uint16_t>(source_stream_)); // one entry in center
 
     if (num_files != num_files_this_disk)
     {
         throw xlnt::exception("multi disk zip files are not supported");
     }
 
-    /*auto size_of_header = */ read_int<std::uint32_t>(source_stream_); // size of header
-    auto header_offset = read_int<std::uint32_t>(source_stream_); // offset to header
+    const auto size_of_header = read_int<std::uint32_t>(source_stream_); // size of header
+    auto header_offset = std::uint64_t(read_int<std::uint32_t>(source_stream_)); // offset to header
+
+    if (num_files == zip64_count_marker || size_of_header == zip64_marker || header_offset == zip64_marker)
+    {
+        // the ZIP64 end of central locator comes right before the end of central
+        const auto locator_size = std::size_t(20);
+
+        if (central_end < locator_size)
+        {
+            throw xlnt::exception("failed to find ZIP64 end of central directory locator");
+        }
+
+        source_stream_.seekg(static_cast<std::streamoff>(central_end - locator_size));
+
+        if (read_int<std::uint32_t>(source_stream_) != 0x07064b50)
+        {
+            throw xlnt::exception("failed to find ZIP64 end of central directory locator");
+        }
+
+        /*auto disk_number = */ read_int<std::uint32_t>(source_stream_);
+        const auto record_offset = read_int<std::uint64_t>(source_stream_);
+        source_stream_.seekg(static_cast<std::streamoff>(record_offset));
+
+        if (read_int<std::uint32_t>(source_stream_) != 0x06064b50)
+        {
+            throw xlnt::exception("missing ZIP64 end of central directory signature");
+        }
+
+        /*auto record_size = */ read_int<std::uint64_t>(source_stream_);
+        /*auto version_made_by = */ read_int<std::uint16_t>(source_stream_);
+        /*auto version_needed = */ read_int<std::uint16_t>(source_stream_);
+        /*auto disk_number1 = */ read_int<std::uint32_t>(source_stream_);
+        /*auto disk_number2 = */ read_int<std::uint32_t>(source_stream_);
+        num_files = read_int<std::uint64_t>(source_stream_);
+        num_files_this_disk = read_int<std::uint64_t>(source_stream_);
+
+        if (num_files != num_files_this_disk)
+        {
+            throw xlnt::exception("multi disk zip files are not supported");
+        }
+
+        /*auto size_of_header = */ read_int<std::uint64_t>(source_stream_);
+        header_offset = read_int<std::uint64_t>(source_stream_);
+    }
 
     // go to header and read all file headers
-    source_stream_.seekg(header_offset);
+    source_stream_.seekg(static_cast<std::streamoff>(header_offset));
 
-    for (std::uint16_t i = 0; i < num_files; ++i)
+    for (std::uint64_t i = 0; i < num_files; ++i)
     {
         auto header = read_header(source_stream_, true);
         file_headers_[header.filename] = header;
@@ -588,7 +1053,7 @@ bool izstream::read_central_header()
     return true;
 }
 
-std::unique_ptr<std::streambuf> izstream::open(const path &filename) const
+std::unique_ptr<std::streambuf> izstream::open(const path &filename, bool pipelined) const
 {
     if (!has_file(filename))
     {
@@ -596,19 +1061,44 @@ std::unique_ptr<std::streambuf> izstream::open(const path &filename) const
     }
 
     auto header = file_headers_.at(filename.string());
-    source_stream_.seekg(header.header_offset);
-    auto buffer = new zip_streambuf_decompress(source_stream_, header);
+
+    if (data_ != nullptr)
+    {
+        auto buffer = open_in_memory(header);
+
+        return pipelined ? std::unique_ptr<std::streambuf>(new pipelined_istreambuf(std::move(buffer)))
+                         : std::move(buffer);
+    }
+
+    source_stream_.seekg(static_cast<std::streamoff>(header.header_offset));
+
+    const auto part = instrumentation::enabled && instrumentation_ != nullptr
+        ? instrumentation_->begin_part(filename)
+        : 0;
+    auto buffer = new zip_streambuf_decompress(source_stream_, header, instrumentation_, part, progress_);
 
     return std::unique_ptr<zip_streambuf_decompress>(buffer);
 }
 
 std::string izstream::read(const path &filename) const
 {
+    const auto &file_header = header(filename);
     auto buffer = open(filename);
-    std::istream stream(buffer.get());
-    auto bytes = to_vector(stream);
 
-    return std::string(bytes.begin(), bytes.end());
+    // the size comes from the archive so don't trust it beyond deflate's maximum ratio
+    auto result = std::string();
+    result.reserve(std::min(std::size_t(file_header.uncompressed_size),
+        std::size_t(file_header.compressed_size) * 1032 + buffer_size));
+
+    std::vector<char> chunk(buffer_size);
+    std::streamsize count = 0;
+
+    while ((count = buffer->sgetn(chunk.data(), static_cast<std::streamsize>(chunk.size()))) > 0)
+    {
+        result.append(chunk.data(), static_cast<std::size_t>(count));
+    }
+
+    return result;
 }
 
 std::vector<path> izstream::files() const
@@ -625,5 +1115,125 @@ bool izstream::has_file(const path &filename) const
     return file_headers_.count(filename.string()) != 0;
 }
 
+const zheader &izstream::header(const path &filename) const
+{
+    const auto match = file_headers_.find(filename.string());
+
+    if (match == file_headers_.end())
+    {
+        throw xlnt::exception("file not found");
+    }
+
+    return match->second;
+}
+
+bool izstream::matches(const path &filename, const std::vector<std::uint8_t> &bytes) const
+{
+    const auto match = file_headers_.find(filename.string());
+
+    return match != file_headers_.end()
+        && match->second.uncompressed_size == bytes.size()
+        && match->second.crc == static_cast<std::uint32_t>(crc32(0, bytes.data(), bytes.size()));
+}
+
+void izstream::read_raw(const path &filename, std::ostream &destination) const
+{
+    const auto &file_header = header(filename);
+    const auto data_size = std::size_t(file_header.compression_type == 0
+        ? file_header.uncompressed_size
+        : file_header.compressed_size);
+
+    if (data_ != nullptr)
+    {
+        destination.write(reinterpret_cast<const char *>(data_ + data_offset(file_header)),
+            static_cast<std::streamsize>(data_size));
+
+        return;
+    }
+
+    source_stream_.seekg(static_cast<std::streamoff>(file_header.header_offset));
+    read_header(source_stream_, false);
+
+    std::vector<char> buffer(buffer_size);
+    auto remaining = data_size;
+
+    while (remaining > 0)
+    {
+        const auto count = std::min(remaining, buffer.size());
+        source_stream_.read(buffer.data(), static_cast<std::streamsize>(count));
+
+        if (static_cast<std::size_t>(source_stream_.gcount()) != count)
+        {
+            throw xlnt::exception("ZIP entry extends past the end of the file, possibly truncated");
+        }
+
+        destination.write(buffer.data(), static_cast<std::streamsize>(count));
+        remaining -= count;
+    }
+}
+
+std::size_t izstream::data_offset(const zheader &header) const
+{
+    // the local header repeats the central one but may have a different extra field
+    const auto local_header_size = std::size_t(30);
+
+    if (header.header_offset > size_ || size_ - header.header_offset < local_header_size)
+    {
+        throw xlnt::exception("couldn't read ZIP local header, possibly corrupted");
+    }
+
+    const auto local_header = data_ + static_cast<std::size_t>(header.header_offset);
+
+    if (read_little_endian<std::uint32_t>(local_header) != 0x04034b50)
+    {
+        throw xlnt::exception("missing local header signature");
+    }
+
+    const auto offset = static_cast<std::size_t>(header.header_offset) + local_header_size
+        + read_little_endian<std::uint16_t>(local_header + 26) + read_little_endian<std::uint16_t>(local_header + 28);
+    const auto data_size = header.compression_type == 0 ? header.uncompressed_size : header.compressed_size;
+
+    if (offset > size_ || size_ - offset < data_size)
+    {
+        throw xlnt::exception("ZIP entry extends past the end of the file, possibly truncated");
+    }
+
+    return offset;
+}
+
+std::unique_ptr<std::streambuf> izstream::open_in_memory(const zheader &header) const
+{
+    const auto offset = data_offset(header);
+
+    const auto part = instrumentation::enabled && instrumentation_ != nullptr
+        ? instrumentation_->begin_part(path(header.filename))
+        : 0;
+
+    return std::unique_ptr<std::streambuf>(
+        new zip_streambuf_memory(data_ + offset, header, instrumentation_, part, progress_));
+}
+
+void izstream::instrument(instrumentation *parts)
+{
+    instrumentation_ = parts;
+}
+
+void izstream::monitor(progress_monitor *progress)
+{
+    progress_ = progress;
+}
+
+std::uint64_t izstream::uncompressed_size() const
+{
+    std::uint64_t total = 0;
+
+    for (const auto &header : file_headers_)
+    {
+        total += header.second.uncompressed_size;
+    }
+
+    return total;
+}
+
 } // namespace detail
 } // namespace xlnt
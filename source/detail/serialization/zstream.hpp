@@ -42,15 +42,21 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGES.
 
 #include <xlnt/xlnt_config.hpp>
 #include <xlnt/utils/path.hpp>
+#include <xlnt/workbook/serialization_options.hpp>
 
 //TODO: don't export these classes (some tests are using them for now)
 
 namespace xlnt {
 namespace detail {
 
+class instrumentation;
+class izstream;
+class progress_monitor;
+
 /// <summary>
 /// A structure representing the header that occurs before each compressed file in a ZIP
-/// archive and again at the end of the file with more information.
+/// archive and again at the end of the file with more information. Sizes and offsets
+/// that don't fit in 32 bits are read from and written to ZIP64 records.
 /// </summary>
 struct XLNT_API zheader
 {
@@ -60,17 +66,19 @@ struct XLNT_API zheader
     std::uint16_t stamp_date = 0;
     std::uint16_t stamp_time = 0;
     std::uint32_t crc = 0;
-    std::uint32_t compressed_size = 0;
-    std::uint32_t uncompressed_size = 0;
+    std::uint64_t compressed_size = 0;
+    std::uint64_t uncompressed_size = 0;
     std::string filename;
     std::string comment;
     std::vector<std::uint8_t> extra;
-    std::uint32_t header_offset = 0;
+    std::uint64_t header_offset = 0;
 };
 
 /// <summary>
 /// Writes a series of uncompressed binary file data as ostreams into another ostream
-/// according to the ZIP format.
+/// according to the ZIP format. Archives and files over 4 GB and archives of more than
+/// 65534 files use ZIP64 records, which only the central directory holds, so readers
+/// that rely on the local headers alone can't read files over 4 GB.
 /// </summary>
 class XLNT_API ozstream
 {
@@ -86,13 +94,38 @@ public:
     virtual ~ozstream();
 
     /// <summary>
-    /// Returns a pointer to a streambuf which compresses the data it receives.
+    /// Returns a pointer to a streambuf which compresses the data it receives as
+    /// described by compression. If pipelined is true, the data is compressed and
+    /// written on a separate thread by the returned pipelined_ostreambuf, so nothing
+    /// else may be written to the destination until the streambuf is destroyed.
+    /// </summary>
+    std::unique_ptr<std::streambuf> open(const path &file,
+        const compression_options &compression = compression_options(), bool pipelined = false);
+
+    /// <summary>
+    /// Copies file from source as it is stored there, still compressed and with the same
+    /// CRC-32 and sizes, instead of inflating and deflating it again. No streambuf
+    /// returned by open may still be alive.
     /// </summary>
-    std::unique_ptr<std::streambuf> open(const path &file);
+    void copy(const izstream &source, const path &file);
+
+    /// <summary>
+    /// Records the time spent writing and deflating each part opened from now on in the
+    /// given instrumentation, which must outlive the parts.
+    /// </summary>
+    void instrument(instrumentation *parts);
+
+    /// <summary>
+    /// Counts the bytes deflated and parts written from now on in the given
+    /// progress_monitor, which must outlive the parts.
+    /// </summary>
+    void monitor(progress_monitor *progress);
 
 private:
     std::vector<zheader> file_headers_;
     std::ostream &destination_stream_;
+    instrumentation *instrumentation_ = nullptr;
+    progress_monitor *progress_ = nullptr;
 };
 
 /// <summary>
@@ -107,15 +140,24 @@ public:
     /// </summary>
     izstream(std::istream &stream);
 
+    /// <summary>
+    /// Construct a new zip_file_reader which reads a ZIP archive held in memory, such as
+    /// a mapped file, which must outlive this object and every streambuf it opens.
+    /// Files are inflated straight from memory and several may be read at once.
+    /// </summary>
+    izstream(const std::uint8_t *data, std::size_t size);
+
     /// <summary>
     /// Destructor.
     /// </summary>
     virtual ~izstream();
 
     /// <summary>
-    ///
+    /// Returns a pointer to a streambuf which decompresses file. If pipelined is true
+    /// and the archive is held in memory, file is inflated on a separate thread while
+    /// it is read from the streambuf. A stream can't be shared with such a thread.
     /// </summary>
-    std::unique_ptr<std::streambuf> open(const path &file) const;
+    std::unique_ptr<std::streambuf> open(const path &file, bool pipelined = false) const;
 
     /// <summary>
     ///
@@ -132,12 +174,76 @@ public:
     /// </summary>
     bool has_file(const path &filename) const;
 
+    /// <summary>
+    /// Returns the central directory header of file, which records its CRC-32 and sizes.
+    /// </summary>
+    const zheader &header(const path &file) const;
+
+    /// <summary>
+    /// Returns true if file holds exactly bytes, going by the size and CRC-32 recorded
+    /// in the archive.
+    /// </summary>
+    bool matches(const path &file, const std::vector<std::uint8_t> &bytes) const;
+
+    /// <summary>
+    /// Writes the stored bytes of file to destination without inflating them.
+    /// </summary>
+    void read_raw(const path &file, std::ostream &destination) const;
+
+    /// <summary>
+    /// Records the time spent reading and inflating each part opened from now on in the
+    /// given instrumentation, which must outlive the parts.
+    /// </summary>
+    void instrument(instrumentation *parts);
+
+    /// <summary>
+    /// Counts the bytes inflated and parts read from now on in the given
+    /// progress_monitor, which must outlive the parts.
+    /// </summary>
+    void monitor(progress_monitor *progress);
+
+    /// <summary>
+    /// Returns the sum of the uncompressed sizes of all files in the archive.
+    /// </summary>
+    std::uint64_t uncompressed_size() const;
+
 private:
     /// <summary>
     ///
     /// </summary>
     bool read_central_header();
 
+    /// <summary>
+    /// Opens a file in an archive held in memory.
+    /// </summary>
+    std::unique_ptr<std::streambuf> open_in_memory(const zheader &header) const;
+
+    /// <summary>
+    /// Returns the offset of the stored bytes of a file in an archive held in memory,
+    /// throwing if they don't lie within it.
+    /// </summary>
+    std::size_t data_offset(const zheader &header) const;
+
+    /// <summary>
+    /// The archive if it is held in memory, otherwise null.
+    /// </summary>
+    const std::uint8_t *data_ = nullptr;
+
+    /// <summary>
+    ///
+    /// </summary>
+    std::size_t size_ = 0;
+
+    /// <summary>
+    /// Reads the central directory of an archive held in memory through source_stream_.
+    /// </summary>
+    std::unique_ptr<std::streambuf> data_buffer_;
+
+    /// <summary>
+    ///
+    /// </summary>
+    std::unique_ptr<std::istream> data_stream_;
+
     /// <summary>
     ///
     /// </summary>
@@ -147,6 +253,16 @@ private:
     ///
     /// </summary>
     std::istream &source_stream_;
+
+    /// <summary>
+    ///
+    /// </summary>
+    instrumentation *instrumentation_ = nullptr;
+
+    /// <summary>
+    ///
+    /// </summary>
+    progress_monitor *progress_ = nullptr;
 };
 
 } // namespace detail
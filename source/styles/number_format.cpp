@@ -36,10 +36,8 @@ namespace {
 
 const std::unordered_map<std::size_t, xlnt::number_format> &builtin_formats()
 {
-    static std::unordered_map<std::size_t, xlnt::number_format> *formats = nullptr;
-    
-    if (formats == nullptr)
-    {
+    // built exactly once, even when first called from several threads at a time
+    static const auto *formats = []() {
         const std::unordered_map<std::size_t, std::string> format_strings
         {
             {0, "General"},
@@ -79,15 +77,16 @@ const std::unordered_map<std::size_t, xlnt::number_format> &builtin_formats()
             {49, "@"}
         };
 
-        formats = new std::unordered_map<std::size_t, xlnt::number_format>();
-        auto &formats_ref = *formats;
+        auto result = new std::unordered_map<std::size_t, xlnt::number_format>();
 
         for (auto format_string_pair : format_strings)
         {
-            formats_ref[format_string_pair.first] =
-                xlnt::number_format(format_string_pair.second, format_string_pair.first);
+            result->emplace(format_string_pair.first,
+                xlnt::number_format(format_string_pair.second, format_string_pair.first));
         }
-    }
+
+        return result;
+    }();
 
     return *formats;
 }
@@ -21,7 +21,9 @@
 // @license: http://www.opensource.org/licenses/mit-license.php
 // @author: see AUTHORS file
 #include <cmath>
+#include <cstddef>
 #include <ctime>
+#include <vector>
 
 #include <xlnt/utils/date.hpp>
 
@@ -34,11 +36,108 @@ std::tm safe_localtime(std::time_t raw_time)
     localtime_s(&result, &raw_time);
 
     return result;
-#else
+#elif defined(_WIN32)
+    // the Windows CRT keeps the result of localtime per thread
     return *localtime(&raw_time);
+#else
+    std::tm result;
+    localtime_r(&raw_time, &result);
+
+    return result;
 #endif
 }
 
+// Number of days from 1899-12-30, the day before serial 1 in a 1900-based
+// workbook ignoring the leap year bug, to 1970-01-01.
+const int windows_1900_epoch = 25569;
+
+// Returns the number of days since 1970-01-01 in the proleptic Gregorian calendar.
+// See http://howardhinnant.github.io/date_algorithms.html#days_from_civil
+int days_from_civil(int year, int month, int day)
+{
+    year -= month <= 2 ? 1 : 0;
+    const auto era = (year >= 0 ? year : year - 399) / 400;
+    const auto year_of_era = year - era * 400;
+    const auto day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const auto day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+
+    return era * 146097 + day_of_era - 719468;
+}
+
+// The inverse of days_from_civil.
+// See http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+xlnt::date civil_from_days(int days)
+{
+    days += 719468;
+    const auto era = (days >= 0 ? days : days - 146096) / 146097;
+    const auto day_of_era = days - era * 146097;
+    const auto year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    const auto day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    const auto shifted_month = (5 * day_of_year + 2) / 153;
+    const auto day = day_of_year - (153 * shifted_month + 2) / 5 + 1;
+    const auto month = shifted_month < 10 ? shifted_month + 3 : shifted_month - 9;
+
+    return xlnt::date(year_of_era + era * 400 + (month <= 2 ? 1 : 0), month, day);
+}
+
+xlnt::date from_windows_1900_serial(int serial)
+{
+    // Excel treats 1900 as a leap year, so serial 60 is the nonexistent 1900-02-29
+    // and every earlier serial is offset by one day.
+    if (serial == 60)
+    {
+        return xlnt::date(1900, 2, 29);
+    }
+
+    return civil_from_days(serial - (serial < 60 ? windows_1900_epoch - 1 : windows_1900_epoch));
+}
+
+// Converts the serials of a 1900-based workbook, each plus offset, to civil dates like
+// from_windows_1900_serial. The loop has no calls and its branches only select values,
+// so the compiler can vectorize it. The fields are written to separate arrays because
+// date has no default constructor.
+void civil_from_serials(const int *serials, std::size_t count, int offset,
+    int *years, int *months, int *days)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const auto serial = serials[i] + offset;
+        const auto since_epoch = serial - windows_1900_epoch + (serial < 60 ? 1 : 0) + 719468;
+        const auto era = (since_epoch >= 0 ? since_epoch : since_epoch - 146096) / 146097;
+        const auto day_of_era = since_epoch - era * 146097;
+        const auto year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+        const auto day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+        const auto shifted_month = (5 * day_of_year + 2) / 153;
+        const auto month = shifted_month < 10 ? shifted_month + 3 : shifted_month - 9;
+        const auto leap_quirk = serial == 60;
+
+        years[i] = leap_quirk ? 1900 : year_of_era + era * 400 + (month <= 2 ? 1 : 0);
+        months[i] = leap_quirk ? 2 : month;
+        days[i] = leap_quirk ? 29 : day_of_year - (153 * shifted_month + 2) / 5 + 1;
+    }
+}
+
+// The inverse of civil_from_serials, like date::to_number, without calls or branches
+// other than selects. The fields of each date are interleaved, so compilers don't
+// vectorize this one, but it still saves a call per date.
+void serials_from_civil(const xlnt::date *dates, std::size_t count, int offset, int *serials)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const auto month = dates[i].month;
+        const auto day = dates[i].day;
+        const auto year = dates[i].year - (month <= 2 ? 1 : 0);
+        const auto era = (year >= 0 ? year : year - 399) / 400;
+        const auto year_of_era = year - era * 400;
+        const auto day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        const auto day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+        const auto serial = era * 146097 + day_of_era - 719468 + windows_1900_epoch;
+        const auto leap_quirk = day == 29 && month == 2 && dates[i].year == 1900;
+
+        serials[i] = (leap_quirk ? 60 : serial - (serial <= 60 ? 1 : 0)) - offset;
+    }
+}
+
 } // namespace
 
 namespace xlnt {
@@ -50,37 +149,24 @@ date::date(int year_, int month_, int day_)
 
 date date::from_number(int days_since_base_year, calendar base_date)
 {
-    date result(0, 0, 0);
+    return from_windows_1900_serial(days_since_base_year + (base_date == calendar::mac_1904 ? 1462 : 0));
+}
 
-    if (base_date == calendar::mac_1904)
-    {
-        days_since_base_year += 1462;
-    }
+std::vector<date> date::from_numbers(const std::vector<int> &serials, calendar base_date)
+{
+    const auto count = serials.size();
+    std::vector<int> fields(count * 3);
+    civil_from_serials(serials.data(), count, base_date == calendar::mac_1904 ? 1462 : 0,
+        fields.data(), fields.data() + count, fields.data() + 2 * count);
 
-    if (days_since_base_year == 60)
-    {
-        result.day = 29;
-        result.month = 2;
-        result.year = 1900;
+    std::vector<date> result;
+    result.reserve(count);
 
-        return result;
-    }
-    else if (days_since_base_year < 60)
+    for (std::size_t i = 0; i < count; ++i)
     {
-        days_since_base_year++;
+        result.emplace_back(fields[i], fields[count + i], fields[2 * count + i]);
     }
 
-    int l = days_since_base_year + 68569 + 2415019;
-    int n = int((4 * l) / 146097);
-    l = l - int((146097 * n + 3) / 4);
-    int i = int((4000 * (l + 1)) / 1461001);
-    l = l - int((1461 * i) / 4) + 31;
-    int j = int((80 * l) / 2447);
-    result.day = l - int((2447 * j) / 80);
-    l = int(j / 11);
-    result.month = j + 2 - (12 * l);
-    result.year = 100 * (n - 49) + i + l;
-
     return result;
 }
 
@@ -101,9 +187,7 @@ int date::to_number(calendar base_date) const
         return 60;
     }
 
-    int days_since_1900 = int((1461 * (year + 4800 + int((month - 14) / 12))) / 4)
-        + int((367 * (month - 2 - 12 * ((month - 14) / 12))) / 12)
-        - int((3 * (int((year + 4900 + int((month - 14) / 12)) / 100))) / 4) + day - 2415019 - 32075;
+    auto days_since_1900 = days_from_civil(year, month, day) + windows_1900_epoch;
 
     if (days_since_1900 <= 60)
     {
@@ -118,6 +202,14 @@ int date::to_number(calendar base_date) const
     return days_since_1900;
 }
 
+std::vector<int> date::to_numbers(const std::vector<date> &dates, calendar base_date)
+{
+    std::vector<int> result(dates.size());
+    serials_from_civil(dates.data(), dates.size(), base_date == calendar::mac_1904 ? 1462 : 0, result.data());
+
+    return result;
+}
+
 date date::today()
 {
     std::tm now = safe_localtime(std::time(nullptr));
@@ -22,6 +22,7 @@
 // @author: see AUTHORS file
 #include <cmath>
 #include <ctime>
+#include <vector>
 
 #include <xlnt/utils/date.hpp>
 #include <xlnt/utils/datetime.hpp>
@@ -52,6 +53,50 @@ datetime datetime::from_number(double raw_time, calendar base_date)
         time_part.microsecond);
 }
 
+std::vector<datetime> datetime::from_numbers(const std::vector<double> &numbers, calendar base_date)
+{
+    const auto count = numbers.size();
+    std::vector<int> serials(count);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        serials[i] = static_cast<int>(numbers[i]);
+    }
+
+    const auto dates = date::from_numbers(serials, base_date);
+    std::vector<datetime> result;
+    result.reserve(count);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        result.emplace_back(dates[i], time::from_number(numbers[i]));
+    }
+
+    return result;
+}
+
+std::vector<double> datetime::to_numbers(const std::vector<datetime> &datetimes, calendar base_date)
+{
+    std::vector<date> dates;
+    dates.reserve(datetimes.size());
+
+    for (const auto &dt : datetimes)
+    {
+        dates.emplace_back(dt.year, dt.month, dt.day);
+    }
+
+    const auto serials = date::to_numbers(dates, base_date);
+    std::vector<double> result(datetimes.size());
+
+    for (std::size_t i = 0; i < datetimes.size(); ++i)
+    {
+        const auto &dt = datetimes[i];
+        result[i] = serials[i] + time(dt.hour, dt.minute, dt.second, dt.microsecond).to_number();
+    }
+
+    return result;
+}
+
 bool datetime::operator==(const datetime &comparand) const
 {
     return year == comparand.year 
@@ -159,4 +159,13 @@ unsupported::~unsupported()
 {
 }
 
+operation_cancelled::operation_cancelled()
+    : exception("operation cancelled")
+{
+}
+
+operation_cancelled::~operation_cancelled()
+{
+}
+
 } // namespace xlnt
@@ -34,8 +34,14 @@ std::tm safe_localtime(std::time_t raw_time)
     localtime_s(&result, &raw_time);
 
     return result;
-#else
+#elif defined(_WIN32)
+    // the Windows CRT keeps the result of localtime per thread
     return *localtime(&raw_time);
+#else
+    std::tm result;
+    localtime_r(&raw_time, &result);
+
+    return result;
 #endif
 }
 
@@ -0,0 +1,57 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <numeric>
+
+#include <xlnt/workbook/serialization_statistics.hpp>
+
+namespace xlnt {
+
+bool serialization_statistics::enabled()
+{
+#ifdef XLNT_INSTRUMENTATION
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::uint64_t serialization_statistics::compressed_bytes() const
+{
+    return std::accumulate(parts.begin(), parts.end(), std::uint64_t(0),
+        [](std::uint64_t sum, const part_statistics &p) { return sum + p.compressed_bytes; });
+}
+
+std::uint64_t serialization_statistics::uncompressed_bytes() const
+{
+    return std::accumulate(parts.begin(), parts.end(), std::uint64_t(0),
+        [](std::uint64_t sum, const part_statistics &p) { return sum + p.uncompressed_bytes; });
+}
+
+double serialization_statistics::compression_seconds() const
+{
+    return std::accumulate(parts.begin(), parts.end(), 0.0,
+        [](double sum, const part_statistics &p) { return sum + p.compression_seconds; });
+}
+
+} // namespace xlnt
@@ -0,0 +1,82 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <xlnt/utils/exceptions.hpp>
+#include <xlnt/workbook/shared_string_view.hpp>
+#include <detail/implementations/shared_string_table.hpp>
+
+namespace xlnt {
+
+const std::size_t shared_string_view::npos = static_cast<std::size_t>(-1);
+
+shared_string_view::shared_string_view(const detail::shared_string_table &table)
+    : table_(&table)
+{
+}
+
+std::size_t shared_string_view::size() const
+{
+    return table_->size();
+}
+
+bool shared_string_view::empty() const
+{
+    return table_->empty();
+}
+
+const rich_text &shared_string_view::at(std::size_t index) const
+{
+    if (index >= table_->size())
+    {
+        throw invalid_parameter();
+    }
+
+    return table_->values()[index];
+}
+
+const rich_text &shared_string_view::operator[](std::size_t index) const
+{
+    return table_->values()[index];
+}
+
+std::size_t shared_string_view::find(const rich_text &text) const
+{
+    return table_->find(text);
+}
+
+std::size_t shared_string_view::find(const std::string &plain_text) const
+{
+    return table_->find(plain_text);
+}
+
+shared_string_view::const_iterator shared_string_view::begin() const
+{
+    return table_->values().begin();
+}
+
+shared_string_view::const_iterator shared_string_view::end() const
+{
+    return table_->values().end();
+}
+
+} // namespace xlnt
@@ -103,7 +103,6 @@ void streaming_workbook_writer::open(std::ostream &stream)
     producer_->open(stream);
     producer_->current_worksheet_ = new detail::worksheet_impl(workbook_.get(), 1, "Sheet1");
     producer_->current_cell_ = new detail::cell_impl();
-    producer_->current_cell_->parent_ = producer_->current_worksheet_;
 }
 
 } // namespace xlnt
@@ -24,6 +24,7 @@
 
 #include <algorithm>
 #include <array>
+#include <cstdio>
 #include <fstream>
 #include <functional>
 #include <set>
@@ -42,8 +43,10 @@
 #include <xlnt/utils/exceptions.hpp>
 #include <xlnt/utils/path.hpp>
 #include <xlnt/utils/variant.hpp>
+#include <xlnt/workbook/memory_usage.hpp>
 #include <xlnt/workbook/metadata_property.hpp>
 #include <xlnt/workbook/named_range.hpp>
+#include <xlnt/workbook/serialization_options.hpp>
 #include <xlnt/workbook/theme.hpp>
 #include <xlnt/workbook/workbook.hpp>
 #include <xlnt/workbook/workbook_view.hpp>
@@ -54,10 +57,14 @@
 #include <detail/constants.hpp>
 #include <detail/default_case.hpp>
 #include <detail/implementations/cell_impl.hpp>
+#include <detail/implementations/heap_usage.hpp>
 #include <detail/implementations/workbook_impl.hpp>
 #include <detail/implementations/worksheet_impl.hpp>
 #include <detail/serialization/excel_thumbnail.hpp>
+#include <detail/serialization/mapped_file.hpp>
 #include <detail/serialization/open_stream.hpp>
+#include <detail/serialization/snapshot.hpp>
+#include <detail/serialization/source_package.hpp>
 #include <detail/serialization/vector_streambuf.hpp>
 #include <detail/serialization/xlsx_consumer.hpp>
 #include <detail/serialization/xlsx_producer.hpp>
@@ -750,6 +757,7 @@ worksheet workbook::create_sheet()
         sheet_id = std::max(sheet_id, ws.id() + 1);
     }
     d_->worksheets_.push_back(detail::worksheet_impl(this, sheet_id, title));
+    d_->worksheets_.back().cell_map_.spill(d_->spill_);
     // unique sheet file name
     auto workbook_rel = d_->manifest_.relationship(path("/"), relationship_type::office_document);
     auto workbook_files = d_->manifest_.relationships(workbook_rel.target().path());
@@ -784,11 +792,19 @@ worksheet workbook::copy_sheet(worksheet to_copy)
 {
     if (to_copy.d_->parent_ != this) throw invalid_parameter();
 
-    detail::worksheet_impl impl(*to_copy.d_);
     auto new_sheet = create_sheet();
-    impl.title_ = new_sheet.title();
-    impl.id_ = new_sheet.id();
-    *new_sheet.d_ = impl;
+    const auto title = new_sheet.title();
+    const auto id = new_sheet.id();
+
+    // cells are shared with to_copy until either sheet modifies them
+    *new_sheet.d_ = *to_copy.d_;
+    new_sheet.d_->title_ = title;
+    new_sheet.d_->id_ = id;
+
+    if (!new_sheet.d_->comments_.empty())
+    {
+        new_sheet.register_comments_in_manifest();
+    }
 
     return new_sheet;
 }
@@ -805,8 +821,7 @@ worksheet workbook::copy_sheet(worksheet to_copy, std::size_t index)
         {
         }
 
-        d_->worksheets_.insert(iter, d_->worksheets_.back());
-        d_->worksheets_.pop_back();
+        d_->worksheets_.splice(iter, d_->worksheets_, std::prev(d_->worksheets_.end()));
     }
 
     return sheet_by_index(index);
@@ -863,21 +878,54 @@ range workbook::named_range(const std::string &name)
 
 void workbook::load(std::istream &stream)
 {
-    clear();
-    detail::xlsx_consumer consumer(*this);
-    consumer.read(stream);
+    load(stream, load_options());
+}
+
+void workbook::load(std::istream &stream, const load_options &options)
+{
+    // load into a new workbook so this one is unchanged if the load fails or is cancelled
+    workbook loaded(new detail::workbook_impl());
+    loaded.d_->spill_ = d_->spill_; // keeps the memory budget while loading
+    detail::xlsx_consumer consumer(loaded);
+
+    if (options.keep_source)
+    {
+        consumer.read(std::make_shared<detail::source_package>(detail::to_vector(stream)), options);
+    }
+    else
+    {
+        consumer.read(stream, options);
+    }
+
+    swap(loaded);
 }
 
 void workbook::load(const std::vector<std::uint8_t> &data)
+{
+    load(data, load_options());
+}
+
+void workbook::load(const std::vector<std::uint8_t> &data, const load_options &options)
 {
     if (data.size() < 22) // the shortest ZIP file is 22 bytes
     {
         throw xlnt::exception("file is empty or malformed");
     }
 
-    xlnt::detail::vector_istreambuf data_buffer(data);
-    std::istream data_stream(&data_buffer);
-    load(data_stream);
+    workbook loaded(new detail::workbook_impl());
+    loaded.d_->spill_ = d_->spill_;
+    detail::xlsx_consumer consumer(loaded);
+
+    if (options.keep_source)
+    {
+        consumer.read(std::make_shared<detail::source_package>(std::vector<std::uint8_t>(data)), options);
+    }
+    else
+    {
+        consumer.read(data.data(), data.size(), options);
+    }
+
+    swap(loaded);
 }
 
 void workbook::load(const std::string &filename)
@@ -887,6 +935,34 @@ void workbook::load(const std::string &filename)
 
 void workbook::load(const path &filename)
 {
+    load(filename, load_options());
+}
+
+void workbook::load(const path &filename, const load_options &options)
+{
+    // read regular files straight from memory, falling back to a stream for anything else
+    std::unique_ptr<detail::mapped_file> mapping(new detail::mapped_file(filename));
+
+    if (mapping->is_open())
+    {
+        workbook loaded(new detail::workbook_impl());
+        loaded.d_->spill_ = d_->spill_;
+        detail::xlsx_consumer consumer(loaded);
+
+        if (options.keep_source)
+        {
+            consumer.read(std::make_shared<detail::source_package>(std::move(mapping)), options);
+        }
+        else
+        {
+            consumer.read(mapping->data(), mapping->size(), options);
+        }
+
+        swap(loaded);
+
+        return;
+    }
+
     std::ifstream file_stream;
     open_stream(file_stream, filename.string());
 
@@ -895,7 +971,7 @@ void workbook::load(const path &filename)
         throw xlnt::exception("file not found " + filename.string());
     }
 
-    load(file_stream);
+    load(file_stream, options);
 }
 
 void workbook::load(const std::string &filename, const std::string &password)
@@ -905,6 +981,17 @@ void workbook::load(const std::string &filename, const std::string &password)
 
 void workbook::load(const path &filename, const std::string &password)
 {
+    detail::mapped_file mapping(filename);
+
+    if (mapping.is_open())
+    {
+        clear();
+        detail::xlsx_consumer consumer(*this);
+        consumer.read(mapping.data(), mapping.size(), password);
+
+        return;
+    }
+
     std::ifstream file_stream;
     open_stream(file_stream, filename.string());
 
@@ -936,10 +1023,15 @@ void workbook::load(std::istream &stream, const std::string &password)
 }
 
 void workbook::save(std::vector<std::uint8_t> &data) const
+{
+    save(data, save_options());
+}
+
+void workbook::save(std::vector<std::uint8_t> &data, const save_options &options) const
 {
     xlnt::detail::vector_ostreambuf data_buffer(data);
     std::ostream data_stream(&data_buffer);
-    save(data_stream);
+    save(data_stream, options);
 }
 
 void workbook::save(std::vector<std::uint8_t> &data, const std::string &password) const
@@ -961,9 +1053,49 @@ void workbook::save(const std::string &filename, const std::string &password) co
 
 void workbook::save(const path &filename) const
 {
-    std::ofstream file_stream;
-    open_stream(file_stream, filename.string());
-    save(file_stream);
+    save(filename, save_options());
+}
+
+void workbook::save(const path &filename, const save_options &options) const
+{
+    if (d_->source_ == nullptr)
+    {
+        std::ofstream file_stream;
+        open_stream(file_stream, filename.string());
+        save(file_stream, options);
+
+        return;
+    }
+
+    // the kept source may be mapped from filename itself, which must stay intact
+    // until the new package is complete
+    const auto temporary = filename.string() + ".xlnt-save";
+
+    try
+    {
+        std::ofstream file_stream;
+        open_stream(file_stream, temporary);
+        save(file_stream, options);
+    }
+    catch (...)
+    {
+        std::remove(temporary.c_str());
+        throw;
+    }
+
+#ifdef _WIN32
+    // Neither rename nor remove work on a file that is mapped here, so stop mapping
+    // the kept source in case it's filename. Then remove the file since rename
+    // doesn't replace one.
+    d_->source_->unmap();
+    std::remove(filename.string().c_str());
+#endif
+
+    if (std::rename(temporary.c_str(), filename.string().c_str()) != 0)
+    {
+        std::remove(temporary.c_str());
+        throw xlnt::exception("couldn't replace " + filename.string());
+    }
 }
 
 void workbook::save(const path &filename, const std::string &password) const
@@ -974,9 +1106,14 @@ void workbook::save(const path &filename, const std::string &password) const
 }
 
 void workbook::save(std::ostream &stream) const
+{
+    save(stream, save_options());
+}
+
+void workbook::save(std::ostream &stream, const save_options &options) const
 {
     detail::xlsx_producer producer(*this);
-    producer.write(stream);
+    producer.write(stream, options);
 }
 
 void workbook::save(std::ostream &stream, const std::string &password) const
@@ -985,6 +1122,65 @@ void workbook::save(std::ostream &stream, const std::string &password) const
     producer.write(stream, password);
 }
 
+void workbook::save_snapshot(std::vector<std::uint8_t> &data) const
+{
+    data.clear();
+    detail::snapshot_producer producer(*this);
+    producer.write(data);
+}
+
+void workbook::save_snapshot(const path &filename) const
+{
+    std::vector<std::uint8_t> data;
+    save_snapshot(data);
+
+    std::ofstream file_stream;
+    open_stream(file_stream, filename.string());
+    file_stream.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+
+    if (!file_stream.good())
+    {
+        throw xlnt::exception("couldn't write " + filename.string());
+    }
+}
+
+void workbook::load_snapshot(const std::vector<std::uint8_t> &data)
+{
+    workbook loaded(new detail::workbook_impl());
+    loaded.d_->spill_ = d_->spill_;
+    detail::snapshot_consumer consumer(loaded);
+    consumer.read(data.data(), data.size());
+
+    swap(loaded);
+}
+
+void workbook::load_snapshot(const path &filename)
+{
+    detail::mapped_file mapping(filename);
+
+    if (mapping.is_open())
+    {
+        workbook loaded(new detail::workbook_impl());
+        loaded.d_->spill_ = d_->spill_;
+        detail::snapshot_consumer consumer(loaded);
+        consumer.read(mapping.data(), mapping.size());
+
+        swap(loaded);
+
+        return;
+    }
+
+    std::ifstream file_stream;
+    open_stream(file_stream, filename.string());
+
+    if (!file_stream.good())
+    {
+        throw xlnt::exception("file not found " + filename.string());
+    }
+
+    load_snapshot(detail::to_vector(file_stream));
+}
+
 #ifdef _MSC_VER
 void workbook::save(const std::wstring &filename) const
 {
@@ -1057,8 +1253,7 @@ worksheet workbook::create_sheet(std::size_t index)
         {
         }
 
-        d_->worksheets_.insert(iter, d_->worksheets_.back());
-        d_->worksheets_.pop_back();
+        d_->worksheets_.splice(iter, d_->worksheets_, std::prev(d_->worksheets_.end()));
     }
 
     return sheet_by_index(index);
@@ -1068,6 +1263,7 @@ worksheet workbook::create_sheet_with_rel(const std::string &title, const relati
 {
     auto sheet_id = d_->worksheets_.size() + 1;
     d_->worksheets_.push_back(detail::worksheet_impl(this, sheet_id, title));
+    d_->worksheets_.back().cell_map_.spill(d_->spill_);
 
     auto workbook_rel = d_->manifest_.relationship(path("/"), relationship_type::office_document);
     auto sheet_absoulute_path = workbook_rel.target().path().parent().append(rel.target().path());
@@ -1141,8 +1337,12 @@ worksheet workbook::operator[](std::size_t index)
 
 void workbook::clear()
 {
+    const auto spill = d_->spill_;
     *d_ = detail::workbook_impl();
     d_->stylesheet_.clear();
+
+    // Keeps the memory budget for a workbook loaded next
+    d_->spill_ = spill;
 }
 
 bool workbook::operator==(const workbook &rhs) const
@@ -1164,9 +1364,11 @@ void workbook::swap(workbook &right)
 
     if (left.d_ != nullptr)
     {
-        for (auto ws : left)
+        // reparent the implementations directly since handing out worksheets would
+        // mark them as changed
+        for (auto &impl : left.d_->worksheets_)
         {
-            ws.parent(left);
+            impl.parent_ = &left;
         }
 
         if (left.d_->stylesheet_.is_set())
@@ -1177,9 +1379,11 @@ void workbook::swap(workbook &right)
 
     if (right.d_ != nullptr)
     {
-        for (auto ws : right)
+        // reparent the implementations directly since handing out worksheets would
+        // mark them as changed
+        for (auto &impl : right.d_->worksheets_)
         {
-            ws.parent(right);
+            impl.parent_ = &right;
         }
 
         if (right.d_->stylesheet_.is_set())
@@ -1334,51 +1538,109 @@ const manifest &workbook::manifest() const
 
 const std::map<std::size_t, rich_text> &workbook::shared_strings_by_id() const
 {
-    return d_->shared_strings_values_;
+    const auto &values = d_->shared_strings_.values();
+    auto &by_id = d_->shared_strings_values_;
+
+    for (auto index = by_id.size(); index < values.size(); ++index)
+    {
+        by_id.emplace_hint(by_id.end(), index, values[index]);
+    }
+
+    return by_id;
 }
 
 const rich_text& workbook::shared_strings(std::size_t index) const
 {
-    auto it = d_->shared_strings_values_.find(index);
+    const auto &values = d_->shared_strings_.values();
 
-    if (it != d_->shared_strings_values_.end())
+    if (index < values.size())
     {
-        return it->second;
+        return values[index];
     }
 
     static rich_text empty;
     return empty;
 }
 
+shared_string_view workbook::shared_strings_view() const
+{
+    return shared_string_view(d_->shared_strings_);
+}
+
 std::unordered_map<rich_text, std::size_t, rich_text_hash> &workbook::shared_strings()
 {
+    static_cast<const workbook *>(this)->shared_strings();
     return d_->shared_strings_ids_;
 }
 
 const std::unordered_map<rich_text, std::size_t, rich_text_hash> &workbook::shared_strings() const
 {
-    return d_->shared_strings_ids_;
+    const auto &values = d_->shared_strings_.values();
+    auto &ids = d_->shared_strings_ids_;
+
+    for (auto &index = d_->shared_strings_ids_count_; index < values.size(); ++index)
+    {
+        ids.emplace(values[index], index);
+    }
+
+    return ids;
 }
 
 std::size_t workbook::add_shared_string(const rich_text &shared, bool allow_duplicates)
 {
-    register_workbook_part(relationship_type::shared_string_table);
+    if (d_->shared_strings_.empty())
+    {
+        register_workbook_part(relationship_type::shared_string_table);
+    }
+    else if (!allow_duplicates)
+    {
+        const auto index = d_->shared_strings_.find(shared);
+
+        if (index != detail::shared_string_table::npos)
+        {
+            return index;
+        }
+    }
 
-    if (!allow_duplicates)
+    return d_->shared_strings_.append(shared);
+}
+
+std::size_t workbook::add_shared_string(rich_text &&shared, bool allow_duplicates)
+{
+    if (d_->shared_strings_.empty())
     {
-        auto it = d_->shared_strings_ids_.find(shared);
+        register_workbook_part(relationship_type::shared_string_table);
+    }
+    else if (!allow_duplicates)
+    {
+        const auto index = d_->shared_strings_.find(shared);
 
-        if (it != d_->shared_strings_ids_.end())
+        if (index != detail::shared_string_table::npos)
         {
-            return it->second;
+            return index;
         }
     }
 
-    auto sz = d_->shared_strings_ids_.size();
-    d_->shared_strings_ids_[shared] = sz;
-    d_->shared_strings_values_[sz] = shared;
+    return d_->shared_strings_.append(std::move(shared));
+}
+
+std::size_t workbook::add_shared_string(std::string &&shared, bool allow_duplicates)
+{
+    if (d_->shared_strings_.empty())
+    {
+        register_workbook_part(relationship_type::shared_string_table);
+    }
+    else if (!allow_duplicates)
+    {
+        const auto index = d_->shared_strings_.find(shared);
 
-    return sz;
+        if (index != detail::shared_string_table::npos)
+        {
+            return index;
+        }
+    }
+
+    return d_->shared_strings_.append(rich_text(std::move(shared)));
 }
 
 bool workbook::contains(const std::string &sheet_title) const
@@ -1402,7 +1664,7 @@ void workbook::thumbnail(const std::vector<std::uint8_t> &thumbnail,
     }
 
     auto thumbnail_rel = d_->manifest_.relationship(path("/"), relationship_type::thumbnail);
-    d_->images_[thumbnail_rel.target().to_string()] = thumbnail;
+    d_->images_.set(thumbnail_rel.target().to_string(), thumbnail);
 }
 
 const std::vector<std::uint8_t> &workbook::thumbnail() const
@@ -1546,6 +1808,101 @@ void workbook::calculation_properties(const class calculation_properties &props)
     d_->calculation_properties_ = props;
 }
 
+void workbook::calculate(std::size_t threads)
+{
+    if (!d_->formula_engine_)
+    {
+        d_->formula_engine_.reset(new detail::formula_engine(*d_));
+    }
+
+    // Reading a cell may page rows in and out, which isn't safe to do on several threads
+    d_->formula_engine_->calculate(d_->spill_ ? 1 : threads);
+}
+
+workbook_memory_usage workbook::memory_usage() const
+{
+    using detail::heap_usage;
+
+    workbook_memory_usage usage;
+
+    for (auto ws : *this)
+    {
+        usage.worksheets.push_back(ws.memory_usage());
+    }
+
+    usage.shared_strings = d_->shared_strings_.memory_usage()
+        + heap_usage::of_hash_table(d_->shared_strings_ids_)
+        + heap_usage::of_tree(d_->shared_strings_values_);
+
+    for (const auto &entry : d_->shared_strings_ids_)
+    {
+        usage.shared_strings += heap_usage::of(entry.first);
+    }
+
+    for (const auto &entry : d_->shared_strings_values_)
+    {
+        usage.shared_strings += heap_usage::of(entry.second);
+    }
+
+    if (d_->stylesheet_.is_set())
+    {
+        const auto &stylesheet = d_->stylesheet_.get();
+
+        usage.stylesheet = sizeof(detail::stylesheet)
+            + heap_usage::of(stylesheet.format_impls)
+            + heap_usage::of_hash_table(stylesheet.style_impls)
+            + heap_usage::of(stylesheet.style_names)
+            + heap_usage::of(stylesheet.borders)
+            + heap_usage::of(stylesheet.fills)
+            + heap_usage::of(stylesheet.fonts)
+            + heap_usage::of(stylesheet.number_formats)
+            + heap_usage::of(stylesheet.colors);
+
+        for (const auto &name : stylesheet.style_names)
+        {
+            usage.stylesheet += heap_usage::of(name);
+        }
+    }
+
+    usage.images = d_->images_.memory_usage();
+    usage.spilled = d_->images_.spilled_bytes();
+
+    if (d_->formula_engine_)
+    {
+        usage.calculation = sizeof(detail::formula_engine) + d_->formula_engine_->memory_usage();
+    }
+
+    usage.other = sizeof(detail::workbook_impl)
+        + heap_usage::of(d_->worksheets_) - d_->worksheets_.size() * sizeof(detail::worksheet_impl)
+        + heap_usage::of(d_->core_properties_)
+        + heap_usage::of(d_->extended_properties_)
+        + heap_usage::of(d_->custom_properties_)
+        + heap_usage::of_hash_table(d_->sheet_title_rel_id_map_)
+        + heap_usage::of(d_->title_);
+
+    return usage;
+}
+
+void workbook::memory_budget(std::size_t budget, const path &scratch_directory)
+{
+    const auto spill = budget == 0
+        ? std::shared_ptr<detail::spill_file>()
+        : std::make_shared<detail::spill_file>(scratch_directory, budget);
+
+    d_->spill_ = spill;
+    d_->images_.spill(spill);
+
+    for (auto &ws : d_->worksheets_)
+    {
+        ws.cell_map_.spill(spill);
+    }
+}
+
+std::size_t workbook::memory_budget() const
+{
+    return d_->spill_ ? d_->spill_->budget() : 0;
+}
+
 void workbook::garbage_collect_formulae()
 {
     auto any_with_formula = false;
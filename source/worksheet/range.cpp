@@ -204,6 +204,11 @@ void range::apply(std::function<void(class cell)> f)
     }
 }
 
+void range::save_csv(std::ostream &stream, const csv_options &options) const
+{
+    ws_.save_csv(ref_, stream, options);
+}
+
 cell range::cell(const cell_reference &ref)
 {
     return (*this)[ref.row() - 1][ref.column().index - 1];
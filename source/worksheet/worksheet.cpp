@@ -25,6 +25,7 @@
 #include <algorithm>
 #include <cmath>
 #include <limits>
+#include <vector>
 
 #include <xlnt/cell/cell.hpp>
 #include <xlnt/cell/cell_reference.hpp>
@@ -33,6 +34,7 @@
 #include <xlnt/utils/date.hpp>
 #include <xlnt/utils/datetime.hpp>
 #include <xlnt/utils/exceptions.hpp>
+#include <xlnt/workbook/memory_usage.hpp>
 #include <xlnt/workbook/named_range.hpp>
 #include <xlnt/workbook/workbook.hpp>
 #include <xlnt/workbook/worksheet_iterator.hpp>
@@ -43,17 +45,382 @@
 #include <xlnt/worksheet/range_reference.hpp>
 #include <xlnt/worksheet/worksheet.hpp>
 #include <detail/constants.hpp>
+#include <detail/formula/shared_formula.hpp>
 #include <detail/implementations/cell_impl.hpp>
+#include <detail/implementations/heap_usage.hpp>
 #include <detail/implementations/workbook_impl.hpp>
 #include <detail/implementations/worksheet_impl.hpp>
+#include <detail/serialization/csv_writer.hpp>
 
 namespace {
 
+using xlnt::detail::last_sheet_column;
+using xlnt::detail::last_sheet_row;
+
 int points_to_pixels(double points, double dpi)
 {
     return static_cast<int>(std::ceil(points * dpi / 72));
 }
 
+bool shift_reference(xlnt::cell_reference &reference, bool rows, std::uint32_t position, std::uint32_t count, bool insert)
+{
+    auto index = std::uint64_t(rows ? reference.row() : reference.column_index());
+    auto last = index;
+
+    if (!xlnt::detail::shift_span(index, last, position, count, insert))
+    {
+        return false;
+    }
+
+    if (rows)
+    {
+        reference.row(static_cast<xlnt::row_t>(index));
+    }
+    else
+    {
+        reference.column_index(static_cast<xlnt::column_t::index_t>(index));
+    }
+
+    return true;
+}
+
+bool shift_range(xlnt::range_reference &reference, bool rows, std::uint32_t position, std::uint32_t count, bool insert)
+{
+    auto top_left = reference.top_left();
+    auto bottom_right = reference.bottom_right();
+
+    auto first = std::uint64_t(rows ? top_left.row() : top_left.column_index());
+    auto last = std::uint64_t(rows ? bottom_right.row() : bottom_right.column_index());
+    const auto reversed = first > last;
+
+    if (reversed)
+    {
+        std::swap(first, last);
+    }
+
+    if (!xlnt::detail::shift_span(first, last, position, count, insert))
+    {
+        return false;
+    }
+
+    if (reversed)
+    {
+        std::swap(first, last);
+    }
+
+    if (rows)
+    {
+        top_left.row(static_cast<xlnt::row_t>(first));
+        bottom_right.row(static_cast<xlnt::row_t>(last));
+    }
+    else
+    {
+        top_left.column_index(static_cast<xlnt::column_t::index_t>(first));
+        bottom_right.column_index(static_cast<xlnt::column_t::index_t>(last));
+    }
+
+    reference = xlnt::range_reference(top_left, bottom_right);
+
+    return true;
+}
+
+std::uint32_t line_index(xlnt::row_t row)
+{
+    return row;
+}
+
+std::uint32_t line_index(const xlnt::column_t &column)
+{
+    return column.index;
+}
+
+template <typename Index>
+void shift_indices(std::vector<Index> &indices, std::uint32_t position, std::uint32_t count, bool insert)
+{
+    std::vector<Index> shifted;
+    shifted.reserve(indices.size());
+
+    for (const auto &index : indices)
+    {
+        auto first = std::uint64_t(line_index(index));
+        auto last = first;
+
+        if (xlnt::detail::shift_span(first, last, position, count, insert))
+        {
+            shifted.push_back(Index(static_cast<std::uint32_t>(first)));
+        }
+    }
+
+    indices.swap(shifted);
+}
+
+// Moves the entries of map keyed at or after position. Entries before it are left
+// in place, so only the moved ones are rehashed.
+template <typename Key, typename Value>
+void shift_keys(std::unordered_map<Key, Value> &map, std::uint32_t position, std::uint32_t count, bool insert)
+{
+    std::vector<std::pair<Key, Value>> moved;
+
+    for (auto it = map.begin(); it != map.end();)
+    {
+        auto first = std::uint64_t(line_index(it->first));
+        auto last = first;
+
+        if (first < position)
+        {
+            ++it;
+            continue;
+        }
+
+        if (xlnt::detail::shift_span(first, last, position, count, insert))
+        {
+            moved.emplace_back(Key(static_cast<std::uint32_t>(first)), std::move(it->second));
+        }
+
+        it = map.erase(it);
+    }
+
+    for (auto &entry : moved)
+    {
+        map.emplace(std::move(entry.first), std::move(entry.second));
+    }
+}
+
+// Moves the references into ws in the formulas of every worksheet of wb, its workbook, to
+// account for lines inserted or deleted. Shared formula groups move their anchor along
+// with its cell, or to a remaining cell of the group if it was deleted, and the formula
+// of the anchor along with it. Only cells whose formula no longer follows from their
+// group, such as cells moved away from an anchor that stays put when the formula refers
+// to another sheet, get a formula of their own. Rows are only copied for them and for
+// plain formulas that change.
+void shift_formulas(xlnt::detail::workbook_impl &wb, xlnt::detail::worksheet_impl &ws, bool rows, std::uint32_t position, std::uint32_t count, bool insert)
+{
+    using xlnt::detail::translate_formula;
+
+    for (auto &sheet : wb.worksheets_)
+    {
+        const auto local = &sheet == &ws;
+
+        auto shift = [&](const std::string &formula) {
+            return xlnt::detail::shift_formula(formula, ws.title_, local, rows, position, count, insert);
+        };
+
+        // Moves reference to where its cell ends up, returning false if it's deleted
+        auto destination = [&](xlnt::cell_reference &reference) {
+            return !local || shift_reference(reference, rows, position, count, insert);
+        };
+
+        auto offset = [](const xlnt::cell_reference &from, const xlnt::cell_reference &to) {
+            return std::make_pair(static_cast<std::int64_t>(to.row()) - from.row(),
+                static_cast<std::int64_t>(to.column_index()) - from.column_index());
+        };
+
+        std::vector<std::pair<xlnt::cell_reference, std::string>> shifted;
+        std::vector<std::pair<xlnt::cell_reference, std::uint32_t>> members;
+
+        sheet.cell_map_.for_each_row([&](xlnt::row_t row, const xlnt::detail::cell_store::row_type &cells) {
+            for (const auto &cell : cells)
+            {
+                if (cell.second.shared_formula_ != 0)
+                {
+                    members.emplace_back(xlnt::cell_reference(cell.first, row), cell.second.shared_formula_);
+                    continue;
+                }
+
+                if (!cell.second.formula_.is_set()) continue;
+
+                auto result = shift(cell.second.formula_.get());
+
+                if (result != cell.second.formula_.get())
+                {
+                    shifted.emplace_back(xlnt::cell_reference(cell.first, row), std::move(result));
+                }
+            }
+        });
+
+        const auto &groups = sheet.shared_formulas_;
+        auto anchored = groups;
+        std::vector<bool> placed(groups.size(), false);
+
+        for (std::size_t i = 0; i < groups.size(); ++i)
+        {
+            placed[i] = destination(anchored[i].anchor);
+            anchored[i].formula = shift(groups[i].formula);
+        }
+
+        for (const auto &member : members)
+        {
+            const auto index = member.second - 1;
+            auto moved = member.first;
+
+            if (placed[index] || !destination(moved)) continue;
+
+            const auto from = offset(groups[index].anchor, member.first);
+            anchored[index].anchor = moved;
+            anchored[index].formula = shift(translate_formula(groups[index].formula, from.first, from.second));
+            placed[index] = true;
+        }
+
+        for (const auto &member : members)
+        {
+            const auto index = member.second - 1;
+            auto moved = member.first;
+
+            // cells deleted along with their line are left alone
+            if (!destination(moved)) continue;
+
+            const auto from = offset(groups[index].anchor, member.first);
+            const auto to = offset(anchored[index].anchor, moved);
+            auto expected = shift(translate_formula(groups[index].formula, from.first, from.second));
+
+            if (expected != translate_formula(anchored[index].formula, to.first, to.second))
+            {
+                shifted.emplace_back(member.first, std::move(expected));
+            }
+        }
+
+        for (std::size_t i = 0; i < groups.size(); ++i)
+        {
+            // groups whose cells were all deleted keep their index but are never used again
+            if (!placed[i]) anchored[i] = groups[i];
+        }
+
+        if (shifted.empty() && anchored == groups) continue;
+
+        sheet.changed();
+        sheet.shared_formulas_ = std::move(anchored);
+
+        for (auto &entry : shifted)
+        {
+            auto &cell = sheet.cell_map_.existing_row(entry.first.row()).at(entry.first.column());
+            cell.formula_ = std::move(entry.second);
+            cell.shared_formula_ = 0;
+        }
+    }
+}
+
+// Moves the targets in the worksheet self of the named ranges of every worksheet of wb. Targets that were deleted entirely are removed along with names
+// left without any.
+void shift_named_ranges(xlnt::detail::workbook_impl &wb, const xlnt::worksheet &self,
+    bool rows, std::uint32_t position, std::uint32_t count, bool insert)
+{
+    for (auto &sheet : wb.worksheets_)
+    {
+        for (auto it = sheet.named_ranges_.begin(); it != sheet.named_ranges_.end();)
+        {
+            const auto &targets = it->second.targets();
+
+            if (std::none_of(targets.begin(), targets.end(),
+                    [&self](const xlnt::named_range::target &target) { return target.first == self; }))
+            {
+                ++it;
+                continue;
+            }
+
+            std::vector<xlnt::named_range::target> shifted;
+
+            for (auto target : targets)
+            {
+                if (target.first == self && !shift_range(target.second, rows, position, count, insert))
+                {
+                    continue;
+                }
+
+                shifted.push_back(target);
+            }
+
+            sheet.changed();
+
+            if (shifted.empty())
+            {
+                it = sheet.named_ranges_.erase(it);
+                continue;
+            }
+
+            it->second = xlnt::named_range(it->first, shifted);
+            ++it;
+        }
+    }
+}
+
+// Inserts or deletes count rows (or columns) at position in ws, which self refers to,
+// in the workbook wb and moves everything stored by position in the worksheet along with the cells and
+// every reference to them in the workbook.
+void shift_lines(xlnt::detail::workbook_impl &wb, xlnt::detail::worksheet_impl &ws, const xlnt::worksheet &self,
+    bool rows, std::uint32_t position, std::uint32_t count, bool insert)
+{
+    ws.changed();
+    shift_formulas(wb, ws, rows, position, count, insert);
+    shift_named_ranges(wb, self, rows, position, count, insert);
+
+    if (rows)
+    {
+        insert ? ws.cell_map_.insert_rows(position, count) : ws.cell_map_.delete_rows(position, count);
+        shift_keys(ws.row_properties_, position, count, insert);
+    }
+    else
+    {
+        insert ? ws.cell_map_.insert_columns(position, count) : ws.cell_map_.delete_columns(position, count);
+        shift_keys(ws.column_properties_, position, count, insert);
+    }
+
+    auto merged = ws.merged_cells_.ranges();
+    ws.merged_cells_.clear();
+
+    for (auto &reference : merged)
+    {
+        if (shift_range(reference, rows, position, count, insert) && !reference.is_single_cell())
+        {
+            ws.merged_cells_.insert(reference);
+        }
+    }
+
+    if (ws.auto_filter_.is_set() && !shift_range(ws.auto_filter_.get(), rows, position, count, insert))
+    {
+        ws.auto_filter_.clear();
+    }
+
+    if (ws.print_area_.is_set() && !shift_range(ws.print_area_.get(), rows, position, count, insert))
+    {
+        ws.print_area_.clear();
+    }
+
+    if (rows)
+    {
+        shift_indices(ws.row_breaks_, position, count, insert);
+    }
+    else
+    {
+        shift_indices(ws.column_breaks_, position, count, insert);
+    }
+
+    // Comments are keyed by the reference of their cell, which moved with its flag
+    std::vector<std::pair<std::string, xlnt::comment>> comments;
+
+    for (auto it = ws.comments_.begin(); it != ws.comments_.end();)
+    {
+        auto reference = xlnt::cell_reference(it->first);
+
+        if ((rows ? reference.row() : reference.column_index()) < position)
+        {
+            ++it;
+            continue;
+        }
+
+        if (shift_reference(reference, rows, position, count, insert))
+        {
+            comments.emplace_back(reference.to_string(), std::move(it->second));
+        }
+
+        it = ws.comments_.erase(it);
+    }
+
+    for (auto &entry : comments)
+    {
+        ws.comments_.emplace(std::move(entry.first), std::move(entry.second));
+    }
+}
+
 } // namespace
 
 namespace xlnt {
@@ -93,7 +460,7 @@ void worksheet::create_named_range(const std::string &name, const range_referenc
 
         // name is a valid reference, make sure it's outside the allowed range
 
-        if (column_t(temp.first).index <= column_t("XFD").index && temp.second <= 1048576)
+        if (column_t(temp.first).index <= last_sheet_column && temp.second <= last_sheet_row)
         {
             throw invalid_parameter(); //("named range name must be outside the range A1-XFD1048576");
         }
@@ -116,7 +483,7 @@ cell worksheet::operator[](const cell_reference &ref)
 
 std::vector<range_reference> worksheet::merged_ranges() const
 {
-    return d_->merged_cells_;
+    return d_->merged_cells_.ranges();
 }
 
 bool worksheet::has_page_margins() const
@@ -136,6 +503,7 @@ page_margins worksheet::page_margins() const
 
 void worksheet::page_margins(const class page_margins &margins)
 {
+    d_->changed();
     d_->page_margins_ = margins;
 }
 
@@ -146,6 +514,7 @@ void worksheet::auto_filter(const std::string &reference_string)
 
 void worksheet::auto_filter(const range_reference &reference)
 {
+    d_->changed();
     d_->auto_filter_ = reference;
 }
 
@@ -166,11 +535,13 @@ bool worksheet::has_auto_filter() const
 
 void worksheet::clear_auto_filter()
 {
+    d_->changed();
     d_->auto_filter_.clear();
 }
 
 void worksheet::page_setup(const struct page_setup &setup)
 {
+    d_->changed();
     d_->page_setup_ = setup;
 }
 
@@ -196,32 +567,30 @@ const workbook &worksheet::workbook() const
 
 void worksheet::garbage_collect()
 {
-    auto cell_map_iter = d_->cell_map_.begin();
+    std::vector<row_t> rows;
+    rows.reserve(d_->cell_map_.size());
+    d_->cell_map_.for_each_row_index([&rows](row_t row) { rows.push_back(row); });
 
-    while (cell_map_iter != d_->cell_map_.end())
+    for (auto row : rows)
     {
-        auto cell_iter = cell_map_iter->second.begin();
+        auto &cells = d_->cell_map_.existing_row(row);
+        auto cell_iter = cells.begin();
 
-        while (cell_iter != cell_map_iter->second.end())
+        while (cell_iter != cells.end())
         {
-            class cell current_cell(&cell_iter->second);
-
-            if (current_cell.garbage_collectible())
+            if (d_->garbage_collectible(cell_iter->second))
             {
-                cell_iter = cell_map_iter->second.erase(cell_iter);
+                cell_iter = cells.erase(cell_iter);
                 continue;
             }
 
             cell_iter++;
         }
 
-        if (cell_map_iter->second.empty())
+        if (cells.empty())
         {
-            cell_map_iter = d_->cell_map_.erase(cell_map_iter);
-            continue;
+            d_->cell_map_.erase(row);
         }
-
-        cell_map_iter++;
     }
 }
 
@@ -290,6 +659,7 @@ void worksheet::freeze_panes(xlnt::cell top_left_cell)
 
 void worksheet::freeze_panes(const cell_reference &ref)
 {
+    d_->changed();
     if (ref == "A1")
     {
         unfreeze_panes();
@@ -335,6 +705,7 @@ void worksheet::freeze_panes(const cell_reference &ref)
 
 void worksheet::unfreeze_panes()
 {
+    d_->changed();
     if (!has_view()) return;
 
     auto &primary_view = d_->views_.front();
@@ -345,6 +716,7 @@ void worksheet::unfreeze_panes()
 
 void worksheet::active_cell(const cell_reference &ref)
 {
+    d_->changed();
     if (!has_view())
     {
         d_->views_.push_back(sheet_view());
@@ -391,25 +763,20 @@ cell_reference worksheet::active_cell() const
 
 cell worksheet::cell(const cell_reference &reference)
 {
-    auto &row = d_->cell_map_[reference.row()];
-    auto match = row.find(reference.column_index());
-
-    if (match == row.end())
-    {
-        match = row.emplace(reference.column_index(), detail::cell_impl()).first;
-        auto &impl = match->second;
+    auto &impl = d_->cell_map_.cell(reference.row(), reference.column_index());
+    d_->cell_map_.handed_out(impl, d_);
 
-        impl.parent_ = d_;
-        impl.column_ = reference.column_index();
-        impl.row_ = reference.row();
-    }
-
-    return xlnt::cell(&match->second);
+    return xlnt::cell(&impl);
 }
 
 const cell worksheet::cell(const cell_reference &reference) const
 {
-    return xlnt::cell(&d_->cell_map_.at(reference.row()).at(reference.column_index()));
+    // cells are always handed out from unshared rows so that writing through a copy of
+    // the returned handle can't change a copy of this worksheet
+    auto &impl = d_->cell_map_.existing_row(reference.row()).at(reference.column_index());
+    d_->cell_map_.handed_out(impl, d_);
+
+    return xlnt::cell(&impl);
 }
 
 cell worksheet::cell(xlnt::column_t column, row_t row)
@@ -424,13 +791,7 @@ const cell worksheet::cell(xlnt::column_t column, row_t row) const
 
 bool worksheet::has_cell(const cell_reference &reference) const
 {
-    const auto row = d_->cell_map_.find(reference.row());
-    if (row == d_->cell_map_.cend()) return false;
-
-    const auto col = row->second.find(reference.column_index());
-    if (col == row->second.cend()) return false;
-
-    return true;
+    return d_->cell_map_.find(reference.row(), reference.column_index()) != nullptr;
 }
 
 bool worksheet::has_row_properties(row_t row) const
@@ -476,14 +837,8 @@ column_t worksheet::lowest_column() const
     }
 
     auto lowest = constants::max_column();
-
-    for (auto &row : d_->cell_map_)
-    {
-        for (auto &c : row.second)
-        {
-            lowest = std::min(lowest, c.first);
-        }
-    }
+    auto highest = constants::min_column();
+    d_->cell_map_.column_bounds(lowest, highest);
 
     return lowest;
 }
@@ -513,11 +868,7 @@ row_t worksheet::lowest_row() const
     }
 
     auto lowest = constants::max_row();
-
-    for (auto &row : d_->cell_map_)
-    {
-        lowest = std::min(lowest, row.first);
-    }
+    d_->cell_map_.for_each_row_index([&lowest](row_t row) { lowest = std::min(lowest, row); });
 
     return lowest;
 }
@@ -542,11 +893,7 @@ row_t worksheet::lowest_row_or_props() const
 row_t worksheet::highest_row() const
 {
     auto highest = constants::min_row();
-
-    for (auto &row : d_->cell_map_)
-    {
-        highest = std::max(highest, row.first);
-    }
+    d_->cell_map_.for_each_row_index([&highest](row_t row) { highest = std::max(highest, row); });
 
     return highest;
 }
@@ -570,15 +917,9 @@ row_t worksheet::highest_row_or_props() const
 
 column_t worksheet::highest_column() const
 {
+    auto lowest = constants::max_column();
     auto highest = constants::min_column();
-
-    for (auto &row : d_->cell_map_)
-    {
-        for (auto &c : row.second)
-        {
-            highest = std::max(highest, c.first);
-        }
-    }
+    d_->cell_map_.column_bounds(lowest, highest);
 
     return highest;
 }
@@ -600,6 +941,45 @@ column_t worksheet::highest_column_or_props() const
     return highest;
 }
 
+worksheet_memory_usage worksheet::memory_usage() const
+{
+    using detail::heap_usage;
+
+    worksheet_memory_usage usage;
+    usage.title = d_->title_;
+
+    usage.cells = d_->cell_map_.cell_count();
+    d_->cell_map_.memory_usage(usage.cell_storage, usage.formulas);
+    usage.spilled = d_->cell_map_.spilled_bytes();
+
+    usage.formulas += heap_usage::of(d_->shared_formulas_);
+
+    for (const auto &group : d_->shared_formulas_)
+    {
+        usage.formulas += heap_usage::of(group.formula);
+    }
+
+    usage.comments = heap_usage::of_hash_table(d_->comments_);
+
+    for (const auto &entry : d_->comments_)
+    {
+        usage.comments += heap_usage::of(entry.first) + heap_usage::of(entry.second);
+    }
+
+    usage.other = sizeof(detail::worksheet_impl) + heap_usage::of(d_->title_)
+        + d_->merged_cells_.memory_usage()
+        + heap_usage::of_hash_table(d_->column_properties_)
+        + heap_usage::of_hash_table(d_->row_properties_)
+        + heap_usage::of_hash_table(d_->named_ranges_)
+        + heap_usage::of(d_->views_)
+        + heap_usage::of(d_->column_breaks_)
+        + heap_usage::of(d_->row_breaks_)
+        + heap_usage::of(d_->print_title_cols_)
+        + heap_usage::of(d_->print_title_rows_);
+
+    return usage;
+}
+
 range_reference worksheet::calculate_dimension() const
 {
     return range_reference(lowest_column(), lowest_row(),
@@ -648,50 +1028,58 @@ void worksheet::unmerge_cells(const std::string &reference_string)
 
 void worksheet::merge_cells(const range_reference &reference)
 {
-    d_->merged_cells_.push_back(reference);
-    bool first = true;
+    d_->changed();
+    d_->merged_cells_.insert(reference);
+
+    const auto top_left = reference.top_left();
+    const auto bottom_right = reference.bottom_right();
 
-    for (auto row : range(reference))
+    // Returns true if the cell at column in row is merged away and has a value to clear
+    auto cleared = [&](row_t row, column_t column, const detail::cell_impl &cell) {
+        return column >= top_left.column() && column <= bottom_right.column()
+            && !(row == top_left.row() && column == top_left.column())
+            && (cell.type_ != cell::type::empty || cell.formula_.is_set() || cell.shared_formula_ != 0);
+    };
+
+    // Only cells that already exist need their values cleared, so visit those rather than
+    // every position in the range, and only rows with a value to clear are written to.
+    // Whether a cell is merged comes from merged_cells_.
+    for (auto row = top_left.row(); row <= bottom_right.row(); ++row)
     {
-        for (auto cell : row)
+        const auto cells = d_->cell_map_.find_row(row);
+
+        if (cells == nullptr || std::none_of(cells->begin(), cells->end(),
+                [&](const detail::cell_store::row_type::value_type &entry) { return cleared(row, entry.first, entry.second); }))
+        {
+            continue;
+        }
+
+        for (auto &entry : d_->cell_map_.existing_row(row))
         {
-            cell.merged(true);
+            if (!cleared(row, entry.first, entry.second)) continue;
+
+            d_->cell_map_.handed_out(entry.second, d_);
+            auto cell = xlnt::cell(&entry.second);
 
-            if (!first)
+            if (cell.data_type() == cell::type::shared_string)
             {
-                if (cell.data_type() == cell::type::shared_string)
-                {
-                    cell.value("");
-                }
-                else
-                {
-                    cell.clear_value();
-                }
+                cell.value("");
+            }
+            else
+            {
+                cell.clear_value();
             }
-
-            first = false;
         }
     }
 }
 
 void worksheet::unmerge_cells(const range_reference &reference)
 {
-    auto match = std::find(d_->merged_cells_.begin(), d_->merged_cells_.end(), reference);
-
-    if (match == d_->merged_cells_.end())
+    d_->changed();
+    if (!d_->merged_cells_.erase(reference))
     {
         throw invalid_parameter();
     }
-
-    d_->merged_cells_.erase(match);
-
-    for (auto row : range(reference))
-    {
-        for (auto cell : row)
-        {
-            cell.merged(false);
-        }
-    }
 }
 
 row_t worksheet::next_row() const
@@ -744,17 +1132,96 @@ const cell_vector worksheet::cells(bool skip_null) const
 
 void worksheet::clear_cell(const cell_reference &ref)
 {
-    d_->cell_map_.at(ref.row()).erase(ref.column());
+    d_->changed();
+    d_->cell_map_.existing_row(ref.row()).erase(ref.column());
+    reset_formula_engine();
     // TODO: garbage collect newly unreferenced resources such as styles?
 }
 
 void worksheet::clear_row(row_t row)
 {
+    d_->changed();
     d_->cell_map_.erase(row);
     d_->row_properties_.erase(row);
+    reset_formula_engine();
     // TODO: garbage collect newly unreferenced resources such as styles?
 }
 
+void worksheet::insert_rows(row_t row, row_t amount)
+{
+    if (row < constants::min_row() || row > constants::max_row())
+    {
+        throw invalid_parameter();
+    }
+
+    if (amount == 0) return;
+
+    // The bound is only an upper limit on the highest row, so find that if it's too high
+    auto highest = d_->cell_map_.row_bound();
+
+    if (highest >= row && (highest > last_sheet_row || amount > last_sheet_row - highest))
+    {
+        highest = d_->cell_map_.empty() ? 0 : highest_row();
+
+        if (highest >= row && (highest > last_sheet_row || amount > last_sheet_row - highest))
+        {
+            throw invalid_parameter();
+        }
+    }
+
+    reset_formula_engine();
+    shift_lines(*workbook().d_, *d_, *this, true, row, amount, true);
+}
+
+void worksheet::delete_rows(row_t row, row_t amount)
+{
+    if (row < constants::min_row() || row > constants::max_row())
+    {
+        throw invalid_parameter();
+    }
+
+    if (amount == 0) return;
+
+    reset_formula_engine();
+    shift_lines(*workbook().d_, *d_, *this, true, row, std::min(amount, constants::max_row() - row + 1), false);
+}
+
+void worksheet::insert_columns(column_t column, column_t::index_t amount)
+{
+    if (column < constants::min_column() || column > constants::max_column())
+    {
+        throw invalid_parameter();
+    }
+
+    if (amount == 0) return;
+
+    if (!d_->cell_map_.empty())
+    {
+        const auto highest = highest_column().index;
+
+        if (highest >= column.index && (highest > last_sheet_column || amount > last_sheet_column - highest))
+        {
+            throw invalid_parameter();
+        }
+    }
+
+    reset_formula_engine();
+    shift_lines(*workbook().d_, *d_, *this, false, column.index, amount, true);
+}
+
+void worksheet::delete_columns(column_t column, column_t::index_t amount)
+{
+    if (column < constants::min_column() || column > constants::max_column())
+    {
+        throw invalid_parameter();
+    }
+
+    if (amount == 0) return;
+
+    reset_formula_engine();
+    shift_lines(*workbook().d_, *d_, *this, false, column.index, std::min(amount, constants::max_column().index - column.index + 1), false);
+}
+
 bool worksheet::operator==(const worksheet &other) const
 {
     return compare(other, true);
@@ -769,35 +1236,33 @@ bool worksheet::compare(const worksheet &other, bool reference) const
 
     if (d_->parent_ != other.d_->parent_) return false;
 
-    for (auto &row : d_->cell_map_)
-    {
-        if (other.d_->cell_map_.find(row.first) == other.d_->cell_map_.end())
+    auto cells_equal = true;
+
+    d_->cell_map_.for_each_row([&other, &cells_equal](row_t row, const detail::cell_store::row_type &cells) {
+        if (!cells_equal) return;
+
+        if (other.d_->cell_map_.find_row(row) == nullptr)
         {
-            return false;
+            cells_equal = false;
+            return;
         }
 
-        for (auto &cell : row.second)
+        for (auto &cell : cells)
         {
-            if (other.d_->cell_map_[row.first].find(cell.first) == other.d_->cell_map_[row.first].end())
-            {
-                return false;
-            }
-
-            xlnt::cell this_cell(&cell.second);
-            xlnt::cell other_cell(&other.d_->cell_map_[row.first][cell.first]);
-
-            if (this_cell.data_type() != other_cell.data_type())
-            {
-                return false;
-            }
+            const auto other_cell = other.d_->cell_map_.find(row, cell.first);
 
-            if (this_cell.data_type() == xlnt::cell::type::number
-                && std::fabs(this_cell.value<double>() - other_cell.value<double>()) > 0.0)
+            if (other_cell == nullptr
+                || cell.second.type_ != other_cell->type_
+                || (cell.second.type_ == xlnt::cell::type::number
+                       && std::fabs(cell.second.value_numeric_ - other_cell->value_numeric_) > 0.0))
             {
-                return false;
+                cells_equal = false;
+                return;
             }
         }
-    }
+    });
+
+    if (!cells_equal) return false;
 
     // todo: missing some comparisons
 
@@ -893,6 +1358,7 @@ sheet_state worksheet::sheet_state() const
 
 void worksheet::add_column_properties(column_t column, const xlnt::column_properties &props)
 {
+    d_->changed();
     d_->column_properties_[column] = props;
 }
 
@@ -903,6 +1369,7 @@ bool worksheet::has_column_properties(column_t column) const
 
 column_properties &worksheet::column_properties(column_t column)
 {
+    d_->changed();
     return d_->column_properties_[column];
 }
 
@@ -913,6 +1380,7 @@ const column_properties &worksheet::column_properties(column_t column) const
 
 row_properties &worksheet::row_properties(row_t row)
 {
+    d_->changed();
     return d_->row_properties_[row];
 }
 
@@ -923,6 +1391,7 @@ const row_properties &worksheet::row_properties(row_t row) const
 
 void worksheet::add_row_properties(row_t row, const xlnt::row_properties &props)
 {
+    d_->changed();
     d_->row_properties_[row] = props;
 }
 
@@ -1009,11 +1478,13 @@ bool worksheet::has_view() const
 
 sheet_view &worksheet::view(std::size_t index) const
 {
+    d_->changed();
     return d_->views_.at(index);
 }
 
 void worksheet::add_view(const sheet_view &new_view)
 {
+    d_->changed();
     d_->views_.push_back(new_view);
 }
 
@@ -1039,6 +1510,7 @@ const phonetic_pr& worksheet::phonetic_properties() const
 
 void worksheet::phonetic_properties(const phonetic_pr& phonetic_props)
 {
+    d_->changed();
     d_->phonetic_properties_.set(phonetic_props);
 }
 
@@ -1049,17 +1521,20 @@ bool worksheet::has_header_footer() const
 
 void worksheet::header_footer(const class header_footer &hf)
 {
+    d_->changed();
     d_->header_footer_ = hf;
 }
 
 void worksheet::clear_page_breaks()
 {
+    d_->changed();
     d_->row_breaks_.clear();
     d_->column_breaks_.clear();
 }
 
 void worksheet::page_break_at_row(row_t row)
 {
+    d_->changed();
     d_->row_breaks_.push_back(row);
 }
 
@@ -1070,6 +1545,7 @@ const std::vector<row_t> &worksheet::page_break_rows() const
 
 void worksheet::page_break_at_column(xlnt::column_t column)
 {
+    d_->changed();
     d_->column_breaks_.push_back(column);
 }
 
@@ -1111,6 +1587,16 @@ void worksheet::garbage_collect_formulae()
     workbook().garbage_collect_formulae();
 }
 
+void worksheet::reset_formula_engine()
+{
+    auto &engine = workbook().d_->formula_engine_;
+
+    if (engine)
+    {
+        engine->reset();
+    }
+}
+
 void worksheet::parent(xlnt::workbook &wb)
 {
     d_->parent_ = &wb;
@@ -1144,7 +1630,32 @@ sheet_format_properties worksheet::format_properties() const
 
 void worksheet::format_properties(const sheet_format_properties &properties)
 {
+    d_->changed();
     d_->format_properties_ = properties;
 }
 
+void worksheet::save_csv(std::ostream &stream, const csv_options &options) const
+{
+    if (d_->cell_map_.empty()) return;
+
+    save_csv(calculate_dimension(), stream, options);
+}
+
+void worksheet::save_csv(const range_reference &reference, std::ostream &stream, const csv_options &options) const
+{
+    const auto &workbook_stylesheet = d_->parent_->d_->stylesheet_;
+    const auto styles = workbook_stylesheet.is_set() ? &workbook_stylesheet.get() : nullptr;
+
+    // Reading rows under a memory budget pages blocks in and out, which only one
+    // thread may do at a time
+    auto adjusted = options;
+
+    if (d_->parent_->d_->spill_)
+    {
+        adjusted.threads = 1;
+    }
+
+    detail::csv_writer(*d_, styles, adjusted).write(reference, stream);
+}
+
 } // namespace xlnt
@@ -375,6 +375,18 @@ private:
         cell.value(std::string(1, 10)); // Newline
         cell.value(std::string(1, 13)); // Carriage return
         cell.value(" Leading and trailing spaces are legal ");
+
+        // illegal characters are found at every position within longer strings
+        for (std::size_t position = 0; position < 20; ++position)
+        {
+            std::string str(20, 'a');
+            str[position] = 0x1F;
+            xlnt_assert_throws(cell.value(str), xlnt::illegal_character);
+            xlnt_assert_throws(cell.value(std::string(str)), xlnt::illegal_character);
+        }
+
+        cell.value(std::string("tab\tseparated\r\nlines \xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9"));
+        xlnt_assert_equals(cell.value<std::string>(), "tab\tseparated\r\nlines \xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9");
     }
 
     // void test_time_regex() {}
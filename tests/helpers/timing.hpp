@@ -26,9 +26,12 @@
 namespace xlnt {
 namespace benchmarks {
 
+/// <summary>
+/// Returns a monotonic time in milliseconds, only meaningful relative to another call.
+/// </summary>
 inline std::size_t current_time()
 {
-    auto now = std::chrono::system_clock::now();
+    auto now = std::chrono::steady_clock::now();
     auto time_since_epoch = now.time_since_epoch();
     auto duration = std::chrono::duration<double, std::milli>(time_since_epoch);
 
@@ -0,0 +1,486 @@
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <detail/serialization/zstream.hpp>
+#include <helpers/workbook_generator.hpp>
+#include <xlnt/cell/cell_reference.hpp>
+#include <xlnt/utils/exceptions.hpp>
+
+namespace {
+
+const std::string xml_declaration = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n";
+const std::string xmlns_main = "http://schemas.openxmlformats.org/spreadsheetml/2006/main";
+const std::string xmlns_r = "http://schemas.openxmlformats.org/officeDocument/2006/relationships";
+const std::string xmlns_package_rels = "http://schemas.openxmlformats.org/package/2006/relationships";
+
+// splitmix64 is used instead of <random> distributions, whose output is
+// implementation defined, so that generated files are identical everywhere.
+class generator_random
+{
+public:
+    explicit generator_random(std::uint64_t seed)
+        : state_(seed)
+    {
+    }
+
+    std::uint64_t next()
+    {
+        auto z = (state_ += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // Returns a number in [0, 1).
+    double unit()
+    {
+        return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    std::size_t below(std::size_t bound)
+    {
+        return bound == 0 ? 0 : static_cast<std::size_t>(next() % bound);
+    }
+
+private:
+    std::uint64_t state_;
+};
+
+// Owns the streambuf of one part of the package. ozstream keeps a pointer
+// into its list of headers for the open part, so only one may be open at a time.
+class part_writer
+{
+public:
+    part_writer(xlnt::detail::ozstream &archive, const std::string &name)
+        : buffer_(archive.open(xlnt::path(name))),
+          stream_(buffer_.get())
+    {
+    }
+
+    std::ostream &stream()
+    {
+        return stream_;
+    }
+
+private:
+    std::unique_ptr<std::streambuf> buffer_;
+    std::ostream stream_;
+};
+
+void write_part(xlnt::detail::ozstream &archive, const std::string &name, const std::string &content)
+{
+    part_writer part(archive, name);
+    part.stream() << content;
+}
+
+std::string sheet_part(std::size_t index)
+{
+    return "worksheets/sheet" + std::to_string(index + 1) + ".xml";
+}
+
+std::string comments_part(std::size_t index)
+{
+    return "comments" + std::to_string(index + 1) + ".xml";
+}
+
+std::string vml_part(std::size_t index)
+{
+    return "drawings/vmlDrawing" + std::to_string(index + 1) + ".vml";
+}
+
+std::string shared_string(std::size_t index)
+{
+    return "string value " + std::to_string(index);
+}
+
+// Numbers are written as integers with two decimal places so the text
+// doesn't depend on the locale or the floating point formatting of the platform.
+void append_number(std::string &out, std::uint64_t hundredths)
+{
+    out.append(std::to_string(hundredths / 100));
+    out.push_back('.');
+    out.push_back(static_cast<char>('0' + (hundredths / 10) % 10));
+    out.push_back(static_cast<char>('0' + hundredths % 10));
+}
+
+std::uint64_t sheet_seed(const workbook_shape &shape, std::size_t sheet)
+{
+    return shape.seed ^ (0x2545f4914f6cdd1dULL * (sheet + 1));
+}
+
+// Merged regions are 2x2 blocks laid out on a 3x3 grid from the top left so they never overlap.
+std::size_t merged_region_count(const workbook_shape &shape)
+{
+    const auto per_row = shape.columns / 3;
+    const auto region_rows = shape.rows / 3;
+
+    return std::min(shape.merged_regions, per_row * region_rows);
+}
+
+std::string merged_region(const workbook_shape &shape, std::size_t index)
+{
+    const auto per_row = shape.columns / 3;
+    const auto row = static_cast<xlnt::row_t>(1 + 3 * (index / per_row));
+    const auto column = static_cast<xlnt::column_t::index_t>(1 + 3 * (index % per_row));
+
+    return xlnt::cell_reference(column, row).to_string() + ":"
+        + xlnt::cell_reference(column + 1, row + 1).to_string();
+}
+
+// Only the top left cell of a merged region has a value, as when Excel merges cells.
+bool covered_by_merge(const workbook_shape &shape, std::size_t merged, std::size_t row, std::size_t column)
+{
+    const auto per_row = shape.columns / 3;
+    const auto region_row = (row - 1) / 3;
+    const auto region_column = (column - 1) / 3;
+
+    if ((row - 1) % 3 == 2 || (column - 1) % 3 == 2 || region_column >= per_row) return false;
+    if ((row - 1) % 3 == 0 && (column - 1) % 3 == 0) return false;
+
+    return region_row * per_row + region_column < merged;
+}
+
+// Comments are spread evenly down the rows and across the columns.
+std::size_t comment_count(const workbook_shape &shape)
+{
+    return std::min(shape.comments, shape.rows * shape.columns);
+}
+
+xlnt::cell_reference comment_cell(const workbook_shape &shape, std::size_t index)
+{
+    const auto count = comment_count(shape);
+    const auto row = static_cast<xlnt::row_t>(1 + index * shape.rows / count);
+    const auto column = static_cast<xlnt::column_t::index_t>(1 + index % shape.columns);
+
+    return xlnt::cell_reference(column, row);
+}
+
+void write_content_types(xlnt::detail::ozstream &archive, const workbook_shape &shape)
+{
+    std::string xml = xml_declaration;
+    xml.append("<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">");
+    xml.append("<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>");
+    xml.append("<Default Extension=\"xml\" ContentType=\"application/xml\"/>");
+    xml.append("<Default Extension=\"vml\" ContentType=\"application/vnd.openxmlformats-officedocument.vmlDrawing\"/>");
+    xml.append("<Override PartName=\"/xl/workbook.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml\"/>");
+    xml.append("<Override PartName=\"/xl/styles.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.styles+xml\"/>");
+    xml.append("<Override PartName=\"/xl/sharedStrings.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sharedStrings+xml\"/>");
+
+    for (std::size_t sheet = 0; sheet < shape.sheets; ++sheet)
+    {
+        xml.append("<Override PartName=\"/xl/" + sheet_part(sheet)
+            + "\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml\"/>");
+
+        if (comment_count(shape) > 0)
+        {
+            xml.append("<Override PartName=\"/xl/" + comments_part(sheet)
+                + "\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.comments+xml\"/>");
+        }
+    }
+
+    xml.append("</Types>");
+    write_part(archive, "[Content_Types].xml", xml);
+}
+
+void write_package_relationships(xlnt::detail::ozstream &archive)
+{
+    write_part(archive, "_rels/.rels",
+        xml_declaration + "<Relationships xmlns=\"" + xmlns_package_rels + "\">"
+            + "<Relationship Id=\"rId1\" Type=\"" + xmlns_r + "/officeDocument\" Target=\"xl/workbook.xml\"/>"
+            + "</Relationships>");
+}
+
+void write_workbook(xlnt::detail::ozstream &archive, const workbook_shape &shape)
+{
+    std::string xml = xml_declaration;
+    xml.append("<workbook xmlns=\"" + xmlns_main + "\" xmlns:r=\"" + xmlns_r + "\"><sheets>");
+
+    for (std::size_t sheet = 0; sheet < shape.sheets; ++sheet)
+    {
+        const auto number = std::to_string(sheet + 1);
+        xml.append("<sheet name=\"Sheet" + number + "\" sheetId=\"" + number + "\" r:id=\"rId" + number + "\"/>");
+    }
+
+    xml.append("</sheets></workbook>");
+    write_part(archive, "xl/workbook.xml", xml);
+
+    std::string rels = xml_declaration;
+    rels.append("<Relationships xmlns=\"" + xmlns_package_rels + "\">");
+
+    for (std::size_t sheet = 0; sheet < shape.sheets; ++sheet)
+    {
+        rels.append("<Relationship Id=\"rId" + std::to_string(sheet + 1) + "\" Type=\"" + xmlns_r
+            + "/worksheet\" Target=\"" + sheet_part(sheet) + "\"/>");
+    }
+
+    const auto next_id = shape.sheets + 1;
+    rels.append("<Relationship Id=\"rId" + std::to_string(next_id) + "\" Type=\"" + xmlns_r
+        + "/styles\" Target=\"styles.xml\"/>");
+    rels.append("<Relationship Id=\"rId" + std::to_string(next_id + 1) + "\" Type=\"" + xmlns_r
+        + "/sharedStrings\" Target=\"sharedStrings.xml\"/>");
+    rels.append("</Relationships>");
+    write_part(archive, "xl/_rels/workbook.xml.rels", rels);
+}
+
+// Every format after the first gets its own font so that no two formats are equal.
+void write_styles(xlnt::detail::ozstream &archive, const workbook_shape &shape)
+{
+    const auto count = std::max(shape.styles, std::size_t(1));
+    part_writer part(archive, "xl/styles.xml");
+    auto &out = part.stream();
+
+    out << xml_declaration << "<styleSheet xmlns=\"" << xmlns_main << "\">";
+    out << "<fonts count=\"" << count << "\">";
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const auto color = static_cast<unsigned long>((i * 2654435761UL) & 0xffffff);
+        const auto hex = "0123456789ABCDEF";
+
+        out << "<font>";
+        if (i % 2 == 1) out << "<b/>";
+        if (i % 3 == 1) out << "<i/>";
+        out << "<sz val=\"" << (i == 0 ? 11 : 8 + i % 20) << "\"/>";
+
+        if (i != 0)
+        {
+            out << "<color rgb=\"FF";
+            for (int shift = 20; shift >= 0; shift -= 4) out << hex[(color >> shift) & 0xf];
+            out << "\"/>";
+        }
+
+        out << "<name val=\"Calibri\"/><family val=\"2\"/></font>";
+    }
+
+    out << "</fonts>";
+    out << "<fills count=\"2\"><fill><patternFill patternType=\"none\"/></fill>"
+        << "<fill><patternFill patternType=\"gray125\"/></fill></fills>";
+    out << "<borders count=\"1\"><border><left/><right/><top/><bottom/><diagonal/></border></borders>";
+    out << "<cellStyleXfs count=\"1\"><xf numFmtId=\"0\" fontId=\"0\" fillId=\"0\" borderId=\"0\"/></cellStyleXfs>";
+    out << "<cellXfs count=\"" << count << "\">";
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        out << "<xf numFmtId=\"0\" fontId=\"" << i << "\" fillId=\"0\" borderId=\"0\" xfId=\"0\""
+            << (i == 0 ? "" : " applyFont=\"1\"") << "/>";
+    }
+
+    out << "</cellXfs>";
+    out << "<cellStyles count=\"1\"><cellStyle name=\"Normal\" xfId=\"0\" builtinId=\"0\"/></cellStyles>";
+    out << "</styleSheet>";
+}
+
+void write_shared_strings(xlnt::detail::ozstream &archive, const workbook_shape &shape)
+{
+    part_writer part(archive, "xl/sharedStrings.xml");
+    auto &out = part.stream();
+
+    out << xml_declaration << "<sst xmlns=\"" << xmlns_main << "\" uniqueCount=\"" << shape.distinct_strings << "\">";
+
+    for (std::size_t i = 0; i < shape.distinct_strings; ++i)
+    {
+        out << "<si><t>" << shared_string(i) << "</t></si>";
+    }
+
+    out << "</sst>";
+}
+
+void write_sheet(xlnt::detail::ozstream &archive, const workbook_shape &shape, std::size_t sheet, generated_totals &totals)
+{
+    generator_random random(sheet_seed(shape, sheet));
+    const auto strings = shape.distinct_strings > 0 ? shape.string_ratio : 0.0;
+    const auto styles = std::max(shape.styles, std::size_t(1));
+    const auto merged = merged_region_count(shape);
+
+    part_writer part(archive, "xl/" + sheet_part(sheet));
+    auto &out = part.stream();
+
+    out << xml_declaration << "<worksheet xmlns=\"" << xmlns_main << "\" xmlns:r=\"" << xmlns_r << "\">";
+
+    if (shape.rows > 0 && shape.columns > 0)
+    {
+        const auto last = xlnt::cell_reference(static_cast<xlnt::column_t::index_t>(shape.columns),
+            static_cast<xlnt::row_t>(shape.rows));
+        out << "<dimension ref=\"A1:" << last.to_string() << "\"/>";
+    }
+
+    out << "<sheetData>";
+
+    std::string row_xml;
+    std::vector<std::string> column_names;
+
+    for (std::size_t column = 1; column <= shape.columns; ++column)
+    {
+        column_names.push_back(xlnt::column_t::column_string_from_index(static_cast<xlnt::column_t::index_t>(column)));
+    }
+
+    for (std::size_t row = 1; row <= shape.rows; ++row)
+    {
+        const auto row_string = std::to_string(row);
+        row_xml.clear();
+
+        for (std::size_t column = 1; column <= shape.columns; ++column)
+        {
+            if (covered_by_merge(shape, merged, row, column)) continue;
+            if (random.unit() >= shape.density) continue;
+
+            const auto kind = random.unit();
+            const auto style = random.below(styles);
+            const auto reference = column_names[column - 1] + row_string;
+
+            row_xml.append("<c r=\"");
+            row_xml.append(reference);
+            row_xml.push_back('"');
+
+            if (style != 0)
+            {
+                row_xml.append(" s=\"");
+                row_xml.append(std::to_string(style));
+                row_xml.push_back('"');
+            }
+
+            if (kind < shape.formula_ratio)
+            {
+                // Refer to the cell on the left so that formulas form dependency chains
+                row_xml.append("><f>");
+                row_xml.append(column == 1 ? row_string + "*2" : column_names[column - 2] + row_string + "*2");
+                row_xml.append("</f></c>");
+                ++totals.formula_cells;
+            }
+            else if (random.unit() < strings)
+            {
+                row_xml.append(" t=\"s\"><v>");
+                row_xml.append(std::to_string(random.below(shape.distinct_strings)));
+                row_xml.append("</v></c>");
+                ++totals.string_cells;
+            }
+            else
+            {
+                row_xml.append("><v>");
+                append_number(row_xml, random.next() % 100000000);
+                row_xml.append("</v></c>");
+                ++totals.number_cells;
+            }
+
+            ++totals.cells;
+        }
+
+        if (!row_xml.empty())
+        {
+            out << "<row r=\"" << row_string << "\">" << row_xml << "</row>";
+        }
+    }
+
+    out << "</sheetData>";
+
+    if (merged > 0)
+    {
+        out << "<mergeCells count=\"" << merged << "\">";
+
+        for (std::size_t i = 0; i < merged; ++i)
+        {
+            out << "<mergeCell ref=\"" << merged_region(shape, i) << "\"/>";
+        }
+
+        out << "</mergeCells>";
+        totals.merged_regions += merged;
+    }
+
+    if (comment_count(shape) > 0)
+    {
+        out << "<legacyDrawing r:id=\"rId2\"/>";
+    }
+
+    out << "</worksheet>";
+}
+
+void write_comments(xlnt::detail::ozstream &archive, const workbook_shape &shape, std::size_t sheet, generated_totals &totals)
+{
+    const auto count = comment_count(shape);
+
+    write_part(archive, "xl/worksheets/_rels/sheet" + std::to_string(sheet + 1) + ".xml.rels",
+        xml_declaration + "<Relationships xmlns=\"" + xmlns_package_rels + "\">"
+            + "<Relationship Id=\"rId1\" Type=\"" + xmlns_r + "/comments\" Target=\"../" + comments_part(sheet) + "\"/>"
+            + "<Relationship Id=\"rId2\" Type=\"" + xmlns_r + "/vmlDrawing\" Target=\"../" + vml_part(sheet) + "\"/>"
+            + "</Relationships>");
+
+    {
+        part_writer part(archive, "xl/" + comments_part(sheet));
+        auto &out = part.stream();
+
+        out << xml_declaration << "<comments xmlns=\"" << xmlns_main << "\">";
+        out << "<authors><author>generator</author></authors><commentList>";
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            out << "<comment ref=\"" << comment_cell(shape, i).to_string() << "\" authorId=\"0\">"
+                << "<text><t>comment " << i << "</t></text></comment>";
+        }
+
+        out << "</commentList></comments>";
+    }
+
+    // Excel won't show comments without a shape to draw them in
+    part_writer part(archive, "xl/" + vml_part(sheet));
+    auto &out = part.stream();
+
+    out << "<xml xmlns:v=\"urn:schemas-microsoft-com:vml\" xmlns:o=\"urn:schemas-microsoft-com:office:office\""
+        << " xmlns:x=\"urn:schemas-microsoft-com:office:excel\">"
+        << "<o:shapelayout v:ext=\"edit\"><o:idmap v:ext=\"edit\" data=\"" << sheet + 1 << "\"/></o:shapelayout>"
+        << "<v:shapetype id=\"_x0000_t202\" coordsize=\"21600,21600\" o:spt=\"202\" path=\"m,l,21600r21600,l21600,xe\">"
+        << "<v:stroke joinstyle=\"miter\"/><v:path gradientshapeok=\"t\" o:connecttype=\"rect\"/></v:shapetype>";
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const auto cell = comment_cell(shape, i);
+
+        out << "<v:shape id=\"_x0000_s" << 1024 * (sheet + 1) + 1 + i << "\" type=\"#_x0000_t202\""
+            << " style=\"position:absolute;width:108pt;height:60pt;visibility:hidden\" fillcolor=\"#ffffe1\">"
+            << "<v:textbox/><x:ClientData ObjectType=\"Note\"><x:MoveWithCells/><x:SizeWithCells/>"
+            << "<x:Row>" << cell.row() - 1 << "</x:Row>"
+            << "<x:Column>" << cell.column_index() - 1 << "</x:Column></x:ClientData></v:shape>";
+    }
+
+    out << "</xml>";
+    totals.comments += count;
+}
+
+} // namespace
+
+generated_totals generate_workbook(const workbook_shape &shape, std::ostream &destination)
+{
+    generated_totals totals;
+    xlnt::detail::ozstream archive(destination);
+
+    write_content_types(archive, shape);
+    write_package_relationships(archive);
+    write_workbook(archive, shape);
+    write_styles(archive, shape);
+    write_shared_strings(archive, shape);
+
+    for (std::size_t sheet = 0; sheet < shape.sheets; ++sheet)
+    {
+        write_sheet(archive, shape, sheet, totals);
+
+        if (comment_count(shape) > 0)
+        {
+            write_comments(archive, shape, sheet, totals);
+        }
+    }
+
+    return totals;
+}
+
+generated_totals generate_workbook(const workbook_shape &shape, const xlnt::path &filename)
+{
+    std::ofstream file(filename.string(), std::ios::binary);
+
+    if (!file)
+    {
+        throw xlnt::exception("couldn't create " + filename.string());
+    }
+
+    return generate_workbook(shape, file);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+#include <xlnt/utils/path.hpp>
+
+/// <summary>
+/// The shape of a synthetic workbook. Every sheet has the same shape.
+/// </summary>
+struct workbook_shape
+{
+    std::size_t sheets = 1;
+    std::size_t rows = 10000;
+    std::size_t columns = 20;
+
+    /// <summary>
+    /// The fraction of cells in the rows x columns rectangle that have a value.
+    /// </summary>
+    double density = 1.0;
+
+    /// <summary>
+    /// The fraction of non-formula cells holding a shared string instead of a number.
+    /// </summary>
+    double string_ratio = 0.3;
+    std::size_t distinct_strings = 1000;
+
+    /// <summary>
+    /// The number of distinct cell formats, each with its own font.
+    /// </summary>
+    std::size_t styles = 1;
+
+    /// <summary>
+    /// The fraction of cells holding a formula.
+    /// </summary>
+    double formula_ratio = 0.0;
+
+    /// <summary>
+    /// The number of 2x2 merged ranges on each sheet.
+    /// </summary>
+    std::size_t merged_regions = 0;
+
+    /// <summary>
+    /// The number of cell comments on each sheet.
+    /// </summary>
+    std::size_t comments = 0;
+
+    std::uint64_t seed = 12345;
+};
+
+/// <summary>
+/// What generate_workbook wrote, summed over all sheets.
+/// </summary>
+struct generated_totals
+{
+    std::size_t cells = 0;
+    std::size_t number_cells = 0;
+    std::size_t string_cells = 0;
+    std::size_t formula_cells = 0;
+    std::size_t merged_regions = 0;
+    std::size_t comments = 0;
+};
+
+/// <summary>
+/// Writes an XLSX package of the given shape to destination, which must be seekable.
+/// The package is written one row at a time without building a workbook in memory
+/// so it can be far larger than available memory. Packages or parts over 4 GB get
+/// ZIP64 records, which xlnt and spreadsheet applications read from the central
+/// directory. The same shape and seed always produce the same bytes on every platform.
+/// </summary>
+generated_totals generate_workbook(const workbook_shape &shape, std::ostream &destination);
+
+/// <summary>
+/// Writes an XLSX package of the given shape to the file at filename.
+/// </summary>
+generated_totals generate_workbook(const workbook_shape &shape, const xlnt::path &filename);
@@ -22,6 +22,7 @@
 // @author: see AUTHORS file
 
 #include <iostream>
+#include <vector>
 
 #include <helpers/test_suite.hpp>
 #include <xlnt/utils/date.hpp>
@@ -40,6 +41,8 @@ public:
         register_test(test_early_date);
         register_test(test_mac_calendar);
         register_test(test_operators);
+        register_test(test_round_trip_serials);
+        register_test(test_batch_conversion);
     }
 
     void test_from_string()
@@ -113,5 +116,73 @@ public:
         xlnt_assert_equals(d1, d2);
         xlnt_assert_differs(d1, d3);
     }
+
+    void test_round_trip_serials()
+    {
+        // Serials around the nonexistent 1900-02-29, the 1904 epoch and leap day,
+        // the leap days of 2000 and 2100, and the last date Excel can represent
+        std::vector<int> serials;
+
+        for (auto first : {0, 1440, 36550, 73050, 2958366})
+        {
+            for (auto serial = first; serial < first + 100; ++serial)
+            {
+                serials.push_back(serial);
+            }
+        }
+
+        std::vector<int> serials_1904;
+
+        for (auto serial : serials)
+        {
+            serials_1904.push_back(serial - 1462);
+        }
+
+        const auto dates = xlnt::date::from_numbers(serials, xlnt::calendar::windows_1900);
+        xlnt_assert_equals(xlnt::date::from_numbers(serials_1904, xlnt::calendar::mac_1904), dates);
+        xlnt_assert_equals(xlnt::date::to_numbers(dates, xlnt::calendar::windows_1900), serials);
+        xlnt_assert_equals(xlnt::date::to_numbers(dates, xlnt::calendar::mac_1904), serials_1904);
+
+        for (std::size_t i = 0; i < serials.size(); ++i)
+        {
+            xlnt_assert_equals(xlnt::date::from_number(serials[i], xlnt::calendar::windows_1900), dates[i]);
+            xlnt_assert_equals(dates[i].to_number(xlnt::calendar::windows_1900), serials[i]);
+
+            if (i > 0 && serials[i] == serials[i - 1] + 1 && dates[i].day != 1)
+            {
+                xlnt_assert_equals(dates[i].day, dates[i - 1].day + 1);
+                xlnt_assert_equals(dates[i].month, dates[i - 1].month);
+            }
+        }
+
+        xlnt_assert_equals(dates[59], xlnt::date(1900, 2, 28));
+        xlnt_assert_equals(dates[60], xlnt::date(1900, 2, 29));
+        xlnt_assert_equals(dates[61], xlnt::date(1900, 3, 1));
+        xlnt_assert_equals(dates[122], xlnt::date(1904, 1, 1));
+        xlnt_assert_equals(dates[181], xlnt::date(1904, 2, 29));
+        xlnt_assert_equals(dates[235], xlnt::date(2000, 2, 29));
+        xlnt_assert_equals(dates[359], xlnt::date(2100, 2, 28));
+        xlnt_assert_equals(dates[360], xlnt::date(2100, 3, 1));
+        xlnt_assert_equals(dates.back(), xlnt::date(9999, 12, 31));
+    }
+
+    void test_batch_conversion()
+    {
+        const std::vector<double> numbers{1.0, 59.5, 60.0, 61.25, 42567.0, 42567.75};
+        auto converted = xlnt::datetime::from_numbers(numbers, xlnt::calendar::windows_1900);
+        xlnt_assert_equals(converted.size(), numbers.size());
+
+        for (std::size_t i = 0; i < numbers.size(); ++i)
+        {
+            xlnt_assert_equals(converted[i], xlnt::datetime::from_number(numbers[i], xlnt::calendar::windows_1900));
+        }
+
+        xlnt_assert_equals(xlnt::datetime::to_numbers(converted, xlnt::calendar::windows_1900), numbers);
+
+        const std::vector<int> serials{0, 1, 60, 42567};
+        auto dates = xlnt::date::from_numbers(serials, xlnt::calendar::mac_1904);
+        xlnt_assert_equals(dates[3], xlnt::date(2020, 7, 17));
+        xlnt_assert_equals(xlnt::date::to_numbers(dates, xlnt::calendar::mac_1904), serials);
+    }
 };
 static datetime_test_suite x;
\ No newline at end of file
@@ -0,0 +1,280 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <cstdint>
+#include <vector>
+
+#include <xlnt/cell/cell.hpp>
+#include <xlnt/workbook/workbook.hpp>
+#include <xlnt/worksheet/worksheet.hpp>
+#include <detail/formula/shared_formula.hpp>
+#include <helpers/test_suite.hpp>
+
+class calculation_test_suite : public test_suite
+{
+public:
+    calculation_test_suite()
+    {
+        register_test(test_arithmetic);
+        register_test(test_aggregates);
+        register_test(test_lookups);
+        register_test(test_errors);
+        register_test(test_cross_sheet);
+        register_test(test_recalculate_after_change);
+        register_test(test_parallel);
+        register_test(test_round_trip);
+        register_test(test_translate_formula);
+        register_test(test_shift_formula);
+    }
+
+    void test_arithmetic()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+
+        ws.cell("A1").value(3);
+        ws.cell("A2").value(4);
+        ws.cell("B1").formula("=A1+A2*2");
+        ws.cell("B2").formula("=(A1+A2)^2-50%");
+        ws.cell("B3").formula("=\"a\"&A1&\"b\"");
+        ws.cell("B4").formula("=A1<A2");
+        ws.cell("B5").formula("=-B1");
+
+        wb.calculate();
+
+        xlnt_assert_equals(ws.cell("B1").value<double>(), 11.0);
+        xlnt_assert_equals(ws.cell("B2").value<double>(), 48.5);
+        xlnt_assert_equals(ws.cell("B3").data_type(), xlnt::cell::type::formula_string);
+        xlnt_assert_equals(ws.cell("B3").value<std::string>(), "a3b");
+        xlnt_assert_equals(ws.cell("B4").data_type(), xlnt::cell::type::boolean);
+        xlnt_assert(ws.cell("B4").value<bool>());
+        xlnt_assert_equals(ws.cell("B5").value<double>(), -11.0);
+    }
+
+    void test_aggregates()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+
+        ws.cell("A1").value(1);
+        ws.cell("A2").value(2);
+        ws.cell("A3").value("text");
+        ws.cell("A4").value(6);
+        ws.cell("B1").formula("=SUM(A1:A4)");
+        ws.cell("B2").formula("=AVERAGE(A1:A4)");
+        ws.cell("B3").formula("=COUNT(A:A)");
+        ws.cell("B4").formula("=MAX(A1:A4,10)");
+        ws.cell("B5").formula("=MIN(A1:A4)");
+        ws.cell("B6").formula("=IF(B1>5,\"big\",\"small\")");
+
+        wb.calculate();
+
+        xlnt_assert_equals(ws.cell("B1").value<double>(), 9.0);
+        xlnt_assert_equals(ws.cell("B2").value<double>(), 3.0);
+        xlnt_assert_equals(ws.cell("B3").value<double>(), 3.0);
+        xlnt_assert_equals(ws.cell("B4").value<double>(), 10.0);
+        xlnt_assert_equals(ws.cell("B5").value<double>(), 1.0);
+        xlnt_assert_equals(ws.cell("B6").value<std::string>(), "big");
+    }
+
+    void test_lookups()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+
+        ws.cell("A1").value("apple");
+        ws.cell("B1").value(1.5);
+        ws.cell("A2").value("pear");
+        ws.cell("B2").value(2.5);
+        ws.cell("A3").value("plum");
+        ws.cell("B3").value(3.5);
+        ws.cell("D1").formula("=VLOOKUP(\"Pear\",A1:B3,2,FALSE)");
+        ws.cell("D2").formula("=INDEX(B1:B3,MATCH(\"plum\",A1:A3,0))");
+        ws.cell("D3").formula("=INDEX(A1:B3,1,2)");
+        ws.cell("D4").formula("=VLOOKUP(\"kiwi\",A1:B3,2,FALSE)");
+
+        wb.calculate();
+
+        xlnt_assert_equals(ws.cell("D1").value<double>(), 2.5);
+        xlnt_assert_equals(ws.cell("D2").value<double>(), 3.5);
+        xlnt_assert_equals(ws.cell("D3").value<double>(), 1.5);
+        xlnt_assert_equals(ws.cell("D4").data_type(), xlnt::cell::type::error);
+        xlnt_assert_equals(ws.cell("D4").error(), "#N/A");
+    }
+
+    void test_errors()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+
+        ws.cell("A1").value(0);
+        ws.cell("B1").formula("=1/A1");
+        ws.cell("B2").formula("=B1+1");
+        ws.cell("B3").formula("=NOSUCHFUNCTION(1)");
+        ws.cell("B4").formula("=Missing!A1");
+        ws.cell("B5").formula("=B6");
+        ws.cell("B6").formula("=B5");
+
+        wb.calculate();
+
+        xlnt_assert_equals(ws.cell("B1").error(), "#DIV/0!");
+        xlnt_assert_equals(ws.cell("B2").error(), "#DIV/0!");
+        xlnt_assert_equals(ws.cell("B3").error(), "#NAME?");
+        xlnt_assert_equals(ws.cell("B4").error(), "#REF!");
+        xlnt_assert_equals(ws.cell("B5").error(), "#REF!");
+        xlnt_assert_equals(ws.cell("B6").error(), "#REF!");
+    }
+
+    void test_cross_sheet()
+    {
+        xlnt::workbook wb;
+        auto first = wb.active_sheet();
+        first.title("Data");
+        auto second = wb.create_sheet();
+        second.title("My Sheet");
+
+        first.cell("A1").value(5);
+        second.cell("A1").formula("=Data!A1*2");
+        first.cell("B1").formula("='My Sheet'!A1+1");
+
+        wb.calculate();
+
+        xlnt_assert_equals(second.cell("A1").value<double>(), 10.0);
+        xlnt_assert_equals(first.cell("B1").value<double>(), 11.0);
+    }
+
+    void test_recalculate_after_change()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+
+        ws.cell("A1").value(1);
+        ws.cell("A2").value(2);
+        ws.cell("B1").formula("=SUM(A:A)");
+        ws.cell("C1").formula("=B1*10");
+        ws.cell("C2").formula("=A2");
+
+        wb.calculate();
+        xlnt_assert_equals(ws.cell("C1").value<double>(), 30.0);
+
+        ws.cell("A1").value(5);
+        ws.cell("A3").value(4);
+        wb.calculate();
+        xlnt_assert_equals(ws.cell("B1").value<double>(), 11.0);
+        xlnt_assert_equals(ws.cell("C1").value<double>(), 110.0);
+        xlnt_assert_equals(ws.cell("C2").value<double>(), 2.0);
+
+        ws.cell("C2").formula("=A2+A3");
+        ws.cell("D1").formula("=C2");
+        wb.calculate();
+        xlnt_assert_equals(ws.cell("C2").value<double>(), 6.0);
+        xlnt_assert_equals(ws.cell("D1").value<double>(), 6.0);
+
+        ws.insert_rows(1);
+        ws.cell("A1").value(100);
+        wb.calculate();
+        xlnt_assert_equals(ws.cell("B2").value<double>(), 111.0);
+    }
+
+    void test_parallel()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+
+        for (xlnt::row_t row = 1; row <= 2000; ++row)
+        {
+            ws.cell(1, row).value(static_cast<int>(row));
+            ws.cell(2, row).formula("=A" + std::to_string(row) + "*2");
+            ws.cell(3, row).formula("=B" + std::to_string(row) + "+1");
+        }
+
+        ws.cell("D1").formula("=SUM(C1:C2000)");
+
+        wb.calculate(4);
+
+        xlnt_assert_equals(ws.cell("C2000").value<double>(), 4001.0);
+        xlnt_assert_equals(ws.cell("D1").value<double>(), 2000.0 * 2001.0 + 2000.0);
+    }
+
+    void test_round_trip()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+
+        ws.cell("A1").value(2);
+        ws.cell("A2").formula("=A1*21");
+        ws.cell("A3").formula("=\"x\"&A2");
+        wb.calculate();
+
+        std::vector<std::uint8_t> data;
+        wb.save(data);
+
+        xlnt::workbook loaded;
+        loaded.load(data);
+        auto loaded_ws = loaded.active_sheet();
+
+        xlnt_assert_equals(loaded_ws.cell("A2").formula(), "A1*21");
+        xlnt_assert_equals(loaded_ws.cell("A2").value<double>(), 42.0);
+        xlnt_assert_equals(loaded_ws.cell("A3").value<std::string>(), "x42");
+    }
+
+    void test_translate_formula()
+    {
+        using xlnt::detail::translate_formula;
+
+        xlnt_assert_equals(translate_formula("A1+B2", 2, 1), "B3+C4");
+        xlnt_assert_equals(translate_formula("SUM(A1:B3)", 1, 0), "SUM(A2:B4)");
+        xlnt_assert_equals(translate_formula("SUM(A:A)+SUM(1:2)", 1, 1), "SUM(B:B)+SUM(2:3)");
+        xlnt_assert_equals(translate_formula("$A$1+$A1+A$1", 1, 1), "$A$1+$A2+B$1");
+        xlnt_assert_equals(translate_formula("Sheet2!A1+'My Sheet'!B$2", 1, 1), "Sheet2!B2+'My Sheet'!C$2");
+        xlnt_assert_equals(translate_formula("'It''s A1'!A1", 1, 0), "'It''s A1'!A2");
+        xlnt_assert_equals(translate_formula("\"A1\"&A1&\"say \"\"B2\"\"\"", 1, 0), "\"A1\"&A2&\"say \"\"B2\"\"\"");
+        xlnt_assert_equals(translate_formula("IF(ISERROR(A1),#N/A,#REF!)+#DIV/0!", 1, 0), "IF(ISERROR(A2),#N/A,#REF!)+#DIV/0!");
+        xlnt_assert_equals(translate_formula("SUM(Table1[A1])+Table1[[#Totals],[B2]]", 1, 0), "SUM(Table1[A1])+Table1[[#Totals],[B2]]");
+        xlnt_assert_equals(translate_formula("LOG10(A1)+ABC12345678", 1, 0), "LOG10(A2)+ABC12345678");
+        xlnt_assert_equals(translate_formula("A2+B1", -1, 0), "A1+#REF!");
+        xlnt_assert_equals(translate_formula("A1048576+XFD1", 1, 0), "#REF!+XFD2");
+        xlnt_assert_equals(translate_formula("XFD1", 0, 1), "#REF!");
+        xlnt_assert_equals(translate_formula("SUM(A1:A1048576)", 1, 0), "SUM(#REF!)");
+    }
+
+    void test_shift_formula()
+    {
+        using xlnt::detail::shift_formula;
+
+        // inserting two rows before row 3 of Sheet1
+        xlnt_assert_equals(shift_formula("A2+$A$3+A$5", "Sheet1", true, true, 3, 2, true), "A2+$A$5+A$7");
+        xlnt_assert_equals(shift_formula("SUM(A2:A3)+SUM(C:C)", "Sheet1", true, true, 3, 2, true), "SUM(A2:A5)+SUM(C:C)");
+        xlnt_assert_equals(shift_formula("A3+Sheet1!A3+'sheet1'!A3", "Sheet1", false, true, 3, 2, true), "A3+Sheet1!A5+'sheet1'!A5");
+        xlnt_assert_equals(shift_formula("Other!A3+[1]Sheet1!A3+\"A3\"", "Sheet1", true, true, 3, 2, true), "Other!A3+[1]Sheet1!A3+\"A3\"");
+        xlnt_assert_equals(shift_formula("A1048576", "Sheet1", true, true, 3, 2, true), "#REF!");
+
+        // deleting rows 3 and 4
+        xlnt_assert_equals(shift_formula("A3+A4+A5+SUM(A2:A6)+SUM(A3:A4)", "Sheet1", true, true, 3, 2, false), "#REF!+#REF!+A3+SUM(A2:A4)+SUM(#REF!)");
+
+        // inserting and deleting columns
+        xlnt_assert_equals(shift_formula("B1+SUM(A:C)+SUM(1:1)", "Sheet1", true, false, 2, 1, true), "C1+SUM(A:D)+SUM(1:1)");
+        xlnt_assert_equals(shift_formula("B1+SUM(A:C)+C$1", "Sheet1", true, false, 2, 1, false), "#REF!+SUM(A:B)+B$1");
+    }
+};
+static calculation_test_suite x;
@@ -0,0 +1,158 @@
+// Copyright (c) 2014-2018 Thomas Fussell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, WRISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE
+//
+// @license: http://www.opensource.org/licenses/mit-license.php
+// @author: see AUTHORS file
+
+#include <sstream>
+
+#include <xlnt/cell/cell.hpp>
+#include <xlnt/cell/comment.hpp>
+#include <xlnt/styles/font.hpp>
+#include <xlnt/styles/format.hpp>
+#include <xlnt/workbook/workbook.hpp>
+#include <xlnt/workbook/worksheet_iterator.hpp>
+#include <xlnt/worksheet/range.hpp>
+#include <xlnt/worksheet/worksheet.hpp>
+#include <helpers/test_suite.hpp>
+#include <helpers/workbook_generator.hpp>
+
+class generator_test_suite : public test_suite
+{
+public:
+    generator_test_suite()
+    {
+        register_test(test_generate_shape);
+        register_test(test_generate_deterministic);
+        register_test(test_generate_sparse);
+    }
+
+    void test_generate_shape()
+    {
+        workbook_shape shape;
+        shape.sheets = 2;
+        shape.rows = 30;
+        shape.columns = 7;
+        shape.distinct_strings = 5;
+        shape.styles = 4;
+        shape.formula_ratio = 0.2;
+        shape.merged_regions = 3;
+        shape.comments = 4;
+
+        std::stringstream stream;
+        const auto totals = generate_workbook(shape, stream);
+
+        // only the top left cell of each merged region has a value
+        xlnt_assert_equals(totals.cells, 2 * (30 * 7 - 3 * 3));
+        xlnt_assert_equals(totals.cells, totals.number_cells + totals.string_cells + totals.formula_cells);
+        xlnt_assert_differs(totals.string_cells, 0);
+        xlnt_assert_differs(totals.formula_cells, 0);
+        xlnt_assert_equals(totals.merged_regions, 6);
+        xlnt_assert_equals(totals.comments, 8);
+
+        xlnt::workbook wb;
+        wb.load(stream);
+
+        xlnt_assert_equals(wb.sheet_count(), 2);
+        xlnt_assert_equals(wb.shared_strings().size(), 5);
+        xlnt_assert(wb.format(3).font().bold());
+        xlnt_assert(!wb.format(2).font().bold());
+        xlnt_assert_equals(wb.format(2).font().size(), 10.0);
+
+        std::size_t cells = 0;
+        std::size_t strings = 0;
+        std::size_t formulas = 0;
+        std::size_t comments = 0;
+
+        for (auto ws : wb)
+        {
+            xlnt_assert_equals(ws.calculate_dimension(), xlnt::range_reference("A1:G30"));
+            xlnt_assert_equals(ws.merged_ranges().size(), 3);
+            xlnt_assert_equals(ws.merged_ranges().front(), xlnt::range_reference("A1:B2"));
+
+            for (auto row : ws.rows())
+            {
+                for (auto cell : row)
+                {
+                    ++cells;
+                    if (cell.data_type() == xlnt::cell::type::shared_string) ++strings;
+                    if (cell.has_formula()) ++formulas;
+                    if (cell.has_comment()) ++comments;
+                }
+            }
+        }
+
+        xlnt_assert_equals(cells, totals.cells);
+        xlnt_assert_equals(strings, totals.string_cells);
+        xlnt_assert_equals(formulas, totals.formula_cells);
+        xlnt_assert_equals(comments, totals.comments);
+        xlnt_assert_equals(wb.sheet_by_index(0).cell("A1").comment().plain_text(), "comment 0");
+    }
+
+    void test_generate_deterministic()
+    {
+        workbook_shape shape;
+        shape.rows = 50;
+        shape.columns = 5;
+        shape.styles = 3;
+        shape.formula_ratio = 0.1;
+
+        std::stringstream first, second;
+        generate_workbook(shape, first);
+        generate_workbook(shape, second);
+        xlnt_assert_equals(first.str(), second.str());
+
+        shape.seed += 1;
+        std::stringstream reseeded;
+        generate_workbook(shape, reseeded);
+        xlnt_assert_differs(first.str(), reseeded.str());
+    }
+
+    void test_generate_sparse()
+    {
+        workbook_shape shape;
+        shape.rows = 200;
+        shape.columns = 10;
+        shape.density = 0.05;
+
+        std::stringstream stream;
+        const auto totals = generate_workbook(shape, stream);
+
+        xlnt_assert(totals.cells > 0);
+        xlnt_assert(totals.cells < 200);
+
+        xlnt::workbook wb;
+        wb.load(stream);
+
+        std::size_t cells = 0;
+
+        for (auto row : wb.active_sheet().rows())
+        {
+            for (auto cell : row)
+            {
+                xlnt_assert(cell.has_value());
+                ++cells;
+            }
+        }
+
+        xlnt_assert_equals(cells, totals.cells);
+    }
+};
+static generator_test_suite x;
@@ -21,7 +21,14 @@
 // @license: http://www.opensource.org/licenses/mit-license.php
 // @author: see AUTHORS file
 
+#include <algorithm>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <thread>
 
 #include <xlnt/cell/comment.hpp>
 #include <xlnt/cell/hyperlink.hpp>
@@ -41,13 +48,19 @@
 #include <xlnt/workbook/streaming_workbook_writer.hpp>
 #include <xlnt/workbook/workbook.hpp>
 #include <xlnt/workbook/metadata_property.hpp>
+#include <xlnt/workbook/serialization_options.hpp>
+#include <xlnt/workbook/serialization_statistics.hpp>
 #include <xlnt/worksheet/column_properties.hpp>
 #include <xlnt/worksheet/row_properties.hpp>
 #include <xlnt/worksheet/sheet_format_properties.hpp>
 #include <xlnt/worksheet/header_footer.hpp>
 #include <xlnt/worksheet/worksheet.hpp>
 #include <detail/cryptography/xlsx_crypto_consumer.hpp>
+#include <detail/constants.hpp>
+#include <detail/serialization/pipeline.hpp>
 #include <detail/serialization/vector_streambuf.hpp>
+#include <detail/serialization/xml_vocabulary.hpp>
+#include <detail/serialization/zstream.hpp>
 #include <helpers/path_helper.hpp>
 #include <helpers/temporary_file.hpp>
 #include <helpers/test_suite.hpp>
@@ -90,6 +103,26 @@ public:
         register_test(test_round_trip_rw_encrypted_numbers);
         register_test(test_streaming_read);
         register_test(test_streaming_write);
+        register_test(test_shared_formulas);
+        register_test(test_shared_formulas_outlive_original);
+        register_test(test_serialization_statistics);
+        register_test(test_serialization_progress);
+        register_test(test_cancel_load);
+        register_test(test_cancel_save);
+        register_test(test_load_mapped_file);
+        register_test(test_read_archive_in_memory);
+        register_test(test_zip64_archive);
+        register_test(test_read_large_parts);
+        register_test(test_pipelined_load_and_save);
+        register_test(test_pipelined_write_error);
+        register_test(test_parallel_sheet_data);
+        register_test(test_parallel_worksheet_writing);
+        register_test(test_concurrent_load_and_save);
+        register_test(test_xml_vocabulary);
+        register_test(test_keep_source);
+        register_test(test_keep_source_save_in_place);
+        register_test(test_keep_source_calculate);
+        register_test(test_save_compression);
     }
 
     bool workbook_matches_file(xlnt::workbook &wb, const xlnt::path &file)
@@ -708,5 +741,942 @@ public:
         b2.value("should not change");
         c3.value("C3!");
     }
+
+    // Returns a workbook whose cells B1:B4 are a shared formula group.
+    std::vector<std::uint8_t> shared_formula_workbook()
+    {
+        xlnt::workbook original;
+        auto original_ws = original.active_sheet();
+
+        for (xlnt::row_t row = 1; row <= 4; ++row)
+        {
+            original_ws.cell(1, row).value(static_cast<int>(row));
+            original_ws.cell(2, row).formula("=$A$1+A" + std::to_string(row) + "*2");
+        }
+
+        std::vector<std::uint8_t> data;
+        original.save(data);
+
+        // xlnt only writes shared formulas for groups it read, so make B1:B4 one
+        data = edit_part(data, xlnt::path("xl/worksheets/sheet1.xml"), [](std::string xml) {
+            auto replace = [&xml](const std::string &from, const std::string &to) {
+                xml.replace(xml.find(from), from.size(), to);
+            };
+
+            replace("<f>$A$1+A1*2</f>", "<f t=\"shared\" ref=\"B1:B4\" si=\"0\">$A$1+A1*2</f>");
+            replace("<f>$A$1+A2*2</f>", "<f t=\"shared\" si=\"0\"/>");
+            replace("<f>$A$1+A3*2</f>", "<f t=\"shared\" si=\"0\"/>");
+            replace("<f>$A$1+A4*2</f>", "<f t=\"shared\" si=\"0\"/>");
+
+            return xml;
+        });
+
+        return data;
+    }
+
+    void test_shared_formulas()
+    {
+        xlnt::workbook wb;
+        wb.load(shared_formula_workbook());
+        auto ws = wb.active_sheet();
+
+        xlnt_assert_equals(ws.cell("B1").formula(), "$A$1+A1*2");
+        xlnt_assert_equals(ws.cell("B4").formula(), "$A$1+A4*2");
+        xlnt_assert(ws.cell("B3").has_formula());
+
+        ws.cell("B2").formula("=A2");
+        xlnt_assert_equals(ws.cell("B2").formula(), "A2");
+        xlnt_assert_equals(ws.cell("B3").formula(), "$A$1+A3*2");
+
+        std::vector<std::uint8_t> saved;
+        wb.save(saved);
+
+        const auto sheet_xml = read_part(saved, xlnt::path("xl/worksheets/sheet1.xml"));
+        xlnt_assert_differs(sheet_xml.find("<f t=\"shared\" ref=\"B1:B4\" si=\"0\">$A$1+A1*2</f>"), std::string::npos);
+        xlnt_assert_differs(sheet_xml.find("<f t=\"shared\" si=\"0\"/>"), std::string::npos);
+        xlnt_assert_equals(sheet_xml.find("A4*2"), std::string::npos);
+
+        xlnt::workbook reloaded;
+        reloaded.load(saved);
+        auto reloaded_ws = reloaded.active_sheet();
+
+        xlnt_assert_equals(reloaded_ws.cell("B2").formula(), "A2");
+        xlnt_assert_equals(reloaded_ws.cell("B4").formula(), "$A$1+A4*2");
+
+        // groups whose cells don't move stay shared
+        reloaded_ws.insert_rows(10);
+        std::vector<std::uint8_t> resaved;
+        reloaded.save(resaved);
+        xlnt_assert_differs(read_part(resaved, xlnt::path("xl/worksheets/sheet1.xml")).find("t=\"shared\""), std::string::npos);
+
+        // moving cells moves the anchor of their group and its references with them
+        reloaded_ws.insert_rows(2);
+        xlnt_assert_equals(reloaded_ws.cell("B5").formula(), "$A$1+A5*2");
+        xlnt_assert_equals(reloaded_ws.cell("B1").formula(), "$A$1+A1*2");
+        reloaded_ws.insert_rows(1);
+        xlnt_assert_equals(reloaded_ws.cell("B6").formula(), "$A$2+A6*2");
+        reloaded_ws.delete_rows(1, 2);
+        xlnt_assert_equals(reloaded_ws.cell("B4").formula(), "#REF!+A4*2");
+
+        reloaded.save(resaved);
+        const auto shifted_xml = read_part(resaved, xlnt::path("xl/worksheets/sheet1.xml"));
+        xlnt_assert_differs(shifted_xml.find("<f t=\"shared\" ref=\"B3:B4\" si=\"0\">#REF!+A3*2</f>"), std::string::npos);
+        xlnt_assert_equals(shifted_xml.find("A1*2"), std::string::npos);
+    }
+
+    void test_shared_formulas_outlive_original()
+    {
+        auto original = std::unique_ptr<xlnt::workbook>(new xlnt::workbook());
+        original->load(shared_formula_workbook());
+        original->active_sheet().cell("A4").comment(xlnt::comment("note", "author"));
+        original->copy_sheet(original->active_sheet());
+
+        // nothing is read through the copy before the original is gone
+        xlnt::workbook copy(*original);
+        original.reset();
+
+        copy.calculate();
+        auto ws = copy.active_sheet();
+        xlnt_assert(ws.compare(copy.sheet_by_index(1), false));
+        xlnt_assert_equals(ws.cell("B4").value<double>(), 9.0);
+        xlnt_assert_equals(copy.sheet_by_index(1).cell("B3").value<double>(), 7.0);
+
+        std::vector<std::uint8_t> saved;
+        copy.save(saved);
+
+        xlnt::workbook reloaded;
+        reloaded.load(saved);
+        xlnt_assert_equals(reloaded.active_sheet().cell("B4").formula(), "$A$1+A4*2");
+        xlnt_assert_equals(reloaded.active_sheet().cell("A4").comment().plain_text(), "note");
+        xlnt_assert_equals(reloaded.sheet_by_index(1).cell("A4").comment().plain_text(), "note");
+    }
+
+    void test_serialization_statistics()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+
+        for (xlnt::row_t row = 1; row <= 10; ++row)
+        {
+            ws.cell(1, row).value(static_cast<int>(row));
+            ws.cell(2, row).value("string " + std::to_string(row));
+        }
+
+        std::uint64_t counter_calls = 0;
+
+        xlnt::serialization_statistics save_statistics;
+        save_statistics.allocation_counter = [&counter_calls]() { return counter_calls++; };
+        xlnt::save_options save_options;
+        save_options.statistics = &save_statistics;
+
+        std::vector<std::uint8_t> saved;
+        wb.save(saved, save_options);
+
+        xlnt::serialization_statistics load_statistics;
+        xlnt::load_options load_options;
+        load_options.statistics = &load_statistics;
+
+        xlnt::workbook loaded;
+        loaded.load(saved, load_options);
+        xlnt_assert_equals(loaded.active_sheet().cell("B10").value<std::string>(), "string 10");
+
+        if (!xlnt::serialization_statistics::enabled())
+        {
+            xlnt_assert(save_statistics.parts.empty());
+            xlnt_assert(load_statistics.parts.empty());
+            xlnt_assert_equals(save_statistics.cells, 0);
+            xlnt_assert_equals(load_statistics.cells, 0);
+            xlnt_assert_equals(counter_calls, 0);
+
+            return;
+        }
+
+        for (auto statistics : {&save_statistics, &load_statistics})
+        {
+            xlnt_assert_equals(statistics->rows, 10);
+            xlnt_assert_equals(statistics->cells, 20);
+            xlnt_assert_equals(statistics->shared_strings, 10);
+            xlnt_assert(statistics->formats > 0);
+            xlnt_assert(statistics->seconds > 0);
+
+            auto sheet = std::find_if(statistics->parts.begin(), statistics->parts.end(),
+                [](const xlnt::part_statistics &p) { return p.part == xlnt::path("xl/worksheets/sheet1.xml"); });
+            xlnt_assert(sheet != statistics->parts.end());
+            xlnt_assert(sheet->uncompressed_bytes > sheet->compressed_bytes);
+            xlnt_assert(statistics->uncompressed_bytes() > statistics->compressed_bytes());
+
+            // parts read while the workbook part is open don't count towards it
+            auto part_seconds = 0.0;
+            for (const auto &part : statistics->parts)
+            {
+                part_seconds += part.seconds;
+            }
+            xlnt_assert(part_seconds <= statistics->seconds);
+        }
+
+        xlnt_assert(counter_calls > 0);
+    }
+
+    std::vector<std::uint8_t> save_rows(xlnt::row_t rows)
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+
+        for (xlnt::row_t row = 1; row <= rows; ++row)
+        {
+            ws.cell(1, row).value(static_cast<int>(row));
+        }
+
+        std::vector<std::uint8_t> saved;
+        wb.save(saved);
+
+        return saved;
+    }
+
+    void test_serialization_progress()
+    {
+        const auto saved = save_rows(2500);
+
+        std::vector<xlnt::serialization_progress> reports;
+        xlnt::load_options options;
+        options.progress = [&reports](const xlnt::serialization_progress &p) { reports.push_back(p); };
+
+        xlnt::workbook wb;
+        wb.load(saved, options);
+
+        xlnt_assert(reports.size() > 2);
+        xlnt_assert_equals(reports.back().rows, 2500);
+        xlnt_assert(reports.back().parts > 0);
+        xlnt_assert(reports.back().total_bytes > 0);
+        xlnt_assert(reports.back().bytes > 0);
+
+        // rows are reported every progress_interval rows
+        xlnt_assert_equals(std::count_if(reports.begin(), reports.end(),
+                               [](const xlnt::serialization_progress &p) { return p.rows == 1000; }),
+            1);
+
+        for (std::size_t i = 1; i < reports.size(); ++i)
+        {
+            xlnt_assert(reports[i].bytes >= reports[i - 1].bytes);
+            xlnt_assert(reports[i].rows >= reports[i - 1].rows);
+        }
+
+        xlnt::serialization_progress last_save;
+        xlnt::save_options save_options;
+        save_options.progress = [&last_save](const xlnt::serialization_progress &p) { last_save = p; };
+        std::vector<std::uint8_t> resaved;
+        wb.save(resaved, save_options);
+
+        xlnt_assert_equals(last_save.rows, 2500);
+        xlnt_assert(last_save.bytes > 0);
+        xlnt_assert_equals(last_save.total_bytes, 0);
+    }
+
+    void test_cancel_load()
+    {
+        const auto saved = save_rows(5000);
+
+        xlnt::workbook wb;
+        wb.active_sheet().title("Unchanged");
+        wb.active_sheet().cell("A1").value("kept");
+
+        xlnt::cancellation_token token;
+        xlnt::load_options options;
+        options.cancellation = &token;
+        options.progress_interval = 100;
+        options.progress = [&token](const xlnt::serialization_progress &p) {
+            if (p.rows >= 2000) token.cancel();
+        };
+
+        xlnt_assert_throws(wb.load(saved, options), xlnt::operation_cancelled);
+
+        xlnt_assert_equals(wb.sheet_count(), 1);
+        xlnt_assert_equals(wb.active_sheet().title(), "Unchanged");
+        xlnt_assert_equals(wb.active_sheet().cell("A1").value<std::string>(), "kept");
+        xlnt_assert_equals(wb.active_sheet().highest_row(), 1);
+
+        // the workbook is still usable and a load without the token succeeds
+        wb.load(saved);
+        xlnt_assert_equals(wb.active_sheet().highest_row(), 5000);
+    }
+
+    void test_cancel_save()
+    {
+        xlnt::workbook wb;
+        wb.active_sheet().cell("A1").value(1);
+
+        xlnt::cancellation_token token;
+        token.cancel();
+        xlnt::save_options options;
+        options.cancellation = &token;
+
+        std::vector<std::uint8_t> saved;
+        xlnt_assert_throws(wb.save(saved, options), xlnt::operation_cancelled);
+
+        // nothing in the workbook changes so it can be saved again
+        saved.clear();
+        wb.save(saved);
+        xlnt::workbook loaded;
+        loaded.load(saved);
+        xlnt_assert_equals(loaded.active_sheet().cell("A1").value<int>(), 1);
+    }
+
+    void test_load_mapped_file()
+    {
+        // loading by path maps the file; loading from a stream must give the same result
+        for (const auto &name : {"3_default.xlsx", "4_every_style.xlsx", "10_comments_hyperlinks_formulae.xlsx"})
+        {
+            const auto path = path_helper::test_file(name);
+            xlnt::workbook mapped(path);
+
+            std::ifstream file(path.string(), std::ios::binary);
+            xlnt::workbook streamed(file);
+
+            xlnt_assert(saved_bytes(mapped) == saved_bytes(streamed));
+        }
+
+        xlnt::workbook decrypted;
+        decrypted.load(path_helper::test_file("5_encrypted_agile.xlsx"), "secret");
+        xlnt_assert_equals(decrypted.active_sheet().cell("A1").value<std::string>(), "secret");
+    }
+
+    void test_read_archive_in_memory()
+    {
+        // a hand-made archive with two stored files, which are read in place
+        const auto archive = stored_archive({{"a.txt", "first file"}, {"b/c.txt", std::string(100000, 'x')}});
+        xlnt::detail::izstream zip(archive.data(), archive.size());
+
+        xlnt_assert_equals(zip.files().size(), 2);
+        xlnt_assert_equals(zip.read(xlnt::path("a.txt")), "first file");
+
+        // files can be read by several threads at once
+        std::string first, second;
+        std::thread reader([&]() { first = zip.read(xlnt::path("b/c.txt")); });
+        second = zip.read(xlnt::path("b/c.txt"));
+        reader.join();
+
+        xlnt_assert_equals(first, std::string(100000, 'x'));
+        xlnt_assert_equals(second, first);
+
+        // deflated parts are inflated straight from memory
+        const auto saved = save_rows(100);
+        xlnt::detail::izstream saved_zip(saved.data(), saved.size());
+        xlnt_assert_equals(saved_zip.read(xlnt::path("xl/worksheets/sheet1.xml")),
+            read_part(saved, xlnt::path("xl/worksheets/sheet1.xml")));
+
+        // entries claiming to extend past the end are rejected instead of read
+        auto corrupted = archive;
+        // the central directory entry of b/c.txt comes last, before the 22 byte end record
+        const auto entry = corrupted.size() - 22 - (46 + 7);
+        xlnt_assert_equals(corrupted[entry], 0x50);
+        for (auto size_field : {20, 24})
+        {
+            corrupted[entry + size_field + 3] = 0x7f;
+        }
+        xlnt::detail::izstream corrupted_zip(corrupted.data(), corrupted.size());
+        xlnt_assert_equals(corrupted_zip.read(xlnt::path("a.txt")), "first file");
+        xlnt_assert_throws(corrupted_zip.read(xlnt::path("b/c.txt")), xlnt::exception);
+    }
+
+    void test_zip64_archive()
+    {
+        // more files than the end of central directory can count need ZIP64 records
+        const auto files = std::size_t(0x10000);
+        xlnt::compression_options stored = xlnt::compression_options::stored();
+        stored.buffer_size = 64;
+        std::vector<std::uint8_t> archive;
+
+        {
+            xlnt::detail::vector_ostreambuf buffer(archive);
+            std::ostream stream(&buffer);
+            xlnt::detail::ozstream zip(stream);
+
+            for (std::size_t i = 0; i < files; ++i)
+            {
+                auto part = zip.open(xlnt::path(std::to_string(i) + ".txt"), stored);
+                std::ostream(part.get()) << "file " << i;
+            }
+        }
+
+        const auto zip64_end = std::string("PK\x06\x06");
+        xlnt_assert_differs(std::search(archive.begin(), archive.end(), zip64_end.begin(), zip64_end.end()), archive.end());
+
+        xlnt::detail::izstream in_memory(archive.data(), archive.size());
+        xlnt_assert_equals(in_memory.files().size(), files);
+        xlnt_assert_equals(in_memory.read(xlnt::path("65535.txt")), "file 65535");
+
+        xlnt::detail::vector_istreambuf buffer(archive);
+        std::istream stream(&buffer);
+        xlnt::detail::izstream streamed(stream);
+        xlnt_assert_equals(streamed.read(xlnt::path("0.txt")), "file 0");
+
+        // smaller archives stay as they were
+        const auto saved = save_rows(10);
+        xlnt_assert_equals(std::search(saved.begin(), saved.end(), zip64_end.begin(), zip64_end.end()), saved.end());
+    }
+
+    void test_read_large_parts()
+    {
+        // the worksheet spans many of the chunks parts are read and inflated in
+        const auto saved = save_rows(20000);
+        const auto sheet = xlnt::path("xl/worksheets/sheet1.xml");
+        xlnt::detail::izstream in_memory(saved.data(), saved.size());
+        const auto expected = in_memory.read(sheet);
+        xlnt_assert(expected.size() > 1000000);
+        xlnt_assert_equals(expected.size(), in_memory.header(sheet).uncompressed_size);
+        xlnt_assert_equals(read_part(saved, sheet), expected);
+
+        xlnt::detail::vector_istreambuf buffer(saved);
+        std::istream stream(&buffer);
+        xlnt_assert(xlnt::detail::to_vector(stream) == saved);
+
+        xlnt::detail::vector_istreambuf load_buffer(saved);
+        std::istream load_stream(&load_buffer);
+        xlnt::workbook streamed;
+        streamed.load(load_stream);
+        xlnt_assert_equals(streamed.active_sheet().highest_row(), 20000);
+        xlnt_assert_equals(streamed.active_sheet().cell("A20000").value<int>(), 20000);
+    }
+
+    void test_pipelined_load_and_save()
+    {
+        const auto saved = save_rows(50000);
+
+        xlnt::load_options load_options;
+        load_options.pipeline = true;
+        xlnt::workbook wb;
+        wb.load(saved, load_options);
+        xlnt_assert_equals(wb.active_sheet().highest_row(), 50000);
+        xlnt_assert_equals(wb.active_sheet().cell("A50000").value<int>(), 50000);
+
+        // deflating on another thread writes the same bytes
+        xlnt::save_options save_options;
+        save_options.pipeline = true;
+        std::vector<std::uint8_t> resaved;
+        wb.save(resaved, save_options);
+        xlnt_assert(resaved == saved_bytes(wb));
+
+        // stopping early joins the inflating thread
+        xlnt::cancellation_token token;
+        load_options.cancellation = &token;
+        load_options.progress = [&token](const xlnt::serialization_progress &p) {
+            if (p.rows >= 1000) token.cancel();
+        };
+        xlnt::workbook cancelled;
+        xlnt_assert_throws(cancelled.load(saved, load_options), xlnt::operation_cancelled);
+
+        // errors inflating on the other thread are thrown by the load
+        const auto sheet = xlnt::path("xl/worksheets/sheet1.xml");
+        const auto header = xlnt::detail::izstream(saved.data(), saved.size()).header(sheet);
+        auto corrupted = saved;
+        const auto middle = header.header_offset + 30 + header.filename.size() + header.compressed_size / 2;
+        std::fill(corrupted.begin() + static_cast<std::ptrdiff_t>(middle),
+            corrupted.begin() + static_cast<std::ptrdiff_t>(middle) + 64, std::uint8_t(0xff));
+        load_options = xlnt::load_options();
+        load_options.pipeline = true;
+        xlnt_assert_throws(wb.load(corrupted, load_options), std::exception);
+        xlnt_assert_equals(wb.active_sheet().highest_row(), 50000);
+    }
+
+    void test_pipelined_write_error()
+    {
+        // accepts nothing, like a full disk
+        class failing_streambuf : public std::streambuf
+        {
+        protected:
+            std::streamsize xsputn(const char *, std::streamsize) override
+            {
+                return 0;
+            }
+        };
+
+        std::vector<std::uint8_t> bytes;
+        xlnt::detail::pipelined_ostreambuf working(
+            std::unique_ptr<std::streambuf>(new xlnt::detail::vector_ostreambuf(bytes)));
+        std::ostream(&working) << "last block";
+        working.close();
+        xlnt_assert_equals(std::string(bytes.begin(), bytes.end()), "last block");
+
+        // the only block is written by close, which throws what the writing thread ran into
+        xlnt::detail::pipelined_ostreambuf failing(std::unique_ptr<std::streambuf>(new failing_streambuf()));
+        std::ostream(&failing) << "last block";
+        xlnt_assert_throws(failing.close(), xlnt::exception);
+    }
+
+    void test_parallel_sheet_data()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+        auto bold = wb.create_format().font(xlnt::font().bold(true), true);
+
+        // large enough for the worksheet part to be parsed in parallel
+        for (xlnt::row_t row = 1; row <= 10000; ++row)
+        {
+            ws.cell(1, row).value(static_cast<int>(row));
+            ws.cell(2, row).value(row * 0.25);
+            ws.cell(3, row).value("text " + std::to_string(row % 100));
+            ws.cell(4, row).formula("=A" + std::to_string(row) + "*2");
+            ws.cell(5, row).value(row % 2 == 0);
+            if (row % 7 == 0) ws.cell(2, row).format(bold);
+            if (row % 11 == 0) ws.row_properties(row).height = 20.0;
+        }
+
+        std::vector<std::uint8_t> saved;
+        wb.save(saved);
+
+        xlnt::workbook serial;
+        serial.load(saved);
+        const auto expected = saved_bytes(serial);
+
+        // the rows end up the same however many threads parse them
+        for (std::size_t threads : {3, 8})
+        {
+            xlnt::load_options options;
+            options.parse_threads = threads;
+            xlnt::workbook parallel;
+            parallel.load(saved, options);
+            xlnt_assert_equals(parallel.active_sheet().highest_row(), 10000);
+            xlnt_assert_equals(parallel.active_sheet().cell("C1234").value<std::string>(), "text 34");
+            xlnt_assert(saved_bytes(parallel) == expected);
+        }
+
+        // stopping early joins the parsing threads
+        xlnt::cancellation_token token;
+        xlnt::load_options options;
+        options.parse_threads = 4;
+        options.cancellation = &token;
+        options.progress = [&token](const xlnt::serialization_progress &p) {
+            if (p.rows >= 3000) token.cancel();
+        };
+        xlnt::workbook cancelled;
+        xlnt_assert_throws(cancelled.load(saved, options), xlnt::operation_cancelled);
+    }
+
+    void test_parallel_worksheet_writing()
+    {
+        xlnt::workbook wb(path_helper::test_file("10_comments_hyperlinks_formulae.xlsx"));
+
+        for (int sheet = 0; sheet < 3; ++sheet)
+        {
+            auto ws = wb.create_sheet();
+
+            for (xlnt::row_t row = 1; row <= 2000; ++row)
+            {
+                ws.cell(1, row).value(static_cast<int>(row) * sheet);
+                ws.cell(2, row).value("sheet " + std::to_string(sheet));
+            }
+        }
+
+        xlnt::serialization_statistics expected_statistics;
+        xlnt::save_options serial_options;
+        serial_options.statistics = &expected_statistics;
+        std::vector<std::uint8_t> expected;
+        wb.save(expected, serial_options);
+
+        // the worksheets, with their comments, are copied in after being written elsewhere
+        for (std::size_t threads : {2, 8})
+        {
+            xlnt::serialization_statistics statistics;
+            xlnt::save_options options;
+            options.write_threads = threads;
+            options.statistics = &statistics;
+            std::vector<std::uint8_t> saved;
+            wb.save(saved, options);
+            xlnt_assert(saved == expected);
+            xlnt_assert_equals(statistics.rows, expected_statistics.rows);
+            xlnt_assert_equals(statistics.cells, expected_statistics.cells);
+            xlnt_assert_equals(statistics.parts.size(), expected_statistics.parts.size());
+        }
+
+        // stopping early joins the writing threads
+        xlnt::cancellation_token token;
+        xlnt::save_options options;
+        options.write_threads = 2;
+        options.cancellation = &token;
+        options.progress = [&token](const xlnt::serialization_progress &p) {
+            if (p.rows >= 2000) token.cancel();
+        };
+        std::vector<std::uint8_t> cancelled;
+        xlnt_assert_throws(wb.save(cancelled, options), xlnt::operation_cancelled);
+    }
+
+    void test_concurrent_load_and_save()
+    {
+        const std::vector<std::string> files = {"3_default.xlsx", "4_every_style.xlsx",
+            "10_comments_hyperlinks_formulae.xlsx", "13_custom_heights_widths.xlsx"};
+
+        // what each file looks like after one and two round trips on a single thread
+        auto round_trip = [this](const xlnt::path &file) {
+            const auto saved = saved_bytes(xlnt::workbook(file));
+            xlnt::workbook reloaded;
+            reloaded.load(saved);
+
+            return std::make_pair(saved, saved_bytes(reloaded));
+        };
+
+        std::vector<std::pair<std::vector<std::uint8_t>, std::vector<std::uint8_t>>> expected;
+        for (const auto &file : files)
+        {
+            expected.push_back(round_trip(path_helper::test_file(file)));
+        }
+
+        const std::size_t thread_count = 8;
+        std::vector<std::thread> threads;
+        std::vector<std::exception_ptr> errors(thread_count);
+        std::vector<char> matched(thread_count, true);
+
+        for (std::size_t t = 0; t < thread_count; ++t)
+        {
+            threads.emplace_back([&, t]() {
+                try
+                {
+                    for (std::size_t i = 0; i < 10; ++i)
+                    {
+                        const auto index = (t + i) % files.size();
+                        matched[t] = matched[t] && round_trip(path_helper::test_file(files[index])) == expected[index];
+                    }
+                }
+                catch (...)
+                {
+                    errors[t] = std::current_exception();
+                }
+            });
+        }
+
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        for (std::size_t t = 0; t < thread_count; ++t)
+        {
+            if (errors[t]) std::rethrow_exception(errors[t]);
+            xlnt_assert(matched[t]);
+        }
+    }
+
+    void test_keep_source()
+    {
+        const auto source = file_bytes(path_helper::test_file("10_comments_hyperlinks_formulae.xlsx"));
+        xlnt::load_options options;
+        options.keep_source = true;
+        xlnt::workbook wb;
+        wb.load(source, options);
+
+        // nothing changed so every part is either copied or written again as usual
+        const auto unchanged = saved_bytes(wb);
+        for (const auto &part : {"xl/worksheets/sheet1.xml", "xl/worksheets/sheet2.xml",
+                 "xl/worksheets/_rels/sheet2.xml.rels", "xl/comments2.xml", "xl/drawings/vmlDrawing2.vml",
+                 "xl/styles.xml", "xl/sharedStrings.xml", "docProps/thumbnail.jpeg"})
+        {
+            xlnt_assert_equals(stored_part(unchanged, xlnt::path(part)), stored_part(source, xlnt::path(part)));
+        }
+
+        // only the worksheet written to is written again, reading the other doesn't count
+        const auto untouched_title = wb.sheet_by_index(1).title();
+        xlnt_assert(wb.sheet_by_index(1).cell("A2").has_comment());
+        wb.sheet_by_index(0).cell("A1").value("changed");
+        const auto saved = saved_bytes(wb);
+
+        xlnt_assert_differs(stored_part(saved, xlnt::path("xl/worksheets/sheet1.xml")),
+            stored_part(source, xlnt::path("xl/worksheets/sheet1.xml")));
+        xlnt_assert_equals(stored_part(saved, xlnt::path("xl/worksheets/sheet2.xml")),
+            stored_part(source, xlnt::path("xl/worksheets/sheet2.xml")));
+        xlnt_assert_equals(stored_part(saved, xlnt::path("xl/comments2.xml")),
+            stored_part(source, xlnt::path("xl/comments2.xml")));
+
+        xlnt::workbook reloaded;
+        reloaded.load(saved);
+        xlnt_assert_equals(reloaded.sheet_by_index(0).cell("A1").value<std::string>(), "changed");
+        xlnt_assert_equals(reloaded.sheet_by_title(untouched_title).cell("A2").comment().plain_text(),
+            wb.sheet_by_title(untouched_title).cell("A2").comment().plain_text());
+
+        // a changed format makes every worksheet be written again
+        wb.sheet_by_index(0).cell("A1").font(xlnt::font().bold(true));
+        const auto restyled = saved_bytes(wb);
+        xlnt_assert_differs(stored_part(restyled, xlnt::path("xl/styles.xml")),
+            stored_part(source, xlnt::path("xl/styles.xml")));
+        xlnt_assert_differs(stored_part(restyled, xlnt::path("xl/worksheets/sheet2.xml")),
+            stored_part(source, xlnt::path("xl/worksheets/sheet2.xml")));
+
+        // parts xlnt doesn't read are kept instead of being written empty
+        xlnt::workbook printer_settings;
+        printer_settings.load(path_helper::test_file("Issue279_workbook_delete_rename.xlsx"), options);
+        const auto printer_settings_part = xlnt::path("xl/printerSettings/printerSettings1.bin");
+        xlnt_assert_equals(read_part(saved_bytes(printer_settings), printer_settings_part).size(), 5420);
+    }
+
+    void test_keep_source_save_in_place()
+    {
+        temporary_file file;
+        {
+            xlnt::workbook wb;
+            wb.load(save_rows(1000));
+            wb.create_sheet().title("Other");
+            wb.sheet_by_title("Other").cell("B2").value(2);
+            wb.save(file.get_path());
+        }
+
+        xlnt::load_options options;
+        options.keep_source = true;
+        xlnt::workbook wb;
+        wb.load(file.get_path(), options);
+        wb.sheet_by_title("Other").cell("B2").value(3);
+        const auto before = file_bytes(file.get_path());
+        wb.save(file.get_path());
+
+        const auto first_sheet = xlnt::path("xl/worksheets/sheet1.xml");
+        xlnt_assert_equals(stored_part(file_bytes(file.get_path()), first_sheet), stored_part(before, first_sheet));
+
+        xlnt::workbook reloaded;
+        reloaded.load(file.get_path());
+        xlnt_assert_equals(reloaded.sheet_by_title("Other").cell("B2").value<int>(), 3);
+        xlnt_assert_equals(reloaded.sheet_by_index(0).highest_row(), 1000);
+        xlnt_assert(!xlnt::path(file.get_path().string() + ".xlnt-save").exists());
+    }
+
+    void test_keep_source_calculate()
+    {
+        std::vector<std::uint8_t> source;
+        {
+            xlnt::workbook wb;
+            wb.active_sheet().title("Sheet1");
+            wb.active_sheet().cell("A1").value(1);
+            auto other = wb.create_sheet();
+            other.title("Sheet2");
+            other.cell("A1").formula("=Sheet1!A1*2");
+            other.cell("A1").value(2);
+            wb.save(source);
+        }
+
+        xlnt::load_options options;
+        options.keep_source = true;
+        xlnt::workbook wb;
+        wb.load(source, options);
+
+        // Sheet2 only changes through the value calculate stores in it
+        wb.sheet_by_title("Sheet1").cell("A1").value(50);
+        wb.calculate();
+
+        xlnt::workbook reloaded;
+        reloaded.load(saved_bytes(wb));
+        xlnt_assert_equals(reloaded.sheet_by_title("Sheet2").cell("A1").value<int>(), 100);
+
+        // a worksheet found through a const workbook can still be written to
+        const auto &const_wb = wb;
+        xlnt::worksheet through_const = const_wb.sheet_by_title("Sheet2");
+        through_const.cell("B1").value(7);
+
+        reloaded.load(saved_bytes(wb));
+        xlnt_assert_equals(reloaded.sheet_by_title("Sheet2").cell("B1").value<int>(), 7);
+    }
+
+    void test_save_compression()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+
+        for (xlnt::row_t row = 1; row <= 500; ++row)
+        {
+            ws.cell(1, row).value(static_cast<int>(row));
+            ws.cell(2, row).value("text " + std::to_string(row % 7));
+        }
+
+        auto saved_with = [&wb](const xlnt::save_options &options) {
+            std::vector<std::uint8_t> bytes;
+            wb.save(bytes, options);
+
+            return bytes;
+        };
+
+        const auto sheet = xlnt::path("xl/worksheets/sheet1.xml");
+        const auto workbook_part = xlnt::path("xl/workbook.xml");
+
+        xlnt::save_options stored;
+        stored.compression = xlnt::compression_options::stored();
+        const auto stored_bytes = saved_with(stored);
+        xlnt_assert_equals(xlnt::detail::izstream(stored_bytes.data(), stored_bytes.size()).header(sheet).compression_type, 0);
+        xlnt_assert_equals(stored_part(stored_bytes, sheet), read_part(stored_bytes, sheet));
+
+        xlnt::save_options fastest;
+        fastest.compression = xlnt::compression_options::fastest();
+        fastest.compression.buffer_size = 64;
+        xlnt::save_options smallest;
+        smallest.compression = xlnt::compression_options::smallest();
+        smallest.compression.strategy = xlnt::compression_strategy::filtered;
+        const auto fastest_bytes = saved_with(fastest);
+        const auto smallest_bytes = saved_with(smallest);
+        xlnt_assert(smallest_bytes.size() < fastest_bytes.size());
+        xlnt_assert(fastest_bytes.size() < stored_bytes.size());
+
+        for (const auto &bytes : {stored_bytes, fastest_bytes, smallest_bytes})
+        {
+            xlnt_assert_equals(read_part(bytes, sheet), read_part(saved_bytes(wb), sheet));
+
+            xlnt::workbook reloaded;
+            reloaded.load(bytes);
+            xlnt_assert_equals(reloaded.active_sheet().cell("B500").value<std::string>(), "text 3");
+        }
+
+        // only worksheets are stored
+        xlnt::save_options per_part;
+        per_part.part_compression[xlnt::relationship_type::worksheet] = xlnt::compression_options::stored();
+        const auto per_part_bytes = saved_with(per_part);
+        xlnt::detail::izstream per_part_zip(per_part_bytes.data(), per_part_bytes.size());
+        xlnt_assert_equals(per_part_zip.header(sheet).compression_type, 0);
+        xlnt_assert_equals(per_part_zip.header(workbook_part).compression_type, 8);
+
+        xlnt::save_options invalid;
+        invalid.compression.level = 10;
+        xlnt_assert_throws(saved_with(invalid), xlnt::invalid_parameter);
+        invalid.compression.level = 1;
+        invalid.part_compression[xlnt::relationship_type::image].buffer_size = 0;
+        xlnt_assert_throws(saved_with(invalid), xlnt::invalid_parameter);
+    }
+
+    std::vector<std::uint8_t> saved_bytes(const xlnt::workbook &wb)
+    {
+        std::vector<std::uint8_t> bytes;
+        wb.save(bytes);
+
+        return bytes;
+    }
+
+    std::vector<std::uint8_t> stored_archive(const std::vector<std::pair<std::string, std::string>> &files)
+    {
+        std::vector<std::uint8_t> result;
+        auto write = [&result](std::uint32_t value, std::size_t bytes) {
+            for (std::size_t i = 0; i < bytes; ++i)
+            {
+                result.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+            }
+        };
+        auto write_common = [&write](const std::string &name, const std::string &content) {
+            write(20, 2); // version needed
+            write(0, 2); // flags
+            write(0, 2); // stored
+            write(0, 4); // time and date
+            write(0, 4); // crc, which izstream doesn't check
+            write(static_cast<std::uint32_t>(content.size()), 4);
+            write(static_cast<std::uint32_t>(content.size()), 4);
+            write(static_cast<std::uint32_t>(name.size()), 2);
+            write(0, 2); // extra field
+        };
+
+        std::vector<std::uint32_t> offsets;
+
+        for (const auto &file : files)
+        {
+            offsets.push_back(static_cast<std::uint32_t>(result.size()));
+            write(0x04034b50, 4);
+            write_common(file.first, file.second);
+            result.insert(result.end(), file.first.begin(), file.first.end());
+            result.insert(result.end(), file.second.begin(), file.second.end());
+        }
+
+        const auto directory_offset = result.size();
+
+        for (std::size_t i = 0; i < files.size(); ++i)
+        {
+            write(0x02014b50, 4);
+            write(20, 2); // version made by
+            write_common(files[i].first, files[i].second);
+            write(0, 2); // comment
+            write(0, 2); // disk
+            write(0, 2); // internal attributes
+            write(0, 4); // external attributes
+            write(offsets[i], 4);
+            result.insert(result.end(), files[i].first.begin(), files[i].first.end());
+        }
+
+        write(0x06054b50, 4);
+        write(0, 2);
+        write(0, 2);
+        write(static_cast<std::uint32_t>(files.size()), 2);
+        write(static_cast<std::uint32_t>(files.size()), 2);
+        write(static_cast<std::uint32_t>(result.size() - directory_offset), 4);
+        write(static_cast<std::uint32_t>(directory_offset), 4);
+        write(0, 2); // comment
+
+        return result;
+    }
+
+    std::vector<std::uint8_t> file_bytes(const xlnt::path &file)
+    {
+        std::ifstream stream(file.string(), std::ios::binary);
+
+        return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+
+    // Returns part as it is stored in archive, still compressed.
+    std::string stored_part(const std::vector<std::uint8_t> &archive, const xlnt::path &part)
+    {
+        xlnt::detail::izstream zip(archive.data(), archive.size());
+        std::ostringstream stored;
+        zip.read_raw(part, stored);
+
+        return stored.str();
+    }
+
+    std::string read_part(const std::vector<std::uint8_t> &archive, const xlnt::path &part)
+    {
+        xlnt::detail::vector_istreambuf buffer(archive);
+        std::istream stream(&buffer);
+        xlnt::detail::izstream zip(stream);
+
+        return zip.read(part);
+    }
+
+    std::vector<std::uint8_t> edit_part(const std::vector<std::uint8_t> &archive, const xlnt::path &part,
+        const std::function<std::string(std::string)> &edit)
+    {
+        xlnt::detail::vector_istreambuf in_buffer(archive);
+        std::istream in_stream(&in_buffer);
+        xlnt::detail::izstream in(in_stream);
+
+        std::vector<std::uint8_t> result;
+
+        {
+            xlnt::detail::vector_ostreambuf out_buffer(result);
+            std::ostream out_stream(&out_buffer);
+            xlnt::detail::ozstream out(out_stream);
+
+            for (const auto &file : in.files())
+            {
+                auto content = in.read(file);
+
+                if (file == part)
+                {
+                    content = edit(content);
+                }
+
+                auto file_buffer = out.open(file);
+                std::ostream file_stream(file_buffer.get());
+                file_stream << content;
+            }
+        }
+
+        return result;
+    }
+
+    void test_xml_vocabulary()
+    {
+        using xlnt::detail::xml_token;
+
+        for (auto i = 0; i < static_cast<int>(xml_token::unknown); ++i)
+        {
+            const auto t = static_cast<xml_token>(i);
+            xlnt_assert(xlnt::detail::token(xlnt::detail::qn(t)) == t);
+        }
+
+        const auto &c = xlnt::detail::qn(xml_token::spreadsheetml_c);
+        xlnt_assert_equals(c.namespace_(), xlnt::constants::ns("spreadsheetml"));
+        xlnt_assert_equals(c.name(), "c");
+
+        // the same local name in a different namespace is a different token
+        xlnt_assert(xlnt::detail::token(xml::qname(xlnt::constants::ns("x14"), "c")) == xml_token::unknown);
+        xlnt_assert(xlnt::detail::token(xml::qname(xlnt::constants::ns("spreadsheetml"), "notAnElement")) == xml_token::unknown);
+        xlnt_assert(xlnt::detail::token(xml::qname(xlnt::constants::ns("workbook"), "sheets")) == xml_token::spreadsheetml_sheets);
+    }
 };
 static serialization_test_suite x;
@@ -22,9 +22,13 @@
 // @author: see AUTHORS file
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <thread>
 
 #include <xlnt/xlnt.hpp>
+#include <detail/implementations/spill_file.hpp>
 #include <detail/serialization/open_stream.hpp>
 #include <helpers/temporary_file.hpp>
 #include <helpers/test_suite.hpp>
@@ -67,6 +71,20 @@ public:
         register_test(test_id_gen);
         register_test(test_load_file);
         register_test(test_Issue279);
+        register_test(test_copy_sheet_is_independent);
+        register_test(test_copy_outlives_original);
+        register_test(test_shared_string_deduplication);
+        register_test(test_shared_strings_view);
+        register_test(test_shared_string_duplicates_keep_position);
+        register_test(test_memory_usage);
+        register_test(test_memory_usage_of_copies);
+        register_test(test_memory_budget);
+        register_test(test_memory_budget_images);
+        register_test(test_memory_budget_copies_on_threads);
+        register_test(test_spill_file_reuses_space);
+        register_test(test_snapshot);
+        register_test(test_snapshot_of_file);
+        register_test(test_snapshot_rejected);
     }
 
     void test_active_sheet()
@@ -491,5 +509,519 @@ public:
         //save a copy file
         wb.save("temp.xlsx");
     }
+
+    void test_copy_sheet_is_independent()
+    {
+        xlnt::workbook wb;
+        auto original = wb.active_sheet();
+        auto a1 = original.cell("A1");
+        a1.value("original");
+        original.cell("B2").value(2);
+        original.cell("C3").comment(xlnt::comment("note", "author"));
+        auto d4 = original.cell("D4");
+        d4.value(1);
+
+        auto copy = wb.copy_sheet(original);
+
+        // cells obtained before the copy still only refer to original
+        d4.value(5);
+        xlnt_assert_equals(copy.cell("D4").value<int>(), 1);
+        xlnt_assert_equals(original.cell("D4").value<int>(), 5);
+        d4.value(1);
+
+        // and see writes made to original through other cell objects since
+        original.cell("A1").value("again");
+        xlnt_assert_equals(a1.value<std::string>(), "again");
+        xlnt_assert(a1 == original.cell("A1"));
+        xlnt_assert_equals(copy.cell("A1").value<std::string>(), "original");
+        a1.value("original");
+
+        xlnt::workbook wb_copy(wb);
+        a1.value("changed");
+        xlnt_assert_equals(wb_copy.active_sheet().cell("A1").value<std::string>(), "original");
+        a1.value("original");
+
+        // even once the copy they shared a row with is gone
+        auto b2 = original.cell("B2");
+        {
+            xlnt::workbook temporary(wb);
+            original.cell("B2").value(3);
+        }
+        xlnt_assert_equals(b2.value<int>(), 3);
+        b2.value(2);
+
+        xlnt_assert(copy.compare(original, false));
+
+        copy.cell("A1").value("copy");
+        original.cell("B2").value(3);
+
+        xlnt_assert_equals(original.cell("A1").value<std::string>(), "original");
+        xlnt_assert_equals(copy.cell("A1").value<std::string>(), "copy");
+        xlnt_assert_equals(original.cell("B2").value<int>(), 3);
+        xlnt_assert_equals(copy.cell("B2").value<int>(), 2);
+        xlnt_assert_equals(copy.cell("A1").worksheet(), copy);
+        xlnt_assert_equals(copy.cell("C3").comment().plain_text(), "note");
+
+        copy.cell("C3").clear_comment();
+        xlnt_assert(original.cell("C3").has_comment());
+    }
+
+    void test_copy_outlives_original()
+    {
+        auto original = std::unique_ptr<xlnt::workbook>(new xlnt::workbook());
+        original->active_sheet().cell("A1").value("shared");
+        original->active_sheet().cell("A2").value(1.5);
+
+        xlnt::workbook copy(*original);
+        original.reset();
+
+        auto ws = copy.active_sheet();
+        xlnt_assert_equals(ws.cell("A1").value<std::string>(), "shared");
+        xlnt_assert_equals(ws.cell("A1").worksheet(), ws);
+        ws.cell("A2").value(2.5);
+        xlnt_assert_equals(ws.cell("A2").value<double>(), 2.5);
+
+        xlnt::workbook reloaded;
+        std::vector<std::uint8_t> data;
+        copy.save(data);
+        reloaded.load(data);
+        xlnt_assert_equals(reloaded.active_sheet().cell("A1").value<std::string>(), "shared");
+    }
+
+    void test_shared_string_deduplication()
+    {
+        xlnt::workbook wb;
+
+        xlnt::rich_text bold;
+        xlnt::rich_text_run run;
+        run.first = "text";
+        run.second = xlnt::font().bold(true);
+        bold.add_run(run);
+
+        const auto plain_index = wb.add_shared_string(xlnt::rich_text("text"));
+        const auto bold_index = wb.add_shared_string(bold);
+        xlnt_assert_differs(plain_index, bold_index);
+        xlnt_assert_equals(wb.add_shared_string(std::string("text")), plain_index);
+        xlnt_assert_equals(wb.add_shared_string(bold), bold_index);
+
+        for (auto i = 0; i < 10000; ++i)
+        {
+            xlnt_assert_equals(wb.add_shared_string(std::to_string(i)), static_cast<std::size_t>(i + 2));
+        }
+
+        xlnt_assert_equals(wb.add_shared_string(std::string("9999")), std::size_t(10001));
+        xlnt_assert_equals(wb.shared_strings(5000).plain_text(), "4998");
+        xlnt_assert_equals(wb.shared_strings().size(), std::size_t(10002));
+        xlnt_assert_equals(wb.shared_strings_by_id().size(), std::size_t(10002));
+        xlnt_assert_equals(wb.shared_strings().at(bold), bold_index);
+    }
+
+    void test_shared_strings_view()
+    {
+        xlnt::workbook wb;
+        const auto view = wb.shared_strings_view();
+        xlnt_assert(view.empty());
+
+        for (auto i = 0; i < 1000; ++i)
+        {
+            wb.add_shared_string(std::string(50, 'a') + std::to_string(i));
+        }
+
+        xlnt_assert_equals(view.size(), std::size_t(1000));
+        xlnt_assert_equals(view[10].plain_text(), std::string(50, 'a') + "10");
+        xlnt_assert_equals(view.at(999).plain_text(), std::string(50, 'a') + "999");
+        xlnt_assert_throws(view.at(1000), xlnt::invalid_parameter);
+        xlnt_assert_equals(view.find(std::string(50, 'a') + "500"), std::size_t(500));
+        xlnt_assert_equals(view.find(xlnt::rich_text("b")), xlnt::shared_string_view::npos);
+        xlnt_assert_equals(std::distance(view.begin(), view.end()), std::ptrdiff_t(1000));
+
+        // The view refers to the table, so using it doesn't copy any strings
+        const auto before = wb.memory_usage().shared_strings;
+        std::size_t length = 0;
+
+        for (const auto &text : wb.shared_strings_view())
+        {
+            length += text.plain_text().size();
+        }
+
+        xlnt_assert(length > 50 * 1000);
+        xlnt_assert_equals(wb.memory_usage().shared_strings, before);
+
+        // The old accessors still hand out a modifiable map, built on request
+        std::unordered_map<xlnt::rich_text, std::size_t, xlnt::rich_text_hash> &ids = wb.shared_strings();
+        xlnt_assert_equals(ids.size(), std::size_t(1000));
+        xlnt_assert(wb.memory_usage().shared_strings > before + 50 * 1000);
+        ids.clear();
+        xlnt_assert_equals(view.size(), std::size_t(1000));
+    }
+
+    void test_shared_string_duplicates_keep_position()
+    {
+        xlnt::workbook wb;
+        xlnt_assert_equals(wb.add_shared_string(xlnt::rich_text("a")), std::size_t(0));
+        xlnt_assert_equals(wb.add_shared_string(xlnt::rich_text("a"), true), std::size_t(1));
+        xlnt_assert_equals(wb.add_shared_string(xlnt::rich_text("b")), std::size_t(2));
+        xlnt_assert_equals(wb.add_shared_string(xlnt::rich_text("a")), std::size_t(0));
+        xlnt_assert_equals(wb.shared_strings(2).plain_text(), "b");
+
+        wb.active_sheet().cell("A1").value("b");
+        wb.active_sheet().cell("A2").value("a");
+
+        std::vector<std::uint8_t> data;
+        wb.save(data);
+        xlnt::workbook reloaded;
+        reloaded.load(data);
+        xlnt_assert_equals(reloaded.active_sheet().cell("A1").value<std::string>(), "b");
+        xlnt_assert_equals(reloaded.active_sheet().cell("A2").value<std::string>(), "a");
+    }
+
+    void test_memory_usage()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+        const auto empty = wb.memory_usage();
+
+        xlnt_assert_equals(empty.worksheets.size(), 1);
+        xlnt_assert_equals(empty.worksheets.front().title, ws.title());
+        xlnt_assert_equals(empty.worksheets.front().cells, 0);
+
+        for (xlnt::row_t row = 1; row <= 1000; ++row)
+        {
+            ws.cell(1, row).value(static_cast<int>(row));
+            ws.cell(2, row).value("a string long enough not to fit in a small string buffer " + std::to_string(row));
+            ws.cell(3, row).formula("=A" + std::to_string(row) + "*2+SUM(A1:A1000)/1000");
+        }
+
+        ws.cell("D1").comment(xlnt::comment("a comment long enough not to fit in a small string buffer", "author"));
+
+        auto second = wb.create_sheet();
+        second.cell("A1").value(1);
+
+        const auto usage = wb.memory_usage();
+        const auto &sheet = usage.worksheets.front();
+
+        xlnt_assert_equals(usage.worksheets.size(), 2);
+        xlnt_assert_equals(sheet.cells, 3001);
+        xlnt_assert(sheet.cell_storage > 3000 * sizeof(double));
+        xlnt_assert(sheet.formulas > 1000 * 20);
+        xlnt_assert(sheet.comments > 50);
+        xlnt_assert(usage.shared_strings > 1000 * 60);
+        xlnt_assert(usage.stylesheet > 0);
+        xlnt_assert_equals(usage.calculation, 0);
+        xlnt_assert(usage.worksheets.back().cell_storage < sheet.cell_storage / 100);
+        xlnt_assert_equals(usage.total(), usage.shared_strings + usage.stylesheet + usage.images
+            + usage.calculation + usage.other + sheet.total() + usage.worksheets.back().total());
+        xlnt_assert_equals(ws.memory_usage().cell_storage, sheet.cell_storage);
+
+        wb.calculate();
+        xlnt_assert(wb.memory_usage().calculation > 1000 * 30);
+    }
+
+    void test_memory_usage_of_copies()
+    {
+        xlnt::workbook built;
+
+        for (xlnt::row_t row = 1; row <= 1000; ++row)
+        {
+            built.active_sheet().cell(1, row).value(static_cast<int>(row));
+        }
+
+        // cells handed out from every row of built don't keep a copy from sharing them
+        const auto built_alone = built.active_sheet().memory_usage().cell_storage;
+        xlnt::workbook built_copy = built;
+        xlnt_assert(built.active_sheet().memory_usage().cell_storage < built_alone * 6 / 10);
+
+        std::vector<std::uint8_t> data;
+        built.save(data);
+        xlnt::workbook wb;
+        wb.load(data);
+        auto ws = wb.active_sheet();
+        const auto alone = ws.memory_usage().cell_storage;
+
+        // rows are shared until written, so each copy accounts for half of them
+        xlnt::workbook copy = wb;
+        const auto shared = ws.memory_usage().cell_storage;
+        xlnt_assert(shared < alone * 6 / 10);
+        xlnt_assert_equals(copy.active_sheet().memory_usage().cell_storage, shared);
+
+        for (xlnt::row_t row = 1; row <= 1000; ++row)
+        {
+            copy.active_sheet().cell(1, row).value(0);
+        }
+
+        xlnt_assert(ws.memory_usage().cell_storage > alone * 9 / 10);
+    }
+
+    void test_memory_budget()
+    {
+        auto fill = [](xlnt::workbook &wb) {
+            auto ws = wb.active_sheet();
+            auto bold = wb.create_format().font(xlnt::font().bold(true));
+
+            for (xlnt::row_t row = 1; row <= 10000; ++row)
+            {
+                ws.cell(1, row).value(static_cast<int>(row));
+                ws.cell(2, row).value("a string long enough not to fit in a small string buffer " + std::to_string(row));
+                ws.cell(3, row).formula("=A" + std::to_string(row) + "*2");
+
+                if (row % 100 == 0)
+                {
+                    ws.cell(1, row).format(bold);
+                }
+            }
+
+            ws.cell("D5").value("noted");
+            ws.cell("D5").comment(xlnt::comment("kept in memory with its row", "author"));
+        };
+
+        xlnt::workbook unbounded;
+        fill(unbounded);
+
+        xlnt::workbook wb;
+        wb.memory_budget(128 * 1024, xlnt::path("."));
+        xlnt_assert_equals(wb.memory_budget(), 128 * 1024);
+        fill(wb);
+
+        auto ws = wb.active_sheet();
+        auto usage = ws.memory_usage();
+        xlnt_assert_equals(usage.cells, 30001);
+        xlnt_assert(usage.spilled > 0);
+        xlnt_assert(usage.cell_storage < unbounded.active_sheet().memory_usage().cell_storage / 4);
+
+        xlnt_assert_equals(ws.highest_row(), 10000);
+        xlnt_assert_equals(ws.highest_column().index, 4);
+        xlnt_assert_equals(ws.cell("A7").value<int>(), 7);
+        xlnt_assert_equals(ws.cell("B2345").value<std::string>(),
+            "a string long enough not to fit in a small string buffer 2345");
+        xlnt_assert_equals(ws.cell("C999").formula(), "A999*2");
+        xlnt_assert(ws.cell("A300").font().bold());
+        xlnt_assert(!ws.cell("A301").has_format());
+        xlnt_assert_equals(ws.cell("D5").comment().plain_text(), "kept in memory with its row");
+
+        std::vector<std::uint8_t> expected, saved;
+        unbounded.save(expected);
+        wb.save(saved);
+        xlnt_assert(saved == expected);
+
+        // the budget applies while loading too
+        wb.load(saved);
+        ws = wb.active_sheet();
+        xlnt_assert_equals(wb.memory_budget(), 128 * 1024);
+        xlnt_assert(ws.memory_usage().spilled > 0);
+        xlnt_assert_equals(ws.cell("B2345").value<std::string>(),
+            "a string long enough not to fit in a small string buffer 2345");
+
+        wb.memory_budget(0, xlnt::path("."));
+        xlnt_assert_equals(wb.memory_budget(), 0);
+        xlnt_assert_equals(ws.memory_usage().spilled, 0);
+        xlnt_assert(ws.memory_usage().cell_storage > unbounded.active_sheet().memory_usage().cell_storage * 3 / 4);
+    }
+
+    void test_memory_budget_copies_on_threads()
+    {
+        xlnt::workbook wb;
+        wb.memory_budget(64 * 1024, xlnt::path("."));
+        auto ws = wb.active_sheet();
+
+        for (xlnt::row_t row = 1; row <= 20000; ++row)
+        {
+            for (xlnt::column_t::index_t column = 1; column <= 5; ++column)
+            {
+                ws.cell(column, row).value(static_cast<int>(row % 100 + column));
+            }
+        }
+
+        xlnt_assert(ws.memory_usage().spilled > 0);
+
+        const xlnt::workbook a(wb), b(wb);
+        auto sum = [](const xlnt::workbook &copy, long long &total) {
+            const auto sheet = copy.sheet_by_index(0);
+
+            for (xlnt::row_t row = 1; row <= 20000; ++row)
+            {
+                for (xlnt::column_t::index_t column = 1; column <= 5; ++column)
+                {
+                    total += sheet.cell(column, row).value<int>();
+                }
+            }
+        };
+
+        auto expected = 0LL, total_a = 0LL, total_b = 0LL;
+        sum(wb, expected);
+
+        std::thread first(sum, std::cref(a), std::ref(total_a));
+        std::thread second(sum, std::cref(b), std::ref(total_b));
+        first.join();
+        second.join();
+
+        xlnt_assert_equals(total_a, expected);
+        xlnt_assert_equals(total_b, expected);
+    }
+
+    void test_spill_file_reuses_space()
+    {
+        xlnt::detail::spill_file file(xlnt::path("."), 0);
+
+        const auto first = file.write(std::vector<std::uint8_t>(100, 1));
+        const auto second = file.write(std::vector<std::uint8_t>(100, 2));
+        xlnt_assert_equals(second.offset, 100);
+
+        // a record shared by two owners stays until both release it
+        file.retain(first);
+        file.release(first);
+        xlnt_assert_equals(file.write(std::vector<std::uint8_t>(50, 3)).offset, 200);
+
+        file.release(first);
+        const auto reused = file.write(std::vector<std::uint8_t>(60, 4));
+        xlnt_assert_equals(reused.offset, 0);
+        xlnt_assert_equals(file.size(), 210);
+
+        // the rest of the freed space and the space after it are merged
+        file.release(second);
+        xlnt_assert_equals(file.write(std::vector<std::uint8_t>(140, 5)).offset, 60);
+
+        std::vector<std::uint8_t> bytes;
+        file.read(reused, bytes);
+        xlnt_assert(bytes == std::vector<std::uint8_t>(60, 4));
+    }
+
+    void test_memory_budget_images()
+    {
+        const std::vector<std::uint8_t> image(100000, 42);
+
+        xlnt::workbook wb;
+        wb.thumbnail(image, "jpeg", "image/jpeg");
+        const auto in_memory = wb.memory_usage().images;
+
+        wb.memory_budget(1024 * 1024, xlnt::path("."));
+        xlnt_assert(wb.memory_usage().images < in_memory - image.size() + 1000);
+        xlnt_assert_equals(wb.memory_usage().spilled, image.size());
+        xlnt_assert(wb.thumbnail() == image);
+
+        std::vector<std::uint8_t> saved;
+        wb.save(saved);
+
+        xlnt::workbook loaded;
+        loaded.load(saved);
+        xlnt_assert(loaded.thumbnail() == image);
+    }
+
+    void test_snapshot()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+        ws.title("Data");
+        auto italic = wb.create_format().font(xlnt::font().italic(true).color(xlnt::theme_color(3)));
+
+        for (xlnt::row_t row = 1; row <= 1000; ++row)
+        {
+            ws.cell(1, row).value(row * 0.5);
+            ws.cell(2, row).value("text " + std::to_string(row % 10));
+            ws.cell(3, row).formula("=A" + std::to_string(row) + "+1");
+        }
+
+        ws.cell("A10").format(italic);
+        xlnt::rich_text rich;
+        rich.add_run(xlnt::rich_text_run{"bold", xlnt::font().bold(true).size(14), false});
+        rich.add_run(xlnt::rich_text_run{" plain", xlnt::optional<xlnt::font>(), true});
+        ws.cell("D1").value(rich);
+        ws.cell("D2").hyperlink("https://example.com/", "example");
+        ws.cell("D3").comment(xlnt::comment("on an empty cell", "author"));
+        ws.cell("D4").value(true);
+        wb.create_sheet().cell("A1").value(42);
+
+        std::vector<std::uint8_t> snapshot;
+        wb.save_snapshot(snapshot);
+
+        xlnt::workbook restored;
+        restored.load_snapshot(snapshot);
+        xlnt_assert_equals(restored.sheet_count(), 2);
+        auto restored_ws = restored.sheet_by_title("Data");
+
+        xlnt_assert_equals(restored_ws.cell("A999").value<double>(), 499.5);
+        xlnt_assert_equals(restored_ws.cell("B7").value<std::string>(), "text 7");
+        xlnt_assert_equals(restored_ws.cell("C20").formula(), "A20+1");
+        xlnt_assert(restored_ws.cell("A10").font().italic());
+        xlnt_assert(restored_ws.cell("A10").font().color() == xlnt::theme_color(3));
+        xlnt_assert(!restored_ws.cell("A11").has_format());
+        xlnt_assert(restored_ws.cell("D1").value<xlnt::rich_text>() == rich);
+        xlnt_assert_equals(restored_ws.cell("D2").hyperlink().url(), "https://example.com/");
+        xlnt_assert_equals(restored_ws.cell("D2").value<std::string>(), "example");
+        xlnt_assert_equals(restored_ws.cell("D3").comment().plain_text(), "on an empty cell");
+        xlnt_assert(restored_ws.cell("D4").value<bool>());
+        xlnt_assert_equals(restored.sheet_by_index(1).cell("A1").value<int>(), 42);
+        xlnt_assert_equals(restored.shared_strings().size(), wb.shared_strings().size());
+    }
+
+    void test_snapshot_of_file()
+    {
+        for (const auto name : {"10_comments_hyperlinks_formulae.xlsx", "4_every_style.xlsx", "9_unicode_Λ.xlsx"})
+        {
+            xlnt::workbook wb(path_helper::test_file(name));
+
+            temporary_file file;
+            wb.save_snapshot(file.get_path());
+
+            xlnt::workbook restored;
+            restored.load_snapshot(file.get_path());
+
+            // the parts in the package are ordered as they were read, so compare
+            // with the workbook saved and loaded again rather than with wb itself
+            std::vector<std::uint8_t> expected, saved;
+            wb.save(expected);
+            xlnt::workbook reloaded;
+            reloaded.load(expected);
+            expected.clear();
+            reloaded.save(expected);
+
+            restored.save(saved);
+            xlnt_assert(saved == expected);
+        }
+    }
+
+    void test_snapshot_rejected()
+    {
+        xlnt::workbook wb;
+        wb.active_sheet().cell("A1").value("kept");
+        std::vector<std::uint8_t> snapshot;
+        wb.save_snapshot(snapshot);
+
+        xlnt::workbook target;
+
+        std::vector<std::uint8_t> xlsx;
+        wb.save(xlsx);
+        xlnt_assert_throws(target.load_snapshot(xlsx), xlnt::invalid_file);
+
+        auto truncated = snapshot;
+        truncated.resize(truncated.size() - 1);
+        xlnt_assert_throws(target.load_snapshot(truncated), xlnt::invalid_file);
+
+        auto newer = snapshot;
+        ++newer[8];
+        xlnt_assert_throws(target.load_snapshot(newer), xlnt::unsupported);
+
+        // A1 is the last cell: its column, type, shared formula, number and flags are
+        // followed by an empty run count since its text is in the shared strings
+        const auto type_at = snapshot.size() - 18;
+        xlnt_assert_equals(snapshot[type_at], static_cast<std::uint8_t>(xlnt::cell_type::shared_string));
+
+        auto bad_type = snapshot;
+        bad_type[type_at] = 200;
+        xlnt_assert_throws(target.load_snapshot(bad_type), xlnt::invalid_file);
+
+        auto bad_group = snapshot;
+        bad_group[type_at + 1] = 1;
+        xlnt_assert_throws(target.load_snapshot(bad_group), xlnt::invalid_file);
+
+        auto bad_string = snapshot;
+        const auto index = 1.0;
+        std::memcpy(&bad_string[type_at + 5], &index, sizeof(index));
+        xlnt_assert_throws(target.load_snapshot(bad_string), xlnt::invalid_file);
+
+        // a failed load leaves the workbook as it was
+        xlnt_assert_equals(target.active_sheet().title(), "Sheet1");
+        target.load_snapshot(snapshot);
+        xlnt_assert_equals(target.active_sheet().cell("A1").value<std::string>(), "kept");
+    }
 };
 static workbook_test_suite x;
\ No newline at end of file
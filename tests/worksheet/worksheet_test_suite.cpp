@@ -22,9 +22,13 @@
 // @author: see AUTHORS file
 
 #include <iostream>
+#include <limits>
+#include <sstream>
 
 #include <xlnt/cell/cell.hpp>
+#include <xlnt/cell/comment.hpp>
 #include <xlnt/cell/hyperlink.hpp>
+#include <xlnt/workbook/memory_usage.hpp>
 #include <xlnt/workbook/workbook.hpp>
 #include <xlnt/worksheet/column_properties.hpp>
 #include <xlnt/worksheet/row_properties.hpp>
@@ -65,6 +69,11 @@ public:
         register_test(test_merge_range_string);
         register_test(test_unmerge_bad);
         register_test(test_unmerge_range_string);
+        register_test(test_merge_does_not_create_cells);
+        register_test(test_unmerge_many_in_one_row);
+        register_test(test_insert_delete_rows);
+        register_test(test_insert_delete_columns);
+        register_test(test_insert_delete_references);
         register_test(test_print_titles_old);
         register_test(test_print_titles_new);
         register_test(test_print_area);
@@ -105,6 +114,10 @@ public:
         register_test(test_clear_cell);
         register_test(test_clear_row);
         register_test(test_set_title);
+        register_test(test_save_csv);
+        register_test(test_save_csv_quoting);
+        register_test(test_save_csv_parallel);
+        register_test(test_save_csv_memory_budget);
     }
 
     void test_new_worksheet()
@@ -405,6 +418,211 @@ public:
         xlnt_assert_equals(ws.merged_ranges().size(), 0);
     }
 
+    void test_merge_does_not_create_cells()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+        ws.cell("B2").value("kept");
+        ws.cell("C2").value("cleared");
+
+        ws.merge_cells("B2:XFD2");
+
+        for (xlnt::row_t row = 10; row < 1000; row += 3)
+        {
+            ws.merge_cells(xlnt::range_reference(xlnt::cell_reference(1, row), xlnt::cell_reference(2, row + 1)));
+        }
+
+        xlnt_assert(!ws.has_cell("D2"));
+        xlnt_assert(!ws.has_cell("A10"));
+        xlnt_assert_equals(ws.cell("B2").value<std::string>(), "kept");
+        xlnt_assert_equals(ws.cell("C2").value<std::string>(), "");
+
+        xlnt_assert(ws.cell("XFD2").is_merged());
+        xlnt_assert(!ws.cell("A2").is_merged());
+        xlnt_assert(ws.cell("B500").is_merged());
+        xlnt_assert(!ws.cell("A504").is_merged());
+        xlnt_assert(!ws.cell("C500").is_merged());
+
+        ws.unmerge_cells("A499:B500");
+        xlnt_assert(!ws.cell("B500").is_merged());
+        xlnt_assert(ws.cell("B503").is_merged());
+        xlnt_assert_equals(ws.merged_ranges().front(), xlnt::range_reference("B2:XFD2"));
+
+        // a single cell isn't a merged range
+        ws.cell("A1").merged(true);
+        xlnt_assert(!ws.cell("A1").is_merged());
+        ws.cell("C2").merged(false);
+        xlnt_assert(!ws.cell("XFD2").is_merged());
+
+        // rows without values in the range stay shared with copies
+        auto original = wb.create_sheet();
+
+        for (xlnt::row_t row = 1; row <= 1000; ++row)
+        {
+            original.cell(xlnt::cell_reference(1, row)).value(row);
+        }
+
+        const auto alone = original.memory_usage().cell_storage;
+        auto copy = wb.copy_sheet(original);
+        copy.merge_cells("B1:C1000");
+        xlnt_assert(copy.memory_usage().cell_storage < alone * 3 / 4);
+    }
+
+    void test_unmerge_many_in_one_row()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+
+        for (xlnt::column_t::index_t column = 1; column < 10000; column += 2)
+        {
+            ws.merge_cells(xlnt::range_reference(xlnt::cell_reference(column, 1), xlnt::cell_reference(column + 1, 1)));
+        }
+
+        xlnt_assert(ws.cell(xlnt::cell_reference(9000, 1)).is_merged());
+        xlnt_assert(!ws.cell(xlnt::cell_reference(9000, 2)).is_merged());
+        xlnt_assert(!ws.cell(xlnt::cell_reference(10001, 1)).is_merged());
+
+        for (xlnt::column_t::index_t column = 1; column < 10000; column += 4)
+        {
+            ws.unmerge_cells(xlnt::range_reference(xlnt::cell_reference(column, 1), xlnt::cell_reference(column + 1, 1)));
+            xlnt_assert(!ws.cell(xlnt::cell_reference(column + 1, 1)).is_merged());
+            xlnt_assert(ws.cell(xlnt::cell_reference(column + 2, 1)).is_merged());
+        }
+
+        const auto remaining = ws.merged_ranges();
+        xlnt_assert_equals(remaining.size(), 2500);
+        xlnt_assert_equals(remaining.front(), xlnt::range_reference("C1:D1"));
+        xlnt_assert_equals(remaining.back(), xlnt::range_reference(xlnt::cell_reference(9999, 1), xlnt::cell_reference(10000, 1)));
+
+        for (const auto &range : remaining)
+        {
+            ws.unmerge_cells(range);
+        }
+
+        xlnt_assert(ws.merged_ranges().empty());
+        xlnt_assert(!ws.cell("D1").is_merged());
+    }
+
+    void test_insert_delete_rows()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+        ws.cell("A1").value("top");
+        ws.cell("A3").value("moved");
+        ws.cell("B4").value("commented");
+        ws.cell("B4").comment(xlnt::comment("note", "author"));
+        ws.row_properties(3).height = 30;
+        ws.merge_cells("D2:E5");
+        ws.auto_filter("A3:C10");
+        ws.print_area("A1:C10");
+
+        ws.insert_rows(3, 2);
+
+        xlnt_assert_equals(ws.cell("A1").value<std::string>(), "top");
+        xlnt_assert(!ws.has_cell("A3"));
+        xlnt_assert_equals(ws.cell("A5").value<std::string>(), "moved");
+        xlnt_assert_equals(ws.cell("A5").reference(), "A5");
+        xlnt_assert(ws.cell("B6").has_comment());
+        xlnt_assert_equals(ws.cell("B6").comment().plain_text(), "note");
+        xlnt_assert(ws.has_row_properties(5));
+        xlnt_assert(!ws.has_row_properties(3));
+        xlnt_assert_equals(ws.merged_ranges().front(), xlnt::range_reference("D2:E7"));
+        xlnt_assert_equals(ws.auto_filter(), xlnt::range_reference("A5:C12"));
+        xlnt_assert_equals(ws.print_area(), xlnt::range_reference("$A$1:$C$12"));
+
+        ws.delete_rows(2, 4);
+
+        xlnt_assert_equals(ws.cell("A1").value<std::string>(), "top");
+        xlnt_assert(!ws.has_cell("A5"));
+        xlnt_assert(ws.cell("B2").has_comment());
+        xlnt_assert_equals(ws.merged_ranges().front(), xlnt::range_reference("D2:E3"));
+        xlnt_assert_equals(ws.auto_filter(), xlnt::range_reference("A2:C8"));
+
+        ws.cell("A5").value("last");
+        xlnt_assert_throws(ws.insert_rows(2, 2000000), xlnt::invalid_parameter);
+        xlnt_assert_throws(ws.insert_rows(2, 1048576u - 4), xlnt::invalid_parameter);
+        xlnt_assert_equals(ws.cell("A5").value<std::string>(), "last");
+        ws.insert_rows(2, 1048576u - 5);
+        xlnt_assert_equals(ws.cell(xlnt::cell_reference("A", 1048576u)).value<std::string>(), "last");
+        ws.delete_rows(2, 1048576u - 5);
+        xlnt_assert_equals(ws.cell("A5").value<std::string>(), "last");
+
+        std::vector<std::uint8_t> data;
+        wb.save(data);
+        xlnt::workbook reloaded;
+        reloaded.load(data);
+        xlnt_assert_equals(reloaded.active_sheet().cell("B2").comment().plain_text(), "note");
+    }
+
+    void test_insert_delete_columns()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+        ws.cell("A1").value(1);
+        ws.cell("C1").value(3);
+        ws.cell("D2").value(4);
+        ws.column_properties("C").width = 20.0;
+        ws.merge_cells("B3:D3");
+
+        ws.insert_columns("B");
+
+        xlnt_assert_equals(ws.cell("A1").value<int>(), 1);
+        xlnt_assert_equals(ws.cell("D1").value<int>(), 3);
+        xlnt_assert_equals(ws.cell("E2").value<int>(), 4);
+        xlnt_assert(ws.has_column_properties("D"));
+        xlnt_assert_equals(ws.merged_ranges().front(), xlnt::range_reference("C3:E3"));
+
+        ws.delete_columns("A", 3);
+
+        xlnt_assert_equals(ws.cell("A1").value<int>(), 3);
+        xlnt_assert_equals(ws.cell("B2").value<int>(), 4);
+        xlnt_assert(!ws.has_cell("D1"));
+        xlnt_assert_equals(ws.merged_ranges().front(), xlnt::range_reference("A3:B3"));
+
+        ws.delete_columns("A");
+        xlnt_assert(ws.merged_ranges().empty());
+        xlnt_assert_throws(ws.insert_columns("A", std::numeric_limits<xlnt::column_t::index_t>::max()), xlnt::invalid_parameter);
+        xlnt_assert_throws(ws.insert_columns("A", 16384u), xlnt::invalid_parameter);
+        ws.insert_columns("A", 16383u);
+        xlnt_assert_equals(ws.cell("XFD2").value<int>(), 4);
+        ws.delete_columns("A", 16383u);
+        xlnt_assert_equals(ws.cell("A2").value<int>(), 4);
+    }
+
+    void test_insert_delete_references()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+        ws.cell("A1").formula("=SUM(B2:B4)*$C$3+C5");
+        ws.cell("A6").formula("=A1+B$3");
+        ws.create_named_range("totals", "$B$2:$B$4");
+        ws.create_named_range("gone", "B3");
+        auto other = wb.create_sheet();
+        other.title("Other Sheet");
+        other.cell("A1").formula("='Sheet1'!B3+SHEET1!C$5+B3");
+
+        ws.insert_rows(3, 2);
+
+        xlnt_assert_equals(ws.cell("A1").formula(), "SUM(B2:B6)*$C$5+C7");
+        xlnt_assert_equals(ws.cell("A8").formula(), "A1+B$5");
+        xlnt_assert_equals(other.cell("A1").formula(), "'Sheet1'!B5+SHEET1!C$7+B3");
+        xlnt_assert_equals(ws.named_range("totals").reference(), xlnt::range_reference("$B$2:$B$6"));
+
+        ws.delete_rows(4, 2);
+
+        xlnt_assert_equals(ws.cell("A1").formula(), "SUM(B2:B4)*#REF!+C5");
+        xlnt_assert_equals(other.cell("A1").formula(), "'Sheet1'!#REF!+SHEET1!C$5+B3");
+        xlnt_assert(!ws.has_named_range("gone"));
+        xlnt_assert_equals(ws.named_range("totals").reference(), xlnt::range_reference("$B$2:$B$4"));
+
+        ws.insert_columns("B");
+        xlnt_assert_equals(ws.cell("A1").formula(), "SUM(C2:C4)*#REF!+D5");
+
+        ws.delete_columns("C");
+        xlnt_assert_equals(ws.cell("A1").formula(), "SUM(#REF!)*#REF!+C5");
+        xlnt_assert(!ws.has_named_range("totals"));
+    }
+
     void test_print_titles_old()
     {
         xlnt::workbook wb;
@@ -1254,5 +1472,125 @@ public:
         xlnt_assert(ws1_title == ws1.title());
         xlnt_assert(ws2_title == ws2.title());
     }
+
+    void test_save_csv()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+        ws.cell("A1").value("name");
+        ws.cell("B1").value("amount");
+        ws.cell("A2").value("first");
+        ws.cell("B2").value(1.5);
+        ws.cell("B2").number_format(xlnt::number_format::number_00());
+        ws.cell("C3").value(true);
+
+        std::ostringstream csv;
+        ws.save_csv(csv);
+        xlnt_assert_equals(csv.str(), "name,amount,\r\nfirst,1.50,\r\n,,TRUE\r\n");
+
+        std::ostringstream raw;
+        auto options = xlnt::csv_options::tsv();
+        options.formatted = false;
+        ws.range("A2:B2").save_csv(raw, options);
+        xlnt_assert_equals(raw.str(), "first\t1.5\n");
+    }
+
+    void test_save_csv_quoting()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+        ws.cell("A1").value("a,b");
+        ws.cell("B1").value("say \"hi\"");
+        ws.cell("C1").value(2);
+
+        std::ostringstream minimal;
+        ws.save_csv(minimal);
+        xlnt_assert_equals(minimal.str(), "\"a,b\",\"say \"\"hi\"\"\",2\r\n");
+
+        auto options = xlnt::csv_options::csv();
+        options.quoting = xlnt::csv_quoting::non_numeric;
+        std::ostringstream non_numeric;
+        ws.save_csv(non_numeric, options);
+        xlnt_assert_equals(non_numeric.str(), "\"a,b\",\"say \"\"hi\"\"\",2\r\n");
+
+        options.quoting = xlnt::csv_quoting::all;
+        std::ostringstream all;
+        ws.range("C1:C1").save_csv(all, options);
+        xlnt_assert_equals(all.str(), "\"2\"\r\n");
+
+        // a missing cell is quoted the same as an existing empty one
+        ws.cell("B2").value(nullptr);
+        std::ostringstream empty;
+        ws.range("A2:C2").save_csv(empty, options);
+        xlnt_assert_equals(empty.str(), "\"\",\"\",\"\"\r\n");
+
+        // unquoted fields escape what would split them
+        ws.cell("A3").value("tab\there");
+        ws.cell("B3").value("line\r\nbreak");
+        ws.cell("C3").value("back\\slash");
+        std::ostringstream tsv;
+        ws.range("A3:C3").save_csv(tsv, xlnt::csv_options::tsv());
+        xlnt_assert_equals(tsv.str(), "tab\\there\tline\\r\\nbreak\tback\\\\slash\n");
+
+        options.quoting = xlnt::csv_quoting::none;
+        std::ostringstream none;
+        ws.range("A1:C1").save_csv(none, options);
+        xlnt_assert_equals(none.str(), "a\\,b,say \"hi\",2\r\n");
+    }
+
+    void test_save_csv_parallel()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+
+        for (xlnt::row_t row = 1; row <= 100; ++row)
+        {
+            ws.cell(xlnt::cell_reference(1, row)).value(static_cast<int>(row));
+            ws.cell(xlnt::cell_reference(2, row)).value("row" + std::to_string(row));
+        }
+
+        std::ostringstream serial;
+        ws.save_csv(serial);
+
+        auto options = xlnt::csv_options::csv();
+        options.threads = 4;
+        options.rows_per_block = 7;
+        std::ostringstream parallel;
+        ws.save_csv(parallel, options);
+
+        xlnt_assert_equals(serial.str(), parallel.str());
+    }
+
+    void test_save_csv_memory_budget()
+    {
+        xlnt::workbook wb;
+        auto ws = wb.active_sheet();
+
+        for (xlnt::row_t row = 1; row <= 2000; ++row)
+        {
+            ws.cell(xlnt::cell_reference(1, row)).value(static_cast<int>(row));
+            ws.cell(xlnt::cell_reference(2, row)).value("row" + std::to_string(row));
+        }
+
+        std::ostringstream expected;
+        ws.save_csv(expected);
+
+        // reading rows pages them in and others out, so the threads option is ignored
+        wb.memory_budget(1, xlnt::path("."));
+        auto options = xlnt::csv_options::csv();
+        options.threads = 4;
+        options.rows_per_block = 7;
+
+        std::ostringstream budgeted;
+        ws.save_csv(budgeted, options);
+        xlnt_assert_equals(budgeted.str(), expected.str());
+
+        std::ostringstream range;
+        ws.range("A1:B2000").save_csv(range, options);
+        xlnt_assert_equals(range.str(), expected.str());
+        xlnt_assert(ws.memory_usage().spilled > 0);
+
+        wb.memory_budget(0, xlnt::path("."));
+    }
 };
 static worksheet_test_suite x;
\ No newline at end of file